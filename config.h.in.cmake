@@ -100,6 +100,8 @@
 
 #cmakedefine HAVE_MKOSTEMPS
 
+#cmakedefine HAVE_MEMFD_CREATE
+
 #cmakedefine HAVE_MKSTEMPS
 
 #cmakedefine HAVE_MKDTEMP
@@ -0,0 +1,266 @@
+/* Benchmark for measuring the latency of clBuildProgram
+
+   Copyright (c) 2026 pocl developers
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include "pocl_opencl.h"
+
+#define CL_HPP_ENABLE_EXCEPTIONS
+
+#include <CL/opencl.hpp>
+
+#include "common.hh"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+struct {
+  int platform_index = -1;
+  int device_index = -1;
+  int sample_count = 20;
+  const char *build_options = "";
+} options;
+
+void print_help(const char *name) {
+  std::cerr << "Usage: " << name << " [-p platform_index] [-d device_index] "
+            << "[-s sample_count] [-o build_options]" << std::endl
+            << "-p specifies which platform to use. (default:"
+            << options.platform_index << ")" << std::endl
+            << "-d specifies which device to use. (default:"
+            << options.device_index << ")" << std::endl
+            << "-s sets the number of samples measured. (default: "
+            << options.sample_count << ")" << std::endl
+            << "-o sets the build options. (default: \""
+            << options.build_options << "\")" << std::endl;
+}
+
+bool parse_args(char **argv) {
+  const char *name = *argv++;
+  while (*argv) {
+    const char *arg = *argv;
+    if (arg[0] == '-') {
+      if (arg[1] == '-') {
+        if (!strcmp(arg + 2, "help"))
+          goto fail;
+        else {
+          std::cerr << "Unknown long flag " << arg + 2 << std::endl;
+          goto fail;
+        }
+      } else if (arg[1] == 'p' && arg[2] == 0) {
+        argv++;
+        if (!*argv) {
+          std::cerr << "Missing platform index" << std::endl;
+          goto fail;
+        }
+        options.platform_index = std::stoi(*argv, nullptr);
+      } else if (arg[1] == 'd' && arg[2] == 0) {
+        argv++;
+        if (!*argv) {
+          std::cerr << "Missing device index" << std::endl;
+          goto fail;
+        }
+        options.device_index = std::stoi(*argv);
+      } else if (arg[1] == 's' && arg[2] == 0) {
+        argv++;
+        if (!*argv) {
+          std::cerr << "Missing sample count" << std::endl;
+          goto fail;
+        }
+        options.sample_count = std::stoi(*argv);
+      } else if (arg[1] == 'o' && arg[2] == 0) {
+        argv++;
+        if (!*argv) {
+          std::cerr << "Missing build options" << std::endl;
+          goto fail;
+        }
+        options.build_options = *argv;
+      } else {
+        std::cerr << "Unknown flag " << arg + 1 << std::endl;
+        goto fail;
+      }
+    }
+    argv++;
+  }
+  if (options.device_index >= 0 && options.platform_index < 0)
+    options.platform_index = 0;
+  return true;
+fail:
+  print_help(name);
+  return false;
+}
+
+/* Every sample gets a distinct source, so that it's compiled instead of
+ * being found in the kernel cache. */
+static std::string make_source(unsigned long long seed, int i) {
+  return "__kernel void saxpy_" + std::to_string(i) +
+         "(float a, __global const float *x, __global float *y) {\n"
+         "  size_t i = get_global_id(0);\n"
+         "  y[i] = mad(a, x[i], y[i]) + " +
+         std::to_string(seed % 1000003) + ".0f;\n"
+         "}\n";
+}
+
+/* The peak resident set size of the process in KiB, 0 if not known. */
+static long peak_rss_kib() {
+#ifndef _WIN32
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0)
+    return usage.ru_maxrss;
+#endif
+  return 0;
+}
+
+static bool time_build(cl::Context &ctx, cl::Device &device,
+                       const std::string &source, double &time) {
+  using namespace std::chrono;
+
+  cl::Program prog(ctx, source);
+  auto start = steady_clock::now();
+  try {
+    prog.build(options.build_options);
+  } catch (cl::Error &err) {
+    std::string log = prog.getBuildInfo<CL_PROGRAM_BUILD_LOG>(device);
+    std::cerr << "\t\tFailed to build program: " << log << std::endl;
+    return false;
+  }
+  auto end = steady_clock::now();
+  time = duration_cast<duration<double, std::micro>>(end - start).count();
+  return true;
+}
+
+bool measure_device(cl::Device &device, int index) {
+  if (options.sample_count <= 0)
+    return true;
+
+  try {
+    std::cout << "\tDevice " << index << ":" << std::endl
+              << "\t\tname: " << device.getInfo<CL_DEVICE_NAME>() << std::endl
+              << "\t\tversion: " << device.getInfo<CL_DEVICE_VERSION>()
+              << std::endl;
+    cl::Context ctx(device);
+
+    unsigned long long seed =
+        std::chrono::steady_clock::now().time_since_epoch().count();
+    std::vector<double> first(options.sample_count);
+    std::vector<double> again(options.sample_count);
+    long rss_before = peak_rss_kib(), rss_first = 0;
+
+    // The first sample also includes any one-time setup of the compiler,
+    // such as generating the precompiled headers for these build options
+    // and loading the kernel library.
+    for (int i = 0; i < options.sample_count; ++i) {
+      std::string source = make_source(seed, i);
+      if (!time_build(ctx, device, source, first[i]))
+        return false;
+      if (i == 0)
+        rss_first = peak_rss_kib();
+      if (!time_build(ctx, device, source, again[i]))
+        return false;
+    }
+
+    std::cout << "\t\tfirst build: " << first[0] << " µs" << std::endl;
+    if (rss_before > 0)
+      std::cout << "\t\tpeak RSS: " << rss_before << " KiB before, "
+                << rss_first << " KiB after the first build, "
+                << peak_rss_kib() << " KiB after all builds" << std::endl;
+    std::vector<double> rest(first.begin() + 1, first.end());
+    if (!rest.empty())
+      print_measurements("uncached builds:", rest, 2);
+    print_measurements("rebuilds (kernel cache hit):", again, 2);
+
+  } catch (cl::Error &err) {
+    std::cerr << err.what() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool measure_platform(cl::Platform &platform, int index) {
+  try {
+    std::cout << "Platform " << index << ":" << std::endl
+              << "\tname: " << platform.getInfo<CL_PLATFORM_NAME>() << std::endl
+              << "\tversion: " << platform.getInfo<CL_PLATFORM_VERSION>()
+              << std::endl
+              << "\tvendor: " << platform.getInfo<CL_PLATFORM_VENDOR>()
+              << std::endl;
+
+    std::vector<cl::Device> devices;
+    platform.getDevices(CL_DEVICE_TYPE_ALL, &devices);
+
+    if (options.device_index < 0) {
+      bool ret = true;
+      for (size_t i = 0; i < devices.size(); ++i)
+        ret = measure_device(devices[i], i) && ret;
+      return ret;
+    } else if ((size_t)options.device_index < devices.size()) {
+      return measure_device(devices[options.device_index],
+                            options.device_index);
+    } else {
+      std::cerr << "\t" << devices.size() << " devices found, index "
+                << options.device_index << " is out of range." << std::endl;
+      return false;
+    }
+  } catch (cl::Error &err) {
+    std::cerr << err.what() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  (void)argc;
+  if (!parse_args(argv))
+    return 1;
+
+  std::vector<cl::Platform> platforms;
+  if (cl::Platform::get(&platforms) != CL_SUCCESS) {
+    std::cerr << "Failed to enumerate OpenCL platforms!" << std::endl;
+    return 1;
+  }
+
+  if (platforms.size() == 0) {
+    std::cerr << "No OpenCL platforms found!" << std::endl;
+    return 1;
+  }
+
+  if (options.platform_index < 0) {
+    bool failed = true;
+    for (size_t i = 0; i < platforms.size(); ++i)
+      failed = measure_platform(platforms[i], i) && failed;
+    if (failed)
+      return 1;
+  } else if ((size_t)options.platform_index < platforms.size()) {
+    if (!measure_platform(platforms[options.platform_index],
+                          options.platform_index))
+      return 1;
+  } else {
+    std::cerr << platforms.size() << " platforms found, index "
+              << options.platform_index << " is out of range." << std::endl;
+    return 1;
+  }
+  std::cout << "All good" << std::endl;
+  return 0;
+}
@@ -0,0 +1,282 @@
+/* Benchmark for measuring the throughput of the color convert DBK
+
+   Copyright (c) 2026 pocl developers
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#define CL_HPP_ENABLE_EXCEPTIONS
+
+#include <CL/opencl.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct Format {
+  const char *name;
+  pocl_image_format format;
+};
+
+static const Format input_formats[] = {{"nv12", POCL_DF_IMAGE_NV12},
+                                       {"nv21", POCL_DF_IMAGE_NV21},
+                                       {"iyuv", POCL_DF_IMAGE_IYUV}};
+static const Format output_formats[] = {{"rgb", POCL_DF_IMAGE_RGB},
+                                        {"rgba", POCL_DF_IMAGE_RGBA},
+                                        {"bgra", POCL_DF_IMAGE_BGRA}};
+
+struct {
+  int platform_index = 0;
+  int device_index = 0;
+  int sample_count = 5;
+  std::vector<std::pair<cl_uint, cl_uint>> sizes = {
+      {640, 480}, {1920, 1080}, {3840, 2160}};
+  std::vector<std::string> inputs = {"nv12"};
+  std::vector<std::string> outputs = {"rgb", "rgba"};
+} options;
+
+void print_help(const char *name) {
+  std::cerr << "Usage: " << name << " [-p platform_index] [-d device_index] "
+            << "[-s sample_count] [-n WxH,...] [-i format,...] "
+            << "[-o format,...]" << std::endl
+            << "-p specifies which platform to use. (default:"
+            << options.platform_index << ")" << std::endl
+            << "-d specifies which device to use. (default:"
+            << options.device_index << ")" << std::endl
+            << "-s sets the number of samples measured. (default: "
+            << options.sample_count << ")" << std::endl
+            << "-n sets the sizes of the images converted. "
+            << "(default: 640x480,1920x1080,3840x2160)" << std::endl
+            << "-i sets the yuv formats converted: nv12, nv21 or iyuv. "
+            << "(default: nv12)" << std::endl
+            << "-o sets the rgb formats converted to: rgb, rgba or bgra. "
+            << "(default: rgb,rgba)" << std::endl;
+}
+
+static std::vector<std::string> split(const char *list) {
+  std::vector<std::string> items;
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ','))
+    if (!item.empty())
+      items.push_back(item);
+  return items;
+}
+
+template <size_t N>
+static const Format *find_format(const Format (&formats)[N],
+                                 const std::string &name) {
+  for (auto &f : formats)
+    if (name == f.name)
+      return &f;
+  std::cerr << "Unknown image format " << name << std::endl;
+  return nullptr;
+}
+
+bool parse_args(char **argv) {
+  const char *name = *argv++;
+  while (*argv) {
+    const char *arg = *argv;
+    if (arg[0] != '-' || arg[1] == 0 || arg[2] != 0 || argv[1] == nullptr) {
+      std::cerr << "Unknown or incomplete flag " << arg << std::endl;
+      goto fail;
+    }
+    argv++;
+    switch (arg[1]) {
+    case 'p':
+      options.platform_index = std::stoi(*argv);
+      break;
+    case 'd':
+      options.device_index = std::stoi(*argv);
+      break;
+    case 's':
+      options.sample_count = std::stoi(*argv);
+      break;
+    case 'n':
+      options.sizes.clear();
+      for (auto &s : split(*argv)) {
+        size_t x = s.find('x');
+        if (x == std::string::npos) {
+          std::cerr << "Invalid image size " << s << std::endl;
+          goto fail;
+        }
+        options.sizes.emplace_back(std::stoi(s.substr(0, x)),
+                                   std::stoi(s.substr(x + 1)));
+      }
+      break;
+    case 'i':
+      options.inputs = split(*argv);
+      for (auto &f : options.inputs)
+        if (!find_format(input_formats, f))
+          goto fail;
+      break;
+    case 'o':
+      options.outputs = split(*argv);
+      for (auto &f : options.outputs)
+        if (!find_format(output_formats, f))
+          goto fail;
+      break;
+    default:
+      std::cerr << "Unknown flag " << arg << std::endl;
+      goto fail;
+    }
+    argv++;
+  }
+  return true;
+fail:
+  print_help(name);
+  return false;
+}
+
+bool measure_conversion(cl::Context &ctx, cl::Device &device,
+                        cl::CommandQueue &cq, cl_uint width, cl_uint height,
+                        const Format &input, const Format &output) {
+  using namespace std::chrono;
+
+  pocl_image_attr_t input_attrs = {width, height, POCL_COLOR_SPACE_BT709,
+                                   POCL_CHANNEL_RANGE_FULL, input.format};
+  pocl_image_attr_t output_attrs = input_attrs;
+  output_attrs.format = output.format;
+  cl_dbk_attributes_img_color_convert_exp attrs = {input_attrs,
+                                                   output_attrs};
+
+  auto createProgramWithDBKs =
+      reinterpret_cast<clCreateProgramWithDefinedBuiltInKernelsEXP_fn>(
+          clGetExtensionFunctionAddressForPlatform(
+              device.getInfo<CL_DEVICE_PLATFORM>()(),
+              "clCreateProgramWithDefinedBuiltInKernelsEXP"));
+  if (createProgramWithDBKs == nullptr) {
+    std::cerr << "clCreateProgramWithDefinedBuiltInKernelsEXP not found"
+              << std::endl;
+    return false;
+  }
+  cl_device_id dev = device();
+  cl_dbk_id_exp id = CL_DBK_IMG_COLOR_CONVERT_EXP;
+  const char *kernel_name = "color_convert";
+  const void *attr_list[1] = {&attrs};
+  cl_int dev_status = CL_SUCCESS;
+  cl_int status = CL_SUCCESS;
+  cl_program prog_handle =
+      createProgramWithDBKs(ctx(), 1, &dev, 1, &id, &kernel_name, attr_list,
+                            &dev_status, &status);
+  if (status != CL_SUCCESS) {
+    std::cerr << "Creating the color convert DBK failed: " << status
+              << std::endl;
+    return false;
+  }
+  cl::Program program(prog_handle);
+  program.build({device});
+  cl::Kernel kernel(program, kernel_name);
+
+  size_t pixels = (size_t)width * height;
+  size_t chroma = (size_t)((width + 1) / 2) * ((height + 1) / 2);
+  size_t input_size = pixels + 2 * chroma;
+  size_t output_size = pixels * (output.format == POCL_DF_IMAGE_RGB ? 3 : 4);
+  std::vector<unsigned char> image(input_size);
+  for (size_t i = 0; i < input_size; ++i)
+    image[i] = (unsigned char)(i * 7919 + 13);
+  cl::Buffer input_buf(ctx, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                       input_size, image.data());
+  cl::Buffer output_buf(ctx, CL_MEM_WRITE_ONLY, output_size);
+  kernel.setArg(0, input_buf);
+  kernel.setArg(1, output_buf);
+
+  // Repeat small images so that a sample takes a measurable time.
+  int repeats = std::max(1, (int)(5e7 / pixels));
+
+  // warm up
+  cq.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(1));
+  cq.finish();
+
+  double best = 0.0, sum = 0.0;
+  for (int i = 0; i < options.sample_count; ++i) {
+    auto start = steady_clock::now();
+    for (int r = 0; r < repeats; ++r)
+      cq.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(1));
+    cq.finish();
+    double secs =
+        duration_cast<duration<double>>(steady_clock::now() - start).count();
+    double mpix = pixels * repeats / secs * 1e-6;
+    best = std::max(best, mpix);
+    sum += mpix;
+  }
+  std::cout << "\t\t\t" << input.name << " -> " << output.name << ": average "
+            << sum / std::max(1, options.sample_count) << " MPix/s, best "
+            << best << " MPix/s" << std::endl;
+  return true;
+}
+
+int main(int argc, char **argv) {
+  (void)argc;
+  if (!parse_args(argv))
+    return 1;
+
+  try {
+    std::vector<cl::Platform> platforms;
+    cl::Platform::get(&platforms);
+    if ((size_t)options.platform_index >= platforms.size()) {
+      std::cerr << platforms.size() << " platforms found, index "
+                << options.platform_index << " is out of range." << std::endl;
+      return 1;
+    }
+    cl::Platform &platform = platforms[options.platform_index];
+    std::vector<cl::Device> devices;
+    platform.getDevices(CL_DEVICE_TYPE_ALL, &devices);
+    if ((size_t)options.device_index >= devices.size()) {
+      std::cerr << devices.size() << " devices found, index "
+                << options.device_index << " is out of range." << std::endl;
+      return 1;
+    }
+    cl::Device &device = devices[options.device_index];
+    std::cout << "Platform " << options.platform_index << ": "
+              << platform.getInfo<CL_PLATFORM_NAME>() << std::endl
+              << "\tDevice " << options.device_index << ": "
+              << device.getInfo<CL_DEVICE_NAME>() << std::endl;
+    if (device.getInfo<CL_DEVICE_BUILT_IN_KERNELS>().find(
+            "img_color_convert_exp") == std::string::npos) {
+      std::cerr << "The device does not support the color convert DBK."
+                << std::endl;
+      return 1;
+    }
+
+    cl::Context ctx(device);
+    cl::CommandQueue cq(ctx, device);
+    for (auto &size : options.sizes) {
+      std::cout << "\t\t" << size.first << "x" << size.second << ":"
+                << std::endl;
+      for (auto &in : options.inputs)
+        for (auto &out : options.outputs)
+          if (!measure_conversion(ctx, device, cq, size.first, size.second,
+                                  *find_format(input_formats, in),
+                                  *find_format(output_formats, out)))
+            return 1;
+    }
+  } catch (cl::Error &err) {
+    std::cerr << err.what() << ": " << err.err() << std::endl;
+    return 1;
+  }
+  std::cout << "All good" << std::endl;
+  return 0;
+}
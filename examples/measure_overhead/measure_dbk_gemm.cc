@@ -0,0 +1,298 @@
+/* Benchmark for measuring the throughput of the matmul DBK
+
+   Copyright (c) 2026 pocl developers
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#define CL_HPP_ENABLE_EXCEPTIONS
+
+#include <CL/opencl.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct {
+  int platform_index = 0;
+  int device_index = 0;
+  int sample_count = 5;
+  cl_uint batch = 1;
+  std::vector<cl_uint> sizes = {64, 128, 256, 512, 1024};
+  std::vector<std::string> kernels = {"libxsmm", "native"};
+} options;
+
+void print_help(const char *name) {
+  std::cerr << "Usage: " << name << " [-p platform_index] [-d device_index] "
+            << "[-s sample_count] [-b batch] [-n size,...] [-k kernel,...]"
+            << std::endl
+            << "-p specifies which platform to use. (default:"
+            << options.platform_index << ")" << std::endl
+            << "-d specifies which device to use. (default:"
+            << options.device_index << ")" << std::endl
+            << "-s sets the number of samples measured. (default: "
+            << options.sample_count << ")" << std::endl
+            << "-b sets the number of matrices in the batch. (default: "
+            << options.batch << ")" << std::endl
+            << "-n sets the sizes of the square matrices multiplied. "
+            << "(default: 64,128,256,512,1024)" << std::endl
+            << "-k sets the POCL_CPU_GEMM_KERNEL values compared on PoCL CPU "
+            << "devices: libxsmm, native, avx512, avx2, sse2, neon or "
+            << "generic. (default: libxsmm,native)" << std::endl;
+}
+
+static std::vector<std::string> split(const char *list) {
+  std::vector<std::string> items;
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ','))
+    if (!item.empty())
+      items.push_back(item);
+  return items;
+}
+
+bool parse_args(char **argv) {
+  const char *name = *argv++;
+  while (*argv) {
+    const char *arg = *argv;
+    if (arg[0] != '-' || arg[1] == 0 || arg[2] != 0 || argv[1] == nullptr) {
+      std::cerr << "Unknown or incomplete flag " << arg << std::endl;
+      goto fail;
+    }
+    argv++;
+    switch (arg[1]) {
+    case 'p':
+      options.platform_index = std::stoi(*argv);
+      break;
+    case 'd':
+      options.device_index = std::stoi(*argv);
+      break;
+    case 's':
+      options.sample_count = std::stoi(*argv);
+      break;
+    case 'b':
+      options.batch = std::stoi(*argv);
+      break;
+    case 'n':
+      options.sizes.clear();
+      for (auto &s : split(*argv))
+        options.sizes.push_back(std::stoi(s));
+      break;
+    case 'k':
+      options.kernels = split(*argv);
+      break;
+    default:
+      std::cerr << "Unknown flag " << arg << std::endl;
+      goto fail;
+    }
+    argv++;
+  }
+  return true;
+fail:
+  print_help(name);
+  return false;
+}
+
+static void setup_tensor(cl_tensor_desc_exp &desc,
+                         cl_tensor_layout_blas_exp &layout, cl_uint batch,
+                         cl_uint rows, cl_uint cols) {
+  memset(&desc, 0, sizeof(desc));
+  memset(&layout, 0, sizeof(layout));
+  desc.dtype = CL_TENSOR_DTYPE_FP32_EXP;
+  desc.layout_type = CL_TENSOR_LAYOUT_BLAS_EXP;
+  desc.layout = &layout;
+  if (batch > 1) {
+    desc.rank = 3;
+    desc.shape[0] = batch;
+    desc.shape[1] = rows;
+    desc.shape[2] = cols;
+    layout.leading_dims[0] = 2;
+    layout.leading_dims[1] = 1;
+  } else {
+    desc.rank = 2;
+    desc.shape[0] = rows;
+    desc.shape[1] = cols;
+    layout.leading_dims[0] = 1;
+  }
+}
+
+static cl::Buffer create_tensor(cl::Context &ctx,
+                                const cl_tensor_desc_exp &desc,
+                                cl_mem_flags flags, size_t size,
+                                void *host_ptr) {
+  cl_mem_properties props[] = {CL_MEM_TENSOR_EXP, (cl_mem_properties)&desc,
+                               0};
+  cl_int status;
+  cl_mem mem = clCreateBufferWithProperties(ctx(), props, flags, size,
+                                            host_ptr, &status);
+  if (status != CL_SUCCESS)
+    throw cl::Error(status, "clCreateBufferWithProperties");
+  return cl::Buffer(mem);
+}
+
+bool measure_size(cl::Context &ctx, cl::Device &device, cl::CommandQueue &cq,
+                  cl_uint n) {
+  using namespace std::chrono;
+
+  cl_uint batch = options.batch;
+  cl_dbk_attributes_matmul_exp attrs;
+  cl_tensor_layout_blas_exp layouts[3];
+  memset(&attrs, 0, sizeof(attrs));
+  setup_tensor(attrs.a, layouts[0], batch, n, n);
+  setup_tensor(attrs.b, layouts[1], batch, n, n);
+  setup_tensor(attrs.c, layouts[2], batch, n, n);
+
+  auto createProgramWithDBKs =
+      reinterpret_cast<clCreateProgramWithDefinedBuiltInKernelsEXP_fn>(
+          clGetExtensionFunctionAddressForPlatform(
+              device.getInfo<CL_DEVICE_PLATFORM>()(),
+              "clCreateProgramWithDefinedBuiltInKernelsEXP"));
+  if (createProgramWithDBKs == nullptr) {
+    std::cerr << "clCreateProgramWithDefinedBuiltInKernelsEXP not found"
+              << std::endl;
+    return false;
+  }
+  cl_device_id dev = device();
+  cl_dbk_id_exp id = CL_DBK_MATMUL_EXP;
+  const char *kernel_name = "matmul";
+  const void *attr_list[1] = {&attrs};
+  cl_int dev_status = CL_SUCCESS;
+  cl_int status = CL_SUCCESS;
+  cl_program prog_handle =
+      createProgramWithDBKs(ctx(), 1, &dev, 1, &id, &kernel_name, attr_list,
+                            &dev_status, &status);
+  if (status != CL_SUCCESS) {
+    std::cerr << "Creating the matmul DBK failed: " << status << std::endl;
+    return false;
+  }
+  cl::Program program(prog_handle);
+  program.build({device});
+  cl::Kernel kernel(program, kernel_name);
+
+  size_t elems = (size_t)batch * n * n;
+  std::vector<float> a(elems), b(elems), c(elems);
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (size_t i = 0; i < elems; ++i) {
+    a[i] = dist(gen);
+    b[i] = dist(gen);
+  }
+  cl::Buffer a_buf = create_tensor(ctx, attrs.a, CL_MEM_COPY_HOST_PTR,
+                                   elems * sizeof(float), a.data());
+  cl::Buffer b_buf = create_tensor(ctx, attrs.b, CL_MEM_COPY_HOST_PTR,
+                                   elems * sizeof(float), b.data());
+  cl::Buffer c_buf =
+      create_tensor(ctx, attrs.c, 0, elems * sizeof(float), nullptr);
+  kernel.setArg(0, a_buf);
+  kernel.setArg(1, b_buf);
+  kernel.setArg(2, c_buf);
+
+  double flop = 2.0 * batch * n * n * n;
+  // Repeat small GEMMs so that a sample takes a measurable time.
+  int repeats = std::max(1, (int)(2e8 / flop));
+
+  std::cout << "\t\t" << batch << " x " << n << "x" << n << "x" << n << ":"
+            << std::endl;
+  for (auto &impl : options.kernels) {
+    // Read by the PoCL CPU devices at each launch.
+    setenv("POCL_CPU_GEMM_KERNEL", impl.c_str(), 1);
+    cq.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(1));
+    cq.enqueueReadBuffer(c_buf, CL_TRUE, 0, elems * sizeof(float), c.data());
+
+    // spot check some elements of the result
+    double max_err = 0.0;
+    for (size_t s = 0; s < 16; ++s) {
+      size_t bi = s % batch, i = (s * 7919) % n, j = (s * 104729) % n;
+      double ref = 0.0;
+      for (size_t k = 0; k < n; ++k)
+        ref += (double)a[(bi * n + i) * n + k] * b[(bi * n + k) * n + j];
+      max_err = std::max(max_err, std::fabs(ref - c[(bi * n + i) * n + j]));
+    }
+
+    double best = 0.0, sum = 0.0;
+    for (int i = 0; i < options.sample_count; ++i) {
+      auto start = steady_clock::now();
+      for (int r = 0; r < repeats; ++r)
+        cq.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(1));
+      cq.finish();
+      double secs =
+          duration_cast<duration<double>>(steady_clock::now() - start).count();
+      double gflops = flop * repeats / secs * 1e-9;
+      best = std::max(best, gflops);
+      sum += gflops;
+    }
+    std::cout << "\t\t\t" << impl << ": average "
+              << sum / std::max(1, options.sample_count) << " GFLOP/s, best "
+              << best << " GFLOP/s, max error " << max_err << std::endl;
+  }
+  unsetenv("POCL_CPU_GEMM_KERNEL");
+  return true;
+}
+
+int main(int argc, char **argv) {
+  (void)argc;
+  if (!parse_args(argv))
+    return 1;
+
+  try {
+    std::vector<cl::Platform> platforms;
+    cl::Platform::get(&platforms);
+    if ((size_t)options.platform_index >= platforms.size()) {
+      std::cerr << platforms.size() << " platforms found, index "
+                << options.platform_index << " is out of range." << std::endl;
+      return 1;
+    }
+    cl::Platform &platform = platforms[options.platform_index];
+    std::vector<cl::Device> devices;
+    platform.getDevices(CL_DEVICE_TYPE_ALL, &devices);
+    if ((size_t)options.device_index >= devices.size()) {
+      std::cerr << devices.size() << " devices found, index "
+                << options.device_index << " is out of range." << std::endl;
+      return 1;
+    }
+    cl::Device &device = devices[options.device_index];
+    std::cout << "Platform " << options.platform_index << ": "
+              << platform.getInfo<CL_PLATFORM_NAME>() << std::endl
+              << "\tDevice " << options.device_index << ": "
+              << device.getInfo<CL_DEVICE_NAME>() << std::endl;
+    if (device.getInfo<CL_DEVICE_BUILT_IN_KERNELS>().find("matmul_exp") ==
+        std::string::npos) {
+      std::cerr << "The device does not support the matmul DBK." << std::endl;
+      return 1;
+    }
+
+    cl::Context ctx(device);
+    cl::CommandQueue cq(ctx, device);
+    for (cl_uint n : options.sizes)
+      if (!measure_size(ctx, device, cq, n))
+        return 1;
+  } catch (cl::Error &err) {
+    std::cerr << err.what() << ": " << err.err() << std::endl;
+    return 1;
+  }
+  std::cout << "All good" << std::endl;
+  return 0;
+}
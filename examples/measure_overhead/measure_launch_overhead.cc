@@ -0,0 +1,254 @@
+/* Benchmark for measuring the per-launch overhead of small NDRange kernels
+
+   Copyright (c) 2026 pocl developers
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include "pocl_opencl.h"
+
+#define CL_HPP_ENABLE_EXCEPTIONS
+
+#include <CL/opencl.hpp>
+
+#include "common.hh"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+struct {
+  int platform_index = -1;
+  int device_index = -1;
+  int sample_count = 20;
+  int command_count = 10000;
+} options;
+
+void print_help(const char *name) {
+  std::cerr << "Usage: " << name << " [-p platform_index] [-d device_index] "
+            << "[-s sample_count] [-n command_count]" << std::endl
+            << "-p specifies which platform to use. (default:"
+            << options.platform_index << ")" << std::endl
+            << "-d specifies which device to use. (default:"
+            << options.device_index << ")" << std::endl
+            << "-s sets the number of samples measured. (default: "
+            << options.sample_count << ")" << std::endl
+            << "-n sets the number of launches per sample. (default: "
+            << options.command_count << ")" << std::endl;
+}
+
+bool parse_args(char **argv) {
+  const char *name = *argv++;
+  while (*argv) {
+    const char *arg = *argv;
+    if (arg[0] == '-') {
+      if (arg[1] == '-') {
+        if (!strcmp(arg + 2, "help"))
+          goto fail;
+        else {
+          std::cerr << "Unknown long flag " << arg + 2 << std::endl;
+          goto fail;
+        }
+      } else if (arg[1] == 'p' && arg[2] == 0) {
+        argv++;
+        if (!*argv) {
+          std::cerr << "Missing platform index" << std::endl;
+          goto fail;
+        }
+        options.platform_index = std::stoi(*argv, nullptr);
+      } else if (arg[1] == 'd' && arg[2] == 0) {
+        argv++;
+        if (!*argv) {
+          std::cerr << "Missing device index" << std::endl;
+          goto fail;
+        }
+        options.device_index = std::stoi(*argv);
+      } else if (arg[1] == 's' && arg[2] == 0) {
+        argv++;
+        if (!*argv) {
+          std::cerr << "Missing sample count" << std::endl;
+          goto fail;
+        }
+        options.sample_count = std::stoi(*argv);
+      } else if (arg[1] == 'n' && arg[2] == 0) {
+        argv++;
+        if (!*argv) {
+          std::cerr << "Missing command count" << std::endl;
+          goto fail;
+        }
+        options.command_count = std::stoi(*argv);
+      } else {
+        std::cerr << "Unknown flag " << arg + 1 << std::endl;
+        goto fail;
+      }
+    }
+    argv++;
+  }
+  if (options.device_index >= 0 && options.platform_index < 0)
+    options.platform_index = 0;
+  return true;
+fail:
+  print_help(name);
+  return false;
+}
+
+static const char *kernel_source = R"CLC(
+kernel void axpy(global const float *x, global float *y, float a,
+                 local float *tmp, uint n) {
+  size_t i = get_global_id(0);
+  tmp[get_local_id(0)] = x[i];
+  if (i < n)
+    y[i] += a * tmp[get_local_id(0)];
+}
+)CLC";
+
+bool measure_device(cl::Device &device, int index) {
+  if (options.sample_count <= 0 || options.command_count <= 0)
+    return true;
+
+  using namespace std::chrono;
+
+  try {
+    std::cout << "\tDevice " << index << ":" << std::endl
+              << "\t\tname: " << device.getInfo<CL_DEVICE_NAME>() << std::endl
+              << "\t\tversion: " << device.getInfo<CL_DEVICE_VERSION>()
+              << std::endl;
+    cl::Context ctx(device);
+    cl::CommandQueue cq(ctx, device);
+    cl::Program program(ctx, kernel_source);
+    program.build({device});
+    cl::Kernel kernel(program, "axpy");
+
+    const cl_uint n = 64;
+    cl::Buffer x(ctx, CL_MEM_READ_WRITE, n * sizeof(cl_float));
+    cl::Buffer y[2] = {cl::Buffer(ctx, CL_MEM_READ_WRITE, n * sizeof(cl_float)),
+                       cl::Buffer(ctx, CL_MEM_READ_WRITE, n * sizeof(cl_float))};
+    cl_float zero = 0.0f;
+    cq.enqueueFillBuffer(x, zero, 0, n * sizeof(cl_float));
+    cq.enqueueFillBuffer(y[0], zero, 0, n * sizeof(cl_float));
+    cq.enqueueFillBuffer(y[1], zero, 0, n * sizeof(cl_float));
+
+    kernel.setArg(0, x);
+    kernel.setArg(1, y[0]);
+    kernel.setArg(2, 1.0f);
+    kernel.setArg(3, cl::Local(n * sizeof(cl_float)));
+    kernel.setArg(4, n);
+    cq.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(n),
+                            cl::NDRange(n));
+    cq.finish();
+
+    // Tiny single work-group launches chained by the in-order queue, so
+    // that the time is dominated by the per-launch runtime overhead: first
+    // with the same arguments in every launch, then changing a buffer and
+    // a scalar argument between the launches.
+    for (int vary = 0; vary < 2; ++vary) {
+      std::vector<double> times(options.sample_count);
+      for (int i = 0; i < options.sample_count; ++i) {
+        auto start = steady_clock::now();
+        for (int j = 0; j < options.command_count; ++j) {
+          if (vary) {
+            kernel.setArg(1, y[j & 1]);
+            kernel.setArg(2, (cl_float)j);
+          }
+          cq.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(n),
+                                  cl::NDRange(n));
+        }
+        cq.finish();
+        auto end = steady_clock::now();
+        times[i] = duration_cast<duration<double, std::micro>>(end - start)
+                       .count() /
+                   options.command_count;
+      }
+      print_measurements(vary ? "per-launch time, changing arguments:"
+                              : "per-launch time, same arguments:",
+                         times, 2);
+    }
+  } catch (cl::Error &err) {
+    std::cerr << err.what() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool measure_platform(cl::Platform &platform, int index) {
+  try {
+    std::cout << "Platform " << index << ":" << std::endl
+              << "\tname: " << platform.getInfo<CL_PLATFORM_NAME>() << std::endl
+              << "\tversion: " << platform.getInfo<CL_PLATFORM_VERSION>()
+              << std::endl
+              << "\tvendor: " << platform.getInfo<CL_PLATFORM_VENDOR>()
+              << std::endl;
+
+    std::vector<cl::Device> devices;
+    platform.getDevices(CL_DEVICE_TYPE_ALL, &devices);
+
+    if (options.device_index < 0) {
+      bool ret = true;
+      for (size_t i = 0; i < devices.size(); ++i)
+        ret = measure_device(devices[i], i) && ret;
+      return ret;
+    } else if ((size_t)options.device_index < devices.size()) {
+      return measure_device(devices[options.device_index],
+                            options.device_index);
+    } else {
+      std::cerr << "\t" << devices.size() << " devices found, index "
+                << options.device_index << " is out of range." << std::endl;
+      return false;
+    }
+  } catch (cl::Error &err) {
+    std::cerr << err.what() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  (void)argc;
+  if (!parse_args(argv))
+    return 1;
+
+  std::vector<cl::Platform> platforms;
+  if (cl::Platform::get(&platforms) != CL_SUCCESS) {
+    std::cerr << "Failed to enumerate OpenCL platforms!" << std::endl;
+    return 1;
+  }
+
+  if (platforms.size() == 0) {
+    std::cerr << "No OpenCL platforms found!" << std::endl;
+    return 1;
+  }
+
+  if (options.platform_index < 0) {
+    bool failed = true;
+    for (size_t i = 0; i < platforms.size(); ++i)
+      failed = measure_platform(platforms[i], i) && failed;
+    if (failed)
+      return 1;
+  } else if ((size_t)options.platform_index < platforms.size()) {
+    if (!measure_platform(platforms[options.platform_index],
+                          options.platform_index))
+      return 1;
+  } else {
+    std::cerr << platforms.size() << " platforms found, index "
+              << options.platform_index << " is out of range." << std::endl;
+    return 1;
+  }
+  std::cout << "All good" << std::endl;
+  return 0;
+}
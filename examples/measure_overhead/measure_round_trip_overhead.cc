@@ -27,6 +27,8 @@
 
 #include <CL/opencl.hpp>
 
+#include <CL/cl_ext_pocl.h>
+
 #include "common.hh"
 #include <algorithm>
 #include <chrono>
@@ -149,6 +151,63 @@ bool measure_round_trip_latency(cl::CommandQueue &cq, cl::Kernel &k) {
   return true;
 }
 
+// Launch a kernel with many arguments, changing one scalar argument between
+// launches, and report how many bytes the remote driver submitted per
+// launch. Skipped on devices that do not report remote traffic stats.
+#define MANY_ARGS 32
+bool measure_argument_traffic(cl::Context &ctx, cl::Device &device,
+                              cl::CommandQueue &cq) {
+  if (options.sample_count <= 0)
+    return true;
+
+  cl_ulong stats[6];
+  if (clGetDeviceInfo(device(), CL_DEVICE_REMOTE_TRAFFIC_STATS_POCL,
+                      sizeof(stats), stats, nullptr) != CL_SUCCESS)
+    return true;
+
+  std::string src = "__kernel void many_args(__global int *arr";
+  for (int i = 0; i < MANY_ARGS; ++i)
+    src += ", int a" + std::to_string(i);
+  src += ") { arr[get_global_id(0)] = a0";
+  for (int i = 1; i < MANY_ARGS; ++i)
+    src += " + a" + std::to_string(i);
+  src += "; }";
+
+  cl::Program prog(ctx, src);
+  try {
+    prog.build();
+  } catch (cl::Error &err) {
+    std::string log = prog.getBuildInfo<CL_PROGRAM_BUILD_LOG>(device);
+    std::cerr << "\t\tFailed to build kernel: " << log << std::endl;
+    return false;
+  }
+
+  cl::Buffer output(ctx, CL_MEM_WRITE_ONLY, sizeof(int));
+  cl::Kernel kern(prog, "many_args");
+  kern.setArg(0, output);
+  for (int i = 0; i < MANY_ARGS; ++i)
+    kern.setArg(i + 1, i);
+  cq.enqueueNDRangeKernel(kern, cl::NullRange, cl::NDRange(1));
+  cq.finish();
+
+  clGetDeviceInfo(device(), CL_DEVICE_REMOTE_TRAFFIC_STATS_POCL,
+                  sizeof(stats), stats, nullptr);
+  cl_ulong submitted_before = stats[4];
+  for (int i = 0; i < options.sample_count; ++i) {
+    kern.setArg(1 + i % MANY_ARGS, i);
+    cq.enqueueNDRangeKernel(kern, cl::NullRange, cl::NDRange(1));
+  }
+  cq.finish();
+  clGetDeviceInfo(device(), CL_DEVICE_REMOTE_TRAFFIC_STATS_POCL,
+                  sizeof(stats), stats, nullptr);
+
+  std::cout << "\t\tbytes submitted per launch with one of " << MANY_ARGS
+            << " arguments changed: "
+            << double(stats[4] - submitted_before) / options.sample_count
+            << std::endl;
+  return true;
+}
+
 #define TESTMAGIC 31337
 bool measure_device(cl::Device &device, int index) {
   try {
@@ -184,6 +243,8 @@ bool measure_device(cl::Device &device, int index) {
     }
 
     measure_round_trip_latency(cq, kern);
+    if (!measure_argument_traffic(ctx, device, cq))
+      return false;
     int result = 0;
     cq.enqueueReadBuffer(output, true, 0, sizeof(int), &result);
     if (result != TESTMAGIC) {
@@ -282,14 +282,22 @@ typedef cl_int pocl_color_space;
 /**
  * Collection of different image data formats that can be used
  * to populate entries in pocl_image_attr_t.
- * @todo describe each type
  */
 enum pocl_image_format_e
 {
+  /* interleaved 8-bit R, G and B */
   POCL_DF_IMAGE_RGB,
+  /* 8-bit Y plane followed by a plane of interleaved U and V samples
+   * subsampled 2x2 */
   POCL_DF_IMAGE_NV12,
+  /* as NV12, with V before U */
   POCL_DF_IMAGE_NV21,
+  /* 8-bit Y, U and V planes, U and V subsampled 2x2 (a.k.a. I420) */
   POCL_DF_IMAGE_IYUV,
+  /* interleaved 8-bit R, G, B and A */
+  POCL_DF_IMAGE_RGBA,
+  /* interleaved 8-bit B, G, R and A */
+  POCL_DF_IMAGE_BGRA,
 };
 typedef cl_int pocl_image_format;
 
@@ -233,6 +233,11 @@ extern "C"
     uint16_t peer_port;
     uint8_t use_rdma;
     uint8_t fast_socket;
+    /* If set, the message was sent over a Unix domain socket together with
+       the fd of a sealed memfd region of shm_size bytes (SCM_RIGHTS), which
+       the buffer transfers of the session can refer to. */
+    uint8_t use_shm;
+    uint64_t shm_size;
   } CreateOrAttachSessionMsg_t;
 
   typedef struct __attribute__ ((packed))
@@ -243,6 +248,8 @@ extern "C"
     uint8_t authkey[AUTHKEY_LENGTH];
     uint16_t peer_port;
     uint8_t use_rdma;
+    /* Set if the server mapped the shared memory region of the client. */
+    uint8_t use_shm;
   } CreateOrAttachSessionReply_t;
 
   typedef struct __attribute__ ((packed)) DeviceInfo_s
@@ -401,6 +408,15 @@ extern "C"
     uint32_t width;
     uint32_t height;
     uint32_t depth;
+    /* Large buffers are streamed to the destination server in several
+       messages, each carrying chunk_size bytes at chunk_offset. more_chunks
+       is set in all but the last one. chunk_size 0 means the whole buffer. */
+    uint32_t more_chunks;
+    uint64_t chunk_offset;
+    uint64_t chunk_size;
+    /* Set by the source server if it failed to read a streamed chunk. The
+       chunk is then the last one and fails the migration. */
+    int32_t source_error;
   } MigrateD2DMsg_t;
 
   typedef struct __attribute__ ((packed)) CreateBufferMsg_s
@@ -458,6 +474,10 @@ extern "C"
        one. In that case, the obj_id of the request is set to the raw svm pool
        offset adjusted (remote VM) pointer instead of a cl_mem object id. */
     unsigned char is_svm;
+    /* If set to 1, the data is read to shm_offset of the shared memory
+       region of the session instead of being sent after the reply. */
+    unsigned char use_shm;
+    uint64_t shm_offset;
   } ReadBufferMsg_t;
 
   typedef struct __attribute__ ((packed)) WriteBufferMsg_s
@@ -470,6 +490,10 @@ extern "C"
        one. In that case, the obj_id of the request is set to the raw svm pool
        offset adjusted (remote VM) pointer instead of a cl_mem object id. */
     unsigned char is_svm;
+    /* If set to 1, the data is at shm_offset of the shared memory region of
+       the session instead of following the message. */
+    unsigned char use_shm;
+    uint64_t shm_offset;
   } WriteBufferMsg_t;
 
   typedef struct __attribute__ ((packed)) CopyBufferMsg_s
@@ -661,12 +685,23 @@ extern "C"
     vec3_t offset;
     uint8_t has_local;
     uint8_t dim;
-    // if new args are present
+    // if new args are present, one of RUN_KERNEL_ARGS_*
     uint16_t has_new_args;
     uint32_t args_num;
     uint64_t pod_arg_size;
   } RunKernelMsg_t;
 
+/* The launch reuses the arguments of the previous launch of the kernel on the
+   device. */
+#define RUN_KERNEL_ARGS_UNCHANGED 0
+/* The extra data holds the values of all args_num arguments followed by their
+   is-SVM flags, the second extra data the POD argument bytes. */
+#define RUN_KERNEL_ARGS_ALL 1
+/* Only args_num changed arguments are sent: their uint64_t values, uint32_t
+   indices and is-SVM flags, and the bytes of the changed POD arguments. The
+   others keep their values from the previous launch. */
+#define RUN_KERNEL_ARGS_CHANGED 2
+
   typedef struct __attribute__ ((packed)) DeviceInfoMsg_s
   {
     POCL_ALIGNAS(8) // Meant for aligning the structure, not the members.
@@ -391,6 +391,18 @@ typedef enum pocl_migration_type_e {
   ENQUEUE_MIGRATE_TYPE_D2D
 } pocl_migration_type_t;
 
+#define POCL_MAX_MIGRATION_RANGES 8
+
+/* A set of sorted, non-overlapping byte ranges [start, end) of a buffer.
+   Adding a range to a full set merges the two closest ranges, so the set
+   always covers (at least) all the added bytes. */
+typedef struct
+{
+  unsigned num;
+  uint64_t start[POCL_MAX_MIGRATION_RANGES];
+  uint64_t end[POCL_MAX_MIGRATION_RANGES];
+} pocl_interval_set;
+
 /* For clEnqueueMigrateMemObjects(). */
 typedef struct
 {
@@ -406,6 +418,11 @@ typedef struct
   /* Set to 1 if this is a migration command generated by the runtime to
      ensure coherence for the input buffers of commands. */
   char implicit;
+  /* The byte ranges of a D2H/H2D migration that differ between the source
+     and the destination, with POCL_MIGRATE_DIRTY_RANGES. Empty (num == 0)
+     means the whole buffer. Drivers can ignore it and copy the whole
+     buffer. */
+  pocl_interval_set ranges;
 } _cl_command_migrate;
 
 typedef struct
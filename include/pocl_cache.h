@@ -93,6 +93,16 @@ int pocl_cache_write_header (char *header_path,
                              const char *header_content,
                              uint64_t header_size);
 
+/* Path of the precompiled OpenCL C headers for building with the given
+ * options on the device. Returns nonzero if the kernel cache is disabled. */
+int pocl_cache_pch_path (char *pch_path, cl_device_id device,
+                         const char *build_options);
+
+/* Path of a file in a subdirectory of the cache, for data a driver keeps
+ * across runs. Returns nonzero if the kernel cache is disabled. */
+int pocl_cache_device_data_path (char *path, const char *subdir,
+                                 const char *name);
+
 int pocl_cache_update_program_last_access(cl_program program,
                                           unsigned device_i);
 
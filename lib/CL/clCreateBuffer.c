@@ -26,6 +26,7 @@
 #include "pocl_cl.h"
 #include "common.h"
 #include "devices.h"
+#include "pocl_host_mem_pool.h"
 #include "pocl_shared.h"
 #include "pocl_tensor_util.h"
 #include "pocl_util.h"
@@ -294,7 +295,11 @@ ERROR:
     }
 
     if (((flags & CL_MEM_USE_HOST_PTR) == 0) && mem->mem_host_ptr)
-      POCL_MEM_FREE (mem->mem_host_ptr);
+      {
+        size_t align = max (context->min_buffer_alignment, 16);
+        pocl_host_mem_free (mem->mem_host_ptr, align, mem->size);
+        mem->mem_host_ptr = NULL;
+      }
 
     POCL_MEM_FREE (mem);
   }
@@ -62,7 +62,9 @@ POname(clCreateCommandQueue)(cl_context context,
                       "not supported by the device (%zu)\n",
                       (size_t)properties, (size_t)supported_device_props);
 
-  if (POCL_DEBUGGING_ON || pocl_cq_profiling_enabled)
+  /* the tracers need the timestamps */
+  if (POCL_DEBUGGING_ON || pocl_cq_profiling_enabled
+      || pocl_is_tracing_enabled ())
     properties |= CL_QUEUE_PROFILING_ENABLE;
 
   for (i=0; i<context->num_devices; i++)
@@ -172,7 +172,9 @@ POname(clCreateCommandQueueWithProperties)(cl_context context,
   if (properties)
     {
       assert (i < 10);
-      cq_ret->properties = queue_props;
+      /* keep the profiling forced on by clCreateCommandQueue */
+      cq_ret->properties
+          = queue_props | (cq_ret->properties & CL_QUEUE_PROFILING_ENABLE);
       cq_ret->priority = priority;
       cq_ret->throttle = throttle;
       cq_ret->num_queue_properties = i + 1;
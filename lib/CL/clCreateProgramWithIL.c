@@ -38,8 +38,6 @@ CL_API_SUFFIX__VERSION_2_1
 {
   cl_program program = NULL;
   int errcode = CL_SUCCESS;
-  char program_bc_spirv[POCL_MAX_PATHNAME_LENGTH];
-  program_bc_spirv[0] = 0;
 
   POCL_GOTO_ERROR_COND ((context == NULL), CL_INVALID_CONTEXT);
 
@@ -100,28 +98,14 @@ CL_API_SUFFIX__VERSION_2_1
 #ifdef ENABLE_SPIRV
   /* this might change the size */
   pocl_preprocess_spirv_input (program);
-#endif
-
-  errcode = pocl_cache_write_spirv (program_bc_spirv,
-                                    program->program_il,
-                                    program->program_il_size);
 
-#ifdef ENABLE_SPIRV
-  pocl_get_program_spec_constants (program, program_bc_spirv,
-                                   program->program_il,
+  pocl_get_program_spec_constants (program, program->program_il,
                                    program->program_il_size);
-
 #endif
 
-
 ERROR:
   if (errcode_ret)
     *errcode_ret = errcode;
-  if (pocl_get_bool_option("POCL_LEAVE_KERNEL_COMPILER_TEMP_FILES", 0) == 0)
-    {
-      if (program_bc_spirv[0] != 0)
-        pocl_remove (program_bc_spirv);
-    }
   return program;
 }
 POsym(clCreateProgramWithIL)
@@ -110,6 +110,7 @@ pocl_copy_buffer_common (cl_command_buffer_khr command_buffer,
   pocl_buffer_migration_info *migr_infos
     = pocl_append_unique_migration_info (NULL, src_buffer, 1);
   pocl_append_unique_migration_info (migr_infos, dst_buffer, 0);
+  pocl_set_migration_write_range (migr_infos, dst_buffer, dst_offset, size);
 
   if (src_buffer->size_buffer != NULL)
     pocl_append_unique_migration_info (migr_infos, src_buffer->size_buffer, 1);
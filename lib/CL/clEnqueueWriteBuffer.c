@@ -97,24 +97,29 @@ pocl_write_buffer_common (cl_command_buffer_khr command_buffer,
     }
 
   char rdonly = 0;
+  pocl_buffer_migration_info *migr_infos
+    = pocl_append_unique_migration_info (NULL, buffer, rdonly);
+  pocl_set_migration_write_range (migr_infos, buffer, offset, size);
+
 
   if (command_buffer == NULL)
     {
       errcode = pocl_check_event_wait_list (
           command_queue, num_items_in_wait_list, event_wait_list);
       if (errcode != CL_SUCCESS)
-        return errcode;
+        {
+          POCL_MEM_FREE (migr_infos);
+          return errcode;
+        }
       errcode = pocl_create_command (
         cmd, command_queue, CL_COMMAND_WRITE_BUFFER, event,
-        num_items_in_wait_list, event_wait_list,
-        pocl_append_unique_migration_info (NULL, buffer, rdonly));
+        num_items_in_wait_list, event_wait_list, migr_infos);
     }
   else
     {
       errcode = pocl_cmdbuf_create_command (
         cmd, command_buffer, command_queue, CL_COMMAND_WRITE_BUFFER,
-        num_items_in_wait_list, sync_point_wait_list,
-        pocl_append_unique_migration_info (NULL, buffer, rdonly));
+        num_items_in_wait_list, sync_point_wait_list, migr_infos);
     }
   if (errcode != CL_SUCCESS)
     return errcode;
@@ -23,6 +23,7 @@
    IN THE SOFTWARE.
 */
 
+#include "devices/common.h"
 #include "devices/devices.h"
 #include "pocl_runtime_config.h"
 #include "pocl_util.h"
@@ -111,6 +112,8 @@ POname(clReleaseContext)(cl_context context) CL_API_SUFFIX__VERSION_1_0
 
       /* see below on why we don't call uninit_devices here anymore */
       --cl_context_count;
+
+      pocl_print_system_memory_stats ();
     }
   else
     {
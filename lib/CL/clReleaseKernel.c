@@ -62,6 +62,7 @@ POname(clReleaseKernel)(cl_kernel kernel) CL_API_SUFFIX__VERSION_1_0
           if (device->ops->free_kernel && (*(device->available) == CL_TRUE))
             device->ops->free_kernel (device, program, kernel, i);
         }
+      pocl_free_kernel_arg_blocks (kernel);
 
       if (kernel->meta->total_argument_storage_size)
         {
@@ -24,6 +24,8 @@
 
 #include "devices.h"
 #include "pocl_cl.h"
+#include "pocl_host_mem_pool.h"
+#include "pocl_mem_management.h"
 #include "pocl_util.h"
 #include "utlist.h"
 
@@ -158,7 +160,10 @@ POname(clReleaseMemObject)(cl_mem memobj) CL_API_SUFFIX__VERSION_1_0
                 memobj->mem_host_ptr = NULL;
               else
                 {
-                  pocl_aligned_free (memobj->mem_host_ptr);
+                  size_t align
+                      = max (memobj->context->min_buffer_alignment, 16);
+                  pocl_host_mem_free (memobj->mem_host_ptr, align,
+                                      memobj->size);
                 }
             }
         }
@@ -166,6 +171,8 @@ POname(clReleaseMemObject)(cl_mem memobj) CL_API_SUFFIX__VERSION_1_0
         free_sub_buffer_data (memobj);
 
       POCL_MEM_FREE (memobj->device_ptrs);
+      POCL_MEM_FREE (memobj->dirty_log);
+      pocl_free_broadcast_state (memobj);
 
       assert (memobj->destructor_callbacks == NULL);
 
@@ -37,10 +37,18 @@ pocl_validate_img_attrs (cl_dbk_id_exp kernel_id,
         pocl_image_attr_t output_attr = attrs->output_image;
 
         POCL_RETURN_ERROR_ON ((input_attr.format != POCL_DF_IMAGE_NV12
-                               || output_attr.format != POCL_DF_IMAGE_RGB),
+                               && input_attr.format != POCL_DF_IMAGE_NV21
+                               && input_attr.format != POCL_DF_IMAGE_IYUV),
                               CL_DBK_INVALID_ATTRIBUTE_EXP,
-                              "other color conversions than nv12->rgb have "
-                              "not been implemented yet.\n");
+                              "other input formats than nv12, nv21 and iyuv "
+                              "have not been implemented yet.\n");
+
+        POCL_RETURN_ERROR_ON ((output_attr.format != POCL_DF_IMAGE_RGB
+                               && output_attr.format != POCL_DF_IMAGE_RGBA
+                               && output_attr.format != POCL_DF_IMAGE_BGRA),
+                              CL_DBK_INVALID_ATTRIBUTE_EXP,
+                              "other output formats than rgb, rgba and bgra "
+                              "have not been implemented yet.\n");
 
         POCL_RETURN_ERROR_ON (
           (input_attr.color_space != POCL_COLOR_SPACE_BT709
@@ -1036,11 +1036,9 @@ pocl_basic_create_kernel (cl_device_id device,
   cl_dbk_id_exp dbk_id = p->builtin_kernel_ids[dbk_index];
   switch (dbk_id)
     {
-#ifdef HAVE_LIBXSMM
     case CL_DBK_GEMM_EXP:
     case CL_DBK_MATMUL_EXP:
       return status;
-#endif
 #ifdef HAVE_LIBJPEG_TURBO
     case CL_DBK_JPEG_ENCODE_EXP:
       {
@@ -1065,6 +1063,8 @@ pocl_basic_create_kernel (cl_device_id device,
       }
 #endif
     case CL_DBK_IMG_COLOR_CONVERT_EXP:
+    case CL_DBK_CONVERT_EXP:
+    case CL_DBK_SET_ROWS_EXP:
       return CL_SUCCESS;
 #ifdef HAVE_OPENCV
     case CL_DBK_NMS_BOX_EXP:
@@ -1099,11 +1099,9 @@ pocl_basic_free_kernel (cl_device_id device,
   cl_dbk_id_exp dbk_id = p->builtin_kernel_ids[dbk_index];
   switch (dbk_id)
     {
-#ifdef HAVE_LIBXSMM
     case CL_DBK_GEMM_EXP:
     case CL_DBK_MATMUL_EXP:
       return status;
-#endif
 #ifdef HAVE_LIBJPEG_TURBO
     case CL_DBK_JPEG_ENCODE_EXP:
       {
@@ -1125,6 +1123,8 @@ pocl_basic_free_kernel (cl_device_id device,
       }
 #endif
     case CL_DBK_IMG_COLOR_CONVERT_EXP:
+    case CL_DBK_CONVERT_EXP:
+    case CL_DBK_SET_ROWS_EXP:
       return CL_SUCCESS;
 #ifdef HAVE_OPENCV
     case CL_DBK_NMS_BOX_EXP:
@@ -51,6 +51,7 @@
 #include "pocl_cache.h"
 #include "pocl_debug.h"
 #include "pocl_dynlib.h"
+#include "pocl_host_mem_pool.h"
 #include "pocl_file_util.h"
 #include "pocl_image_util.h"
 #include "pocl_mem_management.h"
@@ -510,6 +511,18 @@ pocl_exec_command (_cl_command_node *node)
                   &node->migr_infos->buffer->device_ptrs[dev->global_mem_id],
                   mem->mem_host_ptr, NULL, origin, region, 0, 0, 0);
               }
+            else if (cmd->migrate.ranges.num > 0)
+              {
+                /* Only the ranges modified after the host's version. */
+                const pocl_interval_set *r = &cmd->migrate.ranges;
+                assert (dev->ops->read);
+                for (unsigned j = 0; j < r->num; ++j)
+                  dev->ops->read (
+                    dev->data, (char *)mem->mem_host_ptr + r->start[j],
+                    &node->migr_infos->buffer
+                       ->device_ptrs[dev->global_mem_id],
+                    mem, r->start[j], r->end[j] - r->start[j]);
+              }
             else
               {
                 assert (dev->ops->read);
@@ -537,6 +550,18 @@ pocl_exec_command (_cl_command_node *node)
                   &node->migr_infos->buffer->device_ptrs[dev->global_mem_id],
                   mem->mem_host_ptr, NULL, origin, region, 0, 0, 0);
               }
+            else if (cmd->migrate.ranges.num > 0)
+              {
+                /* Only the ranges modified after the device's version. */
+                const pocl_interval_set *r = &cmd->migrate.ranges;
+                assert (dev->ops->write);
+                for (unsigned j = 0; j < r->num; ++j)
+                  dev->ops->write (
+                    dev->data, (char *)mem->mem_host_ptr + r->start[j],
+                    &node->migr_infos->buffer
+                       ->device_ptrs[dev->global_mem_id],
+                    mem, r->start[j], r->end[j] - r->start[j]);
+              }
             else
               {
                 assert (dev->ops->write);
@@ -1451,6 +1476,7 @@ pocl_print_system_memory_stats()
                     system_memory.total_alloc_limit >> 10,
                     system_memory.currently_allocated >> 10,
                     system_memory.max_ever_allocated >> 10);
+  pocl_host_mem_pool_print_stats ();
 }
 
 /* default WG size in each dimension & total WG size.
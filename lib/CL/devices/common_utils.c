@@ -343,10 +343,10 @@ pocl_cpu_init_common (cl_device_id device, unsigned dev_i)
                   "org.khronos.openvx.scale_image.bl.u8;"
                   "org.khronos.openvx.tensor_convert_depth.wrap.u8.f32;"
                   "img_color_convert_exp;"
-#ifdef HAVE_LIBXSMM
                   "gemm_exp;"
                   "matmul_exp;"
-#endif
+                  "convert_exp;"
+                  "set_rows_exp;"
 #ifdef HAVE_LIBJPEG_TURBO
                   "jpeg_encode_exp;"
                   "jpeg_decode_exp;"
@@ -358,10 +358,7 @@ pocl_cpu_init_common (cl_device_id device, unsigned dev_i)
                   "nms_box_exp;"
 #endif
         );
-      device->num_builtin_kernels = 5
-#ifdef HAVE_LIBXSMM
-                                    + 2
-#endif
+      device->num_builtin_kernels = 9
 #ifdef HAVE_LIBJPEG_TURBO
                                     + 2
 #endif
@@ -568,75 +565,158 @@ pocl_cpu_init_common (cl_device_id device, unsigned dev_i)
   return ret;
 }
 
+/* the number of blocks kept per kernel for reuse */
+#define MAX_CACHED_ARG_BLOCKS 4
+
+#define ARG_BLOCK_HEADER_SIZE                                                 \
+  ((sizeof (pocl_kernel_arg_block) + MAX_EXTENDED_ALIGNMENT - 1)              \
+   & ~(MAX_EXTENDED_ALIGNMENT - 1))
+
+/* the arguments array directly follows the header */
+#define ARG_BLOCK_OF(arguments)                                               \
+  ((pocl_kernel_arg_block *)((char *)(arguments)-ARG_BLOCK_HEADER_SIZE))
+
+static pocl_kernel_arg_block *
+new_kernel_arg_block (kernel_run_command *k)
+{
+  pocl_kernel_metadata_t *meta = k->kernel->meta;
+  unsigned num_images = 0;
+  for (cl_uint i = 0; i < meta->num_args; ++i)
+    if (meta->arg_info[i].type == POCL_ARG_TYPE_IMAGE)
+      ++num_images;
+
+  size_t images_offset = ARG_BLOCK_HEADER_SIZE + 3 * ARGS_SIZE;
+  images_offset = (images_offset + MAX_EXTENDED_ALIGNMENT - 1)
+                  & ~(MAX_EXTENDED_ALIGNMENT - 1);
+  size_t total = images_offset + num_images * sizeof (dev_image_t);
+  char *p = pocl_aligned_malloc (MAX_EXTENDED_ALIGNMENT, total);
+  if (p == NULL)
+    return NULL;
+  memset (p, 0, total);
+
+  pocl_kernel_arg_block *b = (pocl_kernel_arg_block *)p;
+  void **arguments = (void **)(p + ARG_BLOCK_HEADER_SIZE);
+  void **arguments2 = arguments + (ARGS_SIZE / sizeof (void *));
+  b->device = k->device;
+  b->keys = (uint64_t *)(arguments2 + (ARGS_SIZE / sizeof (void *)));
+  b->images = (dev_image_t *)(p + images_offset);
+
+  /* the slots which are the same for every launch */
+  unsigned j = 0;
+  for (cl_uint i = 0; i < meta->num_args; ++i)
+    {
+      if (ARG_IS_LOCAL (meta->arg_info[i]))
+        continue;
+      switch (meta->arg_info[i].type)
+        {
+        case POCL_ARG_TYPE_POINTER:
+          arguments[i] = &arguments2[i];
+          break;
+        case POCL_ARG_TYPE_SAMPLER:
+          arguments[i] = &arguments2[i];
+          b->keys[i] = UINT64_MAX;
+          break;
+        case POCL_ARG_TYPE_IMAGE:
+          arguments[i] = &arguments2[i];
+          arguments2[i] = &b->images[j++];
+          b->keys[i] = UINT64_MAX;
+          break;
+        default:
+          break;
+        }
+    }
+  return b;
+}
+
 /* called from kernel setup code.
- * Sets up the actual arguments, except the local ones. */
-void
+ * Sets up the actual arguments, except the local ones.
+ * Returns CL_OUT_OF_HOST_MEMORY if the argument arrays can't be allocated. */
+int
 pocl_setup_kernel_arg_array (kernel_run_command *k)
 {
   struct pocl_argument *al;
 
   pocl_kernel_metadata_t *meta = k->kernel->meta;
+  cl_kernel kernel = k->kernel;
   cl_uint i;
-  void **arguments;
-  void **arguments2;
-  k->arguments = arguments = malloc (ARGS_SIZE);
-  k->arguments2 = arguments2 = malloc (ARGS_SIZE);
+  pocl_kernel_arg_block *b, *prev = NULL;
+
+  POCL_LOCK_OBJ (kernel);
+  for (b = (pocl_kernel_arg_block *)kernel->cpu_arg_blocks; b != NULL;
+       prev = b, b = b->next)
+    {
+      if (b->device != k->device)
+        continue;
+      if (prev)
+        prev->next = b->next;
+      else
+        kernel->cpu_arg_blocks = b->next;
+      break;
+    }
+  POCL_UNLOCK_OBJ (kernel);
+
+  if (b == NULL)
+    b = new_kernel_arg_block (k);
+  if (b == NULL)
+    return CL_OUT_OF_HOST_MEMORY;
+
+  void **arguments = (void **)((char *)b + ARG_BLOCK_HEADER_SIZE);
+  void **arguments2 = arguments + (ARGS_SIZE / sizeof (void *));
+  k->arguments = arguments;
+  k->arguments2 = arguments2;
 
   for (i = 0; i < meta->num_args; ++i)
     {
       al = &(k->kernel_args[i]);
       if (ARG_IS_LOCAL (meta->arg_info[i]))
-        {
-          arguments[i] = NULL;
-          arguments2[i] = NULL;
-        }
+        continue;
       else if (meta->arg_info[i].type == POCL_ARG_TYPE_POINTER)
         {
           /* It's legal to pass a NULL pointer to clSetKernelArguments. In
              that case we must pass the same NULL forward to the kernel.
              Otherwise, the user must have created a buffer with per device
              pointers stored in the cl_mem. */
-          arguments[i] = &arguments2[i];
-          if (al->value == NULL)
+          void *ptr = NULL;
+          if (al->value != NULL && al->is_raw_ptr)
+            ptr = *(void **)al->value;
+          else if (al->value != NULL)
             {
-              arguments2[i] = NULL;
-            }
-          else
-            {
-              void *ptr = NULL;
-              if (al->is_raw_ptr)
-                {
-                  ptr = *(void **)al->value;
-                }
-              else
-                {
-                  cl_mem m = (*(cl_mem *)(al->value));
-                  ptr = m->device_ptrs[k->device->global_mem_id].mem_ptr;
-                }
-              arguments2[i] = (char *)ptr;
+              cl_mem m = (*(cl_mem *)(al->value));
+              ptr = m->device_ptrs[k->device->global_mem_id].mem_ptr;
             }
+          arguments2[i] = (char *)ptr;
         }
       else if (meta->arg_info[i].type == POCL_ARG_TYPE_IMAGE)
         {
-          dev_image_t di = { NULL };
-          pocl_fill_dev_image_t (&di, al, k->device);
-          void *devptr = pocl_aligned_malloc (MAX_EXTENDED_ALIGNMENT,
-                                              sizeof (dev_image_t));
-          arguments[i] = &arguments2[i];
-          arguments2[i] = devptr;
-          memcpy (devptr, &di, sizeof (dev_image_t));
+          cl_mem m = *(cl_mem *)al->value;
+          dev_image_t *di = (dev_image_t *)arguments2[i];
+          if (b->keys[i] != m->id)
+            {
+              pocl_fill_dev_image_t (di, al, k->device);
+              b->keys[i] = m->id;
+            }
+          else
+            {
+              /* only the storage can change for the same image */
+              IMAGE1D_TO_BUFFER (m);
+              di->_data = m->device_ptrs[k->device->global_mem_id].mem_ptr;
+            }
         }
       else if (meta->arg_info[i].type == POCL_ARG_TYPE_SAMPLER)
         {
-          dev_sampler_t ds;
-          pocl_fill_dev_sampler_t (&ds, al);
-
-          arguments[i] = &arguments2[i];
-          arguments2[i] = (void *)ds;
+          cl_sampler s = *(cl_sampler *)al->value;
+          if (b->keys[i] != s->id)
+            {
+              dev_sampler_t ds;
+              pocl_fill_dev_sampler_t (&ds, al);
+              arguments2[i] = (void *)ds;
+              b->keys[i] = s->id;
+            }
         }
       else
         arguments[i] = al->value;
     }
+  return CL_SUCCESS;
 }
 
 /* called from each driver thread.
@@ -728,38 +808,29 @@ pocl_setup_kernel_arg_array_with_locals (void **arguments,
 }
 
 /* called from kernel teardown code.
- * frees the actual arguments, except the local ones. */
+ * Returns the argument arrays to the kernel for reuse. */
 void
 pocl_free_kernel_arg_array (kernel_run_command *k)
 {
-  cl_uint i;
-  pocl_kernel_metadata_t *meta = k->kernel->meta;
-  void **arguments = k->arguments;
-  void **arguments2 = k->arguments2;
-
-  for (i = 0; i < meta->num_args; ++i)
+  cl_kernel kernel = k->kernel;
+  pocl_kernel_arg_block *b = ARG_BLOCK_OF (k->arguments);
+  pocl_kernel_arg_block *c;
+  unsigned num_cached = 0;
+
+  POCL_LOCK_OBJ (kernel);
+  LL_FOREACH ((pocl_kernel_arg_block *)kernel->cpu_arg_blocks, c)
+    ++num_cached;
+  if (num_cached < MAX_CACHED_ARG_BLOCKS)
     {
-      if (ARG_IS_LOCAL (meta->arg_info[i]))
-        {
-          if (!k->device->device_alloca_locals)
-            {
-              assert (arguments[i] == NULL);
-              assert (arguments2[i] == NULL);
-            }
-          else
-            {
-              /* Device side local space allocation has deallocation via stack
-                 unwind. */
-            }
-        }
-      else if (meta->arg_info[i].type == POCL_ARG_TYPE_IMAGE)
-        {
-          pocl_aligned_free (arguments2[i]);
-        }
+      b->next = (pocl_kernel_arg_block *)kernel->cpu_arg_blocks;
+      kernel->cpu_arg_blocks = b;
+      b = NULL;
     }
+  POCL_UNLOCK_OBJ (kernel);
 
-  POCL_MEM_FREE (k->arguments);
-  POCL_MEM_FREE (k->arguments2);
+  pocl_aligned_free (b);
+  k->arguments = NULL;
+  k->arguments2 = NULL;
 }
 
 /* called from each driver thread.
@@ -828,6 +899,7 @@ pocl_convert_to_libxsmm_type (cl_tensor_datatype_exp T)
       return LIBXSMM_DATATYPE_UNSUPPORTED;
     }
 }
+#endif
 
 int
 pocl_cpu_validate_khr_gemm (cl_bool TransA,
@@ -912,12 +984,22 @@ pocl_cpu_validate_khr_gemm (cl_bool TransA,
                             "CPU supports only Beta == 0.0 or 1.0\n");
     }
 
-  /* TODO: check validity of data layouts of the tensors. Now assume
-   * they are correct and they are using BLAS-like layout. */
+  const cl_tensor_desc_exp *Tensors[] = { TenA, TenB, TenCOut };
+  for (unsigned I = 0; I < 3; ++I)
+    {
+      POCL_RETURN_ERROR_ON ((Tensors[I]->layout_type != CL_TENSOR_LAYOUT_BLAS_EXP
+                             && Tensors[I]->layout_type
+                                  != CL_TENSOR_LAYOUT_BLAS_PITCHED_EXP),
+                            CL_INVALID_TENSOR_LAYOUT_EXP,
+                            "CPU supports only BLAS tensor layouts\n");
+      POCL_RETURN_ERROR_ON ((Tensors[I]->rank < 2 || Tensors[I]->rank > 3),
+                            CL_INVALID_TENSOR_RANK_EXP,
+                            "CPU supports only matrices and batches of "
+                            "matrices\n");
+    }
 
   return CL_SUCCESS;
 }
-#endif
 
 int
 pocl_cpu_supports_dbk (cl_device_id device,
@@ -926,16 +1008,14 @@ pocl_cpu_supports_dbk (cl_device_id device,
 {
   switch (kernel_id)
     {
-#ifdef HAVE_LIBXSMM
     case CL_DBK_GEMM_EXP:
     case CL_DBK_MATMUL_EXP:
       {
-        /* The following code checks for LIBXSMM specific requirements put
+        /* The following code checks for the CPU specific requirements put
          * on the tensors that are part of the kernel attributes. */
         return pocl_validate_dbk_attributes (kernel_id, kernel_attributes,
                                              pocl_cpu_validate_khr_gemm);
       }
-#endif
 #ifdef HAVE_LIBJPEG_TURBO
     case CL_DBK_JPEG_DECODE_EXP:
     case CL_DBK_JPEG_ENCODE_EXP:
@@ -951,6 +1031,22 @@ pocl_cpu_supports_dbk (cl_device_id device,
     case CL_DBK_NMS_BOX_EXP:
       return pocl_validate_dbk_attributes (kernel_id, kernel_attributes, NULL);
 #endif
+    case CL_DBK_CONVERT_EXP:
+      {
+        int err
+          = pocl_validate_dbk_attributes (kernel_id, kernel_attributes, NULL);
+        if (err != CL_SUCCESS)
+          return err;
+        return pocl_cpu_validate_dbk_convert (kernel_attributes);
+      }
+    case CL_DBK_SET_ROWS_EXP:
+      {
+        int err
+          = pocl_validate_dbk_attributes (kernel_id, kernel_attributes, NULL);
+        if (err != CL_SUCCESS)
+          return err;
+        return pocl_cpu_validate_dbk_set_rows (kernel_attributes);
+      }
     default:
       POCL_RETURN_ERROR (
         CL_DBK_UNSUPPORTED_EXP,
@@ -969,29 +1065,11 @@ pocl_cpu_probe ()
 int
 pocl_cpu_build_defined_builtin (cl_program program, cl_uint device_i)
 {
-
-#ifdef HAVE_LIBXSMM
-  /* TODO perhaps prebuild something here ? */
-  return CL_SUCCESS;
-#endif
-#ifdef HAVE_LIBJPEG_TURBO
-  return CL_SUCCESS;
-#endif
-#ifdef HAVE_ONNXRT
+  /* The DBKs have been validated by pocl_cpu_supports_dbk () at program
+     creation, and the CPU implementations need no build step. */
   return CL_SUCCESS;
-#endif
-#ifdef HAVE_OPENCV
-  return CL_SUCCESS;
-#endif
-  /* TODO: is it necessary to return an error here or can it be caught earlier
-     on? */
-  POCL_RETURN_ERROR (
-    CL_BUILD_PROGRAM_FAILURE,
-    "The CPU driver has not been compiled with support for DBKs\n");
 }
 
-#ifdef HAVE_LIBXSMM
-
 static cl_bool
 tensor_is_blas_row_major (const cl_tensor_desc_exp *A)
 {
@@ -1057,26 +1135,118 @@ tensor_get_blas_stride_in_elements (const cl_tensor_desc_exp *A, unsigned Dim)
            * tensor_get_trailing_dim (A, BL->leading_dims);
 }
 
+/* Sets the element strides of the rows, the columns and the batch entries
+ * (zero for a single matrix, which is then broadcast over the batch) of a
+ * BLAS matrix, swapping the rows and the columns if it is transposed. */
+static void
+tensor_get_gemm_strides (const cl_tensor_desc_exp *A,
+                         cl_bool Transpose,
+                         size_t *Strides)
+{
+  size_t Ld = tensor_get_blas_stride_in_elements (A, 0);
+  cl_bool RowMajor = tensor_is_blas_row_major (A) ^ Transpose;
+  Strides[0] = RowMajor ? Ld : 1;
+  Strides[1] = RowMajor ? 1 : Ld;
+  Strides[2] = A->rank > 2 ? tensor_get_blas_stride_in_elements (A, 1) : 0;
+}
+
+#ifdef HAVE_LIBXSMM
+
+/* A GEMM or matmul launch, its chunks are the batch entries. */
+typedef struct pocl_xsmm_gemm
+{
+  libxsmm_gemmfunction Kernel;
+  char *A;
+  char *B;
+  char *COut;
+  char *CIOpt;
+  const cl_tensor_desc_exp *TenCIOpt;
+  const cl_tensor_desc_exp *TenCout;
+  size_t InElemSize;
+  size_t OutElemSize;
+  size_t COm;
+  size_t COn;
+  size_t Ldc;
+  size_t ABatchStrideInElts;
+  size_t BBatchStrideInElts;
+  size_t CBatchStrideInElts;
+  float Beta;
+} pocl_xsmm_gemm;
+
 static int
-pocl_cpu_execute_gemm_anytype (char *Aptr,
-                               char *Bptr,
-                               char *COut,
-                               char *CIopt,
-                               libxsmm_datatype InElemType,
-                               size_t InElemSize,
-                               libxsmm_datatype OutElemType,
-                               size_t OutElemSize,
-                               cl_bool TransposeA,
-                               cl_bool TransposeB,
-                               const cl_tensor_desc_exp *TenA,
-                               const cl_tensor_desc_exp *TenB,
-                               const cl_tensor_desc_exp *TenCout,
-                               const cl_tensor_desc_exp *TenCIOpt,
-                               float Alpha,
-                               float Beta)
+pocl_xsmm_gemm_run (void *State, size_t First, size_t Count)
+{
+  const pocl_xsmm_gemm *G = (const pocl_xsmm_gemm *)State;
+  size_t OutElemSize = G->OutElemSize;
+  size_t COm = G->COm;
+  size_t COn = G->COn;
+  size_t Ldc = G->Ldc;
+
+  libxsmm_gemm_param gemm_param
+    = { 0 }; /* collect call-arguments into single structure */
+
+  for (size_t BatchIndex = First; BatchIndex < First + Count; ++BatchIndex)
+    {
+
+      char *Src = &G->CIOpt[BatchIndex * G->CBatchStrideInElts * OutElemSize];
+      char *Dst = &G->COut[BatchIndex * G->CBatchStrideInElts * OutElemSize];
+
+      if (G->TenCIOpt && G->Beta != 0.0f)
+        {
+          if (tensor_is_blas_row_major (G->TenCIOpt))
+            {
+              /* Need to convert C input to column-major. */
+              libxsmm_otrans (Dst, Src, OutElemSize, COm, COn, Ldc, COm);
+            }
+          else
+            {
+              /* copy CIn to COut */
+              libxsmm_matcopy (Dst, Src, OutElemSize, COm, COn, Ldc, COm);
+            }
+        }
+      else
+        {
+          /* Zero-initialize. */
+          libxsmm_matcopy (Dst, NULL, OutElemSize, COm, COn, Ldc, COm);
+        }
+
+      gemm_param.a.primary
+        = &G->A[BatchIndex * G->ABatchStrideInElts * G->InElemSize];
+      gemm_param.b.primary
+        = &G->B[BatchIndex * G->BBatchStrideInElts * G->InElemSize];
+      gemm_param.c.primary = Dst;
+      G->Kernel (&gemm_param);
+
+      if (tensor_is_blas_row_major (G->TenCout))
+        {
+          /* Results are always in column-major. */
+          libxsmm_itrans (Dst, OutElemSize, COm, COn, COm, Ldc);
+        }
+    }
+
+  return CL_SUCCESS;
+}
+
+static int
+pocl_xsmm_partition_gemm_anytype (char *Aptr,
+                                  char *Bptr,
+                                  char *COut,
+                                  char *CIopt,
+                                  libxsmm_datatype InElemType,
+                                  size_t InElemSize,
+                                  libxsmm_datatype OutElemType,
+                                  size_t OutElemSize,
+                                  cl_bool TransposeA,
+                                  cl_bool TransposeB,
+                                  const cl_tensor_desc_exp *TenA,
+                                  const cl_tensor_desc_exp *TenB,
+                                  const cl_tensor_desc_exp *TenCout,
+                                  const cl_tensor_desc_exp *TenCIOpt,
+                                  float Alpha,
+                                  float Beta,
+                                  pocl_cpu_dbk_partition *Part)
 {
   libxsmm_datatype CompElemType = OutElemType;
-  size_t CompElemSize = OutElemSize;
 
   size_t BatchDims = TenA->rank - 2;
   size_t Am = TenA->shape[BatchDims + 0];
@@ -1107,9 +1277,6 @@ pocl_cpu_execute_gemm_anytype (char *Aptr,
   size_t Lda = tensor_get_blas_stride_in_elements (TenA, 0);
   size_t Ldb = tensor_get_blas_stride_in_elements (TenB, 0);
   size_t Ldc = tensor_get_blas_stride_in_elements (TenCout, 0);
-  size_t ABatchStrideInElts = tensor_get_blas_stride_in_elements (TenA, 1);
-  size_t BBatchStrideInElts = tensor_get_blas_stride_in_elements (TenB, 1);
-  size_t CBatchStrideInElts = tensor_get_blas_stride_in_elements (TenCout, 1);
 
   /* libxsmm expects data in column-major format but we can feed it
    * row-major data by transposing the inputs and and the output. */
@@ -1130,74 +1297,81 @@ pocl_cpu_execute_gemm_anytype (char *Aptr,
     // m /*lda*/, k /*ldb*/, m /*ldc*/,
     Lda, Ldb, Ldc, InElemType, InElemType, OutElemType, CompElemType);
 
-  /* generate and dispatch a matrix multiplication kernel */
+  /* generate and dispatch a matrix multiplication kernel; the dispatched
+   * kernels are thread-safe, so the batch entries can run in parallel */
   const libxsmm_gemmfunction kernel = libxsmm_dispatch_gemm (
     gemm_shape, (libxsmm_bitfield)(flags_trans | flags_ab),
     (libxsmm_bitfield)LIBXSMM_GEMM_PREFETCH_NONE);
   assert (NULL != kernel && "LIBXSMM: JIT generation of kernel failed");
 
-  libxsmm_gemm_param gemm_param
-    = { 0 }; /* collect call-arguments into single structure */
+  pocl_xsmm_gemm *G = (pocl_xsmm_gemm *)malloc (sizeof (pocl_xsmm_gemm));
+  if (G == NULL)
+    return CL_OUT_OF_HOST_MEMORY;
+  G->Kernel = kernel;
+  G->A = Aptr;
+  G->B = Bptr;
+  G->COut = COut;
+  G->CIOpt = CIopt;
+  G->TenCIOpt = TenCIOpt;
+  G->TenCout = TenCout;
+  G->InElemSize = InElemSize;
+  G->OutElemSize = OutElemSize;
+  G->COm = COm;
+  G->COn = COn;
+  G->Ldc = Ldc;
+  G->ABatchStrideInElts = tensor_get_blas_stride_in_elements (TenA, 1);
+  G->BBatchStrideInElts = tensor_get_blas_stride_in_elements (TenB, 1);
+  G->CBatchStrideInElts = tensor_get_blas_stride_in_elements (TenCout, 1);
+  G->Beta = Beta;
+
+  Part->num_chunks = TenA->rank > 2 ? TenA->shape[0] : 1;
+  Part->run = pocl_xsmm_gemm_run;
+  Part->finish = free;
+  Part->state = G;
+  return CL_SUCCESS;
+}
 
-  size_t BatchSize = TenA->rank > 2 ? TenA->shape[0] : 1;
+#endif
 
-  for (size_t BatchIndex = 0; BatchIndex < BatchSize; ++BatchIndex)
+static cl_bool
+gemm_scalar_is_zero (const void *Value, cl_tensor_datatype_exp Dtype)
+{
+  switch (Dtype)
     {
-
-      char *Src = &CIopt[BatchIndex * CBatchStrideInElts * OutElemSize];
-      char *Dst = &COut[BatchIndex * CBatchStrideInElts * OutElemSize];
-
-      if (TenCIOpt && Beta != 0.0f)
-        {
-          if (tensor_is_blas_row_major (TenCIOpt))
-            {
-              /* Need to convert C input to column-major. */
-              libxsmm_otrans (Dst, Src, OutElemSize, COm, COn, Ldc, COm);
-            }
-          else
-            {
-              /* copy CIn to COut */
-              libxsmm_matcopy (Dst, Src, OutElemSize, COm, COn, Ldc, COm);
-            }
-        }
-      else
-        {
-          /* Zero-initialize. */
-          libxsmm_matcopy (Dst, NULL, OutElemSize, COm, COn, Ldc, COm);
-        }
-
-      gemm_param.a.primary
-        = &Aptr[BatchIndex * ABatchStrideInElts * InElemSize];
-      gemm_param.b.primary
-        = &Bptr[BatchIndex * BBatchStrideInElts * InElemSize];
-      gemm_param.c.primary
-        = &COut[BatchIndex * CBatchStrideInElts * OutElemSize];
-      kernel (&gemm_param);
-
-      if (tensor_is_blas_row_major (TenCout))
-        {
-          /* Results are always in column-major. */
-          libxsmm_itrans (Dst, OutElemSize, COm, COn, COm, Ldc);
-        }
+    case CL_TENSOR_DTYPE_FP16_EXP:
+      return (*(const cl_half *)Value & 0x7fff) == 0;
+    case CL_TENSOR_DTYPE_FP32_EXP:
+      return *(const cl_float *)Value == 0.0f;
+    case CL_TENSOR_DTYPE_FP64_EXP:
+      return *(const cl_double *)Value == 0.0;
+    default:
+      {
+        const char *Bytes = (const char *)Value;
+        for (int I = 0; I < pocl_tensor_type_size (Dtype); ++I)
+          if (Bytes[I] != 0)
+            return CL_FALSE;
+        return CL_TRUE;
+      }
     }
-
-  return CL_SUCCESS;
 }
 
+/* Uses libxsmm if it's available and not overridden by POCL_CPU_GEMM_KERNEL,
+ * otherwise the native implementation in cpu_dbk. */
 static int
-pocl_xsmm_execute_dbk (cl_program program,
-                       cl_kernel kernel,
-                       pocl_kernel_metadata_t *meta,
-                       cl_uint dev_i,
-                       struct pocl_argument *arguments)
+pocl_cpu_partition_gemm (cl_program program,
+                         cl_kernel kernel,
+                         pocl_kernel_metadata_t *meta,
+                         cl_uint dev_i,
+                         struct pocl_argument *arguments,
+                         pocl_cpu_dbk_partition *part)
 {
   cl_device_id dev = program->devices[dev_i];
   unsigned mem_id = dev->global_mem_id;
   void *A = pocl_cpu_get_ptr (&arguments[0], mem_id);
   void *B = pocl_cpu_get_ptr (&arguments[1], mem_id);
   void *Cin = NULL;
-  void *Cout = pocl_cpu_get_ptr (&arguments[2], mem_id);
-  float Alpha = 1.0f, Beta = 0.0f;
+  void *Cout = NULL;
+  const void *BetaValue = NULL;
   cl_tensor_datatype_exp InDtype, OutDtype;
   cl_bool TransposeA, TransposeB;
   const cl_tensor_desc_exp *TenA;
@@ -1211,10 +1385,9 @@ pocl_xsmm_execute_dbk (cl_program program,
       {
         const cl_dbk_attributes_gemm_exp *Attrs
           = (const cl_dbk_attributes_gemm_exp *)meta->builtin_kernel_attrs;
-        void *Cin = pocl_cpu_get_ptr (&arguments[2], mem_id);
-        void *Cout = pocl_cpu_get_ptr (&arguments[3], mem_id);
-        memcpy (&Alpha, arguments[4].value, sizeof (float));
-        memcpy (&Beta, arguments[5].value, sizeof (float));
+        Cin = pocl_cpu_get_ptr (&arguments[2], mem_id);
+        Cout = pocl_cpu_get_ptr (&arguments[3], mem_id);
+        BetaValue = arguments[5].value;
         InDtype = Attrs->a.dtype;
         OutDtype = Attrs->c_out.dtype;
         TransposeA = Attrs->trans_a;
@@ -1229,6 +1402,7 @@ pocl_xsmm_execute_dbk (cl_program program,
       {
         const cl_dbk_attributes_matmul_exp *Attrs
           = (const cl_dbk_attributes_matmul_exp *)meta->builtin_kernel_attrs;
+        Cout = pocl_cpu_get_ptr (&arguments[2], mem_id);
         InDtype = Attrs->a.dtype;
         OutDtype = Attrs->c.dtype;
         TransposeA = Attrs->trans_a;
@@ -1245,17 +1419,85 @@ pocl_xsmm_execute_dbk (cl_program program,
       return CL_FAILED;
     }
 
-  libxsmm_datatype InElemType = pocl_convert_to_libxsmm_type (InDtype);
-  size_t InElemSize = pocl_tensor_type_size (InDtype);
-  libxsmm_datatype OutElemType = pocl_convert_to_libxsmm_type (OutDtype);
-  size_t OutElemSize = pocl_tensor_type_size (OutDtype);
+#ifdef HAVE_LIBXSMM
+  const char *Impl = pocl_get_string_option ("POCL_CPU_GEMM_KERNEL", "auto");
+  if (strcmp (Impl, "auto") == 0 || strcmp (Impl, "libxsmm") == 0)
+    {
+      float Alpha = 1.0f, Beta = 0.0f;
+      if (meta->builtin_kernel_id == CL_DBK_GEMM_EXP)
+        {
+          memcpy (&Alpha, arguments[4].value, sizeof (float));
+          memcpy (&Beta, arguments[5].value, sizeof (float));
+        }
+      libxsmm_datatype InElemType = pocl_convert_to_libxsmm_type (InDtype);
+      size_t InElemSize = pocl_tensor_type_size (InDtype);
+      libxsmm_datatype OutElemType = pocl_convert_to_libxsmm_type (OutDtype);
+      size_t OutElemSize = pocl_tensor_type_size (OutDtype);
+
+      return pocl_xsmm_partition_gemm_anytype (
+        A, B, Cout, Cin, InElemType, InElemSize, OutElemType, OutElemSize,
+        TransposeA, TransposeB, TenA, TenB, TenCout, TenCIOpt, Alpha, Beta,
+        part);
+    }
+#endif
 
-  return pocl_cpu_execute_gemm_anytype (
-    A, B, Cout, Cin, InElemType, InElemSize, OutElemType, OutElemSize,
-    TransposeA, TransposeB, TenA, TenB, TenCout, TenCIOpt, Alpha, Beta);
+  pocl_cpu_gemm_desc Desc;
+  size_t BatchDims = TenCout->rank - 2;
+  Desc.a = A;
+  Desc.b = B;
+  Desc.c_out = Cout;
+  Desc.c_in = NULL;
+  if (Cin != NULL && BetaValue != NULL
+      && !gemm_scalar_is_zero (BetaValue, InDtype))
+    Desc.c_in = Cin;
+  Desc.a_dtype = InDtype;
+  Desc.b_dtype = TenB->dtype;
+  Desc.c_dtype = OutDtype;
+  Desc.m = TenCout->shape[BatchDims + 0];
+  Desc.n = TenCout->shape[BatchDims + 1];
+  Desc.k = TenA->shape[TenA->rank - (TransposeA ? 2 : 1)];
+  Desc.batch = BatchDims > 0 ? TenCout->shape[0] : 1;
+  tensor_get_gemm_strides (TenA, TransposeA, Desc.a_strides);
+  tensor_get_gemm_strides (TenB, TransposeB, Desc.b_strides);
+  tensor_get_gemm_strides (TenCout, CL_FALSE, Desc.c_out_strides);
+  if (Desc.c_in != NULL && TenCIOpt->layout != NULL)
+    tensor_get_gemm_strides (TenCIOpt, CL_FALSE, Desc.c_in_strides);
+  else
+    memcpy (Desc.c_in_strides, Desc.c_out_strides,
+            sizeof (Desc.c_in_strides));
+
+  return pocl_cpu_partition_dbk_khr_gemm (&Desc, part);
 }
 
-#endif
+int
+pocl_cpu_partition_dbk (cl_program program,
+                        cl_kernel kernel,
+                        pocl_kernel_metadata_t *meta,
+                        cl_uint dev_i,
+                        struct pocl_argument *arguments,
+                        pocl_cpu_dbk_partition *part)
+{
+  memset (part, 0, sizeof (pocl_cpu_dbk_partition));
+  switch (meta->builtin_kernel_id)
+    {
+    case CL_DBK_GEMM_EXP:
+    case CL_DBK_MATMUL_EXP:
+      return pocl_cpu_partition_gemm (program, kernel, meta, dev_i, arguments,
+                                      part);
+    case CL_DBK_IMG_COLOR_CONVERT_EXP:
+      return pocl_cpu_partition_dbk_exp_img_yuv2rgb (program, kernel, meta,
+                                                     dev_i, arguments, part);
+    case CL_DBK_CONVERT_EXP:
+      return pocl_cpu_partition_dbk_exp_convert (program, kernel, meta, dev_i,
+                                                 arguments, part);
+    case CL_DBK_SET_ROWS_EXP:
+      return pocl_cpu_partition_dbk_exp_set_rows (program, kernel, meta,
+                                                  dev_i, arguments, part);
+    default:
+      /* the JPEG codecs, NMS and ONNX inference run as a whole */
+      return CL_INVALID_OPERATION;
+    }
+}
 
 int
 pocl_cpu_execute_dbk (cl_program program,
@@ -1264,13 +1506,20 @@ pocl_cpu_execute_dbk (cl_program program,
                       cl_uint dev_i,
                       struct pocl_argument *arguments)
 {
+  pocl_cpu_dbk_partition part;
+  int err
+    = pocl_cpu_partition_dbk (program, kernel, meta, dev_i, arguments, &part);
+  if (err != CL_INVALID_OPERATION)
+    {
+      if (err == CL_SUCCESS && part.num_chunks > 0)
+        err = part.run (part.state, 0, part.num_chunks);
+      if (part.finish)
+        part.finish (part.state);
+      return err;
+    }
+
   switch (meta->builtin_kernel_id)
     {
-#ifdef HAVE_LIBXSMM
-    case CL_DBK_GEMM_EXP:
-    case CL_DBK_MATMUL_EXP:
-      return pocl_xsmm_execute_dbk (program, kernel, meta, dev_i, arguments);
-#endif
 #ifdef HAVE_LIBJPEG_TURBO
     case CL_DBK_JPEG_ENCODE_EXP:
       return pocl_cpu_execute_dbk_khr_jpeg_encode (program, kernel, meta,
@@ -1291,9 +1540,6 @@ pocl_cpu_execute_dbk (cl_program program,
             pocl_cpu_get_ptr (&arguments[3], mem_id));
       }
 #endif
-    case CL_DBK_IMG_COLOR_CONVERT_EXP:
-      return pocl_cpu_execute_dbk_exp_img_yuv2rgb (program, kernel, meta,
-                                                   dev_i, arguments);
 #ifdef HAVE_OPENCV
     case CL_DBK_NMS_BOX_EXP:
       return pocl_cpu_execute_dbk_khr_nms_box (program, kernel, meta, dev_i,
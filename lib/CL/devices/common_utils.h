@@ -37,6 +37,8 @@
 #include "cpu_dbk/pocl_dbk_khr_onnxrt_cpu.h"
 #endif
 #include "cpu_dbk/pocl_dbk_khr_dnn_utils.hh"
+#include "cpu_dbk/pocl_dbk_khr_convert_cpu.h"
+#include "cpu_dbk/pocl_dbk_khr_gemm_cpu.h"
 #include "cpu_dbk/pocl_dbk_khr_img_cpu.h"
 
 /* Generic struct for CPU device drivers.
@@ -69,6 +71,20 @@ struct kernel_run_command
 
   size_t remaining_wgs;
   size_t wgs_dealt;
+
+  /* non-NULL if this is a kernel of a native command buffer replay
+   * (pocl_cpu_cmdbuf_exec); such runs are owned by the command buffer */
+  void *cmdbuf_exec;
+  /* the next kernel of a command buffer fused with this one, whose WGs are
+   * run right after the WG with the same id of this kernel; see
+   * pocl_cpu_fused_setup () */
+  kernel_run_command *fused_next;
+  /* struct pocl_cpu_wg_profile of this launch if POCL_CPU_WG_PROFILING is
+   * enabled, NULL otherwise */
+  void *wg_profile;
+  /* if dbk.run is set, this is a DBK launch whose chunks are executed by
+   * the worker threads in place of the WGs of a compiled kernel */
+  pocl_cpu_dbk_partition dbk;
 };
 
 #ifdef __cplusplus
@@ -107,6 +123,18 @@ int pocl_cpu_execute_dbk (cl_program program,
                           cl_uint dev_i,
                           struct pocl_argument *arguments);
 
+/* Splits a DBK launch into chunks for parallel execution. Returns
+ * CL_SUCCESS and fills *part if the DBK supports it, CL_INVALID_OPERATION if
+ * the DBK must be executed as a whole with pocl_cpu_execute_dbk (), or an
+ * error code if the launch is invalid. */
+POCL_EXPORT
+int pocl_cpu_partition_dbk (cl_program program,
+                            cl_kernel kernel,
+                            pocl_kernel_metadata_t *meta,
+                            cl_uint dev_i,
+                            struct pocl_argument *arguments,
+                            pocl_cpu_dbk_partition *part);
+
 POCL_EXPORT
 void pocl_cpu_probe ();
 
@@ -116,7 +144,7 @@ int pocl_cpu_finalize_binary (cl_device_id dev,
                               const char *input_binary);
 
 POCL_EXPORT
-void pocl_setup_kernel_arg_array (kernel_run_command *k);
+int pocl_setup_kernel_arg_array (kernel_run_command *k);
 
 POCL_EXPORT
 int pocl_setup_kernel_arg_array_with_locals (void **arguments,
@@ -0,0 +1,1085 @@
+/* cpu_cmdbuf.c - native cl_khr_command_buffer support for the CPU drivers
+
+   Copyright (c) 2026 PoCL developers
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+*/
+
+#include <string.h>
+
+#include "common.h"
+#include "common_driver.h"
+#include "cpu_cmdbuf.h"
+#include "pocl_builtin_kernels.h"
+#include "pocl_mem_management.h"
+#include "pocl_runtime_config.h"
+#include "pocl_util.h"
+#include "utlist.h"
+
+#ifdef ENABLE_LLVM
+#include "pocl_llvm.h"
+#endif
+
+/* maximum number of kernels run as one fused launch */
+#define MAX_FUSED_KERNELS 8
+
+/* Command buffers of a non-multi-device command buffer all target the same
+ * device, use the slot of that device in the context device list. */
+static unsigned
+cmdbuf_slot (cl_device_id device, cl_command_buffer_khr cmdbuf)
+{
+  cl_context ctx = cmdbuf->queues[0]->context;
+  for (unsigned i = 0; i < ctx->num_devices; ++i)
+    if (ctx->devices[i] == device)
+      return i;
+  return 0;
+}
+
+static int
+node_is_dbk (_cl_command_node *cmd)
+{
+  return cmd->type == CL_COMMAND_NDRANGE_KERNEL
+         && cmd->command.run.kernel->program->builtin_kernel_attributes
+                != NULL;
+}
+
+static size_t
+node_num_groups (_cl_command_node *cmd)
+{
+  struct pocl_context *pc = &cmd->command.run.pc;
+  return pc->num_groups[0] * pc->num_groups[1] * pc->num_groups[2];
+}
+
+/* Builds the program gvars and looks up (compiling if needed) the WG
+ * function for the current launch parameters of the recorded command.
+ * The recorded command itself is not modified, since clUpdateMutableCommands
+ * can read it concurrently. Call with graph->lock held. */
+static int
+resolve_kernel (pocl_cpu_cmdbuf *graph, pocl_cpu_cmdbuf_node *n)
+{
+  _cl_command_node tmp;
+  memcpy (&tmp, n->cmd, sizeof (_cl_command_node));
+  tmp.device = graph->device;
+
+  cl_kernel kernel = tmp.command.run.kernel;
+  cl_program program = kernel->program;
+
+  if (pocl_driver_build_gvar_init_kernel (program, tmp.program_device_i,
+                                          graph->device,
+                                          pocl_cpu_gvar_init_callback)
+      != 0)
+    return CL_FAILED;
+
+  char *saved_name = NULL;
+  pocl_sanitize_builtin_kernel_name (kernel, &saved_name);
+  void *ci = pocl_check_kernel_dlhandle_cache (&tmp, CL_TRUE, CL_TRUE);
+  pocl_restore_builtin_kernel_name (kernel, saved_name);
+  if (ci == NULL)
+    return CL_FAILED;
+
+  /* The WG function of the old item stays loaded, so a concurrent replay
+   * still using it is not a problem. */
+  if (n->ci)
+    pocl_release_dlhandle_cache (n->ci);
+  n->ci = ci;
+  n->wg = (pocl_workgroup_func)tmp.command.run.wg;
+
+  struct pocl_context *pc = &tmp.command.run.pc;
+  memcpy (n->local_size, pc->local_size, sizeof (n->local_size));
+  n->max_grid_width = pocl_cmd_max_grid_dim_width (&tmp.command.run);
+  n->goffs_zero = pc->global_offset[0] == 0 && pc->global_offset[1] == 0
+                  && pc->global_offset[2] == 0;
+  return CL_SUCCESS;
+}
+
+static int
+kernel_is_stale (pocl_cpu_cmdbuf_node *n)
+{
+  _cl_command_run *run = &n->cmd->command.run;
+  struct pocl_context *pc = &run->pc;
+  int goffs_zero = pc->global_offset[0] == 0 && pc->global_offset[1] == 0
+                   && pc->global_offset[2] == 0;
+  return n->ci == NULL
+         || memcmp (n->local_size, pc->local_size, sizeof (n->local_size))
+         || n->goffs_zero != goffs_zero
+         || pocl_cmd_max_grid_dim_width (run) > n->max_grid_width;
+}
+
+/* Puts a temporary kernel_run_command around the node for the
+ * pocl_{setup,free}_kernel_arg_array () helpers. */
+static void
+node_run_command (pocl_cpu_cmdbuf *graph,
+                  pocl_cpu_cmdbuf_node *n,
+                  kernel_run_command *k)
+{
+  memset (k, 0, sizeof (kernel_run_command));
+  k->kernel = n->cmd->command.run.kernel;
+  k->device = graph->device;
+  k->kernel_args = n->cmd->command.run.arguments;
+  k->arguments = n->arguments;
+  k->arguments2 = n->arguments2;
+}
+
+#ifdef ENABLE_LLVM
+/* Work-group interleaving of element-wise kernels (POCL_CPU_CMDBUF_FUSION).
+
+   A kernel B that only depends on the kernel A recorded right before it
+   can run its WG g immediately after A's WG g on the same thread, instead
+   of in the next level, as long as every buffer they share is accessed
+   only at [get_global_id (0)] with the same element size by both kernels:
+   B's WG g then only reads what A's WG g wrote, while it's still in the
+   cache. The kernels keep their own WG functions, so this only saves the
+   level barrier and the cache misses, not the stores to the intermediate
+   buffers; the "fused" names below refer to such interleaved chains. The access patterns come from the program IR at finalize, the
+   arguments and launch parameters are checked at each replay, since mutable
+   dispatch can change them. */
+
+static void
+analyze_kernel (pocl_cpu_cmdbuf_node *n)
+{
+  _cl_command_node *cmd = n->cmd;
+  cl_kernel kernel = cmd->command.run.kernel;
+  pocl_kernel_metadata_t *meta = kernel->meta;
+
+  for (unsigned i = 0; i < meta->num_args; ++i)
+    if (meta->arg_info[i].type != POCL_ARG_TYPE_NONE
+        && meta->arg_info[i].type != POCL_ARG_TYPE_POINTER)
+      return;
+
+  pocl_kernel_arg_access *access
+      = calloc (meta->num_args + 1, sizeof (pocl_kernel_arg_access));
+  if (access == NULL)
+    return;
+  if (pocl_llvm_get_kernel_arg_access (kernel->program,
+                                       cmd->program_device_i, kernel->name,
+                                       meta->num_args, access)
+      != 0)
+    {
+      POCL_MEM_FREE (access);
+      return;
+    }
+  n->arg_access = access;
+}
+
+/* Links each fusable kernel to its sole predecessor, if that one is a
+ * fusable kernel of the previous level from the same program. */
+static void
+find_fusion_chains (pocl_cpu_cmdbuf *graph)
+{
+  unsigned num_fused = 0;
+  for (unsigned i = 0; i < graph->num_nodes; ++i)
+    {
+      pocl_cpu_cmdbuf_node *n = &graph->nodes[i];
+      if (!n->is_kernel)
+        continue;
+      analyze_kernel (n);
+      if (n->arg_access == NULL || n->sole_pred < 0)
+        continue;
+
+      pocl_cpu_cmdbuf_node *p = &graph->nodes[n->sole_pred];
+      if (!p->is_kernel || p->arg_access == NULL || p->fuse_next >= 0
+          || p->level + 1 != n->level
+          || p->fuse_pos + 1 >= MAX_FUSED_KERNELS
+          || p->cmd->command.run.kernel->program
+                 != n->cmd->command.run.kernel->program)
+        continue;
+
+      p->fuse_next = (int)i;
+      n->fuse_pos = p->fuse_pos + 1;
+      ++num_fused;
+    }
+
+  graph->has_fusion = (num_fused > 0);
+  if (num_fused > 0)
+    POCL_MSG_PRINT_GENERAL ("CPU: %u kernels of the command buffer can be "
+                            "fused to their predecessor\n",
+                            num_fused);
+}
+
+/* Root buffer and byte range of a buffer argument; 0 if it has none. */
+static int
+arg_buffer_range (pocl_argument *al, cl_mem *root, size_t *start, size_t *end)
+{
+  if (al->value == NULL || *(cl_mem *)al->value == NULL)
+    return 0;
+  cl_mem m = *(cl_mem *)al->value;
+  *root = m->parent ? m->parent : m;
+  *start = m->parent ? m->origin : 0;
+  *end = *start + m->size;
+  return 1;
+}
+
+static int
+has_raw_ptr_args (pocl_cpu_cmdbuf_node *n)
+{
+  pocl_kernel_metadata_t *meta = n->cmd->command.run.kernel->meta;
+  pocl_argument *args = n->cmd->command.run.arguments;
+  for (unsigned i = 0; i < meta->num_args; ++i)
+    if (meta->arg_info[i].type == POCL_ARG_TYPE_POINTER && args[i].is_raw_ptr)
+      return 1;
+  return 0;
+}
+
+/* Checks that the WGs of a and b can be interleaved with the current
+ * arguments: all the overlapping buffers written by either kernel must be
+ * accessed element-wise, in the same way by both. */
+static int
+args_allow_fusion (pocl_cpu_cmdbuf_node *a, pocl_cpu_cmdbuf_node *b)
+{
+  pocl_kernel_metadata_t *meta_a = a->cmd->command.run.kernel->meta;
+  pocl_kernel_metadata_t *meta_b = b->cmd->command.run.kernel->meta;
+  pocl_argument *args_a = a->cmd->command.run.arguments;
+  pocl_argument *args_b = b->cmd->command.run.arguments;
+
+  for (unsigned i = 0; i < meta_a->num_args; ++i)
+    {
+      cl_mem root_a, root_b;
+      size_t start_a, end_a, start_b, end_b;
+      if (meta_a->arg_info[i].type != POCL_ARG_TYPE_POINTER
+          || ARG_IS_LOCAL (meta_a->arg_info[i])
+          || !arg_buffer_range (&args_a[i], &root_a, &start_a, &end_a))
+        continue;
+
+      for (unsigned j = 0; j < meta_b->num_args; ++j)
+        {
+          if (meta_b->arg_info[j].type != POCL_ARG_TYPE_POINTER
+              || ARG_IS_LOCAL (meta_b->arg_info[j])
+              || !arg_buffer_range (&args_b[j], &root_b, &start_b, &end_b))
+            continue;
+          if (root_a != root_b || end_a <= start_b || end_b <= start_a)
+            continue;
+
+          pocl_kernel_arg_access *acc_a = &a->arg_access[i];
+          pocl_kernel_arg_access *acc_b = &b->arg_access[j];
+          if (!acc_a->writes && !acc_b->writes)
+            continue;
+          if (start_a != start_b || acc_a->stride <= 0
+              || acc_a->stride != acc_b->stride)
+            return 0;
+        }
+    }
+  return 1;
+}
+
+/* The fused kernels run with the same WG ids, so their launches must be
+ * identical; only 1D ones are supported as the access analysis only
+ * considers the dimension 0. */
+static int
+geometry_allows_fusion (pocl_cpu_cmdbuf_node *head, pocl_cpu_cmdbuf_node *n)
+{
+  struct pocl_context *hpc = &head->cmd->command.run.pc;
+  struct pocl_context *pc = &n->cmd->command.run.pc;
+  return pc->work_dim == 1 && hpc->work_dim == 1 && n->wg != NULL
+         && head->wg != NULL && node_num_groups (n->cmd) > 0
+         && memcmp (pc->num_groups, hpc->num_groups, sizeof (pc->num_groups))
+                == 0
+         && memcmp (pc->local_size, hpc->local_size, sizeof (pc->local_size))
+                == 0
+         && memcmp (pc->global_offset, hpc->global_offset,
+                    sizeof (pc->global_offset))
+                == 0
+         /* the analysis accepts int indices derived from the global id */
+         && pc->num_groups[0] * pc->local_size[0] + pc->global_offset[0]
+                <= INT32_MAX;
+}
+
+/* Decides which links of the fusion chains are usable with the current
+ * state of the recorded commands. A failing link starts a new chain. */
+static void
+validate_fusion (pocl_cpu_cmdbuf *graph, pocl_cpu_cmdbuf_exec *exec)
+{
+  unsigned chain[MAX_FUSED_KERNELS];
+
+  for (unsigned i = 0; i < graph->num_nodes; ++i)
+    {
+      pocl_cpu_cmdbuf_node *n = &graph->nodes[i];
+      if (n->fuse_pos != 0 || n->fuse_next < 0)
+        continue;
+
+      unsigned len = 0;
+      for (int j = (int)i; j >= 0; j = graph->nodes[j].fuse_next)
+        {
+          pocl_cpu_cmdbuf_node *m = &graph->nodes[j];
+          int ok = len > 0 && !has_raw_ptr_args (m)
+                   && geometry_allows_fusion (&graph->nodes[chain[0]], m);
+          for (unsigned k = 0; ok && k < len; ++k)
+            ok = args_allow_fusion (&graph->nodes[chain[k]], m);
+
+          exec->fused[j] = ok;
+          if (!ok)
+            len = 0;
+          if (ok || !has_raw_ptr_args (m))
+            chain[len++] = (unsigned)j;
+        }
+    }
+}
+#endif
+
+/* Brings the prepared kernels up to date with the recorded commands.
+ * Cheap after the first replay unless mutable dispatch changed something. */
+static int
+refresh_graph (pocl_cpu_cmdbuf *graph, pocl_cpu_cmdbuf_exec *exec)
+{
+  int err = CL_SUCCESS;
+  POCL_LOCK (graph->lock);
+  for (unsigned i = 0; i < graph->num_nodes; ++i)
+    {
+      pocl_cpu_cmdbuf_node *n = &graph->nodes[i];
+      if (!n->is_kernel)
+        continue;
+
+      if (node_num_groups (n->cmd) > 0 && kernel_is_stale (n)
+          && resolve_kernel (graph, n) != CL_SUCCESS)
+        {
+          err = CL_FAILED;
+          break;
+        }
+
+      /* the nodes set up before a failed refresh keep their arrays */
+      if (!graph->args_ready && n->arguments == NULL)
+        {
+          kernel_run_command k;
+          node_run_command (graph, n, &k);
+          if (pocl_setup_kernel_arg_array (&k) != CL_SUCCESS)
+            {
+              err = CL_OUT_OF_HOST_MEMORY;
+              break;
+            }
+          n->arguments = k.arguments;
+          n->arguments2 = k.arguments2;
+        }
+    }
+  if (err == CL_SUCCESS)
+    graph->args_ready = 1;
+#ifdef ENABLE_LLVM
+  if (err == CL_SUCCESS && graph->has_fusion)
+    validate_fusion (graph, exec);
+#endif
+  POCL_UNLOCK (graph->lock);
+  return err;
+}
+
+static void
+add_pred (pocl_cpu_cmdbuf_node *n, int pred)
+{
+  if (pred < 0 || n->sole_pred == pred)
+    return;
+  n->sole_pred = (n->sole_pred == -1) ? pred : -2;
+}
+
+/* Computes the dependency level of each recorded command: one more than the
+ * highest level of the commands it has to wait for. These are the sync
+ * points in its wait list, plus the implicit ordering of its queue. */
+static void
+compute_levels (pocl_cpu_cmdbuf *graph, cl_command_buffer_khr cmdbuf)
+{
+  unsigned num_queues = cmdbuf->num_queues;
+  /* per queue: level + 1 of the last command, of the last barrier,
+   * and the highest level + 1 so far; 0 if none */
+  unsigned *last = alloca (num_queues * sizeof (unsigned));
+  unsigned *barrier = alloca (num_queues * sizeof (unsigned));
+  unsigned *highest = alloca (num_queues * sizeof (unsigned));
+  /* per queue: index of the last command and of the last barrier, or -1 */
+  int *last_idx = alloca (num_queues * sizeof (int));
+  int *barrier_idx = alloca (num_queues * sizeof (int));
+  memset (last, 0, num_queues * sizeof (unsigned));
+  memset (barrier, 0, num_queues * sizeof (unsigned));
+  memset (highest, 0, num_queues * sizeof (unsigned));
+  memset (last_idx, -1, num_queues * sizeof (int));
+  memset (barrier_idx, -1, num_queues * sizeof (int));
+
+  graph->num_levels = 0;
+  for (unsigned i = 0; i < graph->num_nodes; ++i)
+    {
+      _cl_command_node *cmd = graph->nodes[i].cmd;
+      unsigned q = cmd->queue_idx;
+      cl_uint num_waits = cmd->sync.syncpoint.num_sync_points_in_wait_list;
+      int ooo = (cmdbuf->queues[q]->properties
+                 & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE)
+                != 0;
+      unsigned level = 0;
+      pocl_cpu_cmdbuf_node *n = &graph->nodes[i];
+      n->sole_pred = -1;
+
+      for (cl_uint j = 0; j < num_waits; ++j)
+        {
+          /* sync point ids start at 1 and follow the recording order */
+          unsigned dep = cmd->sync.syncpoint.sync_point_wait_list[j] - 1;
+          assert (dep < i);
+          level = max (level, graph->nodes[dep].level + 1);
+          add_pred (n, (int)dep);
+        }
+
+      if (!ooo)
+        {
+          level = max (level, last[q]);
+          add_pred (n, last_idx[q]);
+        }
+      else
+        {
+          level = max (level, barrier[q]);
+          add_pred (n, barrier_idx[q]);
+          if (cmd->type == CL_COMMAND_BARRIER && num_waits == 0
+              && highest[q] > 0)
+            {
+              level = max (level, highest[q]);
+              n->sole_pred = -2;
+            }
+        }
+
+      n->level = level;
+      last[q] = level + 1;
+      last_idx[q] = (int)i;
+      highest[q] = max (highest[q], level + 1);
+      if (cmd->type == CL_COMMAND_BARRIER)
+        {
+          barrier[q] = level + 1;
+          barrier_idx[q] = (int)i;
+        }
+      graph->num_levels = max (graph->num_levels, level + 1);
+    }
+
+  /* bucket the nodes by level, keeping the recording order inside levels */
+  graph->level_start = calloc (graph->num_levels + 1, sizeof (unsigned));
+  graph->level_order = malloc (graph->num_nodes * sizeof (unsigned));
+  for (unsigned i = 0; i < graph->num_nodes; ++i)
+    ++graph->level_start[graph->nodes[i].level + 1];
+  graph->max_level_width = 0;
+  for (unsigned l = 0; l < graph->num_levels; ++l)
+    {
+      graph->max_level_width
+          = max (graph->max_level_width, graph->level_start[l + 1]);
+      graph->level_start[l + 1] += graph->level_start[l];
+    }
+  unsigned *fill = alloca ((graph->num_levels + 1) * sizeof (unsigned));
+  memcpy (fill, graph->level_start,
+          (graph->num_levels + 1) * sizeof (unsigned));
+  for (unsigned i = 0; i < graph->num_nodes; ++i)
+    graph->level_order[fill[graph->nodes[i].level]++] = i;
+}
+
+int
+pocl_cpu_create_finalized_command_buffer (cl_device_id device,
+                                          cl_command_buffer_khr cmdbuf)
+{
+  unsigned slot = cmdbuf_slot (device, cmdbuf);
+  cmdbuf->data[slot] = NULL;
+
+  pocl_cpu_cmdbuf *graph = pocl_aligned_malloc (HOST_CPU_CACHELINE_SIZE,
+                                                sizeof (pocl_cpu_cmdbuf));
+  POCL_RETURN_ERROR_COND ((graph == NULL), CL_OUT_OF_HOST_MEMORY);
+  memset (graph, 0, sizeof (pocl_cpu_cmdbuf));
+  POCL_INIT_LOCK (graph->lock);
+  graph->device = device;
+  graph->cmdbuf = cmdbuf;
+
+  _cl_command_node *cmd;
+  LL_FOREACH (cmdbuf->cmds, cmd)
+    ++graph->num_nodes;
+
+  graph->nodes = calloc (graph->num_nodes + 1, sizeof (pocl_cpu_cmdbuf_node));
+  if (graph->nodes == NULL)
+    {
+      POCL_DESTROY_LOCK (graph->lock);
+      pocl_aligned_free (graph);
+      return CL_OUT_OF_HOST_MEMORY;
+    }
+  cmdbuf->data[slot] = graph;
+
+  unsigned i = 0;
+  LL_FOREACH (cmdbuf->cmds, cmd)
+    {
+      pocl_cpu_cmdbuf_node *n = &graph->nodes[i++];
+      n->cmd = cmd;
+      n->fuse_next = -1;
+      n->is_kernel
+          = (cmd->type == CL_COMMAND_NDRANGE_KERNEL) && !node_is_dbk (cmd);
+      /* Compile now rather than at the first replay. A failure is not
+       * fatal here; it's retried and reported through the event of the
+       * enqueue, the same way as for regular NDRange commands. */
+      if (n->is_kernel && node_num_groups (cmd) > 0)
+        {
+          POCL_LOCK (graph->lock);
+          resolve_kernel (graph, n);
+          POCL_UNLOCK (graph->lock);
+        }
+    }
+
+  compute_levels (graph, cmdbuf);
+#ifdef ENABLE_LLVM
+  if (pocl_get_bool_option ("POCL_CPU_CMDBUF_FUSION", 0))
+    find_fusion_chains (graph);
+#endif
+
+  POCL_MSG_PRINT_GENERAL ("CPU: finalized command buffer with %u commands "
+                          "in %u levels\n",
+                          graph->num_nodes, graph->num_levels);
+  return CL_SUCCESS;
+}
+
+static void
+free_exec (pocl_cpu_cmdbuf_exec *exec)
+{
+  for (unsigned i = 0; i < exec->graph->num_nodes; ++i)
+    POCL_DESTROY_LOCK (exec->runs[i].lock);
+  pocl_aligned_free (exec->runs);
+  POCL_MEM_FREE (exec->level_runs);
+  POCL_MEM_FREE (exec->fused);
+  POCL_MEM_FREE (exec);
+}
+
+int
+pocl_cpu_free_command_buffer (cl_device_id device,
+                              cl_command_buffer_khr cmdbuf)
+{
+  unsigned slot = cmdbuf_slot (device, cmdbuf);
+  pocl_cpu_cmdbuf *graph = (pocl_cpu_cmdbuf *)cmdbuf->data[slot];
+  if (graph == NULL)
+    return CL_SUCCESS;
+  cmdbuf->data[slot] = NULL;
+
+  for (unsigned i = 0; i < graph->num_nodes; ++i)
+    {
+      pocl_cpu_cmdbuf_node *n = &graph->nodes[i];
+      if (n->ci)
+        pocl_release_dlhandle_cache (n->ci);
+      if (n->arguments)
+        {
+          kernel_run_command k;
+          node_run_command (graph, n, &k);
+          pocl_free_kernel_arg_array (&k);
+        }
+      POCL_MEM_FREE (n->arg_access);
+    }
+
+  pocl_cpu_cmdbuf_exec *exec, *tmp;
+  LL_FOREACH_SAFE (graph->free_execs, exec, tmp)
+    free_exec (exec);
+
+  POCL_MEM_FREE (graph->nodes);
+  POCL_MEM_FREE (graph->level_order);
+  POCL_MEM_FREE (graph->level_start);
+  POCL_DESTROY_LOCK (graph->lock);
+  pocl_aligned_free (graph);
+  return CL_SUCCESS;
+}
+
+static pocl_cpu_cmdbuf_exec *
+acquire_exec (pocl_cpu_cmdbuf *graph)
+{
+  pocl_cpu_cmdbuf_exec *exec = NULL;
+  POCL_LOCK (graph->lock);
+  exec = graph->free_execs;
+  if (exec)
+    LL_DELETE (graph->free_execs, exec);
+  POCL_UNLOCK (graph->lock);
+  if (exec)
+    return exec;
+
+  /* only reached on the first replay, and when the buffer is used
+   * simultaneously from more than one queue */
+  exec = calloc (1, sizeof (pocl_cpu_cmdbuf_exec));
+  if (exec == NULL)
+    return NULL;
+  exec->graph = graph;
+  size_t runs_size = (graph->num_nodes + 1) * sizeof (kernel_run_command);
+  exec->runs = pocl_aligned_malloc (HOST_CPU_CACHELINE_SIZE, runs_size);
+  exec->level_runs
+      = calloc (graph->max_level_width + 1, sizeof (kernel_run_command *));
+  exec->fused = calloc (graph->num_nodes + 1, 1);
+  if (exec->runs == NULL || exec->level_runs == NULL || exec->fused == NULL)
+    {
+      pocl_aligned_free (exec->runs);
+      POCL_MEM_FREE (exec->level_runs);
+      POCL_MEM_FREE (exec->fused);
+      POCL_MEM_FREE (exec);
+      return NULL;
+    }
+  memset (exec->runs, 0, runs_size);
+  for (unsigned i = 0; i < graph->num_nodes; ++i)
+    POCL_INIT_LOCK (exec->runs[i].lock);
+  return exec;
+}
+
+static void
+release_exec (pocl_cpu_cmdbuf_exec *exec)
+{
+  pocl_cpu_cmdbuf *graph = exec->graph;
+  POCL_LOCK (graph->lock);
+  LL_PREPEND (graph->free_execs, exec);
+  POCL_UNLOCK (graph->lock);
+}
+
+/* Same setup as the drivers' prepare-kernel functions do for a regular
+ * NDRange command, except that nothing needs to be allocated. */
+static void
+setup_kernel_run (pocl_cpu_cmdbuf_exec *exec,
+                  pocl_cpu_cmdbuf_node *n,
+                  kernel_run_command *run,
+                  void *data,
+                  unsigned printf_buffer_capacity)
+{
+  _cl_command_node *cmd = n->cmd;
+  cl_kernel kernel = cmd->command.run.kernel;
+
+  run->data = data;
+  run->kernel = kernel;
+  run->device = exec->graph->device;
+  run->pc = cmd->command.run.pc;
+  run->cmd = cmd;
+  run->pc.printf_buffer = NULL;
+  run->pc.printf_buffer_capacity = printf_buffer_capacity;
+  run->pc.printf_buffer_position = NULL;
+  run->pc.global_var_buffer
+      = kernel->program->gvar_storage[cmd->program_device_i];
+  run->remaining_wgs = node_num_groups (cmd);
+  run->wgs_dealt = 0;
+  run->workgroup = n->wg;
+  run->kernel_args = cmd->command.run.arguments;
+  run->arguments = n->arguments;
+  run->arguments2 = n->arguments2;
+  run->prev = NULL;
+  run->next = NULL;
+  run->ref_count = 0;
+  run->execution_failed = 0;
+  run->cmdbuf_exec = exec;
+  run->fused_next = NULL;
+  run->wg_profile = NULL;
+}
+
+/* Splits a recorded DBK into chunks to be executed by the driver's threads
+ * along with the kernels of the level, like pocl_pthread_prepare_dbk () does
+ * for an enqueued one. run->dbk.run is left NULL if the DBK must be run as
+ * a whole by exec_recorded_command (), and run->execution_failed is set if
+ * the launch is invalid. */
+static void
+setup_dbk_run (pocl_cpu_cmdbuf_exec *exec,
+               pocl_cpu_cmdbuf_node *n,
+               kernel_run_command *run,
+               void *data)
+{
+  _cl_command_node *cmd = n->cmd;
+  cl_kernel kernel = cmd->command.run.kernel;
+
+  run->data = data;
+  run->kernel = kernel;
+  run->device = exec->graph->device;
+  run->cmd = cmd;
+  run->kernel_args = cmd->command.run.arguments;
+  run->prev = NULL;
+  run->next = NULL;
+  run->ref_count = 0;
+  run->execution_failed = 0;
+  run->cmdbuf_exec = exec;
+  run->fused_next = NULL;
+  run->wg_profile = NULL;
+
+  int err = pocl_cpu_partition_dbk (kernel->program, kernel, kernel->meta,
+                                    cmd->program_device_i,
+                                    cmd->command.run.arguments, &run->dbk);
+  if (err == CL_SUCCESS && run->dbk.num_chunks > 0)
+    {
+      run->remaining_wgs = run->dbk.num_chunks;
+      run->wgs_dealt = 0;
+      return;
+    }
+
+  if (run->dbk.finish)
+    run->dbk.finish (run->dbk.state);
+  memset (&run->dbk, 0, sizeof (pocl_cpu_dbk_partition));
+  if (err != CL_SUCCESS && err != CL_INVALID_OPERATION)
+    run->execution_failed = 1;
+}
+
+/* Runs a recorded non-kernel command on the calling thread. */
+static int
+exec_recorded_command (cl_device_id dev, _cl_command_node *node)
+{
+  _cl_command_t *cmd = &node->command;
+
+  switch (node->type)
+    {
+    case CL_COMMAND_NDRANGE_KERNEL:
+      {
+        /* only DBKs which can't be split end up here */
+        cl_kernel kernel = cmd->run.kernel;
+        return pocl_cpu_execute_dbk (kernel->program, kernel, kernel->meta,
+                                     node->program_device_i,
+                                     cmd->run.arguments);
+      }
+
+    case CL_COMMAND_READ_BUFFER:
+      dev->ops->read (
+        dev->data, cmd->read.dst_host_ptr,
+        &POCL_MEM_BS (cmd->read.src)->device_ptrs[dev->global_mem_id],
+        cmd->read.src, cmd->read.offset, cmd->read.size);
+      break;
+
+    case CL_COMMAND_WRITE_BUFFER:
+      dev->ops->write (
+        dev->data, cmd->write.src_host_ptr,
+        &POCL_MEM_BS (cmd->write.dst)->device_ptrs[dev->global_mem_id],
+        cmd->write.dst, cmd->write.offset, cmd->write.size);
+      break;
+
+    case CL_COMMAND_COPY_BUFFER:
+      if (dev->ops->copy_with_size && cmd->copy.src_content_size != NULL)
+        dev->ops->copy_with_size (
+          dev->data,
+          &POCL_MEM_BS (cmd->copy.dst)->device_ptrs[dev->global_mem_id],
+          cmd->copy.dst,
+          &POCL_MEM_BS (cmd->copy.src)->device_ptrs[dev->global_mem_id],
+          cmd->copy.src, cmd->copy.src_content_size_mem_id,
+          cmd->copy.src_content_size, cmd->copy.dst_offset,
+          cmd->copy.src_offset, cmd->copy.size);
+      else
+        dev->ops->copy (
+          dev->data,
+          &POCL_MEM_BS (cmd->copy.dst)->device_ptrs[dev->global_mem_id],
+          cmd->copy.dst,
+          &POCL_MEM_BS (cmd->copy.src)->device_ptrs[dev->global_mem_id],
+          cmd->copy.src, cmd->copy.dst_offset, cmd->copy.src_offset,
+          cmd->copy.size);
+      break;
+
+    case CL_COMMAND_FILL_BUFFER:
+      dev->ops->memfill (
+        dev->data, &cmd->memfill.dst->device_ptrs[dev->global_mem_id],
+        cmd->memfill.dst, cmd->memfill.size, cmd->memfill.offset,
+        cmd->memfill.pattern, cmd->memfill.pattern_size);
+      break;
+
+    case CL_COMMAND_READ_BUFFER_RECT:
+      dev->ops->read_rect (
+        dev->data, cmd->read_rect.dst_host_ptr,
+        &cmd->read_rect.src->device_ptrs[dev->global_mem_id],
+        cmd->read_rect.src, cmd->read_rect.buffer_origin,
+        cmd->read_rect.host_origin, cmd->read_rect.region,
+        cmd->read_rect.buffer_row_pitch, cmd->read_rect.buffer_slice_pitch,
+        cmd->read_rect.host_row_pitch, cmd->read_rect.host_slice_pitch);
+      break;
+
+    case CL_COMMAND_WRITE_BUFFER_RECT:
+      dev->ops->write_rect (
+        dev->data, cmd->write_rect.src_host_ptr,
+        &cmd->write_rect.dst->device_ptrs[dev->global_mem_id],
+        cmd->write_rect.dst, cmd->write_rect.buffer_origin,
+        cmd->write_rect.host_origin, cmd->write_rect.region,
+        cmd->write_rect.buffer_row_pitch, cmd->write_rect.buffer_slice_pitch,
+        cmd->write_rect.host_row_pitch, cmd->write_rect.host_slice_pitch);
+      break;
+
+    case CL_COMMAND_COPY_BUFFER_RECT:
+      dev->ops->copy_rect (
+        dev->data, &cmd->copy_rect.dst->device_ptrs[dev->global_mem_id],
+        cmd->copy_rect.dst,
+        &cmd->copy_rect.src->device_ptrs[dev->global_mem_id],
+        cmd->copy_rect.src, cmd->copy_rect.dst_origin,
+        cmd->copy_rect.src_origin, cmd->copy_rect.region,
+        cmd->copy_rect.dst_row_pitch, cmd->copy_rect.dst_slice_pitch,
+        cmd->copy_rect.src_row_pitch, cmd->copy_rect.src_slice_pitch);
+      break;
+
+    case CL_COMMAND_COPY_IMAGE_TO_BUFFER:
+      dev->ops->read_image_rect (
+        dev->data, cmd->read_image.src,
+        &POCL_MEM_BS (cmd->read_image.src)->device_ptrs[dev->global_mem_id],
+        NULL,
+        &POCL_MEM_BS (cmd->read_image.dst)->device_ptrs[dev->global_mem_id],
+        cmd->read_image.origin, cmd->read_image.region,
+        cmd->read_image.dst_row_pitch, cmd->read_image.dst_slice_pitch,
+        cmd->read_image.dst_offset);
+      break;
+
+    case CL_COMMAND_READ_IMAGE:
+      dev->ops->read_image_rect (
+        dev->data, cmd->read_image.src,
+        &POCL_MEM_BS (cmd->read_image.src)->device_ptrs[dev->global_mem_id],
+        cmd->read_image.dst_host_ptr, NULL, cmd->read_image.origin,
+        cmd->read_image.region, cmd->read_image.dst_row_pitch,
+        cmd->read_image.dst_slice_pitch, cmd->read_image.dst_offset);
+      break;
+
+    case CL_COMMAND_COPY_BUFFER_TO_IMAGE:
+      dev->ops->write_image_rect (
+        dev->data, cmd->write_image.dst,
+        &POCL_MEM_BS (cmd->write_image.dst)->device_ptrs[dev->global_mem_id],
+        NULL, &cmd->write_image.src->device_ptrs[dev->global_mem_id],
+        cmd->write_image.origin, cmd->write_image.region,
+        cmd->write_image.src_row_pitch, cmd->write_image.src_slice_pitch,
+        cmd->write_image.src_offset);
+      break;
+
+    case CL_COMMAND_WRITE_IMAGE:
+      dev->ops->write_image_rect (
+        dev->data, cmd->write_image.dst,
+        &POCL_MEM_BS (cmd->write_image.dst)->device_ptrs[dev->global_mem_id],
+        cmd->write_image.src_host_ptr, NULL, cmd->write_image.origin,
+        cmd->write_image.region, cmd->write_image.src_row_pitch,
+        cmd->write_image.src_slice_pitch, cmd->write_image.src_offset);
+      break;
+
+    case CL_COMMAND_COPY_IMAGE:
+      dev->ops->copy_image_rect (
+        dev->data, cmd->copy_image.src, cmd->copy_image.dst,
+        &POCL_MEM_BS (cmd->copy_image.src)->device_ptrs[dev->global_mem_id],
+        &POCL_MEM_BS (cmd->copy_image.dst)->device_ptrs[dev->global_mem_id],
+        cmd->copy_image.src_origin, cmd->copy_image.dst_origin,
+        cmd->copy_image.region);
+      break;
+
+    case CL_COMMAND_FILL_IMAGE:
+      dev->ops->fill_image (
+        dev->data, cmd->fill_image.dst,
+        &cmd->fill_image.dst->device_ptrs[dev->global_mem_id],
+        cmd->fill_image.origin, cmd->fill_image.region,
+        cmd->fill_image.orig_pixel, cmd->fill_image.fill_pixel,
+        cmd->fill_image.pixel_size);
+      break;
+
+    case CL_COMMAND_SVM_MEMCPY:
+      dev->ops->svm_copy (dev, cmd->svm_memcpy.dst, cmd->svm_memcpy.src,
+                          cmd->svm_memcpy.size);
+      break;
+
+    case CL_COMMAND_SVM_MEMFILL:
+      dev->ops->svm_fill (dev, cmd->svm_fill.svm_ptr, cmd->svm_fill.size,
+                          cmd->svm_fill.pattern, cmd->svm_fill.pattern_size);
+      break;
+
+    case CL_COMMAND_SVM_MEMCPY_RECT_POCL:
+      dev->ops->svm_copy_rect (
+        dev, cmd->svm_memcpy_rect.dst, cmd->svm_memcpy_rect.src,
+        cmd->svm_memcpy_rect.dst_origin, cmd->svm_memcpy_rect.src_origin,
+        cmd->svm_memcpy_rect.region, cmd->svm_memcpy_rect.dst_row_pitch,
+        cmd->svm_memcpy_rect.dst_slice_pitch,
+        cmd->svm_memcpy_rect.src_row_pitch,
+        cmd->svm_memcpy_rect.src_slice_pitch);
+      break;
+
+    case CL_COMMAND_SVM_MEMFILL_RECT_POCL:
+      dev->ops->svm_fill_rect (
+        dev, cmd->svm_fill_rect.svm_ptr, cmd->svm_fill_rect.origin,
+        cmd->svm_fill_rect.region, cmd->svm_fill_rect.row_pitch,
+        cmd->svm_fill_rect.slice_pitch, cmd->svm_fill_rect.pattern,
+        cmd->svm_fill_rect.pattern_size);
+      break;
+
+    case CL_COMMAND_BARRIER:
+      break;
+
+    default:
+      POCL_MSG_ERR ("CPU: unexpected command type %#x in a command buffer\n",
+                    node->type);
+      return CL_FAILED;
+    }
+  return CL_SUCCESS;
+}
+
+void
+pocl_cpu_exec_command_buffer (_cl_command_node *node,
+                              void *data,
+                              unsigned printf_buffer_capacity,
+                              pocl_cpu_cmdbuf_launch_fn launch,
+                              pocl_cpu_cmdbuf_wait_fn wait)
+{
+  cl_event event = node->sync.event.event;
+  cl_command_buffer_khr cmdbuf = node->command.replay.buffer;
+  cl_device_id dev = node->device;
+  pocl_cpu_cmdbuf *graph = cmdbuf->data[cmdbuf_slot (dev, cmdbuf)];
+  pocl_cpu_cmdbuf_exec *exec = NULL;
+  unsigned execution_failed = 0;
+
+  pocl_update_event_running (event);
+
+  if (graph == NULL || (exec = acquire_exec (graph)) == NULL)
+    {
+      POCL_UPDATE_EVENT_FAILED_MSG (CL_OUT_OF_HOST_MEMORY, event,
+                                    "CPU: command buffer not prepared");
+      return;
+    }
+
+  int err = refresh_graph (graph, exec);
+  if (err != CL_SUCCESS)
+    {
+      release_exec (exec);
+      POCL_UPDATE_EVENT_FAILED_MSG (err, event,
+                                    err == CL_OUT_OF_HOST_MEMORY
+                                        ? "CPU: failed to allocate the "
+                                          "kernel argument arrays"
+                                        : "CPU: failed to compile kernel");
+      return;
+    }
+
+  for (unsigned l = 0; l < graph->num_levels && !execution_failed; ++l)
+    {
+      unsigned num_runs = 0;
+      unsigned first = graph->level_start[l];
+      unsigned end = graph->level_start[l + 1];
+
+      for (unsigned i = first; i < end; ++i)
+        {
+          unsigned idx = graph->level_order[i];
+          pocl_cpu_cmdbuf_node *n = &graph->nodes[idx];
+          if (node_is_dbk (n->cmd))
+            {
+              kernel_run_command *run = &exec->runs[idx];
+              setup_dbk_run (exec, n, run, data);
+              if (run->dbk.run)
+                exec->level_runs[num_runs++] = run;
+              continue;
+            }
+          if (!n->is_kernel || node_num_groups (n->cmd) == 0
+              || exec->fused[idx])
+            continue;
+          kernel_run_command *run = &exec->runs[idx];
+          setup_kernel_run (exec, n, run, data, printf_buffer_capacity);
+          exec->level_runs[num_runs++] = run;
+
+          /* the kernels fused to this one are skipped at their own level */
+          for (int j = n->fuse_next; j >= 0 && exec->fused[j];
+               j = graph->nodes[j].fuse_next)
+            {
+              kernel_run_command *next = &exec->runs[j];
+              setup_kernel_run (exec, &graph->nodes[j], next, data,
+                                printf_buffer_capacity);
+              run->fused_next = next;
+              run = next;
+            }
+        }
+
+      if (num_runs > 0)
+        launch (data, exec, exec->level_runs, num_runs);
+
+      /* overlap the rest of the level with the kernels */
+      for (unsigned i = first; i < end; ++i)
+        {
+          unsigned idx = graph->level_order[i];
+          pocl_cpu_cmdbuf_node *n = &graph->nodes[idx];
+          if (n->is_kernel)
+            continue;
+          if (node_is_dbk (n->cmd))
+            {
+              kernel_run_command *run = &exec->runs[idx];
+              if (run->dbk.run != NULL)
+                continue;
+              if (run->execution_failed)
+                {
+                  execution_failed = 1;
+                  continue;
+                }
+            }
+          execution_failed |= (exec_recorded_command (dev, n->cmd) != 0);
+        }
+
+      if (num_runs > 0)
+        {
+          wait (data, exec);
+          for (unsigned i = 0; i < num_runs; ++i)
+            {
+              kernel_run_command *run = exec->level_runs[i];
+              execution_failed |= run->execution_failed;
+              if (run->dbk.finish)
+                run->dbk.finish (run->dbk.state);
+            }
+        }
+    }
+
+  release_exec (exec);
+
+  if (execution_failed)
+    POCL_UPDATE_EVENT_FAILED_MSG (CL_FAILED, event,
+                                  "Command Buffer        ");
+  else
+    POCL_UPDATE_EVENT_COMPLETE_MSG (event, "Command Buffer        ");
+}
+
+size_t
+pocl_cpu_fused_state_size (kernel_run_command *k)
+{
+  size_t size = 0;
+  for (kernel_run_command *m = k->fused_next; m != NULL; m = m->fused_next)
+    {
+      pocl_kernel_metadata_t *meta = m->kernel->meta;
+      size += sizeof (pocl_cpu_fused_wg)
+              + 2 * sizeof (void *)
+                    * (meta->num_args + meta->num_locals + 1);
+    }
+  return size;
+}
+
+unsigned
+pocl_cpu_fused_setup (kernel_run_command *k,
+                      pocl_cpu_fused_wg *state,
+                      char *local_mem,
+                      size_t local_mem_size,
+                      struct pocl_context *pc)
+{
+  unsigned num_fused = 0;
+  for (kernel_run_command *m = k->fused_next; m != NULL; m = m->fused_next)
+    ++num_fused;
+
+  /* the argument arrays follow the state structs */
+  void **ptrs = (void **)(state + num_fused);
+  unsigned i = 0;
+  for (kernel_run_command *m = k->fused_next; m != NULL; m = m->fused_next)
+    {
+      pocl_kernel_metadata_t *meta = m->kernel->meta;
+      size_t num_args = meta->num_args + meta->num_locals + 1;
+      pocl_cpu_fused_wg *f = &state[i++];
+      f->run = m;
+      f->arguments = ptrs;
+      f->arguments2 = ptrs + num_args;
+      ptrs += 2 * num_args;
+
+      /* the WGs of the chain run one after another on this thread, so
+       * they can all use the same local memory */
+      pocl_setup_kernel_arg_array_with_locals (f->arguments, f->arguments2, m,
+                                               local_mem, local_mem_size);
+      memcpy (&f->pc, &m->pc, sizeof (struct pocl_context));
+      f->pc.printf_buffer = pc->printf_buffer;
+      f->pc.printf_buffer_position = pc->printf_buffer_position;
+    }
+  return num_fused;
+}
+
+unsigned
+pocl_cpu_fused_run_wg (pocl_cpu_fused_wg *state,
+                       unsigned num_fused,
+                       size_t x,
+                       size_t y,
+                       size_t z)
+{
+  unsigned execution_failed = 0;
+  for (unsigned i = 0; i < num_fused; ++i)
+    {
+      pocl_cpu_fused_wg *f = &state[i];
+      f->run->workgroup ((uint8_t *)f->arguments, (uint8_t *)&f->pc, x, y, z);
+      execution_failed |= f->pc.execution_failed;
+    }
+  return execution_failed;
+}
+
+void
+pocl_cpu_fused_teardown (pocl_cpu_fused_wg *state, unsigned num_fused)
+{
+  for (unsigned i = 0; i < num_fused; ++i)
+    pocl_free_kernel_arg_array_with_locals (state[i].arguments,
+                                            state[i].arguments2, state[i].run);
+}
@@ -0,0 +1,182 @@
+/* cpu_cmdbuf.h - native cl_khr_command_buffer support for the CPU drivers
+
+   Copyright (c) 2026 PoCL developers
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+*/
+
+#ifndef POCL_CPU_CMDBUF_H
+#define POCL_CPU_CMDBUF_H
+
+#include "common_utils.h"
+
+/* A command buffer finalized for a CPU device is a DAG of the recorded
+ * commands, bucketed into dependency levels: all commands of a level only
+ * depend on commands of earlier levels, so a level can be executed
+ * concurrently once the previous one has finished. Everything that does
+ * not change between replays (WG function, kernel argument arrays, the
+ * level order) is prepared once and reused by every clEnqueueCommandBufferKHR
+ * of the buffer. */
+
+typedef struct pocl_cpu_cmdbuf_node
+{
+  /* the recorded command */
+  _cl_command_node *cmd;
+  /* retained dlhandle cache item of a compiled kernel, NULL otherwise */
+  void *ci;
+  pocl_workgroup_func wg;
+  /* launch parameters the WG function was resolved for; the recorded pc
+   * can be changed by clUpdateMutableCommandsKHR between replays */
+  size_t local_size[3];
+  size_t max_grid_width;
+  int goffs_zero;
+  /* kernel arguments, set up by pocl_setup_kernel_arg_array () */
+  void **arguments;
+  void **arguments2;
+  unsigned level;
+  /* non-DBK NDRange command, runs via the driver's WG scheduler */
+  int is_kernel;
+  /* the only command this one directly depends on, -1 if none and -2 if
+   * there are more than one */
+  int sole_pred;
+  /* work-group interleaving (POCL_CPU_CMDBUF_FUSION): the element-wise access
+   * pattern of the pointer arguments (NULL if the kernel is not fusable),
+   * the next node of the fusion chain (-1 if none) and the position in it */
+  struct pocl_kernel_arg_access *arg_access;
+  int fuse_next;
+  unsigned fuse_pos;
+} pocl_cpu_cmdbuf_node;
+
+typedef struct pocl_cpu_cmdbuf_exec pocl_cpu_cmdbuf_exec;
+typedef struct pocl_cpu_cmdbuf pocl_cpu_cmdbuf;
+
+/* State of one in-flight execution of a command buffer. These are recycled
+ * through a free list, so that replays don't allocate anything. */
+struct pocl_cpu_cmdbuf_exec
+{
+  pocl_cpu_cmdbuf *graph;
+  /* one kernel_run_command per recorded command (only the kernel and DBK
+   * ones are used), their locks are initialized once at creation */
+  kernel_run_command *runs;
+  /* the runs of the currently executing level */
+  kernel_run_command **level_runs;
+  /* number of level_runs not finished yet; owned by the driver */
+  unsigned pending;
+  /* per node: non-zero if it runs fused into its predecessor's launch in
+   * this replay, see refresh_graph () */
+  unsigned char *fused;
+  pocl_cpu_cmdbuf_exec *next;
+};
+
+struct pocl_cpu_cmdbuf
+{
+  POCL_ALIGNAS (HOST_CPU_CACHELINE_SIZE) pocl_lock_t lock;
+  cl_device_id device;
+  cl_command_buffer_khr cmdbuf;
+  pocl_cpu_cmdbuf_node *nodes;
+  unsigned num_nodes;
+  /* node indices sorted by level, level L spans
+   * level_order[level_start[L] .. level_start[L+1]-1] */
+  unsigned *level_order;
+  unsigned *level_start;
+  unsigned num_levels;
+  unsigned max_level_width;
+  /* the argument arrays need the buffers allocated on the device, which
+   * happens at the first enqueue's implicit migrations */
+  int args_ready;
+  /* there are fusion chains to validate at replay */
+  int has_fusion;
+  pocl_cpu_cmdbuf_exec *free_execs;
+};
+
+/* Per-thread state of the kernels fused after a kernel run, with their own
+ * argument arrays and pc sharing the thread's local memory and printf
+ * buffer with the head of the chain. */
+typedef struct pocl_cpu_fused_wg
+{
+  kernel_run_command *run;
+  void **arguments;
+  void **arguments2;
+  struct pocl_context pc;
+} pocl_cpu_fused_wg;
+
+/* Starts executing the (fully set up) kernel runs of one level. */
+typedef void (*pocl_cpu_cmdbuf_launch_fn) (void *data,
+                                           pocl_cpu_cmdbuf_exec *exec,
+                                           kernel_run_command **runs,
+                                           unsigned num_runs);
+/* Returns once all the kernels started by the last launch have finished. */
+typedef void (*pocl_cpu_cmdbuf_wait_fn) (void *data,
+                                         pocl_cpu_cmdbuf_exec *exec);
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+POCL_EXPORT
+int pocl_cpu_create_finalized_command_buffer (cl_device_id device,
+                                              cl_command_buffer_khr cmdbuf);
+
+POCL_EXPORT
+int pocl_cpu_free_command_buffer (cl_device_id device,
+                                  cl_command_buffer_khr cmdbuf);
+
+/* Executes a CL_COMMAND_COMMAND_BUFFER_KHR node and updates its event.
+ * Kernels and the DBKs which can be split into chunks are handed to the
+ * driver level by level via launch/wait, the other commands are run from
+ * the calling thread. */
+POCL_EXPORT
+void pocl_cpu_exec_command_buffer (_cl_command_node *node,
+                                   void *data,
+                                   unsigned printf_buffer_capacity,
+                                   pocl_cpu_cmdbuf_launch_fn launch,
+                                   pocl_cpu_cmdbuf_wait_fn wait);
+
+/* Size of the (stack allocated) state for pocl_cpu_fused_setup (),
+ * 0 if no kernels are fused to k. */
+POCL_EXPORT
+size_t pocl_cpu_fused_state_size (kernel_run_command *k);
+
+/* Sets up the kernels fused to k for running WGs from the calling thread.
+ * pc is the thread's copy of k's context. Returns the number of them. */
+POCL_EXPORT
+unsigned pocl_cpu_fused_setup (kernel_run_command *k,
+                               pocl_cpu_fused_wg *state,
+                               char *local_mem,
+                               size_t local_mem_size,
+                               struct pocl_context *pc);
+
+/* Runs the WG with the given id of each fused kernel, to be called right
+ * after the same WG of the head kernel. Returns non-zero on failure. */
+POCL_EXPORT
+unsigned pocl_cpu_fused_run_wg (pocl_cpu_fused_wg *state,
+                                unsigned num_fused,
+                                size_t x,
+                                size_t y,
+                                size_t z);
+
+POCL_EXPORT
+void pocl_cpu_fused_teardown (pocl_cpu_fused_wg *state, unsigned num_fused);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POCL_CPU_CMDBUF_H */
@@ -0,0 +1,47 @@
+/* pocl_dbk_cpu_partition.h - parallel execution of CPU DBKs
+
+   Copyright (c) 2026 PoCL developers
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+*/
+
+#ifndef POCL_DBK_CPU_PARTITION_H
+#define POCL_DBK_CPU_PARTITION_H
+
+#include <stddef.h>
+
+/* A DBK launch whose iteration space (rows, tiles, batch entries) is split
+ * into chunks which are independent of each other. The CPU drivers hand the
+ * chunks out to all their worker threads like the work-groups of an NDRange
+ * kernel, see pocl_cpu_partition_dbk (). */
+typedef struct pocl_cpu_dbk_partition pocl_cpu_dbk_partition;
+struct pocl_cpu_dbk_partition
+{
+  /* the number of chunks */
+  size_t num_chunks;
+  /* executes the chunks [first, first + count), called concurrently from
+   * the worker threads with disjoint ranges */
+  int (*run) (void *state, size_t first, size_t count);
+  /* called once after all the chunks have been executed, frees the state;
+   * can be NULL */
+  void (*finish) (void *state);
+  void *state;
+};
+
+#endif
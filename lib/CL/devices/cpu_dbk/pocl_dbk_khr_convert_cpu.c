@@ -0,0 +1,1029 @@
+/* pocl_dbk_khr_convert_cpu.c - CPU implementation of the tensor element
+   type conversion and set_rows DBKs.
+
+   Copyright (c) 2026 PoCL developers
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CONVERT_X86
+#include <immintrin.h>
+/* __builtin_cpu_supports () knows F16C and AVX-512 BF16 since GCC 11 and
+ * Clang 16, older compilers only get the AVX2 and AVX-512F kernels. */
+#if (defined(__clang__) && __clang_major__ >= 16)                             \
+  || (!defined(__clang__) && __GNUC__ >= 11)
+#define CONVERT_X86_EXT
+#endif
+#endif
+
+#if defined(__GNUC__) && defined(__aarch64__)
+#define CONVERT_NEON
+#include <arm_neon.h>
+#endif
+
+#include "pocl_cl_half_util.h"
+#include "pocl_dbk_khr_convert_cpu.h"
+#include "pocl_debug.h"
+#include "pocl_mem_management.h"
+#include "pocl_tensor_util.h"
+
+/* the elements converted by one chunk */
+#define CONVERT_CHUNK_ELEMS 32768
+/* the elements converted at once through the stack buffers of the generic
+ * and the strided paths */
+#define CONVERT_BLOCK 256
+
+#define CONVERT_MIN(a, b) ((a) < (b) ? (a) : (b))
+
+/* converts n contiguous elements */
+typedef void (*convert_fn) (const void *src, void *dst, size_t n);
+
+static int
+convert_dtype_supported (cl_tensor_datatype_exp dtype)
+{
+  switch (dtype)
+    {
+    case CL_TENSOR_DTYPE_INT8_EXP:
+    case CL_TENSOR_DTYPE_INT16_EXP:
+    case CL_TENSOR_DTYPE_INT32_EXP:
+    case CL_TENSOR_DTYPE_INT64_EXP:
+    case CL_TENSOR_DTYPE_UINT8_EXP:
+    case CL_TENSOR_DTYPE_UINT16_EXP:
+    case CL_TENSOR_DTYPE_UINT32_EXP:
+    case CL_TENSOR_DTYPE_UINT64_EXP:
+    case CL_TENSOR_DTYPE_FP16_EXP:
+    case CL_TENSOR_DTYPE_BFLOAT16_EXP:
+    case CL_TENSOR_DTYPE_FP32_EXP:
+    case CL_TENSOR_DTYPE_FP64_EXP:
+      return 1;
+    default:
+      return 0;
+    }
+}
+
+static int
+convert_check_tensor (const cl_tensor_desc_exp *t, const char *name)
+{
+  POCL_RETURN_ERROR_ON (
+    (t->layout == NULL
+     || (t->layout_type != CL_TENSOR_LAYOUT_BLAS_EXP
+         && t->layout_type != CL_TENSOR_LAYOUT_BLAS_PITCHED_EXP
+         && t->layout_type != CL_TENSOR_LAYOUT_ML_EXP)),
+    CL_INVALID_TENSOR_LAYOUT_EXP,
+    "CPU supports only BLAS and ML data layouts ('%s')\n", name);
+  POCL_RETURN_ERROR_ON (!convert_dtype_supported (t->dtype),
+                        CL_INVALID_TENSOR_DATATYPE_EXP,
+                        "CPU does not support the element type of '%s'\n",
+                        name);
+  return CL_SUCCESS;
+}
+
+int
+pocl_cpu_validate_dbk_convert (const cl_dbk_attributes_convert_exp *attrs)
+{
+  int err = convert_check_tensor (&attrs->src, "src");
+  if (err != CL_SUCCESS)
+    return err;
+  return convert_check_tensor (&attrs->dst, "dst");
+}
+
+int
+pocl_cpu_validate_dbk_set_rows (const cl_dbk_attributes_set_rows_exp *attrs)
+{
+  int err;
+  if ((err = convert_check_tensor (&attrs->data_in, "data_in")) != CL_SUCCESS
+      || (err = convert_check_tensor (&attrs->rows, "rows")) != CL_SUCCESS
+      || (err = convert_check_tensor (&attrs->indices, "indices"))
+           != CL_SUCCESS
+      || (err = convert_check_tensor (&attrs->data_out, "data_out"))
+           != CL_SUCCESS)
+    return err;
+  POCL_RETURN_ERROR_ON (attrs->data_in.dtype != attrs->data_out.dtype,
+                        CL_INVALID_TENSOR_DATATYPE_EXP,
+                        "CPU requires the same element type for data_in and "
+                        "data_out\n");
+  return CL_SUCCESS;
+}
+
+/********************************************************************/
+/* scalar conversions through a double or int64_t pivot */
+
+static inline float
+convert_bf16_to_float (uint16_t value)
+{
+  uint32_t bits = (uint32_t)value << 16;
+  float f;
+  memcpy (&f, &bits, sizeof (f));
+  return f;
+}
+
+/* rounds to nearest even, NaNs stay (quiet) NaNs */
+static inline uint16_t
+convert_float_to_bf16 (float value)
+{
+  uint32_t bits;
+  memcpy (&bits, &value, sizeof (bits));
+  if ((bits & 0x7fffffffu) > 0x7f800000u)
+    return (uint16_t)((bits >> 16) | 0x40);
+  bits += 0x7fffu + ((bits >> 16) & 1);
+  return (uint16_t)(bits >> 16);
+}
+
+#define CONVERT_INT_TYPES(X)                                                  \
+  X (CL_TENSOR_DTYPE_INT8_EXP, int8_t, INT8_MIN, INT8_MAX)                    \
+  X (CL_TENSOR_DTYPE_INT16_EXP, int16_t, INT16_MIN, INT16_MAX)                \
+  X (CL_TENSOR_DTYPE_INT32_EXP, int32_t, INT32_MIN, INT32_MAX)                \
+  X (CL_TENSOR_DTYPE_INT64_EXP, int64_t, INT64_MIN, INT64_MAX)                \
+  X (CL_TENSOR_DTYPE_UINT8_EXP, uint8_t, 0, UINT8_MAX)                        \
+  X (CL_TENSOR_DTYPE_UINT16_EXP, uint16_t, 0, UINT16_MAX)                     \
+  X (CL_TENSOR_DTYPE_UINT32_EXP, uint32_t, 0, UINT32_MAX)                     \
+  X (CL_TENSOR_DTYPE_UINT64_EXP, uint64_t, 0, UINT64_MAX)
+
+#define CONVERT_LOOP(DST_T, DST, SRC_T, SRC, EXPR)                            \
+  do                                                                          \
+    {                                                                         \
+      const SRC_T *s_ = (const SRC_T *)(SRC);                                 \
+      DST_T *d_ = (DST_T *)(DST);                                             \
+      for (size_t i = 0; i < n; ++i)                                          \
+        {                                                                     \
+          SRC_T x = s_[i];                                                    \
+          d_[i] = (EXPR);                                                     \
+        }                                                                     \
+    }                                                                         \
+  while (0)
+
+static void
+convert_load_f64 (cl_tensor_datatype_exp dtype,
+                  const void *src,
+                  double *dst,
+                  size_t n)
+{
+  switch (dtype)
+    {
+#define LOAD_INT_CASE(DTYPE, T, MIN, MAX)                                     \
+  case DTYPE:                                                                 \
+    CONVERT_LOOP (double, dst, T, src, (double)x);                            \
+    break;
+      CONVERT_INT_TYPES (LOAD_INT_CASE)
+#undef LOAD_INT_CASE
+    case CL_TENSOR_DTYPE_FP16_EXP:
+      CONVERT_LOOP (double, dst, uint16_t, src, pocl_half_to_float (x));
+      break;
+    case CL_TENSOR_DTYPE_BFLOAT16_EXP:
+      CONVERT_LOOP (double, dst, uint16_t, src, convert_bf16_to_float (x));
+      break;
+    case CL_TENSOR_DTYPE_FP32_EXP:
+      CONVERT_LOOP (double, dst, float, src, (double)x);
+      break;
+    case CL_TENSOR_DTYPE_FP64_EXP:
+      memcpy (dst, src, n * sizeof (double));
+      break;
+    default:
+      assert (!"unsupported element type");
+    }
+}
+
+/* Out of range values saturate and NaNs become zero when converted to
+ * integers (the result is undefined by the DBK specification). */
+static void
+convert_store_f64 (cl_tensor_datatype_exp dtype,
+                   const double *src,
+                   void *dst,
+                   size_t n)
+{
+  switch (dtype)
+    {
+#define STORE_INT_CASE(DTYPE, T, MIN, MAX)                                    \
+  case DTYPE:                                                                 \
+    CONVERT_LOOP (T, dst, double, src,                                        \
+                  x != x                 ? (T)0                               \
+                  : x <= (double)(MIN)   ? (T)(MIN)                           \
+                  : x >= (double)(MAX)   ? (T)(MAX)                           \
+                                         : (T)x);                             \
+    break;
+      CONVERT_INT_TYPES (STORE_INT_CASE)
+#undef STORE_INT_CASE
+    case CL_TENSOR_DTYPE_FP16_EXP:
+      CONVERT_LOOP (uint16_t, dst, double, src, pocl_float_to_half ((float)x));
+      break;
+    case CL_TENSOR_DTYPE_BFLOAT16_EXP:
+      CONVERT_LOOP (uint16_t, dst, double, src,
+                    convert_float_to_bf16 ((float)x));
+      break;
+    case CL_TENSOR_DTYPE_FP32_EXP:
+      CONVERT_LOOP (float, dst, double, src, (float)x);
+      break;
+    case CL_TENSOR_DTYPE_FP64_EXP:
+      memcpy (dst, src, n * sizeof (double));
+      break;
+    default:
+      assert (!"unsupported element type");
+    }
+}
+
+static void
+convert_load_i64 (cl_tensor_datatype_exp dtype,
+                  const void *src,
+                  int64_t *dst,
+                  size_t n)
+{
+  switch (dtype)
+    {
+#define LOAD_INT_CASE(DTYPE, T, MIN, MAX)                                     \
+  case DTYPE:                                                                 \
+    CONVERT_LOOP (int64_t, dst, T, src, (int64_t)x);                          \
+    break;
+      CONVERT_INT_TYPES (LOAD_INT_CASE)
+#undef LOAD_INT_CASE
+    default:
+      assert (!"unsupported element type");
+    }
+}
+
+/* integer to integer conversions wrap around */
+static void
+convert_store_i64 (cl_tensor_datatype_exp dtype,
+                   const int64_t *src,
+                   void *dst,
+                   size_t n)
+{
+  switch (dtype)
+    {
+#define STORE_INT_CASE(DTYPE, T, MIN, MAX)                                    \
+  case DTYPE:                                                                 \
+    CONVERT_LOOP (T, dst, int64_t, src, (T)x);                                \
+    break;
+      CONVERT_INT_TYPES (STORE_INT_CASE)
+#undef STORE_INT_CASE
+    default:
+      assert (!"unsupported element type");
+    }
+}
+
+/********************************************************************/
+/* SIMD conversions of the common FP32 <-> FP16/BF16/INT8/UINT8 pairs */
+
+/* Defines NAME which converts VEC elements at a time with BODY (s, d), and
+ * the remaining ones through zero padded buffers, so that the tail is
+ * rounded like the rest of the elements. */
+#define CONVERT_DEFINE_SIMD(NAME, ATTR, SRC_T, DST_T, VEC, BODY)              \
+  static ATTR void NAME (const void *src, void *dst, size_t n)                \
+  {                                                                           \
+    const SRC_T *s = (const SRC_T *)src;                                      \
+    DST_T *d = (DST_T *)dst;                                                  \
+    size_t i = 0;                                                             \
+    for (; i + (VEC) <= n; i += (VEC))                                        \
+      BODY (s + i, d + i);                                                    \
+    if (i < n)                                                                \
+      {                                                                       \
+        SRC_T ts[VEC];                                                        \
+        DST_T td[VEC];                                                        \
+        memset (ts, 0, sizeof (ts));                                          \
+        memcpy (ts, s + i, (n - i) * sizeof (SRC_T));                         \
+        BODY (ts, td);                                                        \
+        memcpy (d + i, td, (n - i) * sizeof (DST_T));                         \
+      }                                                                       \
+  }
+
+#ifdef CONVERT_X86
+
+#define CONVERT_ATTR_F16C __attribute__ ((target ("avx,f16c")))
+#define CONVERT_ATTR_AVX2 __attribute__ ((target ("avx2")))
+#define CONVERT_ATTR_AVX512 __attribute__ ((target ("avx512f")))
+#define CONVERT_ATTR_AVX512BF16                                               \
+  __attribute__ ((target ("avx512f,avx512bf16")))
+
+#define F32_TO_F16_F16C(S, D)                                                 \
+  _mm_storeu_si128 (                                                          \
+    (__m128i *)(D),                                                           \
+    _mm256_cvtps_ph (_mm256_loadu_ps (S), _MM_FROUND_TO_NEAREST_INT))
+#define F16_TO_F32_F16C(S, D)                                                 \
+  _mm256_storeu_ps ((D), _mm256_cvtph_ps (_mm_loadu_si128 ((const __m128i *)(S))))
+#define F32_TO_F16_AVX512(S, D)                                               \
+  _mm256_storeu_si256 (                                                       \
+    (__m256i *)(D),                                                           \
+    _mm512_cvtps_ph (_mm512_loadu_ps (S),                                     \
+                     _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC))
+#define F16_TO_F32_AVX512(S, D)                                               \
+  _mm512_storeu_ps ((D),                                                      \
+                    _mm512_cvtph_ps (_mm256_loadu_si256 ((const __m256i *)(S))))
+#define BF16_TO_F32_AVX512(S, D)                                              \
+  _mm512_storeu_si512 (                                                       \
+    (D), _mm512_slli_epi32 (                                                  \
+           _mm512_cvtepu16_epi32 (_mm256_loadu_si256 ((const __m256i *)(S))), 16))
+#define BF16_TO_F32_AVX2(S, D)                                                \
+  _mm256_storeu_si256 (                                                       \
+    (__m256i *)(D),                                                           \
+    _mm256_slli_epi32 (                                                       \
+      _mm256_cvtepu16_epi32 (_mm_loadu_si128 ((const __m128i *)(S))), 16))
+#define F32_TO_BF16_AVX2(S, D)                                                \
+  _mm_storeu_si128 ((__m128i *)(D), convert_f32_to_bf16_avx2 (S))
+#define I8_TO_F32_AVX2(S, D)                                                  \
+  _mm256_storeu_ps ((D), _mm256_cvtepi32_ps (_mm256_cvtepi8_epi32 (          \
+                           _mm_loadl_epi64 ((const __m128i *)(S)))))
+#define U8_TO_F32_AVX2(S, D)                                                  \
+  _mm256_storeu_ps ((D), _mm256_cvtepi32_ps (_mm256_cvtepu8_epi32 (          \
+                           _mm_loadl_epi64 ((const __m128i *)(S)))))
+#define F32_TO_I8_AVX2(S, D)                                                  \
+  _mm256_storeu_si256 ((__m256i *)(D), convert_f32_to_8bit_avx2 (S, 1))
+#define F32_TO_U8_AVX2(S, D)                                                  \
+  _mm256_storeu_si256 ((__m256i *)(D), convert_f32_to_8bit_avx2 (S, 0))
+
+/* the same rounding as convert_float_to_bf16 () for 8 elements */
+static CONVERT_ATTR_AVX2 inline __m128i
+convert_f32_to_bf16_avx2 (const float *src)
+{
+  __m256 x = _mm256_loadu_ps (src);
+  __m256i bits = _mm256_castps_si256 (x);
+  __m256i hi = _mm256_srli_epi32 (bits, 16);
+  __m256i bias = _mm256_add_epi32 (_mm256_and_si256 (hi, _mm256_set1_epi32 (1)),
+                                   _mm256_set1_epi32 (0x7fff));
+  __m256i r = _mm256_srli_epi32 (_mm256_add_epi32 (bits, bias), 16);
+  __m256i qnan = _mm256_or_si256 (hi, _mm256_set1_epi32 (0x40));
+  __m256 nan = _mm256_cmp_ps (x, x, _CMP_UNORD_Q);
+  r = _mm256_blendv_epi8 (r, qnan, _mm256_castps_si256 (nan));
+  r = _mm256_packus_epi32 (r, r);
+  return _mm256_castsi256_si128 (_mm256_permute4x64_epi64 (r, 0xd8));
+}
+
+/* Converts 32 floats with truncation and saturation. */
+static CONVERT_ATTR_AVX2 inline __m256i
+convert_f32_to_8bit_avx2 (const float *src, int is_signed)
+{
+  __m256i a = _mm256_cvttps_epi32 (_mm256_loadu_ps (src));
+  __m256i b = _mm256_cvttps_epi32 (_mm256_loadu_ps (src + 8));
+  __m256i c = _mm256_cvttps_epi32 (_mm256_loadu_ps (src + 16));
+  __m256i d = _mm256_cvttps_epi32 (_mm256_loadu_ps (src + 24));
+  /* the packs interleave the 128-bit lanes */
+  __m256i ab = _mm256_packs_epi32 (a, b);
+  __m256i cd = _mm256_packs_epi32 (c, d);
+  __m256i r = is_signed ? _mm256_packs_epi16 (ab, cd)
+                        : _mm256_packus_epi16 (ab, cd);
+  return _mm256_permutevar8x32_epi32 (r,
+                                      _mm256_setr_epi32 (0, 4, 1, 5, 2, 6, 3, 7));
+}
+
+CONVERT_DEFINE_SIMD (convert_f32_f16_avx512, CONVERT_ATTR_AVX512, float,
+                     uint16_t, 16, F32_TO_F16_AVX512)
+CONVERT_DEFINE_SIMD (convert_f16_f32_avx512, CONVERT_ATTR_AVX512, uint16_t,
+                     float, 16, F16_TO_F32_AVX512)
+CONVERT_DEFINE_SIMD (convert_bf16_f32_avx512, CONVERT_ATTR_AVX512, uint16_t,
+                     float, 16, BF16_TO_F32_AVX512)
+CONVERT_DEFINE_SIMD (convert_f32_bf16_avx2, CONVERT_ATTR_AVX2, float,
+                     uint16_t, 8, F32_TO_BF16_AVX2)
+CONVERT_DEFINE_SIMD (convert_bf16_f32_avx2, CONVERT_ATTR_AVX2, uint16_t,
+                     float, 8, BF16_TO_F32_AVX2)
+CONVERT_DEFINE_SIMD (convert_f32_i8_avx2, CONVERT_ATTR_AVX2, float, int8_t,
+                     32, F32_TO_I8_AVX2)
+CONVERT_DEFINE_SIMD (convert_f32_u8_avx2, CONVERT_ATTR_AVX2, float, uint8_t,
+                     32, F32_TO_U8_AVX2)
+CONVERT_DEFINE_SIMD (convert_i8_f32_avx2, CONVERT_ATTR_AVX2, int8_t, float, 8,
+                     I8_TO_F32_AVX2)
+CONVERT_DEFINE_SIMD (convert_u8_f32_avx2, CONVERT_ATTR_AVX2, uint8_t, float,
+                     8, U8_TO_F32_AVX2)
+
+#ifdef CONVERT_X86_EXT
+
+#define F32_TO_BF16_AVX512BF16(S, D)                                          \
+  _mm256_storeu_si256 ((__m256i *)(D),                                        \
+                       (__m256i)_mm512_cvtneps_pbh (_mm512_loadu_ps (S)))
+
+CONVERT_DEFINE_SIMD (convert_f32_f16_f16c, CONVERT_ATTR_F16C, float, uint16_t,
+                     8, F32_TO_F16_F16C)
+CONVERT_DEFINE_SIMD (convert_f16_f32_f16c, CONVERT_ATTR_F16C, uint16_t, float,
+                     8, F16_TO_F32_F16C)
+CONVERT_DEFINE_SIMD (convert_f32_bf16_avx512bf16, CONVERT_ATTR_AVX512BF16,
+                     float, uint16_t, 16, F32_TO_BF16_AVX512BF16)
+
+#endif
+#endif
+
+#ifdef CONVERT_NEON
+
+#define F32_TO_F16_NEON(S, D)                                                 \
+  vst1_u16 ((D), vreinterpret_u16_f16 (vcvt_f16_f32 (vld1q_f32 (S))))
+#define F16_TO_F32_NEON(S, D)                                                 \
+  vst1q_f32 ((D), vcvt_f32_f16 (vreinterpret_f16_u16 (vld1_u16 (S))))
+#define BF16_TO_F32_NEON(S, D)                                                \
+  vst1q_u32 ((uint32_t *)(D), vshll_n_u16 (vld1_u16 (S), 16))
+
+CONVERT_DEFINE_SIMD (convert_f32_f16_neon, , float, uint16_t, 4,
+                     F32_TO_F16_NEON)
+CONVERT_DEFINE_SIMD (convert_f16_f32_neon, , uint16_t, float, 4,
+                     F16_TO_F32_NEON)
+CONVERT_DEFINE_SIMD (convert_bf16_f32_neon, , uint16_t, float, 4,
+                     BF16_TO_F32_NEON)
+
+#endif
+
+#define CONVERT_PAIR(SRC, DST)                                                \
+  (((unsigned)(SRC) << 8) | (unsigned)(DST))
+
+/* Returns the fastest SIMD conversion for the host, NULL if the pair goes
+ * through the generic conversion. */
+static convert_fn
+convert_select (cl_tensor_datatype_exp src, cl_tensor_datatype_exp dst)
+{
+  unsigned pair = CONVERT_PAIR (src, dst);
+  (void)pair;
+#ifdef CONVERT_X86
+  int avx512 = __builtin_cpu_supports ("avx512f");
+  int avx2 = __builtin_cpu_supports ("avx2");
+#ifdef CONVERT_X86_EXT
+  int f16c = __builtin_cpu_supports ("f16c");
+  int avx512bf16 = avx512 && __builtin_cpu_supports ("avx512bf16");
+#else
+  int f16c = 0, avx512bf16 = 0;
+#endif
+  switch (pair)
+    {
+    case CONVERT_PAIR (CL_TENSOR_DTYPE_FP32_EXP, CL_TENSOR_DTYPE_FP16_EXP):
+      if (avx512)
+        return convert_f32_f16_avx512;
+#ifdef CONVERT_X86_EXT
+      if (f16c)
+        return convert_f32_f16_f16c;
+#endif
+      break;
+    case CONVERT_PAIR (CL_TENSOR_DTYPE_FP16_EXP, CL_TENSOR_DTYPE_FP32_EXP):
+      if (avx512)
+        return convert_f16_f32_avx512;
+#ifdef CONVERT_X86_EXT
+      if (f16c)
+        return convert_f16_f32_f16c;
+#endif
+      break;
+    case CONVERT_PAIR (CL_TENSOR_DTYPE_FP32_EXP, CL_TENSOR_DTYPE_BFLOAT16_EXP):
+#ifdef CONVERT_X86_EXT
+      if (avx512bf16)
+        return convert_f32_bf16_avx512bf16;
+#endif
+      if (avx2)
+        return convert_f32_bf16_avx2;
+      break;
+    case CONVERT_PAIR (CL_TENSOR_DTYPE_BFLOAT16_EXP, CL_TENSOR_DTYPE_FP32_EXP):
+      if (avx512)
+        return convert_bf16_f32_avx512;
+      if (avx2)
+        return convert_bf16_f32_avx2;
+      break;
+    case CONVERT_PAIR (CL_TENSOR_DTYPE_FP32_EXP, CL_TENSOR_DTYPE_INT8_EXP):
+      if (avx2)
+        return convert_f32_i8_avx2;
+      break;
+    case CONVERT_PAIR (CL_TENSOR_DTYPE_FP32_EXP, CL_TENSOR_DTYPE_UINT8_EXP):
+      if (avx2)
+        return convert_f32_u8_avx2;
+      break;
+    case CONVERT_PAIR (CL_TENSOR_DTYPE_INT8_EXP, CL_TENSOR_DTYPE_FP32_EXP):
+      if (avx2)
+        return convert_i8_f32_avx2;
+      break;
+    case CONVERT_PAIR (CL_TENSOR_DTYPE_UINT8_EXP, CL_TENSOR_DTYPE_FP32_EXP):
+      if (avx2)
+        return convert_u8_f32_avx2;
+      break;
+    default:
+      break;
+    }
+  (void)f16c;
+  (void)avx512bf16;
+#endif
+#ifdef CONVERT_NEON
+  switch (pair)
+    {
+    case CONVERT_PAIR (CL_TENSOR_DTYPE_FP32_EXP, CL_TENSOR_DTYPE_FP16_EXP):
+      return convert_f32_f16_neon;
+    case CONVERT_PAIR (CL_TENSOR_DTYPE_FP16_EXP, CL_TENSOR_DTYPE_FP32_EXP):
+      return convert_f16_f32_neon;
+    case CONVERT_PAIR (CL_TENSOR_DTYPE_BFLOAT16_EXP, CL_TENSOR_DTYPE_FP32_EXP):
+      return convert_bf16_f32_neon;
+    default:
+      break;
+    }
+#endif
+  return NULL;
+}
+
+/********************************************************************/
+
+/* a conversion between two element types */
+typedef struct convert_op
+{
+  cl_tensor_datatype_exp src_dtype;
+  cl_tensor_datatype_exp dst_dtype;
+  size_t src_size;
+  size_t dst_size;
+  /* the SIMD conversion, NULL if none */
+  convert_fn simd;
+  /* the generic conversion goes through int64_t instead of double */
+  int int_pivot;
+} convert_op;
+
+static void
+convert_op_init (convert_op *op,
+                 cl_tensor_datatype_exp src_dtype,
+                 cl_tensor_datatype_exp dst_dtype)
+{
+  op->src_dtype = src_dtype;
+  op->dst_dtype = dst_dtype;
+  op->src_size = pocl_tensor_type_size (src_dtype);
+  op->dst_size = pocl_tensor_type_size (dst_dtype);
+  op->simd = src_dtype == dst_dtype ? NULL : convert_select (src_dtype,
+                                                              dst_dtype);
+  op->int_pivot = pocl_tensor_type_is_int (src_dtype) == 1
+                  && pocl_tensor_type_is_int (dst_dtype) == 1;
+}
+
+static void
+convert_contiguous (const convert_op *op,
+                    const void *src,
+                    void *dst,
+                    size_t n)
+{
+  if (op->src_dtype == op->dst_dtype)
+    {
+      memcpy (dst, src, n * op->src_size);
+      return;
+    }
+  if (op->simd != NULL)
+    {
+      op->simd (src, dst, n);
+      return;
+    }
+
+  const char *s = (const char *)src;
+  char *d = (char *)dst;
+  for (size_t i = 0; i < n; i += CONVERT_BLOCK)
+    {
+      size_t count = CONVERT_MIN (CONVERT_BLOCK, n - i);
+      if (op->int_pivot)
+        {
+          int64_t pivot[CONVERT_BLOCK];
+          convert_load_i64 (op->src_dtype, s + i * op->src_size, pivot,
+                            count);
+          convert_store_i64 (op->dst_dtype, pivot, d + i * op->dst_size,
+                             count);
+        }
+      else
+        {
+          double pivot[CONVERT_BLOCK];
+          convert_load_f64 (op->src_dtype, s + i * op->src_size, pivot,
+                            count);
+          convert_store_f64 (op->dst_dtype, pivot, d + i * op->dst_size,
+                             count);
+        }
+    }
+}
+
+/* Copies n elements of the given size with a stride (in elements) to or
+ * from a contiguous buffer. */
+#define CONVERT_COPY_STRIDED(T)                                               \
+  do                                                                          \
+    {                                                                         \
+      const T *s_ = (const T *)src;                                           \
+      T *d_ = (T *)dst;                                                       \
+      for (size_t i = 0; i < n; ++i)                                          \
+        d_[i * dst_stride] = s_[i * src_stride];                              \
+    }                                                                         \
+  while (0)
+
+static void
+convert_copy_strided (const void *src,
+                      size_t src_stride,
+                      void *dst,
+                      size_t dst_stride,
+                      size_t size,
+                      size_t n)
+{
+  switch (size)
+    {
+    case 1:
+      CONVERT_COPY_STRIDED (uint8_t);
+      break;
+    case 2:
+      CONVERT_COPY_STRIDED (uint16_t);
+      break;
+    case 4:
+      CONVERT_COPY_STRIDED (uint32_t);
+      break;
+    case 8:
+      CONVERT_COPY_STRIDED (uint64_t);
+      break;
+    default:
+      assert (!"unsupported element size");
+    }
+}
+
+/* Converts n elements with strides (in elements), gathering and scattering
+ * the strided sides through stack buffers. */
+static void
+convert_strided (const convert_op *op,
+                 const char *src,
+                 size_t src_stride,
+                 char *dst,
+                 size_t dst_stride,
+                 size_t n)
+{
+  if (src_stride == 1 && dst_stride == 1)
+    {
+      convert_contiguous (op, src, dst, n);
+      return;
+    }
+
+  uint64_t src_buf[CONVERT_BLOCK];
+  uint64_t dst_buf[CONVERT_BLOCK];
+  for (size_t i = 0; i < n; i += CONVERT_BLOCK)
+    {
+      size_t count = CONVERT_MIN (CONVERT_BLOCK, n - i);
+      const char *s = src + i * src_stride * op->src_size;
+      char *d = dst + i * dst_stride * op->dst_size;
+      if (src_stride != 1)
+        {
+          convert_copy_strided (s, src_stride, src_buf, 1, op->src_size,
+                                count);
+          s = (const char *)src_buf;
+        }
+      if (dst_stride != 1)
+        {
+          convert_contiguous (op, s, dst_buf, count);
+          convert_copy_strided (dst_buf, 1, d, dst_stride, op->dst_size,
+                                count);
+        }
+      else
+        convert_contiguous (op, s, d, count);
+    }
+}
+
+/********************************************************************/
+/* convert_exp */
+
+/* The loop nest over the elements of the source and destination tensors,
+ * innermost dimension first. */
+typedef struct convert_state
+{
+  const char *src;
+  char *dst;
+  convert_op op;
+  unsigned ndims;
+  size_t shape[CL_MEM_MAX_TENSOR_RANK_EXP];
+  size_t src_strides[CL_MEM_MAX_TENSOR_RANK_EXP];
+  size_t dst_strides[CL_MEM_MAX_TENSOR_RANK_EXP];
+  /* the rows (iterations of the outer dimensions) */
+  size_t rows;
+  /* the chunks of each row if longer than CONVERT_CHUNK_ELEMS, otherwise 1 */
+  size_t row_segments;
+  size_t rows_per_chunk;
+} convert_state;
+
+/* Orders the dimensions by their destination strides, drops the unit ones
+ * and merges the dimensions that are contiguous in both tensors. */
+static void
+convert_build_nest (convert_state *s,
+                    const cl_tensor_desc_exp *t,
+                    const size_t *src_strides,
+                    const size_t *dst_strides)
+{
+  unsigned order[CL_MEM_MAX_TENSOR_RANK_EXP];
+  unsigned count = 0;
+  for (unsigned dim = 0; dim < t->rank; ++dim)
+    {
+      if (t->shape[dim] == 1)
+        continue;
+      unsigned pos = count++;
+      while (pos > 0
+             && (dst_strides[order[pos - 1]] > dst_strides[dim]
+                 || (dst_strides[order[pos - 1]] == dst_strides[dim]
+                     && src_strides[order[pos - 1]] > src_strides[dim])))
+        {
+          order[pos] = order[pos - 1];
+          --pos;
+        }
+      order[pos] = dim;
+    }
+
+  s->ndims = 0;
+  for (unsigned i = 0; i < count; ++i)
+    {
+      unsigned dim = order[i];
+      if (s->ndims > 0)
+        {
+          unsigned last = s->ndims - 1;
+          if (s->src_strides[last] * s->shape[last] == src_strides[dim]
+              && s->dst_strides[last] * s->shape[last] == dst_strides[dim])
+            {
+              s->shape[last] *= t->shape[dim];
+              continue;
+            }
+        }
+      s->shape[s->ndims] = t->shape[dim];
+      s->src_strides[s->ndims] = src_strides[dim];
+      s->dst_strides[s->ndims] = dst_strides[dim];
+      ++s->ndims;
+    }
+
+  if (s->ndims == 0)
+    {
+      /* a single element */
+      s->ndims = 1;
+      s->shape[0] = 1;
+      s->src_strides[0] = 1;
+      s->dst_strides[0] = 1;
+    }
+}
+
+static int
+convert_run (void *data, size_t first, size_t count)
+{
+  const convert_state *s = (const convert_state *)data;
+  size_t inner = s->shape[0];
+
+  for (size_t chunk = first; chunk < first + count; ++chunk)
+    {
+      size_t row_first, row_count, begin, len;
+      if (s->row_segments > 1)
+        {
+          row_first = chunk / s->row_segments;
+          row_count = 1;
+          begin = (chunk % s->row_segments) * CONVERT_CHUNK_ELEMS;
+          len = CONVERT_MIN (CONVERT_CHUNK_ELEMS, inner - begin);
+        }
+      else
+        {
+          row_first = chunk * s->rows_per_chunk;
+          row_count = CONVERT_MIN (s->rows_per_chunk, s->rows - row_first);
+          begin = 0;
+          len = inner;
+        }
+
+      for (size_t row = row_first; row < row_first + row_count; ++row)
+        {
+          size_t src_off = begin * s->src_strides[0];
+          size_t dst_off = begin * s->dst_strides[0];
+          size_t rest = row;
+          for (unsigned dim = 1; dim < s->ndims; ++dim)
+            {
+              size_t x = rest % s->shape[dim];
+              rest /= s->shape[dim];
+              src_off += x * s->src_strides[dim];
+              dst_off += x * s->dst_strides[dim];
+            }
+          convert_strided (&s->op, s->src + src_off * s->op.src_size,
+                           s->src_strides[0],
+                           s->dst + dst_off * s->op.dst_size,
+                           s->dst_strides[0], len);
+        }
+    }
+
+  return CL_SUCCESS;
+}
+
+int
+pocl_cpu_partition_dbk_exp_convert (cl_program program,
+                                    cl_kernel kernel,
+                                    pocl_kernel_metadata_t *meta,
+                                    cl_uint dev_i,
+                                    struct pocl_argument *arguments,
+                                    pocl_cpu_dbk_partition *part)
+{
+  cl_device_id dev = program->devices[dev_i];
+  const cl_dbk_attributes_convert_exp *attrs = meta->builtin_kernel_attrs;
+  unsigned mem_id = dev->global_mem_id;
+  size_t src_strides[CL_MEM_MAX_TENSOR_RANK_EXP];
+  size_t dst_strides[CL_MEM_MAX_TENSOR_RANK_EXP];
+
+  if (pocl_tensor_get_strides (&attrs->src, src_strides) != CL_SUCCESS
+      || pocl_tensor_get_strides (&attrs->dst, dst_strides) != CL_SUCCESS)
+    {
+      POCL_RETURN_ERROR (CL_INVALID_TENSOR_LAYOUT_EXP,
+                         "convert_exp: unsupported data layout\n");
+    }
+
+  convert_state *s = (convert_state *)calloc (1, sizeof (convert_state));
+  if (s == NULL)
+    return CL_OUT_OF_HOST_MEMORY;
+  s->src = pocl_cpu_get_ptr (&arguments[0], mem_id);
+  s->dst = pocl_cpu_get_ptr (&arguments[1], mem_id);
+  convert_op_init (&s->op, attrs->src.dtype, attrs->dst.dtype);
+  convert_build_nest (s, &attrs->src, src_strides, dst_strides);
+
+  size_t elems = pocl_tensor_element_count (&attrs->src);
+  size_t inner = s->shape[0];
+  s->rows = inner > 0 ? elems / inner : 0;
+  if (inner > CONVERT_CHUNK_ELEMS)
+    {
+      s->row_segments
+        = (inner + CONVERT_CHUNK_ELEMS - 1) / CONVERT_CHUNK_ELEMS;
+      s->rows_per_chunk = 1;
+      part->num_chunks = s->rows * s->row_segments;
+    }
+  else
+    {
+      s->row_segments = 1;
+      s->rows_per_chunk = inner > 0 ? CONVERT_CHUNK_ELEMS / inner : 1;
+      part->num_chunks
+        = (s->rows + s->rows_per_chunk - 1) / s->rows_per_chunk;
+    }
+
+  part->run = convert_run;
+  part->finish = free;
+  part->state = s;
+  return CL_SUCCESS;
+}
+
+/********************************************************************/
+/* set_rows_exp */
+
+typedef struct set_rows_state
+{
+  const char *data_in;
+  const char *rows;
+  const int64_t *indices;
+  char *data_out;
+  /* rows to data_out */
+  convert_op row_op;
+  /* data_in to data_out */
+  convert_op copy_op;
+  /* data: [b0, b1, n, e], rows: [b0, b1, r, e], indices: [0, i0, i1, r] */
+  size_t b1;
+  size_t n;
+  size_t r;
+  size_t e;
+  size_t i0;
+  size_t i1;
+  size_t in_strides[4];
+  size_t rows_strides[4];
+  size_t idx_strides[4];
+  size_t out_strides[4];
+  /* data_in is data_out, only the scattered rows are written */
+  int in_place;
+  /* the data rows (copying) or the scattered rows (in place) of a chunk */
+  size_t rows_per_chunk;
+  /* the chunks of a (b0, b1) batch entry */
+  size_t chunks_per_batch;
+} set_rows_state;
+
+static void
+set_rows_store_row (const set_rows_state *s,
+                    size_t b0,
+                    size_t b1,
+                    size_t row,
+                    size_t dst_row)
+{
+  const char *src
+    = s->rows
+      + (b0 * s->rows_strides[0] + b1 * s->rows_strides[1]
+         + row * s->rows_strides[2])
+          * s->row_op.src_size;
+  char *dst = s->data_out
+              + (b0 * s->out_strides[0] + b1 * s->out_strides[1]
+                 + dst_row * s->out_strides[2])
+                  * s->row_op.dst_size;
+  convert_strided (&s->row_op, src, s->rows_strides[3], dst,
+                   s->out_strides[3], s->e);
+}
+
+static int
+set_rows_run (void *data, size_t first, size_t count)
+{
+  const set_rows_state *s = (const set_rows_state *)data;
+
+  for (size_t chunk = first; chunk < first + count; ++chunk)
+    {
+      size_t batch = chunk / s->chunks_per_batch;
+      size_t block = chunk % s->chunks_per_batch;
+      size_t b0 = batch / s->b1;
+      size_t b1 = batch % s->b1;
+      const int64_t *indices
+        = s->indices + (b0 % s->i0) * s->idx_strides[1]
+          + (b1 % s->i1) * s->idx_strides[2];
+
+      if (s->in_place)
+        {
+          size_t r_begin = block * s->rows_per_chunk;
+          size_t r_end = CONVERT_MIN (r_begin + s->rows_per_chunk, s->r);
+          for (size_t r = r_begin; r < r_end; ++r)
+            {
+              int64_t idx = indices[r * s->idx_strides[3]];
+              if (idx >= 0 && (uint64_t)idx < s->n)
+                set_rows_store_row (s, b0, b1, r, (size_t)idx);
+            }
+          continue;
+        }
+
+      size_t n_begin = block * s->rows_per_chunk;
+      size_t n_end = CONVERT_MIN (n_begin + s->rows_per_chunk, s->n);
+      for (size_t n = n_begin; n < n_end; ++n)
+        {
+          const char *src = s->data_in
+                            + (b0 * s->in_strides[0] + b1 * s->in_strides[1]
+                               + n * s->in_strides[2])
+                                * s->copy_op.src_size;
+          char *dst = s->data_out
+                      + (b0 * s->out_strides[0] + b1 * s->out_strides[1]
+                         + n * s->out_strides[2])
+                          * s->copy_op.dst_size;
+          convert_strided (&s->copy_op, src, s->in_strides[3], dst,
+                           s->out_strides[3], s->e);
+        }
+      /* in the order of the rows, so that the last one of duplicate indices
+       * wins as in a sequential loop */
+      for (size_t r = 0; r < s->r; ++r)
+        {
+          int64_t idx = indices[r * s->idx_strides[3]];
+          if (idx >= 0 && (uint64_t)idx >= n_begin && (uint64_t)idx < n_end)
+            set_rows_store_row (s, b0, b1, r, (size_t)idx);
+        }
+    }
+
+  return CL_SUCCESS;
+}
+
+int
+pocl_cpu_partition_dbk_exp_set_rows (cl_program program,
+                                     cl_kernel kernel,
+                                     pocl_kernel_metadata_t *meta,
+                                     cl_uint dev_i,
+                                     struct pocl_argument *arguments,
+                                     pocl_cpu_dbk_partition *part)
+{
+  cl_device_id dev = program->devices[dev_i];
+  const cl_dbk_attributes_set_rows_exp *attrs = meta->builtin_kernel_attrs;
+  unsigned mem_id = dev->global_mem_id;
+
+  set_rows_state *s = (set_rows_state *)calloc (1, sizeof (set_rows_state));
+  if (s == NULL)
+    return CL_OUT_OF_HOST_MEMORY;
+
+  if (pocl_tensor_get_strides (&attrs->data_in, s->in_strides) != CL_SUCCESS
+      || pocl_tensor_get_strides (&attrs->rows, s->rows_strides) != CL_SUCCESS
+      || pocl_tensor_get_strides (&attrs->indices, s->idx_strides)
+           != CL_SUCCESS
+      || pocl_tensor_get_strides (&attrs->data_out, s->out_strides)
+           != CL_SUCCESS)
+    {
+      free (s);
+      POCL_RETURN_ERROR (CL_INVALID_TENSOR_LAYOUT_EXP,
+                         "set_rows_exp: unsupported data layout\n");
+    }
+
+  s->data_in = pocl_cpu_get_ptr (&arguments[0], mem_id);
+  s->rows = pocl_cpu_get_ptr (&arguments[1], mem_id);
+  s->indices = pocl_cpu_get_ptr (&arguments[2], mem_id);
+  s->data_out = pocl_cpu_get_ptr (&arguments[3], mem_id);
+  convert_op_init (&s->row_op, attrs->rows.dtype, attrs->data_out.dtype);
+  convert_op_init (&s->copy_op, attrs->data_in.dtype, attrs->data_out.dtype);
+
+  size_t b0 = attrs->data_in.shape[0];
+  s->b1 = attrs->data_in.shape[1];
+  s->n = attrs->data_in.shape[2];
+  s->e = attrs->data_in.shape[3];
+  s->r = attrs->rows.shape[2];
+  s->i0 = attrs->indices.shape[1];
+  s->i1 = attrs->indices.shape[2];
+
+  if (s->data_in == s->data_out)
+    {
+      if (memcmp (s->in_strides, s->out_strides, sizeof (s->in_strides)))
+        {
+          free (s);
+          POCL_RETURN_ERROR (CL_INVALID_ARG_VALUE,
+                             "set_rows_exp: data_in and data_out are the "
+                             "same buffer with different data layouts\n");
+        }
+      s->in_place = 1;
+    }
+
+  size_t block_rows = s->in_place ? s->r : s->n;
+  s->rows_per_chunk = s->e > 0 && s->e < CONVERT_CHUNK_ELEMS
+                        ? CONVERT_CHUNK_ELEMS / s->e
+                        : 1;
+  s->chunks_per_batch
+    = (block_rows + s->rows_per_chunk - 1) / s->rows_per_chunk;
+
+  part->num_chunks = s->e > 0 ? b0 * s->b1 * s->chunks_per_batch : 0;
+  part->run = set_rows_run;
+  part->finish = free;
+  part->state = s;
+  return CL_SUCCESS;
+}
@@ -0,0 +1,92 @@
+/* pocl_dbk_khr_convert_cpu.h - CPU implementation of the tensor element
+   type conversion and set_rows DBKs.
+
+   Copyright (c) 2026 PoCL developers
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+*/
+
+#ifndef POCL_DBK_KHR_CONVERT_CPU_H
+#define POCL_DBK_KHR_CONVERT_CPU_H
+
+#include "pocl_cl.h"
+#include "pocl_dbk_cpu_partition.h"
+#include "pocl_export.h"
+
+/**
+ * Checks the CPU specific requirements of the convert DBK: the tensors must
+ * have a (pitched) BLAS or ML data layout and 8 to 64-bit integer, FP16,
+ * BF16, FP32 or FP64 elements.
+ */
+POCL_EXPORT int
+pocl_cpu_validate_dbk_convert (const cl_dbk_attributes_convert_exp *attrs);
+
+/**
+ * Same as pocl_cpu_validate_dbk_convert () for the set_rows DBK, whose
+ * 'rows' are converted to the element type of 'data_out'.
+ */
+POCL_EXPORT int
+pocl_cpu_validate_dbk_set_rows (const cl_dbk_attributes_set_rows_exp *attrs);
+
+/**
+ * Splits the element type conversion of a tensor into chunks of rows, or of
+ * row segments for long rows. The dimensions that are contiguous in both
+ * tensors are merged first, so that tensors with the same data layout are
+ * converted as a flat array. The common conversions between FP32 and
+ * FP16/BF16/INT8/UINT8 use the F16C, AVX-512F, AVX-512 BF16, AVX2 or NEON
+ * instructions when the host has them.
+ *
+ * \param program [in] used to retrieve device data.
+ * \param kernel [in] unused.
+ * \param meta [in] used for retrieving dbk attributes.
+ * \param dev_i [in] used to retrieve device data.
+ * \param arguments [in] the source and destination tensors.
+ * \param part [out] the chunks of the conversion.
+ */
+POCL_EXPORT int
+pocl_cpu_partition_dbk_exp_convert (cl_program program,
+                                    cl_kernel kernel,
+                                    pocl_kernel_metadata_t *meta,
+                                    cl_uint dev_i,
+                                    struct pocl_argument *arguments,
+                                    pocl_cpu_dbk_partition *part);
+
+/**
+ * Splits a set_rows into chunks of (batch entry, block of rows). When
+ * data_in and data_out are the same buffer the chunks cover the scattered
+ * rows only, otherwise they copy blocks of data_in rows to data_out and
+ * store the scattered rows which land in the block. Rows whose index is out
+ * of the bounds of data_out are skipped.
+ *
+ * \param program [in] used to retrieve device data.
+ * \param kernel [in] unused.
+ * \param meta [in] used for retrieving dbk attributes.
+ * \param dev_i [in] used to retrieve device data.
+ * \param arguments [in] the data_in, rows, indices and data_out tensors.
+ * \param part [out] the chunks of the operation.
+ */
+POCL_EXPORT int
+pocl_cpu_partition_dbk_exp_set_rows (cl_program program,
+                                     cl_kernel kernel,
+                                     pocl_kernel_metadata_t *meta,
+                                     cl_uint dev_i,
+                                     struct pocl_argument *arguments,
+                                     pocl_cpu_dbk_partition *part);
+
+#endif
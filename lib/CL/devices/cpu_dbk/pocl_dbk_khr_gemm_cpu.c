@@ -0,0 +1,770 @@
+/* pocl_dbk_khr_gemm_cpu.c - native CPU implementation of the GEMM and
+   matmul DBKs.
+
+   Copyright (c) 2026 PoCL developers
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GEMM_X86
+#include <immintrin.h>
+#endif
+
+#ifdef __aarch64__
+#define GEMM_NEON
+#include <arm_neon.h>
+#endif
+
+#include "pocl_cl_half_util.h"
+#include "pocl_dbk_khr_gemm_cpu.h"
+#include "pocl_debug.h"
+#include "pocl_runtime_config.h"
+#include "pocl_tensor_util.h"
+#include "pocl_util.h"
+
+/* The GEMM is computed GotoBLAS-style: the chunk's block of B is packed
+ * into panels of NR columns, the block of A into panels of MR rows, and a
+ * microkernel multiplies an MR x KC panel of A with a KC x NR panel of B
+ * keeping the MR x NR accumulators in registers. The KC x NR panel of B
+ * stays in L1 while the MC x KC block of A is streamed from L2. */
+
+/* the rows of A in a block (rounded down to a multiple of MR) */
+#define GEMM_MC 96
+/* the columns of B in a block, a multiple of all NRs */
+#define GEMM_NC 256
+/* the size of a row of the panels in bytes: KC is 256 for 4-byte and 128
+ * for 8-byte types */
+#define GEMM_KC_BYTES 1024
+
+#define GEMM_MAX_MR 8
+#define GEMM_MAX_NR 32
+
+/* The types the products are accumulated in. Integer products wrap around
+ * like in the C type, so they are accumulated in unsigned types, and in 32
+ * bits when C is not wider than that. Integer matrices narrower than C are
+ * sign or zero extended and floating-point ones converted at packing. */
+typedef enum gemm_kind
+{
+  GEMM_F32,
+  GEMM_F64,
+  GEMM_I32,
+  GEMM_I64,
+  GEMM_NUM_KINDS
+} gemm_kind;
+
+/* Computes the MR x NR tile c (row-major) = the MR x kc panel a (stored
+ * column by column) * the kc x NR panel b (stored row by row). */
+typedef void (*gemm_ukernel_fn) (size_t kc,
+                                 const void *a,
+                                 const void *b,
+                                 void *c);
+
+typedef struct gemm_ukernel
+{
+  unsigned mr;
+  unsigned nr;
+  gemm_ukernel_fn fn;
+} gemm_ukernel;
+
+typedef struct gemm_isa
+{
+  const char *name;
+  int (*available) (void);
+  gemm_ukernel kernels[GEMM_NUM_KINDS];
+} gemm_isa;
+
+/* The portable microkernels, which the compiler can vectorize as the tile
+ * sizes are constant. They are also used for the integer types with the
+ * ISA-specific target attributes. */
+#define GEMM_DEFINE_GENERIC_UKERNEL(NAME, ATTR, T, MR, NR)                    \
+  ATTR static void NAME (size_t kc, const void *a_, const void *b_, void *c_) \
+  {                                                                           \
+    const T *a = (const T *)a_;                                               \
+    const T *b = (const T *)b_;                                               \
+    T acc[MR * NR];                                                           \
+    memset (acc, 0, sizeof (acc));                                            \
+    for (size_t p = 0; p < kc; ++p, a += MR, b += NR)                         \
+      for (unsigned r = 0; r < MR; ++r)                                       \
+        for (unsigned c = 0; c < NR; ++c)                                     \
+          acc[r * NR + c] += a[r] * b[c];                                     \
+    memcpy (c_, acc, sizeof (acc));                                           \
+  }
+
+GEMM_DEFINE_GENERIC_UKERNEL (ukernel_f32_generic, , float, 4, 8)
+GEMM_DEFINE_GENERIC_UKERNEL (ukernel_f64_generic, , double, 4, 4)
+GEMM_DEFINE_GENERIC_UKERNEL (ukernel_i32_generic, , uint32_t, 4, 8)
+GEMM_DEFINE_GENERIC_UKERNEL (ukernel_i64_generic, , uint64_t, 4, 4)
+
+static int
+gemm_always_available (void)
+{
+  return 1;
+}
+
+#ifdef GEMM_X86
+
+#define GEMM_ATTR_SSE2 __attribute__ ((target ("sse2")))
+#define GEMM_ATTR_AVX2 __attribute__ ((target ("avx2,fma")))
+#define GEMM_ATTR_AVX512 __attribute__ ((target ("avx512f")))
+
+GEMM_ATTR_SSE2 static void
+ukernel_f32_sse2 (size_t kc, const void *a_, const void *b_, void *c_)
+{
+  const float *a = (const float *)a_;
+  const float *b = (const float *)b_;
+  float *c = (float *)c_;
+  __m128 acc[4][2];
+  for (int r = 0; r < 4; ++r)
+    acc[r][0] = acc[r][1] = _mm_setzero_ps ();
+  for (size_t p = 0; p < kc; ++p, a += 4, b += 8)
+    {
+      __m128 b0 = _mm_loadu_ps (b);
+      __m128 b1 = _mm_loadu_ps (b + 4);
+      for (int r = 0; r < 4; ++r)
+        {
+          __m128 ar = _mm_set1_ps (a[r]);
+          acc[r][0] = _mm_add_ps (acc[r][0], _mm_mul_ps (ar, b0));
+          acc[r][1] = _mm_add_ps (acc[r][1], _mm_mul_ps (ar, b1));
+        }
+    }
+  for (int r = 0; r < 4; ++r)
+    {
+      _mm_storeu_ps (c + r * 8, acc[r][0]);
+      _mm_storeu_ps (c + r * 8 + 4, acc[r][1]);
+    }
+}
+
+GEMM_ATTR_SSE2 static void
+ukernel_f64_sse2 (size_t kc, const void *a_, const void *b_, void *c_)
+{
+  const double *a = (const double *)a_;
+  const double *b = (const double *)b_;
+  double *c = (double *)c_;
+  __m128d acc[4][2];
+  for (int r = 0; r < 4; ++r)
+    acc[r][0] = acc[r][1] = _mm_setzero_pd ();
+  for (size_t p = 0; p < kc; ++p, a += 4, b += 4)
+    {
+      __m128d b0 = _mm_loadu_pd (b);
+      __m128d b1 = _mm_loadu_pd (b + 2);
+      for (int r = 0; r < 4; ++r)
+        {
+          __m128d ar = _mm_set1_pd (a[r]);
+          acc[r][0] = _mm_add_pd (acc[r][0], _mm_mul_pd (ar, b0));
+          acc[r][1] = _mm_add_pd (acc[r][1], _mm_mul_pd (ar, b1));
+        }
+    }
+  for (int r = 0; r < 4; ++r)
+    {
+      _mm_storeu_pd (c + r * 4, acc[r][0]);
+      _mm_storeu_pd (c + r * 4 + 2, acc[r][1]);
+    }
+}
+
+GEMM_ATTR_AVX2 static void
+ukernel_f32_avx2 (size_t kc, const void *a_, const void *b_, void *c_)
+{
+  const float *a = (const float *)a_;
+  const float *b = (const float *)b_;
+  float *c = (float *)c_;
+  __m256 acc[6][2];
+  for (int r = 0; r < 6; ++r)
+    acc[r][0] = acc[r][1] = _mm256_setzero_ps ();
+  for (size_t p = 0; p < kc; ++p, a += 6, b += 16)
+    {
+      __m256 b0 = _mm256_loadu_ps (b);
+      __m256 b1 = _mm256_loadu_ps (b + 8);
+      for (int r = 0; r < 6; ++r)
+        {
+          __m256 ar = _mm256_broadcast_ss (a + r);
+          acc[r][0] = _mm256_fmadd_ps (ar, b0, acc[r][0]);
+          acc[r][1] = _mm256_fmadd_ps (ar, b1, acc[r][1]);
+        }
+    }
+  for (int r = 0; r < 6; ++r)
+    {
+      _mm256_storeu_ps (c + r * 16, acc[r][0]);
+      _mm256_storeu_ps (c + r * 16 + 8, acc[r][1]);
+    }
+}
+
+GEMM_ATTR_AVX2 static void
+ukernel_f64_avx2 (size_t kc, const void *a_, const void *b_, void *c_)
+{
+  const double *a = (const double *)a_;
+  const double *b = (const double *)b_;
+  double *c = (double *)c_;
+  __m256d acc[6][2];
+  for (int r = 0; r < 6; ++r)
+    acc[r][0] = acc[r][1] = _mm256_setzero_pd ();
+  for (size_t p = 0; p < kc; ++p, a += 6, b += 8)
+    {
+      __m256d b0 = _mm256_loadu_pd (b);
+      __m256d b1 = _mm256_loadu_pd (b + 4);
+      for (int r = 0; r < 6; ++r)
+        {
+          __m256d ar = _mm256_broadcast_sd (a + r);
+          acc[r][0] = _mm256_fmadd_pd (ar, b0, acc[r][0]);
+          acc[r][1] = _mm256_fmadd_pd (ar, b1, acc[r][1]);
+        }
+    }
+  for (int r = 0; r < 6; ++r)
+    {
+      _mm256_storeu_pd (c + r * 8, acc[r][0]);
+      _mm256_storeu_pd (c + r * 8 + 4, acc[r][1]);
+    }
+}
+
+GEMM_ATTR_AVX512 static void
+ukernel_f32_avx512 (size_t kc, const void *a_, const void *b_, void *c_)
+{
+  const float *a = (const float *)a_;
+  const float *b = (const float *)b_;
+  float *c = (float *)c_;
+  __m512 acc[8][2];
+  for (int r = 0; r < 8; ++r)
+    acc[r][0] = acc[r][1] = _mm512_setzero_ps ();
+  for (size_t p = 0; p < kc; ++p, a += 8, b += 32)
+    {
+      __m512 b0 = _mm512_loadu_ps (b);
+      __m512 b1 = _mm512_loadu_ps (b + 16);
+      for (int r = 0; r < 8; ++r)
+        {
+          __m512 ar = _mm512_set1_ps (a[r]);
+          acc[r][0] = _mm512_fmadd_ps (ar, b0, acc[r][0]);
+          acc[r][1] = _mm512_fmadd_ps (ar, b1, acc[r][1]);
+        }
+    }
+  for (int r = 0; r < 8; ++r)
+    {
+      _mm512_storeu_ps (c + r * 32, acc[r][0]);
+      _mm512_storeu_ps (c + r * 32 + 16, acc[r][1]);
+    }
+}
+
+GEMM_ATTR_AVX512 static void
+ukernel_f64_avx512 (size_t kc, const void *a_, const void *b_, void *c_)
+{
+  const double *a = (const double *)a_;
+  const double *b = (const double *)b_;
+  double *c = (double *)c_;
+  __m512d acc[8][2];
+  for (int r = 0; r < 8; ++r)
+    acc[r][0] = acc[r][1] = _mm512_setzero_pd ();
+  for (size_t p = 0; p < kc; ++p, a += 8, b += 16)
+    {
+      __m512d b0 = _mm512_loadu_pd (b);
+      __m512d b1 = _mm512_loadu_pd (b + 8);
+      for (int r = 0; r < 8; ++r)
+        {
+          __m512d ar = _mm512_set1_pd (a[r]);
+          acc[r][0] = _mm512_fmadd_pd (ar, b0, acc[r][0]);
+          acc[r][1] = _mm512_fmadd_pd (ar, b1, acc[r][1]);
+        }
+    }
+  for (int r = 0; r < 8; ++r)
+    {
+      _mm512_storeu_pd (c + r * 16, acc[r][0]);
+      _mm512_storeu_pd (c + r * 16 + 8, acc[r][1]);
+    }
+}
+
+GEMM_DEFINE_GENERIC_UKERNEL (ukernel_i32_avx2, GEMM_ATTR_AVX2, uint32_t, 6, 16)
+GEMM_DEFINE_GENERIC_UKERNEL (ukernel_i64_avx2, GEMM_ATTR_AVX2, uint64_t, 6, 8)
+GEMM_DEFINE_GENERIC_UKERNEL (ukernel_i32_avx512,
+                             GEMM_ATTR_AVX512,
+                             uint32_t,
+                             8,
+                             32)
+GEMM_DEFINE_GENERIC_UKERNEL (ukernel_i64_avx512,
+                             GEMM_ATTR_AVX512,
+                             uint64_t,
+                             8,
+                             16)
+
+static int
+gemm_has_sse2 (void)
+{
+  return __builtin_cpu_supports ("sse2");
+}
+
+static int
+gemm_has_avx2 (void)
+{
+  return __builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma");
+}
+
+static int
+gemm_has_avx512 (void)
+{
+  return __builtin_cpu_supports ("avx512f");
+}
+
+#endif
+
+#ifdef GEMM_NEON
+
+static void
+ukernel_f32_neon (size_t kc, const void *a_, const void *b_, void *c_)
+{
+  const float *a = (const float *)a_;
+  const float *b = (const float *)b_;
+  float *c = (float *)c_;
+  float32x4_t acc[8][2];
+  for (int r = 0; r < 8; ++r)
+    acc[r][0] = acc[r][1] = vdupq_n_f32 (0.0f);
+  for (size_t p = 0; p < kc; ++p, a += 8, b += 8)
+    {
+      float32x4_t b0 = vld1q_f32 (b);
+      float32x4_t b1 = vld1q_f32 (b + 4);
+      float32x4_t a0 = vld1q_f32 (a);
+      float32x4_t a1 = vld1q_f32 (a + 4);
+      acc[0][0] = vfmaq_laneq_f32 (acc[0][0], b0, a0, 0);
+      acc[0][1] = vfmaq_laneq_f32 (acc[0][1], b1, a0, 0);
+      acc[1][0] = vfmaq_laneq_f32 (acc[1][0], b0, a0, 1);
+      acc[1][1] = vfmaq_laneq_f32 (acc[1][1], b1, a0, 1);
+      acc[2][0] = vfmaq_laneq_f32 (acc[2][0], b0, a0, 2);
+      acc[2][1] = vfmaq_laneq_f32 (acc[2][1], b1, a0, 2);
+      acc[3][0] = vfmaq_laneq_f32 (acc[3][0], b0, a0, 3);
+      acc[3][1] = vfmaq_laneq_f32 (acc[3][1], b1, a0, 3);
+      acc[4][0] = vfmaq_laneq_f32 (acc[4][0], b0, a1, 0);
+      acc[4][1] = vfmaq_laneq_f32 (acc[4][1], b1, a1, 0);
+      acc[5][0] = vfmaq_laneq_f32 (acc[5][0], b0, a1, 1);
+      acc[5][1] = vfmaq_laneq_f32 (acc[5][1], b1, a1, 1);
+      acc[6][0] = vfmaq_laneq_f32 (acc[6][0], b0, a1, 2);
+      acc[6][1] = vfmaq_laneq_f32 (acc[6][1], b1, a1, 2);
+      acc[7][0] = vfmaq_laneq_f32 (acc[7][0], b0, a1, 3);
+      acc[7][1] = vfmaq_laneq_f32 (acc[7][1], b1, a1, 3);
+    }
+  for (int r = 0; r < 8; ++r)
+    {
+      vst1q_f32 (c + r * 8, acc[r][0]);
+      vst1q_f32 (c + r * 8 + 4, acc[r][1]);
+    }
+}
+
+static void
+ukernel_f64_neon (size_t kc, const void *a_, const void *b_, void *c_)
+{
+  const double *a = (const double *)a_;
+  const double *b = (const double *)b_;
+  double *c = (double *)c_;
+  float64x2_t acc[8][2];
+  for (int r = 0; r < 8; ++r)
+    acc[r][0] = acc[r][1] = vdupq_n_f64 (0.0);
+  for (size_t p = 0; p < kc; ++p, a += 8, b += 4)
+    {
+      float64x2_t b0 = vld1q_f64 (b);
+      float64x2_t b1 = vld1q_f64 (b + 2);
+      for (int r = 0; r < 8; ++r)
+        {
+          acc[r][0] = vfmaq_n_f64 (acc[r][0], b0, a[r]);
+          acc[r][1] = vfmaq_n_f64 (acc[r][1], b1, a[r]);
+        }
+    }
+  for (int r = 0; r < 8; ++r)
+    {
+      vst1q_f64 (c + r * 4, acc[r][0]);
+      vst1q_f64 (c + r * 4 + 2, acc[r][1]);
+    }
+}
+
+#endif
+
+/* The ISAs in the order of preference. */
+static const gemm_isa gemm_isas[] = {
+#ifdef GEMM_X86
+  { "avx512",
+    gemm_has_avx512,
+    { { 8, 32, ukernel_f32_avx512 },
+      { 8, 16, ukernel_f64_avx512 },
+      { 8, 32, ukernel_i32_avx512 },
+      { 8, 16, ukernel_i64_avx512 } } },
+  { "avx2",
+    gemm_has_avx2,
+    { { 6, 16, ukernel_f32_avx2 },
+      { 6, 8, ukernel_f64_avx2 },
+      { 6, 16, ukernel_i32_avx2 },
+      { 6, 8, ukernel_i64_avx2 } } },
+  { "sse2",
+    gemm_has_sse2,
+    { { 4, 8, ukernel_f32_sse2 },
+      { 4, 4, ukernel_f64_sse2 },
+      { 4, 8, ukernel_i32_generic },
+      { 4, 4, ukernel_i64_generic } } },
+#endif
+#ifdef GEMM_NEON
+  { "neon",
+    gemm_always_available,
+    { { 8, 8, ukernel_f32_neon },
+      { 8, 4, ukernel_f64_neon },
+      { 4, 8, ukernel_i32_generic },
+      { 4, 4, ukernel_i64_generic } } },
+#endif
+  { "generic",
+    gemm_always_available,
+    { { 4, 8, ukernel_f32_generic },
+      { 4, 4, ukernel_f64_generic },
+      { 4, 8, ukernel_i32_generic },
+      { 4, 4, ukernel_i64_generic } } },
+};
+
+#define GEMM_NUM_ISAS (sizeof (gemm_isas) / sizeof (gemm_isas[0]))
+
+static const gemm_isa *
+gemm_select_isa (void)
+{
+  static int warned = 0;
+  const char *name = pocl_get_string_option ("POCL_CPU_GEMM_KERNEL", "auto");
+  int any = (strcmp (name, "auto") == 0 || strcmp (name, "native") == 0
+             || strcmp (name, "libxsmm") == 0);
+  const gemm_isa *best = NULL;
+  for (size_t i = 0; i < GEMM_NUM_ISAS; ++i)
+    {
+      if (!gemm_isas[i].available ())
+        continue;
+      if (best == NULL)
+        best = &gemm_isas[i];
+      if (any || strcmp (name, gemm_isas[i].name) == 0)
+        return &gemm_isas[i];
+    }
+  if (!warned)
+    {
+      warned = 1;
+      POCL_MSG_WARN ("POCL_CPU_GEMM_KERNEL: '%s' is not available on this "
+                     "host, using '%s'\n",
+                     name, best->name);
+    }
+  return best;
+}
+
+typedef struct gemm_state
+{
+  pocl_cpu_gemm_desc desc;
+  gemm_kind kind;
+  gemm_ukernel uk;
+  size_t mc;
+  size_t nc;
+  size_t kc;
+  size_t m_blocks;
+  size_t n_blocks;
+} gemm_state;
+
+static size_t
+gemm_kind_size (gemm_kind kind)
+{
+  return (kind == GEMM_F32 || kind == GEMM_I32) ? 4 : 8;
+}
+
+#define GEMM_CONV(x) (x)
+#define GEMM_CONV_HALF(x) pocl_half_to_float (x)
+
+/* Packs the no x kc block at src, whose element (o, p) is at
+ * src[o * so + p * sp], into panels of `panel` rows (of A) or columns (of
+ * B), zero-padding the last panel. */
+#define GEMM_PACK(DST_T, SRC_T, CONV)                                         \
+  do                                                                          \
+    {                                                                         \
+      DST_T *d = (DST_T *)dst;                                                \
+      const SRC_T *s = (const SRC_T *)src;                                    \
+      for (size_t o0 = 0; o0 < no; o0 += panel)                               \
+        {                                                                     \
+          size_t np = (no - o0 < panel) ? no - o0 : panel;                    \
+          for (size_t p = 0; p < kc; ++p, d += panel)                         \
+            {                                                                 \
+              const SRC_T *sr = s + o0 * so + p * sp;                         \
+              size_t o = 0;                                                   \
+              for (; o < np; ++o)                                             \
+                d[o] = (DST_T)CONV (sr[o * so]);                              \
+              for (; o < panel; ++o)                                          \
+                d[o] = 0;                                                     \
+            }                                                                 \
+        }                                                                     \
+    }                                                                         \
+  while (0)
+
+#define GEMM_PACK_INT(DST_T)                                                  \
+  switch (dtype)                                                              \
+    {                                                                         \
+    case CL_TENSOR_DTYPE_INT8_EXP:                                            \
+      GEMM_PACK (DST_T, int8_t, GEMM_CONV);                                   \
+      break;                                                                  \
+    case CL_TENSOR_DTYPE_UINT8_EXP:                                           \
+      GEMM_PACK (DST_T, uint8_t, GEMM_CONV);                                  \
+      break;                                                                  \
+    case CL_TENSOR_DTYPE_INT16_EXP:                                           \
+      GEMM_PACK (DST_T, int16_t, GEMM_CONV);                                  \
+      break;                                                                  \
+    case CL_TENSOR_DTYPE_UINT16_EXP:                                          \
+      GEMM_PACK (DST_T, uint16_t, GEMM_CONV);                                 \
+      break;                                                                  \
+    case CL_TENSOR_DTYPE_INT32_EXP:                                           \
+      GEMM_PACK (DST_T, int32_t, GEMM_CONV);                                  \
+      break;                                                                  \
+    case CL_TENSOR_DTYPE_UINT32_EXP:                                          \
+      GEMM_PACK (DST_T, uint32_t, GEMM_CONV);                                 \
+      break;                                                                  \
+    case CL_TENSOR_DTYPE_INT64_EXP:                                           \
+      GEMM_PACK (DST_T, int64_t, GEMM_CONV);                                  \
+      break;                                                                  \
+    case CL_TENSOR_DTYPE_UINT64_EXP:                                          \
+      GEMM_PACK (DST_T, uint64_t, GEMM_CONV);                                 \
+      break;                                                                  \
+    default:                                                                  \
+      assert (!"unsupported integer GEMM input type");                        \
+    }
+
+static void
+gemm_pack (gemm_kind kind,
+           void *dst,
+           const void *src,
+           cl_tensor_datatype_exp dtype,
+           size_t so,
+           size_t sp,
+           size_t no,
+           size_t kc,
+           size_t panel)
+{
+  switch (kind)
+    {
+    case GEMM_F32:
+      if (dtype == CL_TENSOR_DTYPE_FP16_EXP)
+        GEMM_PACK (float, uint16_t, GEMM_CONV_HALF);
+      else
+        GEMM_PACK (float, float, GEMM_CONV);
+      break;
+    case GEMM_F64:
+      if (dtype == CL_TENSOR_DTYPE_FP16_EXP)
+        GEMM_PACK (double, uint16_t, GEMM_CONV_HALF);
+      else if (dtype == CL_TENSOR_DTYPE_FP32_EXP)
+        GEMM_PACK (double, float, GEMM_CONV);
+      else
+        GEMM_PACK (double, double, GEMM_CONV);
+      break;
+    case GEMM_I32:
+      GEMM_PACK_INT (uint32_t);
+      break;
+    case GEMM_I64:
+      GEMM_PACK_INT (uint64_t);
+      break;
+    default:
+      assert (!"unknown GEMM kind");
+    }
+}
+
+#define GEMM_LOAD_HALF(x) pocl_half_to_float (x)
+#define GEMM_STORE_HALF(x) pocl_float_to_half (x)
+
+/* Adds the accumulated tile to the C block of rows x cols elements at out,
+ * and on the first KC block to C_in (at in, if not NULL) instead of the
+ * previous value of C_out. */
+#define GEMM_STORE(ACC_T, OUT_T, LOAD, STORE)                                 \
+  do                                                                          \
+    {                                                                         \
+      const ACC_T *t = (const ACC_T *)tile;                                   \
+      OUT_T *o = (OUT_T *)out;                                                \
+      const OUT_T *i = (const OUT_T *)in;                                     \
+      for (size_t r = 0; r < rows; ++r)                                       \
+        for (size_t c = 0; c < cols; ++c)                                     \
+          {                                                                   \
+            ACC_T v = t[r * ld + c];                                          \
+            if (i != NULL)                                                    \
+              v += (ACC_T)LOAD (i[r * is[0] + c * is[1]]);                    \
+            o[r * os[0] + c * os[1]] = (OUT_T)STORE (v);                      \
+          }                                                                   \
+    }                                                                         \
+  while (0)
+
+static void
+gemm_store_tile (const gemm_state *s,
+                 size_t b,
+                 size_t i0,
+                 size_t j0,
+                 size_t rows,
+                 size_t cols,
+                 const void *tile,
+                 int first)
+{
+  const pocl_cpu_gemm_desc *d = &s->desc;
+  size_t esize = pocl_tensor_type_size (d->c_dtype);
+  const size_t *os = d->c_out_strides;
+  char *out = (char *)d->c_out
+              + (b * os[2] + i0 * os[0] + j0 * os[1]) * esize;
+  const size_t *is = os;
+  const char *in = out;
+  if (first)
+    {
+      is = d->c_in_strides;
+      in = (d->c_in == NULL) ? NULL
+                             : (const char *)d->c_in
+                                 + (b * is[2] + i0 * is[0] + j0 * is[1])
+                                     * esize;
+    }
+  size_t ld = s->uk.nr;
+
+  switch (d->c_dtype)
+    {
+    case CL_TENSOR_DTYPE_FP16_EXP:
+      GEMM_STORE (float, uint16_t, GEMM_LOAD_HALF, GEMM_STORE_HALF);
+      break;
+    case CL_TENSOR_DTYPE_FP32_EXP:
+      GEMM_STORE (float, float, GEMM_CONV, GEMM_CONV);
+      break;
+    case CL_TENSOR_DTYPE_FP64_EXP:
+      GEMM_STORE (double, double, GEMM_CONV, GEMM_CONV);
+      break;
+    case CL_TENSOR_DTYPE_INT8_EXP:
+      GEMM_STORE (uint32_t, int8_t, GEMM_CONV, GEMM_CONV);
+      break;
+    case CL_TENSOR_DTYPE_UINT8_EXP:
+      GEMM_STORE (uint32_t, uint8_t, GEMM_CONV, GEMM_CONV);
+      break;
+    case CL_TENSOR_DTYPE_INT16_EXP:
+      GEMM_STORE (uint32_t, int16_t, GEMM_CONV, GEMM_CONV);
+      break;
+    case CL_TENSOR_DTYPE_UINT16_EXP:
+      GEMM_STORE (uint32_t, uint16_t, GEMM_CONV, GEMM_CONV);
+      break;
+    case CL_TENSOR_DTYPE_INT32_EXP:
+      GEMM_STORE (uint32_t, int32_t, GEMM_CONV, GEMM_CONV);
+      break;
+    case CL_TENSOR_DTYPE_UINT32_EXP:
+      GEMM_STORE (uint32_t, uint32_t, GEMM_CONV, GEMM_CONV);
+      break;
+    case CL_TENSOR_DTYPE_INT64_EXP:
+      GEMM_STORE (uint64_t, int64_t, GEMM_CONV, GEMM_CONV);
+      break;
+    case CL_TENSOR_DTYPE_UINT64_EXP:
+      GEMM_STORE (uint64_t, uint64_t, GEMM_CONV, GEMM_CONV);
+      break;
+    default:
+      assert (!"unsupported GEMM output type");
+    }
+}
+
+static int
+gemm_run (void *data, size_t first, size_t count)
+{
+  const gemm_state *s = (const gemm_state *)data;
+  const pocl_cpu_gemm_desc *d = &s->desc;
+  size_t esize = gemm_kind_size (s->kind);
+  size_t a_esize = pocl_tensor_type_size (d->a_dtype);
+  size_t b_esize = pocl_tensor_type_size (d->b_dtype);
+  unsigned mr = s->uk.mr;
+  unsigned nr = s->uk.nr;
+  uint64_t tile[GEMM_MAX_MR * GEMM_MAX_NR];
+
+  char *apack = pocl_aligned_malloc (64, s->mc * s->kc * esize);
+  char *bpack = pocl_aligned_malloc (64, s->nc * s->kc * esize);
+  if (apack == NULL || bpack == NULL)
+    {
+      pocl_aligned_free (apack);
+      pocl_aligned_free (bpack);
+      return CL_OUT_OF_HOST_MEMORY;
+    }
+
+  for (size_t chunk = first; chunk < first + count; ++chunk)
+    {
+      size_t blocks = s->m_blocks * s->n_blocks;
+      size_t b = chunk / blocks;
+      size_t i0 = (chunk % blocks) / s->n_blocks * s->mc;
+      size_t j0 = (chunk % blocks) % s->n_blocks * s->nc;
+      size_t mc = (d->m - i0 < s->mc) ? d->m - i0 : s->mc;
+      size_t nc = (d->n - j0 < s->nc) ? d->n - j0 : s->nc;
+      const char *a = (const char *)d->a + b * d->a_strides[2] * a_esize;
+      const char *bm = (const char *)d->b + b * d->b_strides[2] * b_esize;
+
+      /* runs once with kc == 0 if k == 0, to store beta * C_in */
+      size_t pc = 0;
+      do
+        {
+          size_t kc = (d->k - pc < s->kc) ? d->k - pc : s->kc;
+          gemm_pack (s->kind, bpack,
+                     bm + (pc * d->b_strides[0] + j0 * d->b_strides[1])
+                            * b_esize,
+                     d->b_dtype, d->b_strides[1], d->b_strides[0], nc, kc,
+                     nr);
+          gemm_pack (s->kind, apack,
+                     a + (i0 * d->a_strides[0] + pc * d->a_strides[1])
+                           * a_esize,
+                     d->a_dtype, d->a_strides[0], d->a_strides[1], mc, kc,
+                     mr);
+          for (size_t jr = 0; jr < nc; jr += nr)
+            for (size_t ir = 0; ir < mc; ir += mr)
+              {
+                s->uk.fn (kc, apack + ir * kc * esize,
+                          bpack + jr * kc * esize, tile);
+                gemm_store_tile (s, b, i0 + ir, j0 + jr,
+                                 (mc - ir < mr) ? mc - ir : mr,
+                                 (nc - jr < nr) ? nc - jr : nr, tile, pc == 0);
+              }
+          pc += kc;
+        }
+      while (pc < d->k);
+    }
+
+  pocl_aligned_free (apack);
+  pocl_aligned_free (bpack);
+  return CL_SUCCESS;
+}
+
+int
+pocl_cpu_partition_dbk_khr_gemm (const pocl_cpu_gemm_desc *desc,
+                                 pocl_cpu_dbk_partition *part)
+{
+  gemm_state *s = (gemm_state *)malloc (sizeof (gemm_state));
+  if (s == NULL)
+    return CL_OUT_OF_HOST_MEMORY;
+  s->desc = *desc;
+
+  if (pocl_tensor_type_is_int (desc->c_dtype))
+    s->kind = pocl_tensor_type_size (desc->c_dtype) > 4 ? GEMM_I64 : GEMM_I32;
+  else
+    s->kind = desc->c_dtype == CL_TENSOR_DTYPE_FP64_EXP ? GEMM_F64 : GEMM_F32;
+
+  const gemm_isa *isa = gemm_select_isa ();
+  s->uk = isa->kernels[s->kind];
+  assert (s->uk.mr <= GEMM_MAX_MR && s->uk.nr <= GEMM_MAX_NR);
+  assert (GEMM_NC % s->uk.nr == 0);
+
+  s->mc = GEMM_MC / s->uk.mr * s->uk.mr;
+  s->nc = GEMM_NC;
+  s->kc = GEMM_KC_BYTES / gemm_kind_size (s->kind);
+  /* Partial sums of half precision C would be rounded between the KC
+   * blocks, accumulate the whole k in one. */
+  if (desc->c_dtype == CL_TENSOR_DTYPE_FP16_EXP)
+    s->kc = desc->k > 0 ? desc->k : 1;
+  s->m_blocks = (desc->m + s->mc - 1) / s->mc;
+  s->n_blocks = (desc->n + s->nc - 1) / s->nc;
+
+  POCL_MSG_PRINT_INFO ("GEMM %zux%zux%zu (batch %zu) with the %s %ux%u "
+                       "microkernel\n",
+                       desc->m, desc->n, desc->k, desc->batch, isa->name,
+                       s->uk.mr, s->uk.nr);
+
+  part->num_chunks = desc->batch * s->m_blocks * s->n_blocks;
+  part->run = gemm_run;
+  part->finish = free;
+  part->state = s;
+  return CL_SUCCESS;
+}
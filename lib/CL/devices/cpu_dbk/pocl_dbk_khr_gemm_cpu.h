@@ -0,0 +1,69 @@
+/* pocl_dbk_khr_gemm_cpu.h - native CPU implementation of the GEMM and
+   matmul DBKs.
+
+   Copyright (c) 2026 PoCL developers
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+*/
+
+#ifndef POCL_DBK_KHR_GEMM_CPU_H
+#define POCL_DBK_KHR_GEMM_CPU_H
+
+#include "pocl_cl.h"
+#include "pocl_dbk_cpu_partition.h"
+#include "pocl_export.h"
+
+/* A (batched) C_out = op(A) * op(B) + beta * C_in with alpha == 1, which is
+ * what pocl_cpu_validate_khr_gemm () accepts. The strides are in elements
+ * and already account for the layouts and the transposes: element (i, j) of
+ * the batch entry b of a matrix X is at X + b * strides[2] + i * strides[0]
+ * + j * strides[1]. A is m x k, B is k x n and C is m x n. */
+typedef struct pocl_cpu_gemm_desc
+{
+  const void *a;
+  const void *b;
+  /* NULL if there is no C input or beta is zero */
+  const void *c_in;
+  void *c_out;
+  cl_tensor_datatype_exp a_dtype;
+  cl_tensor_datatype_exp b_dtype;
+  cl_tensor_datatype_exp c_dtype;
+  size_t m;
+  size_t n;
+  size_t k;
+  size_t batch;
+  size_t a_strides[3];
+  size_t b_strides[3];
+  size_t c_in_strides[3];
+  size_t c_out_strides[3];
+} pocl_cpu_gemm_desc;
+
+/**
+ * Splits a GEMM into chunks of (batch entry, row block, column block). The
+ * chunks pack their blocks of A and B into cache-sized panels and run a
+ * register-tiled microkernel for the SIMD ISA of the host, selected at
+ * runtime (POCL_CPU_GEMM_KERNEL overrides it).
+ *
+ * \param desc [in] the operation, copied into the partition state.
+ * \param part [out] the chunks of the GEMM.
+ */
+POCL_EXPORT int pocl_cpu_partition_dbk_khr_gemm (const pocl_cpu_gemm_desc *desc,
+                                                 pocl_cpu_dbk_partition *part);
+
+#endif
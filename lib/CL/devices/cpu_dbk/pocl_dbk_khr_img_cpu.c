@@ -1,6 +1,7 @@
 /* pocl_dbk_khr_img_cpu.c - cpu implementation of image related dbks.
 
    Copyright (c) 2024 Robin Bijl / Tampere University
+                 2026 PoCL developers
 
    Permission is hereby granted, free of charge, to any person obtaining a copy
    of this software and associated documentation files (the "Software"), to
@@ -21,15 +22,362 @@
    IN THE SOFTWARE.
 */
 
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define YUV2RGB_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) && defined(__aarch64__)
+#define YUV2RGB_NEON
+#include <arm_neon.h>
+#endif
+
 #include "pocl_dbk_khr_img_cpu.h"
 #include "pocl_mem_management.h"
 
+/* the pixels converted by one chunk, rounded to a band of an even number
+ * of rows */
+#define YUV2RGB_CHUNK_PIXELS 65536
+/* the pixels of a row converted at once by the SIMD kernels */
+#define YUV2RGB_VEC 16
+
+/* BT.709 full range weights in 1.14 fixed point (1.5748, 0.4681, 0.1873 and
+ * 1.8556), useful references:
+ * * https://registry.khronos.org/OpenVX/specs/1.3.1/html/OpenVX_Specification_1_3_1.html#group_vision_function_colorconvert
+ * * https://en.wikipedia.org/wiki/YCbCr#ITU-R_BT.709_conversion
+ */
+#define YUV2RGB_RV 25802
+#define YUV2RGB_GV 7669
+#define YUV2RGB_GU 3069
+#define YUV2RGB_BU 30402
+
+/* Rounded (C2 * K) >> 15 where C2 is twice the chroma value in [-128, 127],
+ * i.e. the chroma times the 1.14 weight K. This is what _mm256_mulhrs_epi16
+ * and vqrdmulhq_s16 compute, so that the SIMD kernels and the scalar
+ * code give the same results. */
+#define YUV2RGB_MUL(C2, K) (((C2) * (K) + (1 << 14)) >> 15)
+
+typedef struct yuv2rgb_state yuv2rgb_state;
+
+/* converts 'rows' (1 or 2) rows starting at the even row y */
+typedef void (*yuv2rgb_fn) (const yuv2rgb_state *s, int y, int rows);
+
+struct yuv2rgb_state
+{
+  const uint8_t *y_plane;
+  /* the first U and V samples */
+  const uint8_t *u_plane;
+  const uint8_t *v_plane;
+  uint8_t *output;
+  /* the bytes between two rows of the chroma planes */
+  size_t chroma_stride;
+  /* the bytes between two U (or V) samples of a row, 2 for NV12/NV21 */
+  int chroma_step;
+  int width;
+  int height;
+  int rows_per_chunk;
+  /* 3 or 4 bytes per output pixel, R and B at r_off and b_off, G at 1 and
+   * alpha at 3 */
+  int channels;
+  int r_off;
+  int b_off;
+  yuv2rgb_fn convert_rows;
+};
+
+static inline uint8_t
+yuv2rgb_clamp (int v)
+{
+  return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+/* Converts the pixels from x_start on of 'rows' rows starting at y. */
+static void
+yuv2rgb_rows_scalar (const yuv2rgb_state *s, int y, int rows, int x_start)
+{
+  const uint8_t *u_row = s->u_plane + (size_t)(y / 2) * s->chroma_stride;
+  const uint8_t *v_row = s->v_plane + (size_t)(y / 2) * s->chroma_stride;
+  int channels = s->channels;
+
+  for (int x = x_start; x < s->width; x += 2)
+    {
+      int c = (x / 2) * s->chroma_step;
+      int u2 = 2 * (u_row[c] - 128);
+      int v2 = 2 * (v_row[c] - 128);
+      int dr = YUV2RGB_MUL (v2, YUV2RGB_RV);
+      int dg = YUV2RGB_MUL (v2, YUV2RGB_GV) + YUV2RGB_MUL (u2, YUV2RGB_GU);
+      int db = YUV2RGB_MUL (u2, YUV2RGB_BU);
+      int x_end = x + 2 < s->width ? x + 2 : s->width;
+
+      for (int r = 0; r < rows; ++r)
+        for (int i = x; i < x_end; ++i)
+          {
+            size_t p = (size_t)(y + r) * s->width + i;
+            int y_value = s->y_plane[p];
+            uint8_t *out = s->output + p * channels;
+            out[s->r_off] = yuv2rgb_clamp (y_value + dr);
+            out[1] = yuv2rgb_clamp (y_value - dg);
+            out[s->b_off] = yuv2rgb_clamp (y_value + db);
+            if (channels == 4)
+              out[3] = 255;
+          }
+    }
+}
+
+#ifndef YUV2RGB_NEON
+static void
+yuv2rgb_rows_generic (const yuv2rgb_state *s, int y, int rows)
+{
+  yuv2rgb_rows_scalar (s, y, rows, 0);
+}
+#endif
+
+#ifdef YUV2RGB_X86
+
+#define YUV2RGB_ATTR_AVX2 __attribute__ ((target ("avx2")))
+
+/* Stores 16 pixels whose first and third output channels are in c0 and c2
+ * as 16-bit lanes. */
+YUV2RGB_ATTR_AVX2 static inline void
+yuv2rgb_store_avx2 (uint8_t *out, int channels, __m256i c0, __m256i g,
+                    __m256i c2)
+{
+  /* per 128-bit lane: the bytes of the 8 pixels of the lane */
+  __m256i c0g = _mm256_packus_epi16 (c0, g);
+  __m256i c2a = _mm256_packus_epi16 (c2, _mm256_set1_epi16 (255));
+  __m256i c0c2 = _mm256_unpacklo_epi8 (c0g, c2a);
+  __m256i ga = _mm256_unpackhi_epi8 (c0g, c2a);
+  /* pixels 0-3 and 8-11, pixels 4-7 and 12-15 */
+  __m256i p0 = _mm256_unpacklo_epi8 (c0c2, ga);
+  __m256i p1 = _mm256_unpackhi_epi8 (c0c2, ga);
+  __m256i lo = _mm256_permute2x128_si256 (p0, p1, 0x20);
+  __m256i hi = _mm256_permute2x128_si256 (p0, p1, 0x31);
+
+  if (channels == 4)
+    {
+      _mm256_storeu_si256 ((__m256i *)out, lo);
+      _mm256_storeu_si256 ((__m256i *)(out + 32), hi);
+      return;
+    }
+
+  /* drop the alpha bytes: 12 bytes at the start of each lane, which are
+   * then moved next to each other */
+  __m256i drop_alpha = _mm256_setr_epi8 (
+    0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1, 0, 1, 2, 4, 5, 6,
+    8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+  __m256i join = _mm256_setr_epi32 (0, 1, 2, 4, 5, 6, 3, 7);
+  lo = _mm256_permutevar8x32_epi32 (_mm256_shuffle_epi8 (lo, drop_alpha),
+                                    join);
+  hi = _mm256_permutevar8x32_epi32 (_mm256_shuffle_epi8 (hi, drop_alpha),
+                                    join);
+  _mm_storeu_si128 ((__m128i *)out, _mm256_castsi256_si128 (lo));
+  _mm_storel_epi64 ((__m128i *)(out + 16), _mm256_extracti128_si256 (lo, 1));
+  _mm_storeu_si128 ((__m128i *)(out + 24), _mm256_castsi256_si128 (hi));
+  _mm_storel_epi64 ((__m128i *)(out + 40), _mm256_extracti128_si256 (hi, 1));
+}
+
+/* Converts blocks of 2x16 pixels sharing 8 chroma samples. */
+YUV2RGB_ATTR_AVX2 static void
+yuv2rgb_rows_avx2 (const yuv2rgb_state *s, int y, int rows)
+{
+  const uint8_t *u_row = s->u_plane + (size_t)(y / 2) * s->chroma_stride;
+  const uint8_t *v_row = s->v_plane + (size_t)(y / 2) * s->chroma_stride;
+  /* the UV pairs of NV12/NV21 are loaded from the first byte of the pair,
+   * not to read past the end of the chroma plane */
+  const uint8_t *uv_row = u_row < v_row ? u_row : v_row;
+  int u_odd = u_row > v_row;
+  int channels = s->channels;
+  int swap_rb = s->r_off != 0;
+
+  /* duplicate each chroma sample for the two pixels it covers */
+  __m128i dup_u, dup_v;
+  if (s->chroma_step == 2)
+    {
+      __m128i even = _mm_setr_epi8 (0, 0, 2, 2, 4, 4, 6, 6, 8, 8, 10, 10, 12,
+                                    12, 14, 14);
+      __m128i odd = _mm_add_epi8 (even, _mm_set1_epi8 (1));
+      dup_u = u_odd ? odd : even;
+      dup_v = u_odd ? even : odd;
+    }
+  else
+    dup_u = dup_v
+      = _mm_setr_epi8 (0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7);
+
+  __m256i c128 = _mm256_set1_epi16 (128);
+  __m256i rv = _mm256_set1_epi16 (YUV2RGB_RV);
+  __m256i gv = _mm256_set1_epi16 (YUV2RGB_GV);
+  __m256i gu = _mm256_set1_epi16 (YUV2RGB_GU);
+  __m256i bu = _mm256_set1_epi16 (YUV2RGB_BU);
+
+  int x = 0;
+  for (; x + YUV2RGB_VEC <= s->width; x += YUV2RGB_VEC)
+    {
+      __m128i u8, v8;
+      if (s->chroma_step == 2)
+        {
+          __m128i uv = _mm_loadu_si128 ((const __m128i *)(uv_row + x));
+          u8 = _mm_shuffle_epi8 (uv, dup_u);
+          v8 = _mm_shuffle_epi8 (uv, dup_v);
+        }
+      else
+        {
+          u8 = _mm_shuffle_epi8 (
+            _mm_loadl_epi64 ((const __m128i *)(u_row + x / 2)), dup_u);
+          v8 = _mm_shuffle_epi8 (
+            _mm_loadl_epi64 ((const __m128i *)(v_row + x / 2)), dup_v);
+        }
+      __m256i u2 = _mm256_slli_epi16 (
+        _mm256_sub_epi16 (_mm256_cvtepu8_epi16 (u8), c128), 1);
+      __m256i v2 = _mm256_slli_epi16 (
+        _mm256_sub_epi16 (_mm256_cvtepu8_epi16 (v8), c128), 1);
+      __m256i dr = _mm256_mulhrs_epi16 (v2, rv);
+      __m256i dg = _mm256_add_epi16 (_mm256_mulhrs_epi16 (v2, gv),
+                                     _mm256_mulhrs_epi16 (u2, gu));
+      __m256i db = _mm256_mulhrs_epi16 (u2, bu);
+
+      for (int r = 0; r < rows; ++r)
+        {
+          size_t p = (size_t)(y + r) * s->width + x;
+          __m256i y16 = _mm256_cvtepu8_epi16 (
+            _mm_loadu_si128 ((const __m128i *)(s->y_plane + p)));
+          __m256i red = _mm256_add_epi16 (y16, dr);
+          __m256i green = _mm256_sub_epi16 (y16, dg);
+          __m256i blue = _mm256_add_epi16 (y16, db);
+          yuv2rgb_store_avx2 (s->output + p * channels, channels,
+                              swap_rb ? blue : red, green,
+                              swap_rb ? red : blue);
+        }
+    }
+  yuv2rgb_rows_scalar (s, y, rows, x);
+}
+
+#endif
+
+#ifdef YUV2RGB_NEON
+
+/* Same as yuv2rgb_rows_avx2 () with NEON, the interleaving is done by the
+ * structure stores. */
+static void
+yuv2rgb_rows_neon (const yuv2rgb_state *s, int y, int rows)
+{
+  const uint8_t *u_row = s->u_plane + (size_t)(y / 2) * s->chroma_stride;
+  const uint8_t *v_row = s->v_plane + (size_t)(y / 2) * s->chroma_stride;
+  const uint8_t *uv_row = u_row < v_row ? u_row : v_row;
+  int u_odd = u_row > v_row;
+  int channels = s->channels;
+  int swap_rb = s->r_off != 0;
+  int16x8_t c128 = vdupq_n_s16 (128);
+
+  int x = 0;
+  for (; x + YUV2RGB_VEC <= s->width; x += YUV2RGB_VEC)
+    {
+      uint8x8_t u8, v8;
+      if (s->chroma_step == 2)
+        {
+          uint8x8x2_t uv = vld2_u8 (uv_row + x);
+          u8 = uv.val[u_odd];
+          v8 = uv.val[!u_odd];
+        }
+      else
+        {
+          u8 = vld1_u8 (u_row + x / 2);
+          v8 = vld1_u8 (v_row + x / 2);
+        }
+      uint8x8x2_t u_dup = vzip_u8 (u8, u8);
+      uint8x8x2_t v_dup = vzip_u8 (v8, v8);
+      int16x8_t dr[2], dg[2], db[2];
+      for (int h = 0; h < 2; ++h)
+        {
+          int16x8_t u2 = vshlq_n_s16 (
+            vsubq_s16 (vreinterpretq_s16_u16 (vmovl_u8 (u_dup.val[h])), c128),
+            1);
+          int16x8_t v2 = vshlq_n_s16 (
+            vsubq_s16 (vreinterpretq_s16_u16 (vmovl_u8 (v_dup.val[h])), c128),
+            1);
+          dr[h] = vqrdmulhq_n_s16 (v2, YUV2RGB_RV);
+          dg[h] = vaddq_s16 (vqrdmulhq_n_s16 (v2, YUV2RGB_GV),
+                             vqrdmulhq_n_s16 (u2, YUV2RGB_GU));
+          db[h] = vqrdmulhq_n_s16 (u2, YUV2RGB_BU);
+        }
+
+      for (int r = 0; r < rows; ++r)
+        {
+          size_t p = (size_t)(y + r) * s->width + x;
+          uint8x16_t y8 = vld1q_u8 (s->y_plane + p);
+          int16x8_t y16[2]
+            = { vreinterpretq_s16_u16 (vmovl_u8 (vget_low_u8 (y8))),
+                vreinterpretq_s16_u16 (vmovl_u8 (vget_high_u8 (y8))) };
+          uint8x16_t red = vcombine_u8 (
+            vqmovun_s16 (vaddq_s16 (y16[0], dr[0])),
+            vqmovun_s16 (vaddq_s16 (y16[1], dr[1])));
+          uint8x16_t green = vcombine_u8 (
+            vqmovun_s16 (vsubq_s16 (y16[0], dg[0])),
+            vqmovun_s16 (vsubq_s16 (y16[1], dg[1])));
+          uint8x16_t blue = vcombine_u8 (
+            vqmovun_s16 (vaddq_s16 (y16[0], db[0])),
+            vqmovun_s16 (vaddq_s16 (y16[1], db[1])));
+          uint8_t *out = s->output + p * channels;
+          if (channels == 4)
+            {
+              uint8x16x4_t px = { { swap_rb ? blue : red, green,
+                                    swap_rb ? red : blue,
+                                    vdupq_n_u8 (255) } };
+              vst4q_u8 (out, px);
+            }
+          else
+            {
+              uint8x16x3_t px = { { swap_rb ? blue : red, green,
+                                    swap_rb ? red : blue } };
+              vst3q_u8 (out, px);
+            }
+        }
+    }
+  yuv2rgb_rows_scalar (s, y, rows, x);
+}
+
+#endif
+
+static int
+yuv2rgb_run (void *data, size_t first, size_t count)
+{
+  yuv2rgb_state *s = (yuv2rgb_state *)data;
+
+  size_t y_start = first * s->rows_per_chunk;
+  size_t y_end = (first + count) * s->rows_per_chunk;
+  if (y_end > (size_t)s->height)
+    y_end = s->height;
+
+  /* the bands start at even rows, so that the two rows of a pair share
+   * their chroma row */
+  for (size_t y = y_start; y < y_end; y += 2)
+    s->convert_rows (s, (int)y, y + 1 < y_end ? 2 : 1);
+
+  return CL_SUCCESS;
+}
+
+static yuv2rgb_fn
+yuv2rgb_select (void)
+{
+#ifdef YUV2RGB_X86
+  if (__builtin_cpu_supports ("avx2"))
+    return yuv2rgb_rows_avx2;
+#endif
+#ifdef YUV2RGB_NEON
+  return yuv2rgb_rows_neon;
+#else
+  return yuv2rgb_rows_generic;
+#endif
+}
+
 int
-pocl_cpu_execute_dbk_exp_img_yuv2rgb (cl_program program,
-                                      cl_kernel kernel,
-                                      pocl_kernel_metadata_t *meta,
-                                      cl_uint dev_i,
-                                      struct pocl_argument *arguments)
+pocl_cpu_partition_dbk_exp_img_yuv2rgb (cl_program program,
+                                        cl_kernel kernel,
+                                        pocl_kernel_metadata_t *meta,
+                                        cl_uint dev_i,
+                                        struct pocl_argument *arguments,
+                                        pocl_cpu_dbk_partition *part)
 {
 
   cl_device_id dev = program->devices[dev_i];
@@ -38,11 +386,6 @@ pocl_cpu_execute_dbk_exp_img_yuv2rgb (cl_program program,
   uint8_t *input = pocl_cpu_get_ptr (&arguments[0], mem_id);
   uint8_t *output = pocl_cpu_get_ptr (&arguments[1], mem_id);
 
-  assert (attrs->input_image.format == POCL_DF_IMAGE_NV12
-          && "other yuv formats not supported yet");
-  assert (attrs->output_image.format == POCL_DF_IMAGE_RGB
-          && "other rgb formats not supported yet");
-
   int width = attrs->input_image.width;
   int height = attrs->input_image.height;
   if (attrs->input_image.width == 0 || attrs->input_image.height == 0)
@@ -51,59 +394,94 @@ pocl_cpu_execute_dbk_exp_img_yuv2rgb (cl_program program,
       height = attrs->output_image.height;
     }
   size_t tot_pixels = (size_t)width * height;
+  /* the chroma planes cover odd widths and heights with a last sample */
+  size_t chroma_width = ((size_t)width + 1) / 2;
+  size_t chroma_pixels = chroma_width * (((size_t)height + 1) / 2);
+
+  yuv2rgb_state *s = (yuv2rgb_state *)malloc (sizeof (yuv2rgb_state));
+  if (s == NULL)
+    return CL_OUT_OF_HOST_MEMORY;
+
+  const uint8_t *chroma = input + tot_pixels;
+  switch (attrs->input_image.format)
+    {
+    case POCL_DF_IMAGE_NV12:
+    case POCL_DF_IMAGE_NV21:
+      {
+        int nv21 = attrs->input_image.format == POCL_DF_IMAGE_NV21;
+        s->u_plane = chroma + nv21;
+        s->v_plane = chroma + !nv21;
+        s->chroma_stride = 2 * chroma_width;
+        s->chroma_step = 2;
+        break;
+      }
+    case POCL_DF_IMAGE_IYUV:
+      s->u_plane = chroma;
+      s->v_plane = chroma + chroma_pixels;
+      s->chroma_stride = chroma_width;
+      s->chroma_step = 1;
+      break;
+    default:
+      free (s);
+      POCL_RETURN_ERROR (CL_INVALID_OPERATION,
+                         "unsupported yuv format %d\n",
+                         attrs->input_image.format);
+    }
+
+  switch (attrs->output_image.format)
+    {
+    case POCL_DF_IMAGE_RGB:
+      s->channels = 3;
+      s->r_off = 0;
+      s->b_off = 2;
+      break;
+    case POCL_DF_IMAGE_RGBA:
+      s->channels = 4;
+      s->r_off = 0;
+      s->b_off = 2;
+      break;
+    case POCL_DF_IMAGE_BGRA:
+      s->channels = 4;
+      s->r_off = 2;
+      s->b_off = 0;
+      break;
+    default:
+      free (s);
+      POCL_RETURN_ERROR (CL_INVALID_OPERATION,
+                         "unsupported rgb format %d\n",
+                         attrs->output_image.format);
+    }
 
   cl_mem input_mem = *(cl_mem *)(arguments[0].value);
-  if (input_mem->size < tot_pixels * 3 / 2)
+  if (input_mem->size < tot_pixels + 2 * chroma_pixels)
     {
-      POCL_MSG_ERR ("pocl_cpu_execute_dbk_exp_img_yuv2rgb, "
+      POCL_MSG_ERR ("pocl_cpu_partition_dbk_exp_img_yuv2rgb, "
                     "input memory is not of the correct size \n");
-      assert (0);
+      free (s);
+      return CL_INVALID_MEM_OBJECT;
     }
 
   cl_mem output_mem = *(cl_mem *)(arguments[1].value);
-  if (output_mem->size < tot_pixels * 3)
+  if (output_mem->size < tot_pixels * s->channels)
     {
-      POCL_MSG_ERR ("pocl_cpu_execute_dbk_exp_img_yuv2rgb, "
+      POCL_MSG_ERR ("pocl_cpu_partition_dbk_exp_img_yuv2rgb, "
                     "output memory does not fit result \n");
-      assert (0);
+      free (s);
+      return CL_INVALID_MEM_OBJECT;
     }
 
-  int pixel_index, uv_index;
-  int y_value, u_value, v_value;
-  int r, g, b;
-
-  for (int y = 0; y < height; y++)
-    {
-      for (int x = 0; x < width; x++)
-        {
-
-          uv_index = width * (y / 2) + (x / 2) * 2;
-          pixel_index = y * width + x;
-
-          y_value = input[pixel_index];
-          /* convert from [0, 255] range to [-128, 127] range */
-          u_value = input[tot_pixels + uv_index] - 128;
-          v_value = input[tot_pixels + uv_index + 1] - 128;
-
-          /* convert to rgb with BT.709 weights, useful references:
-           * * https://registry.khronos.org/OpenVX/specs/1.3.1/html/OpenVX_Specification_1_3_1.html#group_vision_function_colorconvert
-           * * https://en.wikipedia.org/wiki/YCbCr#ITU-R_BT.709_conversion
-           */
-          r = (int)(y_value + 1.5748f * v_value);
-          g = (int)(y_value - (0.4681f * v_value) - (0.1873f * u_value));
-          b = (int)(y_value + 1.8556f * u_value);
-
-          /* clamp to uint8_t range */
-          r = r > 255 ? 255 : (r < 0 ? 0 : r);
-          g = g > 255 ? 255 : (g < 0 ? 0 : g);
-          b = b > 255 ? 255 : (b < 0 ? 0 : b);
-
-          /* write results back */
-          output[pixel_index * 3] = r & 0xff;
-          output[pixel_index * 3 + 1] = g & 0xff;
-          output[pixel_index * 3 + 2] = b & 0xff;
-        }
-    }
+  s->y_plane = input;
+  s->output = output;
+  s->width = width;
+  s->height = height;
+  /* bands of an even number of rows */
+  int rows = width > 0 ? YUV2RGB_CHUNK_PIXELS / width : 2;
+  s->rows_per_chunk = rows < 2 ? 2 : rows & ~1;
+  s->convert_rows = yuv2rgb_select ();
 
+  part->num_chunks = (height + s->rows_per_chunk - 1) / s->rows_per_chunk;
+  part->run = yuv2rgb_run;
+  part->finish = free;
+  part->state = s;
   return CL_SUCCESS;
 }
@@ -24,22 +24,28 @@
 #define _POCL_DBK_KHR_IMG_CPU_H_
 
 #include "pocl_cl.h"
+#include "pocl_dbk_cpu_partition.h"
 #include "pocl_export.h"
 
 /**
- * Convert an yuv mem_obj into a rbg mem_obj.
+ * Splits the conversion of an yuv (NV12, NV21 or IYUV) mem_obj into a rgb
+ * (RGB, RGBA or BGRA) mem_obj into chunks of bands of rows. The rows are
+ * converted in pairs sharing their chroma samples, with AVX2 or NEON when
+ * the host has them.
  *
  * \param program [in] used to retrieve device data.
- * \param kernel [out] the jpeg state is retrieved from the kernel data.
+ * \param kernel [in] unused.
  * \param meta [in] used for retrieving dbk attributes.
  * \param dev_i [in] used to retrieve device data.
- * \param arguments [in/out] pointers to data to process and store.
+ * \param arguments [in] pointers to data to process and store.
+ * \param part [out] the chunks of the conversion.
  */
 POCL_EXPORT int
-pocl_cpu_execute_dbk_exp_img_yuv2rgb (cl_program program,
-                                      cl_kernel kernel,
-                                      pocl_kernel_metadata_t *meta,
-                                      cl_uint dev_i,
-                                      struct pocl_argument *arguments);
+pocl_cpu_partition_dbk_exp_img_yuv2rgb (cl_program program,
+                                        cl_kernel kernel,
+                                        pocl_kernel_metadata_t *meta,
+                                        cl_uint dev_i,
+                                        struct pocl_argument *arguments,
+                                        pocl_cpu_dbk_partition *part);
 
 #endif //_POCL_DBK_KHR_IMG_CPU_H_
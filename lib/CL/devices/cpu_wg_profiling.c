@@ -0,0 +1,300 @@
+/* cpu_wg_profiling.c - per work-group chunk profiling of the CPU drivers
+
+   Copyright (c) 2026 PoCL developers
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+*/
+
+#include <string.h>
+
+#include "cpu_wg_profiling.h"
+#include "pocl_runtime_config.h"
+#include "pocl_timing.h"
+#include "pocl_tracing.h"
+#include "utlist.h"
+
+/* Chunks recorded per launch at most, the later ones only count in the
+ * per-thread stats. */
+#define MAX_CHUNKS_PER_LAUNCH 4096
+
+typedef struct wg_kernel_summary wg_kernel_summary;
+struct wg_kernel_summary
+{
+  char *name;
+  unsigned long launches;
+  /* from the launch until all the WGs finished */
+  uint64_t wall_ns;
+  /* wall time times the number of worker threads */
+  uint64_t thread_ns;
+  /* summed over the threads */
+  uint64_t busy_ns;
+  uint64_t fetch_ns;
+  uint64_t lock_wait_ns;
+  /* records of threads beyond the profiled ones, which were dropped */
+  uint64_t ignored;
+  /* summed over the launches: the busiest thread's busy time and the mean
+   * busy time of the threads that ran WGs */
+  uint64_t max_busy_ns;
+  uint64_t mean_busy_ns;
+  /* summed over the launches: from the first thread running out of work
+   * to the last one finishing */
+  uint64_t tail_ns;
+  uint64_t chunks;
+  uint64_t wgs;
+  wg_kernel_summary *next;
+};
+
+static int wg_profiling_enabled = -1;
+static pocl_lock_t wg_summary_lock;
+static wg_kernel_summary *wg_summaries = NULL;
+
+static int
+order_by_wall_time (const void *a, const void *b)
+{
+  const wg_kernel_summary *x = *(const wg_kernel_summary **)a;
+  const wg_kernel_summary *y = *(const wg_kernel_summary **)b;
+  if (x->wall_ns < y->wall_ns)
+    return 1;
+  else if (x->wall_ns > y->wall_ns)
+    return -1;
+  else
+    return 0;
+}
+
+static void
+print_wg_summary (void)
+{
+  unsigned n = 0, i = 0;
+  wg_kernel_summary *s;
+
+  POCL_LOCK (wg_summary_lock);
+  LL_FOREACH (wg_summaries, s)
+    ++n;
+  if (n == 0)
+    {
+      POCL_UNLOCK (wg_summary_lock);
+      return;
+    }
+  wg_kernel_summary **sorted
+      = (wg_kernel_summary **)malloc (n * sizeof (wg_kernel_summary *));
+  LL_FOREACH (wg_summaries, s)
+    sorted[i++] = s;
+  qsort (sorted, n, sizeof (wg_kernel_summary *), order_by_wall_time);
+
+  printf ("\nCPU work-group profile:\n");
+  printf ("     %-40s %8s %10s %6s %9s %10s %9s %10s %10s\n", "kernel",
+          "launches", "avg us", "busy%", "max/mean", "tail us", "WGs/chunk",
+          "fetch us", "lock us");
+  uint64_t ignored = 0;
+  for (i = 0; i < n; ++i)
+    {
+      s = sorted[i];
+      printf ("%3u) %-40s %8lu %10.1f %5.1f%% %9.2f %10.1f %9.1f %10.1f "
+              "%10.1f\n",
+              i + 1, s->name, s->launches,
+              s->wall_ns / 1000.0 / s->launches,
+              s->thread_ns ? 100.0 * s->busy_ns / s->thread_ns : 0.0,
+              s->mean_busy_ns ? (double)s->max_busy_ns / s->mean_busy_ns
+                              : 1.0,
+              s->tail_ns / 1000.0 / s->launches,
+              s->chunks ? (double)s->wgs / s->chunks : 0.0,
+              s->fetch_ns / 1000.0 / s->launches,
+              s->lock_wait_ns / 1000.0 / s->launches);
+      ignored += s->ignored;
+    }
+  printf ("busy%%: time the worker threads ran WGs, max/mean: busy time of "
+          "the busiest thread relative to the mean, tail: time from the "
+          "first thread running out of WGs to the last one finishing, "
+          "fetch: time spent getting chunks of WGs, lock: the part of it "
+          "spent waiting for the lock of the WG pool, per launch.\n");
+  if (ignored)
+    printf ("%" PRIu64 " records of threads beyond the expected number of "
+            "worker threads were dropped.\n",
+            ignored);
+  POCL_UNLOCK (wg_summary_lock);
+  free (sorted);
+}
+
+/* The device init is serialized by pocl_init_lock. */
+void
+pocl_cpu_wg_profiling_init (void)
+{
+  if (wg_profiling_enabled >= 0)
+    return;
+
+  POCL_INIT_LOCK (wg_summary_lock);
+  wg_profiling_enabled = pocl_get_bool_option ("POCL_CPU_WG_PROFILING", 0);
+  if (wg_profiling_enabled)
+    atexit (print_wg_summary);
+}
+
+pocl_cpu_wg_profile *
+pocl_cpu_wg_profile_begin (kernel_run_command *k, unsigned num_threads)
+{
+  if (wg_profiling_enabled <= 0)
+    return NULL;
+
+  size_t num_groups
+      = k->pc.num_groups[0] * k->pc.num_groups[1] * k->pc.num_groups[2];
+  pocl_cpu_wg_profile *p
+      = (pocl_cpu_wg_profile *)calloc (1, sizeof (pocl_cpu_wg_profile));
+  if (p == NULL)
+    return NULL;
+  p->num_threads = num_threads;
+  p->max_chunks = num_groups < MAX_CHUNKS_PER_LAUNCH ? (unsigned)num_groups
+                                                     : MAX_CHUNKS_PER_LAUNCH;
+  p->threads = (pocl_cpu_wg_thread_stats *)pocl_aligned_malloc (
+      HOST_CPU_CACHELINE_SIZE, num_threads * sizeof (pocl_cpu_wg_thread_stats));
+  p->chunks = (pocl_cpu_wg_chunk *)malloc (p->max_chunks
+                                           * sizeof (pocl_cpu_wg_chunk));
+  if (p->threads == NULL || p->chunks == NULL)
+    {
+      pocl_aligned_free (p->threads);
+      free (p->chunks);
+      free (p);
+      return NULL;
+    }
+  memset (p->threads, 0, num_threads * sizeof (pocl_cpu_wg_thread_stats));
+  p->launch_ns = pocl_gettimemono_ns ();
+  return p;
+}
+
+void
+pocl_cpu_wg_profile_chunk (pocl_cpu_wg_profile *p,
+                           unsigned thread,
+                           uint64_t first_wg,
+                           uint64_t num_wgs,
+                           uint64_t start_ns,
+                           uint64_t end_ns)
+{
+  if (thread >= p->num_threads)
+    {
+      POCL_ATOMIC_INC (p->ignored);
+      return;
+    }
+  pocl_cpu_wg_thread_stats *t = &p->threads[thread];
+  if (t->chunks == 0)
+    t->first_ns = start_ns;
+  t->last_ns = end_ns;
+  t->busy_ns += end_ns - start_ns;
+  t->wgs += num_wgs;
+  ++t->chunks;
+
+  unsigned i = POCL_ATOMIC_INC (p->num_chunks) - 1;
+  if (i < p->max_chunks)
+    {
+      pocl_cpu_wg_chunk *c = &p->chunks[i];
+      c->start_ns = start_ns;
+      c->end_ns = end_ns;
+      c->first_wg = first_wg;
+      c->num_wgs = num_wgs;
+      c->thread = thread;
+    }
+}
+
+void
+pocl_cpu_wg_profile_fetch (pocl_cpu_wg_profile *p, unsigned thread,
+                           uint64_t ns, uint64_t lock_wait_ns)
+{
+  if (thread >= p->num_threads)
+    {
+      POCL_ATOMIC_INC (p->ignored);
+      return;
+    }
+  p->threads[thread].fetch_ns += ns;
+  p->threads[thread].lock_wait_ns += lock_wait_ns;
+}
+
+void
+pocl_cpu_wg_profile_end (kernel_run_command *k)
+{
+  pocl_cpu_wg_profile *p = (pocl_cpu_wg_profile *)k->wg_profile;
+  if (p == NULL)
+    return;
+  k->wg_profile = NULL;
+
+  uint64_t end_ns = pocl_gettimemono_ns ();
+  cl_event event = k->cmd->sync.event.event;
+  unsigned num_chunks = p->num_chunks < p->max_chunks ? p->num_chunks
+                                                      : p->max_chunks;
+  for (unsigned i = 0; i < num_chunks; ++i)
+    {
+      pocl_cpu_wg_chunk *c = &p->chunks[i];
+      pocl_event_trace_wg_chunk (event, c->thread, c->first_wg, c->num_wgs,
+                                 c->start_ns, c->end_ns);
+    }
+
+  uint64_t busy = 0, fetch = 0, lock_wait = 0, max_busy = 0, wgs = 0,
+           chunks = 0;
+  uint64_t first_done = UINT64_MAX, last_done = 0;
+  unsigned participants = 0;
+  for (unsigned i = 0; i < p->num_threads; ++i)
+    {
+      pocl_cpu_wg_thread_stats *t = &p->threads[i];
+      fetch += t->fetch_ns;
+      lock_wait += t->lock_wait_ns;
+      if (t->chunks == 0)
+        continue;
+      ++participants;
+      busy += t->busy_ns;
+      wgs += t->wgs;
+      chunks += t->chunks;
+      if (t->busy_ns > max_busy)
+        max_busy = t->busy_ns;
+      if (t->last_ns < first_done)
+        first_done = t->last_ns;
+      if (t->last_ns > last_done)
+        last_done = t->last_ns;
+    }
+
+  POCL_LOCK (wg_summary_lock);
+  wg_kernel_summary *s;
+  LL_FOREACH (wg_summaries, s)
+    if (strcmp (s->name, k->kernel->name) == 0)
+      break;
+  if (s == NULL)
+    {
+      s = (wg_kernel_summary *)calloc (1, sizeof (wg_kernel_summary));
+      if (s)
+        {
+          s->name = strdup (k->kernel->name);
+          LL_PREPEND (wg_summaries, s);
+        }
+    }
+  if (s)
+    {
+      ++s->launches;
+      s->wall_ns += end_ns - p->launch_ns;
+      s->thread_ns += (end_ns - p->launch_ns) * p->num_threads;
+      s->busy_ns += busy;
+      s->fetch_ns += fetch;
+      s->lock_wait_ns += lock_wait;
+      s->ignored += p->ignored;
+      s->max_busy_ns += max_busy;
+      s->mean_busy_ns += participants ? busy / participants : 0;
+      s->tail_ns += participants ? last_done - first_done : 0;
+      s->chunks += chunks;
+      s->wgs += wgs;
+    }
+  POCL_UNLOCK (wg_summary_lock);
+
+  pocl_aligned_free (p->threads);
+  free (p->chunks);
+  free (p);
+}
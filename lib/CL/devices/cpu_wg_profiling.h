@@ -0,0 +1,115 @@
+/* cpu_wg_profiling.h - per work-group chunk profiling of the CPU drivers
+
+   Copyright (c) 2026 PoCL developers
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+*/
+
+#ifndef POCL_CPU_WG_PROFILING_H
+#define POCL_CPU_WG_PROFILING_H
+
+#include "common_utils.h"
+
+/* Opt-in (POCL_CPU_WG_PROFILING=1) profiling of how the work-groups of
+ * each kernel launch are spread over the worker threads of the CPU drivers.
+ * For each launch it records the WG chunks each thread ran and when, the
+ * busy time of the threads and the time they spent fetching work (waiting
+ * for the lock of the WG pool in the pthread driver). The chunks are passed
+ * to the active event tracer (see pocl_event_trace_wg_chunk ()), and a
+ * per-kernel summary of the load balance is printed at exit. */
+
+typedef struct pocl_cpu_wg_thread_stats
+{
+  POCL_ALIGNAS (HOST_CPU_CACHELINE_SIZE) uint64_t first_ns;
+  uint64_t last_ns;
+  uint64_t busy_ns;
+  uint64_t fetch_ns;
+  /* part of fetch_ns spent waiting for the lock of the WG pool */
+  uint64_t lock_wait_ns;
+  uint64_t wgs;
+  unsigned chunks;
+} pocl_cpu_wg_thread_stats;
+
+typedef struct pocl_cpu_wg_chunk
+{
+  uint64_t start_ns;
+  uint64_t end_ns;
+  uint64_t first_wg;
+  uint64_t num_wgs;
+  unsigned thread;
+} pocl_cpu_wg_chunk;
+
+typedef struct pocl_cpu_wg_profile
+{
+  uint64_t launch_ns;
+  unsigned num_threads;
+  /* one per worker thread, each only updated by its thread */
+  pocl_cpu_wg_thread_stats *threads;
+  pocl_cpu_wg_chunk *chunks;
+  unsigned max_chunks;
+  unsigned num_chunks;
+  /* records of threads numbered num_threads or higher */
+  unsigned ignored;
+} pocl_cpu_wg_profile;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Reads POCL_CPU_WG_PROFILING, called at the driver init. */
+POCL_EXPORT
+void pocl_cpu_wg_profiling_init (void);
+
+/* Returns the profile for a new launch of k on num_threads worker threads,
+ * NULL if the profiling is disabled. The threads are numbered from 0, the
+ * records of threads with a higher number are ignored. */
+POCL_EXPORT
+pocl_cpu_wg_profile *pocl_cpu_wg_profile_begin (kernel_run_command *k,
+                                                unsigned num_threads);
+
+/* Records that the thread ran the WGs first_wg .. first_wg+num_wgs-1
+ * between start_ns and end_ns. */
+POCL_EXPORT
+void pocl_cpu_wg_profile_chunk (pocl_cpu_wg_profile *p,
+                                unsigned thread,
+                                uint64_t first_wg,
+                                uint64_t num_wgs,
+                                uint64_t start_ns,
+                                uint64_t end_ns);
+
+/* Adds time the thread spent getting the next chunk of WGs, lock_wait_ns
+ * of which it waited for the lock of the WG pool. */
+POCL_EXPORT
+void pocl_cpu_wg_profile_fetch (pocl_cpu_wg_profile *p,
+                                unsigned thread,
+                                uint64_t ns,
+                                uint64_t lock_wait_ns);
+
+/* Called when all the WGs of k have finished, before its event is
+ * completed. Reports the chunks, adds the launch to the summary and frees
+ * the profile. */
+POCL_EXPORT
+void pocl_cpu_wg_profile_end (kernel_run_command *k);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POCL_CPU_WG_PROFILING_H */
@@ -48,6 +48,8 @@
 #include "pocl_debug.h"
 #include "pocl_dynlib.h"
 #include "pocl_export.h"
+#include "pocl_host_mem_pool.h"
+#include "pocl_mem_management.h"
 #include "pocl_runtime_config.h"
 #include "pocl_tracing.h"
 #include "pocl_util.h"
@@ -671,6 +673,12 @@ pocl_init_devices (cl_platform_id platform)
 
   pocl_event_tracing_init ();
 
+  pocl_host_mem_pool_init ();
+
+  pocl_init_dirty_range_tracking ();
+
+  pocl_init_broadcast_migrations ();
+
   pocl_async_callback_init ();
 
 #ifdef HAVE_SLEEP
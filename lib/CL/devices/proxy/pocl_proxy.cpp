@@ -108,6 +108,9 @@ typedef struct proxy_queue_data_s
   // index of this queue's device in context->devices[]
   unsigned context_device_i;
 
+  // number of commands forwarded to the backend queue since the last clFlush
+  unsigned unflushed;
+
   // ask the thread to exit
   int cq_thread_exit_requested;
   /* queue pthread */
@@ -118,8 +121,22 @@ typedef struct proxy_queue_data_s
 typedef struct pocl_proxy_event_data_s
 {
   pocl_cond_t event_cond;
+  // the backend event of the forwarded command
+  cl_event native;
+  // backend events of the unfinished dependencies, the wait list of native
+  cl_event *native_deps;
+  cl_uint num_native_deps;
+  // result of the backend clEnqueue* call
+  cl_int error;
+  // set once native is valid
+  int forwarded;
+  // set when the command was pushed to the queue thread
+  int pushed;
 } pocl_proxy_event_data_t;
 
+#define PROXY_EVENT_DATA(node)                                                \
+  ((pocl_proxy_event_data_t *)(node)->sync.event.event->data)
+
 static const char proxy_device_name[] = "proxy";
 static cl_uint num_platforms = 0;
 static proxy_platform_data_t *platforms = NULL;
@@ -1722,6 +1739,7 @@ pocl_proxy_init_queue (cl_device_id device, cl_command_queue queue)
   POCL_INIT_COND (qd->wait_cond);
   POCL_INIT_LOCK (qd->wq_lock);
   qd->work_queue = NULL;
+  qd->unflushed = 0;
 
   qd->proxied_id = cq;
   qd->queue = queue;
@@ -1816,12 +1834,68 @@ proxy_push_command (_cl_command_node *node)
   cl_command_queue cq = node->sync.event.event->queue;
   proxy_queue_data_t *qd = (proxy_queue_data_t *)cq->data;
 
+  PROXY_EVENT_DATA (node)->pushed = 1;
   POCL_LOCK (qd->wq_lock);
   DL_APPEND (qd->work_queue, node);
   POCL_SIGNAL_COND (qd->wakeup_cond);
   POCL_UNLOCK (qd->wq_lock);
 }
 
+/* Returns true if all the unfinished dependencies of the (locked) event have
+ * been forwarded to the same backend platform, so the command can be
+ * forwarded with their backend events as its wait list instead of waiting
+ * for them to finish. */
+static int
+proxy_deps_forwarded (cl_event event)
+{
+  proxy_device_data_t *d = (proxy_device_data_t *)event->queue->device->data;
+  event_node *n;
+
+  LL_FOREACH (event->wait_list, n)
+    {
+      cl_event dep = n->event;
+      if (dep->queue == NULL
+          || dep->queue->device->ops != event->queue->device->ops)
+        return 0;
+      proxy_device_data_t *dep_d
+          = (proxy_device_data_t *)dep->queue->device->data;
+      if (dep_d->backend != d->backend)
+        return 0;
+      pocl_proxy_event_data_t *dep_e_d
+          = (pocl_proxy_event_data_t *)POCL_ATOMIC_LOAD (dep->data);
+      if (dep_e_d == NULL || POCL_ATOMIC_LOAD (dep_e_d->forwarded) == 0)
+        return 0;
+    }
+  return 1;
+}
+
+/* Called after the event's command was forwarded; pushes the commands
+ * waiting only for forwarded commands to their queue threads. */
+static void
+proxy_push_dependents (cl_event event)
+{
+  event_node *n;
+
+  POCL_LOCK_OBJ (event);
+  LL_FOREACH (event->notify_list, n)
+    {
+      cl_event target = n->event;
+      POCL_LOCK_OBJ (target);
+      _cl_command_node *node = target->command;
+      if (node != NULL && target->status == CL_QUEUED
+          && node->device->ops == event->queue->device->ops
+          && node->state == POCL_COMMAND_READY
+          && PROXY_EVENT_DATA (node)->pushed == 0
+          && proxy_deps_forwarded (target))
+        {
+          pocl_update_event_submitted (target);
+          proxy_push_command (node);
+        }
+      POCL_UNLOCK_OBJ (target);
+    }
+  POCL_UNLOCK_OBJ (event);
+}
+
 void
 pocl_proxy_submit (_cl_command_node *node, cl_command_queue cq)
 {
@@ -1833,10 +1907,10 @@ pocl_proxy_submit (_cl_command_node *node, cl_command_queue cq)
   assert (e_d);
 
   POCL_INIT_COND (e_d->event_cond);
-  e->data = (void *)e_d;
+  POCL_ATOMIC_STORE (e->data, (void *)e_d);
 
   node->state = POCL_COMMAND_READY;
-  if (pocl_command_is_ready (e))
+  if (pocl_command_is_ready (e) || proxy_deps_forwarded (e))
     {
       pocl_update_event_submitted (e);
       proxy_push_command (node);
@@ -1885,6 +1959,11 @@ pocl_proxy_notify (cl_device_id device, cl_event event, cl_event finished)
 {
   _cl_command_node *node = event->command;
 
+  /* Already forwarded after its dependencies, the backend orders it and
+   * its event callback finishes it. */
+  if (event->data != NULL && PROXY_EVENT_DATA (node)->pushed)
+    return;
+
   if (finished->status < CL_COMPLETE) {
     /* Unlock the finished event in order to prevent a lock order violation
      * with the command queue that will be locked during
@@ -1906,7 +1985,8 @@ pocl_proxy_notify (cl_device_id device, cl_event event, cl_event finished)
       return;
     }
 
-  if (pocl_command_is_ready (node->sync.event.event))
+  if (pocl_command_is_ready (node->sync.event.event)
+      || proxy_deps_forwarded (event))
     {
       assert (event->status == CL_QUEUED);
       pocl_update_event_submitted (event);
@@ -1940,6 +2020,8 @@ pocl_proxy_free_event_data (cl_event event)
 {
   assert (event->data != NULL);
   pocl_proxy_event_data_t *e_d = (pocl_proxy_event_data_t *)event->data;
+  if (e_d->native)
+    clReleaseEvent (e_d->native);
   POCL_DESTROY_COND (e_d->event_cond);
   POCL_MEM_FREE (event->data);
 }
@@ -1953,10 +2035,16 @@ pocl_proxy_notify_event_finished (cl_event event)
 
 /*****************************************************************************/
 
+/* The forwarded commands wait for the backend events of their unfinished
+ * dependencies, and complete from the callback of their own backend event. */
+#define NATIVE_EVENTS(node)                                                   \
+  PROXY_EVENT_DATA (node)->num_native_deps,                                   \
+      PROXY_EVENT_DATA (node)->native_deps, &PROXY_EVENT_DATA (node)->native
+
 #define ENQUEUE(code)                                                         \
   int res = code;                                                             \
   assert (res == CL_SUCCESS);                                                 \
-  clFinish (cq);
+  PROXY_EVENT_DATA (node)->error = res;
 
 #if defined(ENABLE_OPENGL_INTEROP) || defined(ENABLE_EGL_INTEROP)
 static void
@@ -1975,11 +2063,11 @@ pocl_proxy_enque_acquire_gl (void *data, cl_command_queue cq,
   }
 
 #ifdef ENABLE_EGL_INTEROP
-  ENQUEUE (
-      clEnqueueAcquireEGLObjectsKHR (cq, num_objs, proxy_objs, 0, NULL, NULL));
+  ENQUEUE (clEnqueueAcquireEGLObjectsKHR (cq, num_objs, proxy_objs,
+                                          NATIVE_EVENTS (node)));
 #else
-  ENQUEUE (
-      clEnqueueAcquireGLObjects (cq, num_objs, proxy_objs, 0, NULL, NULL));
+  ENQUEUE (clEnqueueAcquireGLObjects (cq, num_objs, proxy_objs,
+                                      NATIVE_EVENTS (node)));
 #endif
 }
 
@@ -1999,11 +2087,11 @@ pocl_proxy_enque_release_gl (void *data, cl_command_queue cq,
   }
 
 #ifdef ENABLE_EGL_INTEROP
-  ENQUEUE (
-      clEnqueueReleaseEGLObjectsKHR (cq, num_objs, proxy_objs, 0, NULL, NULL));
+  ENQUEUE (clEnqueueReleaseEGLObjectsKHR (cq, num_objs, proxy_objs,
+                                          NATIVE_EVENTS (node)));
 #else
-  ENQUEUE (
-      clEnqueueReleaseGLObjects (cq, num_objs, proxy_objs, 0, NULL, NULL));
+  ENQUEUE (clEnqueueReleaseGLObjects (cq, num_objs, proxy_objs,
+                                      NATIVE_EVENTS (node)));
 #endif
 }
 #endif
@@ -2016,8 +2104,8 @@ pocl_proxy_enque_read (void *data, cl_command_queue cq, _cl_command_node *node,
 {
   cl_mem mem = (cl_mem)src_mem_id->mem_ptr;
 
-  ENQUEUE (clEnqueueReadBuffer (cq, mem, CL_FALSE, offset, size, host_ptr, 0,
-                                NULL, NULL));
+  ENQUEUE (clEnqueueReadBuffer (cq, mem, CL_FALSE, offset, size, host_ptr,
+                                NATIVE_EVENTS (node)));
 }
 
 static void
@@ -2029,8 +2117,8 @@ pocl_proxy_enque_write (void *data, cl_command_queue cq,
 {
   cl_mem mem = (cl_mem)dst_mem_id->mem_ptr;
 
-  ENQUEUE (clEnqueueWriteBuffer (cq, mem, CL_FALSE, offset, size, host_ptr, 0,
-                                 NULL, NULL));
+  ENQUEUE (clEnqueueWriteBuffer (cq, mem, CL_FALSE, offset, size, host_ptr,
+                                 NATIVE_EVENTS (node)));
 }
 
 static int
@@ -2047,8 +2135,8 @@ pocl_proxy_enque_copy (void *data, cl_command_queue cq, _cl_command_node *node,
       return 1;
     }
 
-  ENQUEUE (clEnqueueCopyBuffer (cq, src, dst, src_offset, dst_offset, size, 0,
-                                NULL, NULL));
+  ENQUEUE (clEnqueueCopyBuffer (cq, src, dst, src_offset, dst_offset, size,
+                                NATIVE_EVENTS (node)));
   return 0;
 }
 
@@ -2085,7 +2173,7 @@ pocl_proxy_enque_copy_rect (void *data, cl_command_queue cq,
 
   ENQUEUE (clEnqueueCopyBufferRect (
       cq, src, dst, src_origin, dst_origin, region, src_row_pitch,
-      src_slice_pitch, dst_row_pitch, dst_slice_pitch, 0, NULL, NULL));
+      src_slice_pitch, dst_row_pitch, dst_slice_pitch, NATIVE_EVENTS (node)));
 }
 
 static void
@@ -2118,8 +2206,8 @@ pocl_proxy_enque_write_rect (
 
   ENQUEUE (clEnqueueWriteBufferRect (
       cq, mem, CL_FALSE, buffer_origin, host_origin, region, buffer_row_pitch,
-      buffer_slice_pitch, host_row_pitch, host_slice_pitch, host_ptr, 0, NULL,
-      NULL));
+      buffer_slice_pitch, host_row_pitch, host_slice_pitch, host_ptr,
+      NATIVE_EVENTS (node)));
 }
 
 static void
@@ -2136,8 +2224,8 @@ pocl_proxy_enque_read_rect (
 
   ENQUEUE (clEnqueueReadBufferRect (
       cq, mem, CL_FALSE, buffer_origin, host_origin, region, buffer_row_pitch,
-      buffer_slice_pitch, host_row_pitch, host_slice_pitch, host_ptr, 0, NULL,
-      NULL));
+      buffer_slice_pitch, host_row_pitch, host_slice_pitch, host_ptr,
+      NATIVE_EVENTS (node)));
   /*
     POCL_MSG_PRINT_PROXY ("ASYNC READ: \nregion %zu %zu %zu\n"
                   "  buffer_origin %zu %zu %zu\n"
@@ -2166,7 +2254,7 @@ pocl_proxy_enque_memfill (void *data, cl_command_queue cq,
   cl_mem mem = (cl_mem)dst_mem_id->mem_ptr;
 
   ENQUEUE (clEnqueueFillBuffer (cq, mem, pattern, pattern_size, offset, size,
-                                0, NULL, NULL));
+                                NATIVE_EVENTS (node)));
 }
 
 static int
@@ -2187,8 +2275,8 @@ pocl_proxy_enque_map_mem (void *data, cl_command_queue cq,
                            "to dst_host_ptr %p\n",
                            src_mem_id, offset, host_ptr);
   */
-  ENQUEUE (clEnqueueReadBuffer (cq, mem, CL_FALSE, offset, size, host_ptr, 0,
-                                NULL, NULL));
+  ENQUEUE (clEnqueueReadBuffer (cq, mem, CL_FALSE, offset, size, host_ptr,
+                                NATIVE_EVENTS (node)));
 
   return 0;
 }
@@ -2219,7 +2307,7 @@ pocl_proxy_enque_unmap_mem (void *data, cl_command_queue cq,
   else
     {
       ENQUEUE (clEnqueueWriteBuffer (cq, dst, CL_FALSE, offset, size, host_ptr,
-                                     0, NULL, NULL));
+                                     NATIVE_EVENTS (node)));
     }
   return 0;
 }
@@ -2301,8 +2389,8 @@ pocl_proxy_enque_run (cl_device_id pocl_device, void *data, unsigned device_i,
                       pc->global_offset[1],
                       pc->global_offset[2] };
 
-  ENQUEUE (clEnqueueNDRangeKernel (cq, kernel, pc->work_dim,
-                                   offset, global, local, 0, NULL, NULL));
+  ENQUEUE (clEnqueueNDRangeKernel (cq, kernel, pc->work_dim, offset, global,
+                                   local, NATIVE_EVENTS (node)));
 }
 
 static cl_int
@@ -2330,7 +2418,7 @@ pocl_proxy_enque_copy_image_rect (
   */
 
   ENQUEUE (clEnqueueCopyImage (cq, src_img, dst_img, src_origin, dst_origin,
-                               region, 0, NULL, NULL));
+                               region, NATIVE_EVENTS (node)));
   return 0;
 }
 
@@ -2371,14 +2459,15 @@ pocl_proxy_enque_write_image_rect (void *data, cl_command_queue cq,
       assert (src_mem_id);
       cl_mem src = (cl_mem)src_mem_id->mem_ptr;
       ENQUEUE (clEnqueueCopyBufferToImage (cq, src, dst_img, src_offset,
-                                           origin, region, 0, NULL, NULL));
+                                           origin, region,
+                                           NATIVE_EVENTS (node)));
     }
   else
     {
       assert (src_mem_id == NULL);
       ENQUEUE (clEnqueueWriteImage (cq, dst_img, CL_FALSE, origin, region,
                                     src_row_pitch, src_slice_pitch,
-                                    src_host_ptr, 0, NULL, NULL));
+                                    src_host_ptr, NATIVE_EVENTS (node)));
     }
 
   return 0;
@@ -2422,14 +2511,14 @@ pocl_proxy_enque_read_image_rect (void *data, cl_command_queue cq,
       assert (dst_mem_id);
       cl_mem dst = (cl_mem)dst_mem_id->mem_ptr;
       ENQUEUE (clEnqueueCopyImageToBuffer (cq, src_img, dst, origin, region,
-                                           dst_offset, 0, NULL, NULL));
+                                           dst_offset, NATIVE_EVENTS (node)));
     }
   else
     {
       assert (dst_mem_id == NULL);
       ENQUEUE (clEnqueueReadImage (cq, src_img, CL_FALSE, origin, region,
                                    dst_row_pitch, dst_slice_pitch,
-                                   dst_host_ptr, 0, NULL, NULL));
+                                   dst_host_ptr, NATIVE_EVENTS (node)));
     }
 
   return 0;
@@ -2452,7 +2541,7 @@ pocl_proxy_enque_map_image (void *data, cl_command_queue cq,
 
   ENQUEUE (clEnqueueReadImage (cq, mem, CL_FALSE, map->origin, map->region,
                                map->row_pitch, map->slice_pitch, map->host_ptr,
-                               0, NULL, NULL));
+                               NATIVE_EVENTS (node)));
   return 0;
 }
 
@@ -2473,7 +2562,7 @@ pocl_proxy_enque_unmap_image (void *data, cl_command_queue cq,
 
   ENQUEUE (clEnqueueWriteImage (cq, mem, CL_FALSE, map->origin, map->region,
                                 map->row_pitch, map->slice_pitch,
-                                map->host_ptr, 0, NULL, NULL));
+                                map->host_ptr, NATIVE_EVENTS (node)));
   return 0;
 }
 
@@ -2495,8 +2584,8 @@ pocl_proxy_enque_fill_image (void *data, cl_command_queue cq,
                             region[0], region[1], region[2]);
   */
 
-  ENQUEUE (
-      clEnqueueFillImage (cq, mem, fill_pixel, origin, region, 0, NULL, NULL));
+  ENQUEUE (clEnqueueFillImage (cq, mem, fill_pixel, origin, region,
+                               NATIVE_EVENTS (node)));
   return 0;
 }
 
@@ -2525,12 +2614,31 @@ pocl_proxy_enque_migrate_d2d (void *dest_data, void *source_data,
   POCL_MSG_PRINT_PROXY ("internal migrate D2D called\n");
 
   cl_mem_migration_flags flags = 0;
-  ENQUEUE (
-      clEnqueueMigrateMemObjects (cq, 1, &actual_mem, flags, 0, NULL, NULL));
+  ENQUEUE (clEnqueueMigrateMemObjects (cq, 1, &actual_mem, flags,
+                                       NATIVE_EVENTS (node)));
 }
 
 /*****************************************************************************/
 
+static void CL_CALLBACK
+proxy_native_event_finished (cl_event native, cl_int status, void *data)
+{
+  cl_event event = (cl_event)data;
+  _cl_command_node *node = event->command;
+
+  const char *cstr = pocl_command_to_str (node->type);
+  char msg[128] = "Event ";
+  strncat (msg, cstr, 127);
+
+  if (status < 0)
+    {
+      POCL_MSG_ERR ("proxy: backend %s failed with %d\n", cstr, status);
+      POCL_UPDATE_EVENT_FAILED (CL_FAILED, event);
+    }
+  else
+    POCL_UPDATE_EVENT_COMPLETE_MSG (event, msg);
+}
+
 static void
 proxy_exec_command (_cl_command_node *node, cl_device_id dev,
                     proxy_device_data_t *d, proxy_queue_data_t *qd)
@@ -2541,8 +2649,31 @@ proxy_exec_command (_cl_command_node *node, cl_device_id dev,
   cl_command_queue cq_id = qd->proxied_id;
   unsigned context_device_i = qd->context_device_i;
   cl_mem m = NULL;
+  pocl_proxy_event_data_t *e_d = PROXY_EVENT_DATA (node);
+  event_node *n;
 
-  pocl_update_event_running (event);
+  /* Collect the backend events of the dependencies still unfinished. They
+   * are retained, since the dependencies can finish and be freed while the
+   * command is forwarded. */
+  POCL_LOCK_OBJ (event);
+  LL_FOREACH (event->wait_list, n)
+    ++e_d->num_native_deps;
+  if (e_d->num_native_deps > 0)
+    {
+      e_d->native_deps
+          = (cl_event *)malloc (e_d->num_native_deps * sizeof (cl_event));
+      e_d->num_native_deps = 0;
+      LL_FOREACH (event->wait_list, n)
+        {
+          pocl_proxy_event_data_t *dep_e_d
+              = (pocl_proxy_event_data_t *)n->event->data;
+          assert (dep_e_d->forwarded);
+          clRetainEvent (dep_e_d->native);
+          e_d->native_deps[e_d->num_native_deps++] = dep_e_d->native;
+        }
+    }
+  pocl_update_event_running_unlocked (event);
+  POCL_UNLOCK_OBJ (event);
 
   switch (node->type)
     {
@@ -2573,10 +2704,19 @@ proxy_exec_command (_cl_command_node *node, cl_device_id dev,
               }
             else
               {
+                /* One native event per command, so only the bounding span
+                 * of the dirty ranges. */
+                size_t offset = 0, size = m->size;
+                pocl_interval_set *ranges = &cmd->migrate.ranges;
+                if (ranges->num > 0)
+                  {
+                    offset = ranges->start[0];
+                    size = ranges->end[ranges->num - 1] - offset;
+                  }
                 pocl_proxy_enque_read (
-                  d, cq_id, node, m->mem_host_ptr,
+                  d, cq_id, node, (char *)m->mem_host_ptr + offset,
                   &node->migr_infos->buffer->device_ptrs[dev->global_mem_id],
-                  m, 0, m->size);
+                  m, offset, size);
               }
             break;
           }
@@ -2601,10 +2741,17 @@ proxy_exec_command (_cl_command_node *node, cl_device_id dev,
               }
             else
               {
+                size_t offset = 0, size = m->size;
+                pocl_interval_set *ranges = &cmd->migrate.ranges;
+                if (ranges->num > 0)
+                  {
+                    offset = ranges->start[0];
+                    size = ranges->end[ranges->num - 1] - offset;
+                  }
                 pocl_proxy_enque_write (
-                  d, cq_id, node, m->mem_host_ptr,
+                  d, cq_id, node, (char *)m->mem_host_ptr + offset,
                   &node->migr_infos->buffer->device_ptrs[dev->global_mem_id],
-                  m, 0, m->size);
+                  m, offset, size);
               }
             break;
           }
@@ -2794,7 +2941,6 @@ proxy_exec_command (_cl_command_node *node, cl_device_id dev,
       goto FINISH_COMMAND;
 
     case CL_COMMAND_MARKER:
-      clFlush (cq_id);
     case CL_COMMAND_BARRIER:
       goto FINISH_COMMAND;
 
@@ -2804,11 +2950,43 @@ proxy_exec_command (_cl_command_node *node, cl_device_id dev,
 
 FINISH_COMMAND:
 
+  /* commands that were no-ops on the backend still have to wait for their
+   * dependencies before finishing */
+  if (e_d->error == CL_SUCCESS && e_d->native == NULL
+      && e_d->num_native_deps > 0)
+    e_d->error = clEnqueueMarkerWithWaitList (cq_id, NATIVE_EVENTS (node));
+
+  for (cl_uint i = 0; i < e_d->num_native_deps; ++i)
+    clReleaseEvent (e_d->native_deps[i]);
+  POCL_MEM_FREE (e_d->native_deps);
+  e_d->num_native_deps = 0;
+
   cstr = pocl_command_to_str (node->type);
   char msg[128] = "Event ";
   strncat (msg, cstr, 127);
 
-  POCL_UPDATE_EVENT_COMPLETE_MSG (event, msg);
+  if (e_d->error != CL_SUCCESS)
+    {
+      POCL_MSG_ERR ("proxy: forwarding %s failed with %d\n", cstr,
+                    e_d->error);
+      POCL_UPDATE_EVENT_FAILED (CL_FAILED, event);
+      return;
+    }
+
+  if (e_d->native == NULL)
+    {
+      POCL_UPDATE_EVENT_COMPLETE_MSG (event, msg);
+      return;
+    }
+
+  ++qd->unflushed;
+  POCL_ATOMIC_STORE (e_d->forwarded, 1);
+  /* this must be done before setting the callback, which can finish and
+   * free the event */
+  proxy_push_dependents (event);
+  int err = clSetEventCallback (e_d->native, CL_COMPLETE,
+                                proxy_native_event_finished, event);
+  assert (err == CL_SUCCESS);
 }
 
 static void *
@@ -2835,7 +3013,6 @@ pocl_proxy_queue_pthread (void *ptr)
           DL_DELETE (qd->work_queue, cmd);
           POCL_UNLOCK (qd->wq_lock);
 
-          assert (pocl_command_is_ready (cmd->sync.event.event));
           assert (cmd->sync.event.event->status == CL_SUBMITTED);
 
           proxy_exec_command (cmd, device, d, qd);
@@ -2847,6 +3024,15 @@ pocl_proxy_queue_pthread (void *ptr)
           POCL_LOCK (qd->wq_lock);
         }
 
+      /* flush the forwarded commands once the work queue is drained */
+      if ((qd->work_queue == NULL) && qd->unflushed)
+        {
+          qd->unflushed = 0;
+          POCL_UNLOCK (qd->wq_lock);
+          clFlush (qd->proxied_id);
+          POCL_LOCK (qd->wq_lock);
+        }
+
       if ((qd->work_queue == NULL) && (qd->cq_thread_exit_requested == 0))
         {
           POCL_WAIT_COND (qd->wakeup_cond, qd->wq_lock);
@@ -39,6 +39,7 @@
 #include "common.h"
 #include "common_utils.h"
 #include "config.h"
+#include "cpu_cmdbuf.h"
 #include "devices.h"
 #include "pocl-pthread.h"
 #include "pocl-pthread_scheduler.h"
@@ -88,6 +89,10 @@ pocl_pthread_init_device_ops(struct pocl_device_ops *ops)
 
   ops->init_queue = pocl_pthread_init_queue;
   ops->free_queue = pocl_pthread_free_queue;
+
+  ops->create_finalized_command_buffer
+      = pocl_cpu_create_finalized_command_buffer;
+  ops->free_command_buffer = pocl_cpu_free_command_buffer;
 }
 
 unsigned int
@@ -135,6 +140,9 @@ pocl_pthread_init (unsigned j, cl_device_id device, const char* parameters)
   pocl_init_dlhandle_cache ();
   pocl_init_kernel_run_command_manager ();
 
+  /* command buffers are replayed by the scheduler from prepared graphs */
+  device->native_command_buffers = CL_TRUE;
+
   /* pthread has elementary partitioning support,
    * but only if OpenMP is disabled */
 #if  defined(ENABLE_HOST_CPU_DEVICES_OPENMP) || defined(ENABLE_CONFORMANCE)
@@ -32,11 +32,14 @@
 
 #include "common.h"
 #include "common_driver.h"
+#include "cpu_cmdbuf.h"
+#include "cpu_wg_profiling.h"
 #include "pocl-pthread.h"
 #include "pocl-pthread_scheduler.h"
 #include "pocl_builtin_kernels.h"
 #include "pocl_cl.h"
 #include "pocl_mem_management.h"
+#include "pocl_timing.h"
 #include "pocl_util.h"
 #include "utlist.h"
 
@@ -106,6 +109,8 @@ pthread_scheduler_init (cl_device_id device)
 
   POCL_INIT_COND (scheduler.wake_pool);
 
+  pocl_cpu_wg_profiling_init ();
+
   POCL_LOCK (scheduler.wq_lock_fast);
   VG_ASSOC_COND_VAR (scheduler.wake_pool, scheduler.wq_lock_fast);
   POCL_UNLOCK (scheduler.wq_lock_fast);
@@ -210,14 +215,22 @@ pthread_scheduler_push_kernel (kernel_run_command *run_cmd)
 
 static int
 get_wg_index_range (kernel_run_command *k, unsigned *start_index,
-                    unsigned *end_index, int *last_wgs, unsigned num_threads)
+                    unsigned *end_index, int *last_wgs, unsigned num_threads,
+                    uint64_t *lock_wait_ns)
 {
   const unsigned scaled_max_wgs = POCL_PTHREAD_MAX_WGS * num_threads;
   const unsigned scaled_min_wgs = POCL_PTHREAD_MIN_WGS * num_threads;
 
   unsigned limit;
   unsigned max_wgs;
-  POCL_LOCK (k->lock);
+  if (lock_wait_ns)
+    {
+      uint64_t start = pocl_gettimemono_ns ();
+      POCL_LOCK (k->lock);
+      *lock_wait_ns = pocl_gettimemono_ns () - start;
+    }
+  else
+    POCL_LOCK (k->lock);
   if (k->remaining_wgs == 0)
     {
       POCL_UNLOCK (k->lock);
@@ -253,6 +266,27 @@ get_wg_index_range (kernel_run_command *k, unsigned *start_index,
   return 1;
 }
 
+/* get_wg_index_range () which also accounts the time spent in it and the
+ * part of it spent waiting for k->lock to the WG profile */
+static int
+fetch_wg_index_range (kernel_run_command *k, pocl_cpu_wg_profile *prof,
+                      struct pool_thread_data *thread_data,
+                      unsigned *start_index, unsigned *end_index,
+                      int *last_wgs)
+{
+  if (prof == NULL)
+    return get_wg_index_range (k, start_index, end_index, last_wgs,
+                               thread_data->num_threads, NULL);
+
+  uint64_t lock_wait = 0;
+  uint64_t start = pocl_gettimemono_ns ();
+  int ret = get_wg_index_range (k, start_index, end_index, last_wgs,
+                                thread_data->num_threads, &lock_wait);
+  pocl_cpu_wg_profile_fetch (prof, thread_data->index,
+                             pocl_gettimemono_ns () - start, lock_wait);
+  return ret;
+}
+
 inline static void translate_wg_index_to_3d_index (kernel_run_command *k,
                                                    unsigned index,
                                                    size_t *index_3d,
@@ -264,10 +298,43 @@ inline static void translate_wg_index_to_3d_index (kernel_run_command *k,
   index_3d[0] = (index % xy_slice) % row_size;
 }
 
+/* Runs chunks of a DBK launch, fetched like the WGs of a kernel. */
+static void
+dbk_chunk_scheduler (kernel_run_command *k,
+                     struct pool_thread_data *thread_data)
+{
+  unsigned start_index;
+  unsigned end_index;
+  int last_wgs = 0;
+  unsigned execution_failed = 0;
+
+  while (get_wg_index_range (k, &start_index, &end_index, &last_wgs,
+                             thread_data->num_threads, NULL))
+    {
+      if (last_wgs)
+        {
+          POCL_LOCK (scheduler.wq_lock_fast);
+          DL_DELETE (scheduler.kernel_queue, k);
+          POCL_UNLOCK (scheduler.wq_lock_fast);
+        }
+      if (k->dbk.run (k->dbk.state, start_index, end_index - start_index + 1)
+          != CL_SUCCESS)
+        execution_failed = 1;
+    }
+
+  POCL_ATOMIC_OR (k->execution_failed, execution_failed);
+}
+
 static void
 work_group_scheduler (kernel_run_command *k,
                       struct pool_thread_data *thread_data)
 {
+  if (k->dbk.run)
+    {
+      dbk_chunk_scheduler (k, thread_data);
+      return;
+    }
+
   pocl_kernel_metadata_t *meta = k->kernel->meta;
 
   const size_t num_args = meta->num_args + meta->num_locals + 1;
@@ -278,9 +345,10 @@ work_group_scheduler (kernel_run_command *k,
   unsigned start_index;
   unsigned end_index;
   int last_wgs = 0;
+  pocl_cpu_wg_profile *prof = (pocl_cpu_wg_profile *)k->wg_profile;
 
-  if (!get_wg_index_range (k, &start_index, &end_index, &last_wgs,
-                           thread_data->num_threads))
+  if (!fetch_wg_index_range (k, prof, thread_data, &start_index, &end_index,
+                             &last_wgs))
     return;
 
   assert (end_index >= start_index);
@@ -298,6 +366,11 @@ work_group_scheduler (kernel_run_command *k,
   assert (pc.printf_buffer_capacity > 0);
   assert (pc.printf_buffer_position != NULL);
 
+  size_t fused_size = pocl_cpu_fused_state_size (k);
+  pocl_cpu_fused_wg *fused = fused_size ? alloca (fused_size) : NULL;
+  unsigned num_fused = pocl_cpu_fused_setup (
+      k, fused, thread_data->local_mem, scheduler.local_mem_size, &pc);
+
   pocl_cpu_setup_rm_and_ftz (k->device, k->kernel->program);
 
   unsigned slice_size = k->pc.num_groups[0] * k->pc.num_groups[1];
@@ -312,6 +385,7 @@ work_group_scheduler (kernel_run_command *k,
           POCL_UNLOCK (scheduler.wq_lock_fast);
         }
 
+      uint64_t chunk_start = prof ? pocl_gettimemono_ns () : 0;
       for (i = start_index; i <= end_index; ++i)
         {
           size_t gids[3];
@@ -325,10 +399,17 @@ work_group_scheduler (kernel_run_command *k,
           k->workgroup ((uint8_t *)arguments, (uint8_t *)&pc,
                         gids[0], gids[1], gids[2]);
           execution_failed |= pc.execution_failed;
+          if (num_fused)
+            execution_failed |= pocl_cpu_fused_run_wg (
+                fused, num_fused, gids[0], gids[1], gids[2]);
         }
+      if (prof)
+        pocl_cpu_wg_profile_chunk (prof, thread_data->index, start_index,
+                                   end_index - start_index + 1, chunk_start,
+                                   pocl_gettimemono_ns ());
     }
-  while (get_wg_index_range (k, &start_index, &end_index, &last_wgs,
-                             thread_data->num_threads));
+  while (fetch_wg_index_range (k, prof, thread_data, &start_index,
+                               &end_index, &last_wgs));
 
 #ifndef ENABLE_PRINTF_IMMEDIATE_FLUSH
   pocl_write_printf_buffer ((char *)pc.printf_buffer, position);
@@ -336,6 +417,7 @@ work_group_scheduler (kernel_run_command *k,
 
   pocl_free_kernel_arg_array_with_locals ((void **)arguments,
                                           (void **)arguments2, k);
+  pocl_cpu_fused_teardown (fused, num_fused);
 
   POCL_ATOMIC_OR (k->execution_failed, execution_failed);
 }
@@ -352,6 +434,17 @@ work_group_scheduler (kernel_run_command *k,
 
   omp_set_dynamic(0);
   omp_set_num_threads(k->device->max_compute_units);
+
+  if (k->dbk.run)
+    {
+      long num_chunks = (long)k->dbk.num_chunks;
+      unsigned execution_failed = 0;
+#pragma omp parallel for schedule(dynamic) reduction(| : execution_failed)
+      for (long c = 0; c < num_chunks; ++c)
+        execution_failed |= (k->dbk.run (k->dbk.state, c, 1) != CL_SUCCESS);
+      k->execution_failed |= execution_failed;
+      return;
+    }
 #pragma omp parallel
   {
     const size_t num_args = meta->num_args + meta->num_locals + 1;
@@ -371,10 +464,20 @@ work_group_scheduler (kernel_run_command *k,
     uint32_t position = 0;
     pc.printf_buffer_position = &position;
 
+    size_t fused_size = pocl_cpu_fused_state_size (k);
+    pocl_cpu_fused_wg *fused = fused_size ? alloca (fused_size) : NULL;
+    unsigned num_fused = pocl_cpu_fused_setup (
+        k, fused, local_mem, scheduler.local_mem_size, &pc);
+
     pocl_cpu_setup_rm_and_ftz (k->device, k->kernel->program);
 
     size_t x, y, z;
     unsigned execution_failed = 0;
+    /* the WG profile gets the runs of consecutive WGs a thread got from
+     * the OpenMP schedule as its chunks */
+    pocl_cpu_wg_profile *prof = (pocl_cpu_wg_profile *)k->wg_profile;
+    unsigned thread = omp_get_thread_num ();
+    uint64_t chunk_first = 0, chunk_wgs = 0, chunk_start = 0, chunk_end = 0;
     /* runtime = set scheduling according to environment variable OMP_SCHEDULE
      */
 #pragma omp for ordered collapse(3) schedule(runtime)
@@ -382,10 +485,38 @@ work_group_scheduler (kernel_run_command *k,
       for (y = 0; y < pc.num_groups[1]; ++y)
         for (x = 0; x < pc.num_groups[0]; ++x)
           {
+            if (prof)
+              {
+                uint64_t wg = (z * pc.num_groups[1] + y) * pc.num_groups[0]
+                              + x;
+                if (chunk_wgs && wg != chunk_first + chunk_wgs)
+                  {
+                    pocl_cpu_wg_profile_chunk (prof, thread, chunk_first,
+                                               chunk_wgs, chunk_start,
+                                               chunk_end);
+                    chunk_wgs = 0;
+                  }
+                if (chunk_wgs == 0)
+                  {
+                    chunk_first = wg;
+                    chunk_start = pocl_gettimemono_ns ();
+                  }
+              }
             ((pocl_workgroup_func)k->workgroup) ((uint8_t *)arguments,
                                                  (uint8_t *)&pc, x, y, z);
             execution_failed |= pc.execution_failed;
+            if (num_fused)
+              execution_failed
+                  |= pocl_cpu_fused_run_wg (fused, num_fused, x, y, z);
+            if (prof)
+              {
+                chunk_end = pocl_gettimemono_ns ();
+                ++chunk_wgs;
+              }
           }
+    if (prof && chunk_wgs)
+      pocl_cpu_wg_profile_chunk (prof, thread, chunk_first, chunk_wgs,
+                                 chunk_start, chunk_end);
 
 #ifndef ENABLE_PRINTF_IMMEDIATE_FLUSH
     pocl_write_printf_buffer ((char *)pc.printf_buffer, position);
@@ -393,6 +524,7 @@ work_group_scheduler (kernel_run_command *k,
 
     pocl_free_kernel_arg_array_with_locals ((void **)arguments,
                                             (void **)arguments2, k);
+    pocl_cpu_fused_teardown (fused, num_fused);
 
     free (local_mem);
     free (pc.printf_buffer);
@@ -411,6 +543,35 @@ finalize_kernel_command (struct pool_thread_data *thread_data,
   printf("### kernel %s finished\n", k->cmd->command.run.kernel->name);
 #endif
 
+  pocl_cpu_wg_profile_end (k);
+
+  /* the args, WG function and the run itself belong to the command buffer,
+   * only notify the thread replaying it */
+  if (k->cmdbuf_exec)
+    {
+      pocl_cpu_cmdbuf_exec *exec = (pocl_cpu_cmdbuf_exec *)k->cmdbuf_exec;
+      POCL_LOCK (scheduler.wq_lock_fast);
+      --exec->pending;
+      POCL_BROADCAST_COND (scheduler.wake_pool);
+      POCL_UNLOCK (scheduler.wq_lock_fast);
+      return;
+    }
+
+  if (k->dbk.run)
+    {
+      if (k->dbk.finish)
+        k->dbk.finish (k->dbk.state);
+      if (k->execution_failed)
+        POCL_UPDATE_EVENT_FAILED_MSG (CL_FAILED, k->cmd->sync.event.event,
+                                      "Builtin Kernel        ");
+      else
+        POCL_UPDATE_EVENT_COMPLETE_MSG (k->cmd->sync.event.event,
+                                        "Builtin Kernel        ");
+      POCL_DESTROY_LOCK (k->lock);
+      free_kernel_run_command (k);
+      return;
+    }
+
   pocl_free_kernel_arg_array (k);
 
   pocl_release_dlhandle_cache (k->cmd->command.run.device_data);
@@ -487,18 +648,92 @@ pocl_pthread_prepare_kernel (void *data, _cl_command_node *cmd)
   run_cmd->next = NULL;
   run_cmd->ref_count = 0;
   run_cmd->execution_failed = 0;
+  run_cmd->cmdbuf_exec = NULL;
+  run_cmd->fused_next = NULL;
+  run_cmd->wg_profile = NULL;
   POCL_INIT_LOCK (run_cmd->lock);
 
-  pocl_setup_kernel_arg_array (run_cmd);
-
   pocl_update_event_running (cmd->sync.event.event);
 
-#ifndef ENABLE_HOST_CPU_DEVICES_OPENMP
+  if (pocl_setup_kernel_arg_array (run_cmd) != CL_SUCCESS)
+    {
+      pocl_release_dlhandle_cache (ci);
+      POCL_DESTROY_LOCK (run_cmd->lock);
+      free_kernel_run_command (run_cmd);
+      POCL_UPDATE_EVENT_FAILED_MSG (CL_OUT_OF_HOST_MEMORY,
+                                    cmd->sync.event.event,
+                                    "CPU: failed to allocate the kernel "
+                                    "argument arrays");
+      return NULL;
+    }
+
+#ifdef ENABLE_HOST_CPU_DEVICES_OPENMP
+  /* the thread numbers come from omp_get_thread_num (), the team can be
+   * larger than the CUs if the OpenMP runtime is configured so */
+  unsigned omp_threads = (unsigned)omp_get_max_threads ();
+  run_cmd->wg_profile = pocl_cpu_wg_profile_begin (
+      run_cmd, max (cmd->device->max_compute_units, omp_threads));
+#else
+  run_cmd->wg_profile
+      = pocl_cpu_wg_profile_begin (run_cmd, scheduler.num_threads);
   pthread_scheduler_push_kernel (run_cmd);
 #endif
   return run_cmd;
 }
 
+/* Sets up a DBK launch to be executed in chunks by all the threads (of the
+ * sub-device) like an NDRange kernel. Returns NULL if the DBK has been
+ * completed already, either because it can't be split and was run by the
+ * calling thread, or because it failed. */
+static kernel_run_command *
+pocl_pthread_prepare_dbk (void *data, _cl_command_node *cmd)
+{
+  cl_kernel kernel = cmd->command.run.kernel;
+  cl_program program = kernel->program;
+  pocl_kernel_metadata_t *meta = kernel->meta;
+  cl_uint dev_i = cmd->program_device_i;
+  pocl_cpu_dbk_partition part;
+
+  assert (meta->builtin_kernel_id != 0);
+  pocl_update_event_running (cmd->sync.event.event);
+
+  int err = pocl_cpu_partition_dbk (program, kernel, meta, dev_i,
+                                    cmd->command.run.arguments, &part);
+  if (err == CL_INVALID_OPERATION)
+    err = pocl_cpu_execute_dbk (program, kernel, meta, dev_i,
+                                cmd->command.run.arguments);
+  else if (err == CL_SUCCESS && part.num_chunks > 0)
+    {
+      kernel_run_command *run_cmd = new_kernel_run_command ();
+      run_cmd->data = data;
+      run_cmd->kernel = kernel;
+      run_cmd->device = cmd->device;
+      run_cmd->cmd = cmd;
+      run_cmd->remaining_wgs = part.num_chunks;
+      run_cmd->wgs_dealt = 0;
+      run_cmd->kernel_args = cmd->command.run.arguments;
+      run_cmd->next = NULL;
+      run_cmd->ref_count = 0;
+      run_cmd->execution_failed = 0;
+      run_cmd->cmdbuf_exec = NULL;
+      run_cmd->fused_next = NULL;
+      run_cmd->wg_profile = NULL;
+      run_cmd->dbk = part;
+      POCL_INIT_LOCK (run_cmd->lock);
+      return run_cmd;
+    }
+  else if (part.finish)
+    part.finish (part.state);
+
+  if (err != CL_SUCCESS)
+    POCL_UPDATE_EVENT_FAILED_MSG (CL_FAILED, cmd->sync.event.event,
+                                  "Builtin Kernel        ");
+  else
+    POCL_UPDATE_EVENT_COMPLETE_MSG (cmd->sync.event.event,
+                                    "Builtin Kernel        ");
+  return NULL;
+}
+
 /*
   These two check the entire kernel/cmd queue. This is necessary
   because of commands for subdevices. The old code only checked
@@ -596,6 +831,75 @@ check_kernel_queue_for_device (thread_data *td)
 }
 #endif
 
+#ifndef ENABLE_HOST_CPU_DEVICES_OPENMP
+static void
+pthread_cmdbuf_launch (void *data,
+                       pocl_cpu_cmdbuf_exec *exec,
+                       kernel_run_command **runs,
+                       unsigned num_runs)
+{
+  POCL_LOCK (scheduler.wq_lock_fast);
+  exec->pending = num_runs;
+  for (unsigned i = 0; i < num_runs; ++i)
+    DL_APPEND (scheduler.kernel_queue, runs[i]);
+  POCL_BROADCAST_COND (scheduler.wake_pool);
+  POCL_UNLOCK (scheduler.wq_lock_fast);
+}
+
+/* Instead of sleeping, the replaying thread helps with the kernels
+ * (of this or any other command) until its level has finished. */
+static void
+pthread_cmdbuf_wait (void *data, pocl_cpu_cmdbuf_exec *exec)
+{
+  thread_data *td = (thread_data *)data;
+  kernel_run_command *run_cmd;
+
+  POCL_LOCK (scheduler.wq_lock_fast);
+  while (exec->pending > 0)
+    {
+      run_cmd = check_kernel_queue_for_device (td);
+      if (run_cmd == NULL)
+        {
+          POCL_WAIT_COND (scheduler.wake_pool, scheduler.wq_lock_fast);
+          continue;
+        }
+
+      ++run_cmd->ref_count;
+      POCL_UNLOCK (scheduler.wq_lock_fast);
+
+      work_group_scheduler (run_cmd, td);
+
+      POCL_LOCK (scheduler.wq_lock_fast);
+      if ((--run_cmd->ref_count) == 0)
+        {
+          POCL_UNLOCK (scheduler.wq_lock_fast);
+          finalize_kernel_command (td, run_cmd);
+          POCL_LOCK (scheduler.wq_lock_fast);
+        }
+    }
+  POCL_UNLOCK (scheduler.wq_lock_fast);
+}
+
+#else
+
+/* with OpenMP each kernel is already parallel by itself */
+static void
+pthread_cmdbuf_launch (void *data,
+                       pocl_cpu_cmdbuf_exec *exec,
+                       kernel_run_command **runs,
+                       unsigned num_runs)
+{
+  thread_data *td = (thread_data *)data;
+  for (unsigned i = 0; i < num_runs; ++i)
+    work_group_scheduler (runs[i], td);
+}
+
+static void
+pthread_cmdbuf_wait (void *data, pocl_cpu_cmdbuf_exec *exec)
+{
+}
+#endif
+
 static int
 pthread_scheduler_get_work (thread_data *td)
 {
@@ -637,20 +941,20 @@ RETRY:
 
       if (cmd->type == CL_COMMAND_NDRANGE_KERNEL)
         {
-          cl_kernel kernel = cmd->command.run.kernel;
-          cl_program program = kernel->program;
-          pocl_kernel_metadata_t *meta = kernel->meta;
-          cl_uint dev_i = cmd->program_device_i;
+          cl_program program = cmd->command.run.kernel->program;
           if (program->builtin_kernel_attributes)
             {
-              assert (meta->builtin_kernel_id != 0);
-              pocl_update_event_running (cmd->sync.event.event);
-
-              pocl_cpu_execute_dbk (program, kernel, meta, dev_i,
-                                    cmd->command.run.arguments);
-
-              POCL_UPDATE_EVENT_COMPLETE_MSG (cmd->sync.event.event,
-                                              "Builtin Kernel        ");
+              run_cmd = pocl_pthread_prepare_dbk (cmd->device->data, cmd);
+              if (run_cmd)
+                {
+#ifdef ENABLE_HOST_CPU_DEVICES_OPENMP
+                  work_group_scheduler (run_cmd, td);
+                  finalize_kernel_command (td, run_cmd);
+#else
+                  pthread_scheduler_push_kernel (run_cmd);
+#endif
+                  run_cmd = NULL;
+                }
             }
           else
             {
@@ -667,6 +971,12 @@ RETRY:
 #endif
             }
         }
+      else if (cmd->type == CL_COMMAND_COMMAND_BUFFER_KHR)
+        {
+          pocl_cpu_exec_command_buffer (cmd, td, scheduler.printf_buf_size,
+                                        pthread_cmdbuf_launch,
+                                        pthread_cmdbuf_wait);
+        }
       else
         {
           pocl_exec_command (cmd);
@@ -23,12 +23,16 @@
    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
    IN THE SOFTWARE.
 */
+
+#define _GNU_SOURCE
+
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include <errno.h>
+#include <fcntl.h>
 #include <netdb.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
@@ -446,6 +450,93 @@ connection_init (remote_connection_t *connection,
   return pipe_res;
 }
 
+/* Shared memory data plane */
+
+#define DEFAULT_REMOTE_SHM_SIZE_MB 256
+
+/** Creates the memfd backed region that is shared with a server connected
+ * over a Unix domain socket. The size of the memfd is sealed so that the
+ * server can map it without being exposed to SIGBUS by truncation.
+ * Returns NULL if the shared memory is disabled or unsupported. */
+static remote_shm_region_t *
+remote_shm_create (void)
+{
+#ifdef HAVE_MEMFD_CREATE
+  size_t size = (size_t)pocl_get_int_option ("POCL_REMOTE_SHM_SIZE_MB",
+                                             DEFAULT_REMOTE_SHM_SIZE_MB)
+                << 20;
+  if (size == 0)
+    return NULL;
+
+  int fd = memfd_create ("pocl-remote", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd < 0)
+    {
+      POCL_MSG_WARN ("memfd_create() failed (%s), not using shared memory "
+                     "with the server\n",
+                     strerror (errno));
+      return NULL;
+    }
+  void *base = MAP_FAILED;
+  if (ftruncate (fd, size) == 0
+      && fcntl (fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL)
+             == 0)
+    base = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED)
+    {
+      POCL_MSG_WARN ("Could not set up a %zu MB shared memory region (%s), "
+                     "not using shared memory with the server\n",
+                     size >> 20, strerror (errno));
+      close (fd);
+      return NULL;
+    }
+
+  remote_shm_region_t *shm = calloc (1, sizeof (remote_shm_region_t));
+  shm->fd = fd;
+  shm->base = (char *)base;
+  shm->size = size;
+  pocl_init_mem_region (&shm->allocations, (memory_address_t)base, size);
+  /* The chunks are short-lived, reuse the freed ones first. */
+  shm->allocations.strategy = BALLOCS_TIGHT;
+  return shm;
+#else
+  return NULL;
+#endif
+}
+
+static void
+remote_shm_destroy (remote_shm_region_t *shm)
+{
+  if (shm == NULL)
+    return;
+  munmap (shm->base, shm->size);
+  close (shm->fd);
+  POCL_DESTROY_LOCK (shm->allocations.lock);
+  free (shm);
+}
+
+/** Returns the address in the shared memory region of the server where the
+ * size bytes transferred from/to host_ptr are placed: host_ptr itself if it
+ * points to the region, otherwise a staging chunk owned by netcmd. Returns
+ * NULL if the data must go through the socket. */
+static char *
+remote_shm_transfer_ptr (remote_server_data_t *data, network_command *netcmd,
+                         const void *host_ptr, size_t size)
+{
+  remote_shm_region_t *shm = data->shm;
+  if (shm == NULL || size == 0 || size > shm->size)
+    return NULL;
+
+  const char *p = (const char *)host_ptr;
+  if (p >= shm->base && p + size <= shm->base + shm->size)
+    return (char *)p;
+
+  chunk_info_t *chunk = pocl_alloc_buffer_from_region (&shm->allocations, size);
+  if (chunk == NULL)
+    return NULL;
+  netcmd->shm_chunk = chunk;
+  return (char *)chunk->start_address;
+}
+
 static cl_int
 connection_connect (remote_server_data_t *data,
                     remote_connection_t *connection,
@@ -490,12 +581,15 @@ connection_connect (remote_server_data_t *data,
           ((new_connection.fd = socket (AF_UNIX, SOCK_STREAM, 0)) == -1),
           CL_INVALID_DEVICE, "socket() returned errno: %i\n", errno);
 
-        struct sockaddr_un server;
-        memset (&server, 0, sizeof (server));
-        server.sun_family = AF_UNIX;
-        strncpy (server.sun_path, "/tmp/pocl.socket",
-                 sizeof (server.sun_path) - 1);
-        addrlen = sizeof (server);
+        struct sockaddr_un *server_un = (struct sockaddr_un *)&server;
+        POCL_RETURN_ERROR_ON (
+          (strlen (data->address) >= sizeof (server_un->sun_path)),
+          CL_INVALID_DEVICE, "Unix socket path '%s' is too long\n",
+          data->address);
+        server_un->sun_family = AF_UNIX;
+        strncpy (server_un->sun_path, data->address,
+                 sizeof (server_un->sun_path) - 1);
+        addrlen = sizeof (struct sockaddr_un);
         break;
       }
 
@@ -546,8 +640,26 @@ connection_connect (remote_server_data_t *data,
   memcpy (hs.authkey, data->authkey, AUTHKEY_LENGTH);
   ssize_t readb, writeb;
   uint32_t req_len = request_size (hs.message_type);
-  writeb = connection_write_full (&new_connection, &req_len, sizeof (req_len),
-                                  data);
+  /* A new session gets the shared memory region with the first message */
+  if (data->session == 0 && data->shm != NULL)
+    {
+      assert (connection->domain == TransportDomain_Unix);
+      hs.m.get_session.use_shm = 1;
+      hs.m.get_session.shm_size = data->shm->size;
+      writeb = pocl_send_with_fd (new_connection.fd, &req_len,
+                                  sizeof (req_len), data->shm->fd);
+      POCL_RETURN_ERROR_ON ((writeb <= 0), CL_INVALID_DEVICE,
+                            "sendmsg() returned errno: %i\n", errno);
+      if ((size_t)writeb < sizeof (req_len))
+        writeb = connection_write_full (&new_connection,
+                                        (char *)&req_len + writeb,
+                                        sizeof (req_len) - writeb, data);
+      else
+        writeb = 0;
+    }
+  else
+    writeb = connection_write_full (&new_connection, &req_len,
+                                    sizeof (req_len), data);
   assert ((size_t)(writeb) == 0);
   writeb = connection_write_full (&new_connection, &hs, req_len, data);
   assert ((size_t)(writeb) == 0);
@@ -704,6 +816,12 @@ finish_running_cmd (network_command *running_cmd,
    * expected to be completed at some point and it may or may not get
    * completed. This can cause deadlock and needs to handled. */
 
+  if (running_cmd->shm_chunk)
+    {
+      pocl_free_chunk (running_cmd->shm_chunk);
+      running_cmd->shm_chunk = NULL;
+    }
+
   running_cmd->status = status;
   if (status == NETCMD_FAILED)
     {
@@ -1036,10 +1154,21 @@ pocl_remote_reader_pthread (void *aa)
                 = running_cmd->rep_extra_data + running_cmd->rep_extra_size;
             }
           running_cmd->rep_extra_size = running_cmd->reply.data_size;
-          readb
-            = connection_read_full (connection, running_cmd->rep_extra_data,
-                                    running_cmd->reply.data_size, remote);
-          CHECK_READ (readb);
+          if (running_cmd->rep_shm_data)
+            {
+              /* The server wrote the data to the shared memory region */
+              if (running_cmd->rep_shm_data != running_cmd->rep_extra_data)
+                memcpy (running_cmd->rep_extra_data, running_cmd->rep_shm_data,
+                        running_cmd->reply.data_size);
+            }
+          else
+            {
+              readb = connection_read_full (connection,
+                                            running_cmd->rep_extra_data,
+                                            running_cmd->reply.data_size,
+                                            remote);
+              CHECK_READ (readb);
+            }
         }
       POCL_LOCK (inflight->mutex);
       DL_DELETE (inflight->queue, running_cmd);
@@ -1701,6 +1830,8 @@ find_or_create_server (const char *address_with_port, unsigned port,
    * port */
   if (address_with_port[0] == '/')
     {
+      /* The address is the path of the socket */
+      strncpy (d->address, address_with_port, MAX_ADDRESS_SIZE - 1);
       d->fast_connection.domain = TransportDomain_Unix;
       d->slow_connection.domain = TransportDomain_Unix;
     }
@@ -1755,15 +1886,30 @@ find_or_create_server (const char *address_with_port, unsigned port,
     }
 #endif
 
+  if (d->fast_connection.domain == TransportDomain_Unix)
+    d->shm = remote_shm_create ();
+
   ReplyMsg_t hsr;
   if (connection_connect (d, &d->fast_connection, d->fast_port,
                           NETWORK_BUF_SIZE_FAST, &hsr))
     {
       POCL_MSG_ERR ("Could not connect to server\n");
+      remote_shm_destroy (d->shm);
       POCL_MEM_FREE (d);
       return NULL;
     }
 
+  if (d->shm != NULL && !hsr.m.get_session.use_shm)
+    {
+      POCL_MSG_PRINT_REMOTE ("Server did not map the shared memory region\n");
+      remote_shm_destroy (d->shm);
+      d->shm = NULL;
+    }
+  else if (d->shm != NULL)
+    POCL_MSG_PRINT_REMOTE ("Using a %zu MB shared memory region for buffer "
+                           "transfers\n",
+                           d->shm->size >> 20);
+
   memcpy (d->authkey, hsr.m.get_session.authkey, AUTHKEY_LENGTH);
   d->session = hsr.m.get_session.session;
 
@@ -1781,6 +1927,7 @@ find_or_create_server (const char *address_with_port, unsigned port,
                           NETWORK_BUF_SIZE_SLOW, NULL))
     {
       POCL_MSG_ERR ("Could not connect to server\n");
+      remote_shm_destroy (d->shm);
       POCL_MEM_FREE (d);
       return NULL;
     }
@@ -1984,6 +2131,9 @@ release_server (remote_server_data_t *d)
   connection_disconnect (&d->slow_connection);
   connection_release (&d->slow_connection);
 
+  remote_shm_destroy (d->shm);
+  d->shm = NULL;
+
 #ifdef ENABLE_RDMA
   rdma_uninitialize (&d->rdma_data);
 #endif
@@ -1995,8 +2145,27 @@ pocl_network_init_device (cl_device_id device, remote_device_data_t *ddata,
 {
 
   char *tmp = strdup (parameters);
+  remote_server_data_t *data = NULL;
 
   uint32_t did = 0;
+  if (tmp[0] == '/')
+    {
+      /* Unix domain socket: <socket path>[/<device id>][#<peer address>] */
+      char *hash = strchr (tmp, '#');
+      if (hash)
+        *hash = 0;
+      char *last_slash = strrchr (tmp, '/');
+      if (last_slash != tmp && last_slash[1] != 0
+          && strspn (last_slash + 1, "0123456789") == strlen (last_slash + 1))
+        {
+          did = (uint32_t)atoi (last_slash + 1);
+          *last_slash = 0;
+        }
+      data = find_or_create_server (tmp, 0, ddata, device, parameters);
+      POCL_MEM_FREE (tmp);
+      goto SERVER_FOUND;
+    }
+
   if (strchr (tmp, '/') != NULL)
     {
       /* determine device ID from parameters */
@@ -2048,10 +2217,11 @@ pocl_network_init_device (cl_device_id device, remote_device_data_t *ddata,
   snprintf (address_with_guaranteed_port, MAX_ADDRESS_PORT_SIZE, "%s:%d",
             address, port);
 
-  remote_server_data_t *data = find_or_create_server (
-      address_with_guaranteed_port, port, ddata, device, parameters);
+  data = find_or_create_server (address_with_guaranteed_port, port, ddata,
+                                device, parameters);
   POCL_MEM_FREE (tmp);
 
+SERVER_FOUND:
   POCL_RETURN_ERROR_ON ((data == NULL), CL_INVALID_DEVICE,
                         "Could not connect to server \n");
   POCL_RETURN_ERROR_ON ((did >= data->num_devices), CL_INVALID_DEVICE,
@@ -3161,6 +3331,14 @@ pocl_network_read (uint32_t cq_id, remote_device_data_t *ddata,
   netcmd->rep_extra_data = host_ptr;
   netcmd->rep_extra_size = size;
 
+  char *shm_ptr = remote_shm_transfer_ptr (data, netcmd, host_ptr, size);
+  if (shm_ptr)
+    {
+      req->m.read.use_shm = 1;
+      req->m.read.shm_offset = shm_ptr - data->shm->base;
+      netcmd->rep_shm_data = shm_ptr;
+    }
+
   TP_READ_BUFFER (req->msg_id, ddata->local_did, cq_id,
                   node->sync.event.event->id);
 
@@ -3188,13 +3366,25 @@ pocl_network_write (uint32_t cq_id, remote_device_data_t *ddata,
   if (is_svm)
     req->obj_id = (uint64_t)host_ptr + ddata->svm_region_offset;
 
+  TP_WRITE_BUFFER (req->msg_id, ddata->local_did, cq_id,
+                   node->sync.event.event->id);
+
+  char *shm_ptr = remote_shm_transfer_ptr (data, netcmd, host_ptr, size);
+  if (shm_ptr)
+    {
+      if (shm_ptr != host_ptr)
+        memcpy (shm_ptr, host_ptr, size);
+      req->m.write.use_shm = 1;
+      req->m.write.shm_offset = shm_ptr - data->shm->base;
+      /* No payload follows the message, send it with the small commands. */
+      SEND_REQ_FAST;
+      return 0;
+    }
+
   /* REQUEST */
   netcmd->req_extra_data = host_ptr;
   netcmd->req_extra_size = size;
 
-  TP_WRITE_BUFFER (req->msg_id, ddata->local_did, cq_id,
-                   node->sync.event.event->id);
-
 #ifdef ENABLE_RDMA
   if (data->use_rdma)
     {
@@ -3427,37 +3617,108 @@ pocl_network_run_kernel (uint32_t cq_id, remote_device_data_t *ddata,
   req->m.run_kernel.offset = offset;
   req->m.run_kernel.has_local = 1;
   req->m.run_kernel.dim = dim;
-  req->m.run_kernel.has_new_args = (uint8_t)requires_kernarg_update;
+  req->m.run_kernel.has_new_args = RUN_KERNEL_ARGS_UNCHANGED;
 
   if (requires_kernarg_update)
     {
-      req->m.run_kernel.args_num = kernel_md->num_args;
-      req->m.run_kernel.pod_arg_size = kd->pod_total_size;
+      size_t num_args = kernel_md->num_args;
+      size_t changed = 0, changed_pod_size = 0;
+      for (size_t i = 0; i < num_args; ++i)
+        {
+          if (!kd->arg_changed[i])
+            continue;
+          ++changed;
+          if (kernel_md->arg_info[i].type == POCL_ARG_TYPE_NONE
+              && !ARG_IS_LOCAL (kernel_md->arg_info[i]))
+            changed_pod_size += kd->arg_array[i];
+        }
 
-      /* Push the arguments as extra data, as well as an array of
-         flags which inform whether an argument (buffer) is an
-         SVM pointer or not. */
-      netcmd->req_extra_size
-          = (kernel_md->num_args * sizeof (uint64_t))
-            + (kernel_md->num_args * sizeof (unsigned char));
-      if (netcmd->req_extra_size != 0)
+      size_t all_size = num_args * (sizeof (uint64_t) + sizeof (uint8_t))
+                        + kd->pod_total_size;
+      size_t delta_size
+          = changed
+                * (sizeof (uint64_t) + sizeof (uint32_t) + sizeof (uint8_t))
+            + changed_pod_size;
+
+      if (kd->args_sent && delta_size < all_size)
         {
-          netcmd->req_extra_data = malloc (netcmd->req_extra_size);
-          unsigned char *ptr_is_svm_pos
-              = (void *)netcmd->req_extra_data
-                + kernel_md->num_args * sizeof (uint64_t);
-          memcpy ((void *)netcmd->req_extra_data, kd->arg_array,
-                  kernel_md->num_args * sizeof (uint64_t));
-          memcpy (ptr_is_svm_pos, kd->ptr_is_svm,
-                  kernel_md->num_args * sizeof (unsigned char));
+          /* The server still holds the previous arguments of the kernel,
+             send only the ones that changed since. */
+          req->m.run_kernel.has_new_args = RUN_KERNEL_ARGS_CHANGED;
+          req->m.run_kernel.args_num = changed;
+          req->m.run_kernel.pod_arg_size = changed_pod_size;
+          netcmd->req_extra_size = delta_size - changed_pod_size;
+          if (changed != 0)
+            {
+              netcmd->req_extra_data = malloc (netcmd->req_extra_size);
+              uint64_t *values = (uint64_t *)netcmd->req_extra_data;
+              uint32_t *indices = (uint32_t *)(values + changed);
+              uint8_t *is_svm = (uint8_t *)(indices + changed);
+              char *pod = NULL;
+              if (changed_pod_size != 0)
+                {
+                  netcmd->req_extra_size2 = changed_pod_size;
+                  netcmd->req_extra_data2 = malloc (changed_pod_size);
+                  pod = (char *)netcmd->req_extra_data2;
+                }
+              const char *pod_src = kd->pod_arg_storage;
+              size_t j = 0;
+              for (size_t i = 0; i < num_args; ++i)
+                {
+                  int is_pod
+                      = kernel_md->arg_info[i].type == POCL_ARG_TYPE_NONE
+                        && !ARG_IS_LOCAL (kernel_md->arg_info[i]);
+                  if (kd->arg_changed[i])
+                    {
+                      values[j] = kd->arg_array[i];
+                      indices[j] = (uint32_t)i;
+                      is_svm[j] = kd->ptr_is_svm[i];
+                      ++j;
+                      if (is_pod)
+                        {
+                          memcpy (pod, pod_src, kd->arg_array[i]);
+                          pod += kd->arg_array[i];
+                        }
+                    }
+                  if (is_pod)
+                    pod_src += kd->arg_array[i];
+                }
+              assert (j == changed);
+            }
         }
-      netcmd->req_extra_size2 = kd->pod_total_size;
-      if (netcmd->req_extra_size2 != 0)
+      else
         {
-          netcmd->req_extra_data2 = malloc (netcmd->req_extra_size2);
-          memcpy ((void *)netcmd->req_extra_data2, kd->pod_arg_storage,
-                  netcmd->req_extra_size2);
+          req->m.run_kernel.has_new_args = RUN_KERNEL_ARGS_ALL;
+          req->m.run_kernel.args_num = num_args;
+          req->m.run_kernel.pod_arg_size = kd->pod_total_size;
+
+          /* Push the arguments as extra data, as well as an array of
+             flags which inform whether an argument (buffer) is an
+             SVM pointer or not. */
+          netcmd->req_extra_size
+              = (num_args * sizeof (uint64_t))
+                + (num_args * sizeof (unsigned char));
+          if (netcmd->req_extra_size != 0)
+            {
+              netcmd->req_extra_data = malloc (netcmd->req_extra_size);
+              unsigned char *ptr_is_svm_pos
+                  = (void *)netcmd->req_extra_data
+                    + num_args * sizeof (uint64_t);
+              memcpy ((void *)netcmd->req_extra_data, kd->arg_array,
+                      num_args * sizeof (uint64_t));
+              memcpy (ptr_is_svm_pos, kd->ptr_is_svm,
+                      num_args * sizeof (unsigned char));
+            }
+          netcmd->req_extra_size2 = kd->pod_total_size;
+          if (netcmd->req_extra_size2 != 0)
+            {
+              netcmd->req_extra_data2 = malloc (netcmd->req_extra_size2);
+              memcpy ((void *)netcmd->req_extra_data2, kd->pod_arg_storage,
+                      netcmd->req_extra_size2);
+            }
+          kd->args_sent = 1;
         }
+      memset (kd->arg_changed, 0, num_args);
     }
 
   TP_NDRANGE_KERNEL (req->msg_id, ddata->local_did, cq_id,
@@ -27,6 +27,7 @@
 #ifndef POCL_REMOTE_COMMUNICATION_H
 #define POCL_REMOTE_COMMUNICATION_H
 
+#include "bufalloc.h"
 #include "messages.h"
 #include "pocl.h"
 #include "pocl_networking.h"
@@ -167,6 +168,12 @@ struct network_command
 #ifdef ENABLE_RDMA
   struct ibv_mr *rdma_region;
 #endif
+  /* Staging chunk of the transferred data in the shared memory region of
+     the server, released when the command finishes. */
+  chunk_info_t *shm_chunk;
+  /* If set, the reply data is at this address of the shared memory region
+     instead of following the reply. */
+  char *rep_shm_data;
 
   union
   {
@@ -207,6 +214,18 @@ typedef struct remote_connection_s
   sync_t discovery_reconnect_guard;
 } remote_connection_t;
 
+/** A memfd backed memory region shared with a server on the same host, whose
+ * fd is passed to it over the Unix domain socket at session creation. The
+ * buffer reads and writes place their data in chunks allocated from it and
+ * send only their offsets. */
+typedef struct remote_shm_region_s
+{
+  int fd;
+  char *base;
+  size_t size;
+  memory_region_t allocations;
+} remote_shm_region_t;
+
 #define INITIAL_ARRAY_CAP 1024
 
 /* in nanoseconds */
@@ -241,6 +260,9 @@ typedef struct remote_server_data_s
   /** Connection optimized for low latency with small messages, used for
    * commands that are not expected to carry large amounts of data */
   remote_connection_t fast_connection;
+  /** Shared memory data plane of Unix domain socket connections, NULL if it
+   * is not used */
+  remote_shm_region_t *shm;
 
   uint32_t num_platforms;
   uint32_t num_devices;
@@ -332,6 +354,12 @@ typedef struct kernel_data_s
   uint64_t *arg_array;
   /* Per-arg flag set to 1 if the pointer set as a raw SVM pointer. */
   unsigned char *ptr_is_svm;
+  /* Per-arg flag set to 1 if the argument changed since the last launch
+     that sent its arguments to the server. */
+  unsigned char *arg_changed;
+  /* Set to 1 once the server holds the full argument array of this kernel
+     for the device, so later launches can send only the changed ones. */
+  int args_sent;
 } kernel_data_t;
 
 typedef struct program_data_s
@@ -1416,6 +1416,7 @@ pocl_remote_create_kernel (cl_device_id device, cl_program program,
 
   kd->arg_array = calloc ((kernel->meta->num_args), sizeof (uint64_t));
   kd->ptr_is_svm = calloc ((kernel->meta->num_args), sizeof (unsigned char));
+  kd->arg_changed = calloc ((kernel->meta->num_args), sizeof (unsigned char));
 
   return pocl_network_create_kernel (device->data, kernel->name, prog_id,
                                      kern_id, kd);
@@ -1440,6 +1441,7 @@ pocl_remote_free_kernel (cl_device_id device, cl_program program,
 
   POCL_MEM_FREE (kd->arg_array);
   POCL_MEM_FREE (kd->ptr_is_svm);
+  POCL_MEM_FREE (kd->arg_changed);
   POCL_MEM_FREE (kd->pod_arg_storage);
   POCL_MEM_FREE (kd);
   kernel->data[device_i] = NULL;
@@ -1752,26 +1754,37 @@ prepare_kernel_args (cl_device_id device,
   uint64_t *arg_array = kd->arg_array;
   unsigned char *ptr_is_svm = kd->ptr_is_svm;
 
+  unsigned char *arg_changed = kd->arg_changed;
+
+  if (!kd->args_sent)
+    *requires_kernarg_update = 1;
+
   /* Process the kernel arguments.  */
   for (unsigned i = 0; i < kernel_md->num_args; ++i)
     {
+      unsigned char was_svm = ptr_is_svm[i];
       ptr_is_svm[i] = 0;
       al = &(dynamic_args[i]);
       assert (al->is_set > 0);
       if (ARG_IS_LOCAL (kernel_md->arg_info[i]))
         {
           *requires_kernarg_update = 1;
+          if (arg_array[i] != al->size)
+            arg_changed[i] = 1;
           arg_array[i] = al->size;
         }
       else if (al->is_raw_ptr)
         {
-          arg_array[i] = (uint64_t) * (void **)al->value;
+          uint64_t svm_ptr = (uint64_t) * (void **)al->value;
           POCL_MSG_PRINT_MEMORY (
             "Adding SVM pool offset %zu to an SVM ptr arg %u (%p to %p)\n",
-            ddata->svm_region_offset, i, (void *)arg_array[i],
-            (char *)arg_array[i] + ddata->svm_region_offset);
-          arg_array[i] = arg_array[i] + ddata->svm_region_offset;
+            ddata->svm_region_offset, i, (void *)svm_ptr,
+            (char *)svm_ptr + ddata->svm_region_offset);
+          svm_ptr += ddata->svm_region_offset;
           *requires_kernarg_update = 1;
+          if (arg_array[i] != svm_ptr || !was_svm)
+            arg_changed[i] = 1;
+          arg_array[i] = svm_ptr;
           ptr_is_svm[i] = 1;
         }
       else if ((kernel_md->arg_info[i].type == POCL_ARG_TYPE_POINTER)
@@ -1792,9 +1805,10 @@ prepare_kernel_args (cl_device_id device,
                              kernel->name, i, kernel_md->arg_info[i].name);
             }
 
-          if (arg_array[i] != mem_id)
+          if (arg_array[i] != mem_id || was_svm)
             {
               *requires_kernarg_update = 1;
+              arg_changed[i] = 1;
               arg_array[i] = mem_id;
             }
         }
@@ -1805,6 +1819,7 @@ prepare_kernel_args (cl_device_id device,
           if (arg_array[i] != remote_id)
             {
               *requires_kernarg_update = 1;
+              arg_changed[i] = 1;
               arg_array[i] = remote_id;
             }
         }
@@ -1815,6 +1830,7 @@ prepare_kernel_args (cl_device_id device,
           if (memcmp (pod_arg_pointer, al->value, al->size) != 0)
             {
               *requires_kernarg_update = 1;
+              arg_changed[i] = 1;
               memcpy (pod_arg_pointer, al->value, al->size);
               assert (pod_arg_pointer
                       <= (kd->pod_arg_storage + kd->pod_total_size));
@@ -2019,6 +2035,9 @@ copy_deferred_command (char *buf,
             prepare_kernel_args (queue_dev, kernel, kd,
                                  node->command.run.arguments,
                                  &requires_kernarg_update);
+            /* The server sets the kernel's arguments to these for the
+               command buffer, so the next launch must send them all. */
+            kd->args_sent = 0;
 
             extra_data = malloc (extra_size);
             unsigned char *ptr_is_svm_pos
@@ -2786,9 +2805,19 @@ remote_start_command (remote_device_data_t *d, _cl_command_node *node)
               }
             else
               {
+                /* A single request per command, so only the bounding span
+                 * of the dirty ranges. */
+                size_t offset = 0, size = m->size;
+                pocl_interval_set *ranges = &cmd->migrate.ranges;
+                if (ranges->num > 0)
+                  {
+                    offset = ranges->start[0];
+                    size = ranges->end[ranges->num - 1] - offset;
+                  }
                 r = pocl_remote_async_read (
-                  d, node, m->mem_host_ptr,
-                  &m->device_ptrs[node->device->global_mem_id], m, 0, m->size);
+                  d, node, (char *)m->mem_host_ptr + offset,
+                  &m->device_ptrs[node->device->global_mem_id], m, offset,
+                  size);
               }
             assert (r == 0);
             break;
@@ -2813,10 +2842,17 @@ remote_start_command (remote_device_data_t *d, _cl_command_node *node)
               }
             else
               {
+                size_t offset = 0, size = cmd->migrate.migration_size;
+                pocl_interval_set *ranges = &cmd->migrate.ranges;
+                if (ranges->num > 0)
+                  {
+                    offset = ranges->start[0];
+                    size = ranges->end[ranges->num - 1] - offset;
+                  }
                 r = pocl_remote_async_write (
-                  d, node, m->mem_host_ptr,
-                  &m->device_ptrs[node->device->global_mem_id], m, 0,
-                  cmd->migrate.migration_size);
+                  d, node, (char *)m->mem_host_ptr + offset,
+                  &m->device_ptrs[node->device->global_mem_id], m, offset,
+                  size);
               }
             assert (r == 0);
             break;
@@ -1060,6 +1060,69 @@ bool parseSPIRV(const int32_t *Stream, size_t NumWords,
   return Mod.fillModuleInfo(Output);
 }
 
+SPIRV_PARSER_EXPORT
+bool getSpecConstants(const int32_t *Stream, size_t NumWords,
+                      std::vector<SpecConstInfo> &SpecConsts) {
+  SpecConsts.clear();
+  // Only the magic number is checked, the instructions this looks at are the
+  // same in all SPIR-V versions.
+  if (NumWords < 5 || Stream[0] != spv::MagicNumber) {
+    logError("SPIR-V parser: not a SPIR-V module.\n");
+    return false;
+  }
+  Stream += 5;
+  NumWords -= 5;
+
+  std::map<int32_t, uint32_t> SpecIDs;   // result ID -> SpecId
+  std::map<int32_t, uint32_t> TypeSizes; // type ID -> size in bytes
+  std::vector<std::pair<int32_t, int32_t>> Consts; // result ID, type ID
+  while (NumWords > 0) {
+    size_t WordCount = (uint32_t)Stream[0] >> 16;
+    spv::Op Opcode = (spv::Op)(Stream[0] & 0xFFFF);
+    if (WordCount == 0 || WordCount > NumWords) {
+      logError("SPIR-V parser: invalid instruction size\n");
+      return false;
+    }
+    switch (Opcode) {
+    case spv::Op::OpDecorate:
+      if (WordCount >= 4 && Stream[2] == (int32_t)spv::Decoration::SpecId)
+        SpecIDs[Stream[1]] = Stream[3];
+      break;
+    case spv::Op::OpTypeBool:
+      TypeSizes[Stream[1]] = 1;
+      break;
+    case spv::Op::OpTypeInt:
+    case spv::Op::OpTypeFloat:
+      if (WordCount >= 3)
+        TypeSizes[Stream[1]] = (uint32_t)Stream[2] / 8;
+      break;
+    case spv::Op::OpSpecConstantTrue:
+    case spv::Op::OpSpecConstantFalse:
+    case spv::Op::OpSpecConstant:
+      if (WordCount >= 3)
+        Consts.emplace_back(Stream[2], Stream[1]);
+      break;
+    default:
+      break;
+    }
+    Stream += WordCount;
+    NumWords -= WordCount;
+  }
+
+  for (const auto &C : Consts) {
+    auto ID = SpecIDs.find(C.first);
+    if (ID == SpecIDs.end())
+      continue;
+    auto Size = TypeSizes.find(C.second);
+    if (Size == TypeSizes.end()) {
+      logError("SPIR-V parser: unknown spec constant type\n");
+      return false;
+    }
+    SpecConsts.push_back({ID->second, Size->second});
+  }
+  return true;
+}
+
 SPIRV_PARSER_EXPORT
 bool applyAtomicCmpXchgWorkaround(const int32_t *InStream, size_t NumWords,
                                   std::vector<uint8_t> &OutStream) {
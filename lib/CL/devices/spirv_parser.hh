@@ -103,6 +103,17 @@ SPIRV_PARSER_EXPORT
 bool parseSPIRV(const int32_t *Stream, size_t NumWords,
                 OpenCLFunctionInfoMap &FuncInfoMap);
 
+struct SpecConstInfo {
+  uint32_t ID;
+  uint32_t Size;
+};
+
+// Finds the scalar specialization constants (OpSpecConstant{,True,False}
+// decorated with SpecId) of the module, in their declaration order.
+SPIRV_PARSER_EXPORT
+bool getSpecConstants(const int32_t *Stream, size_t NumWords,
+                      std::vector<SpecConstInfo> &SpecConsts);
+
 SPIRV_PARSER_EXPORT
 bool applyAtomicCmpXchgWorkaround(const int32_t *InStream, size_t NumWords,
                                   std::vector<uint8_t> &OutStream);
@@ -42,6 +42,7 @@
 #include "common.h"
 #include "common_utils.h"
 #include "config.h"
+#include "cpu_wg_profiling.h"
 #include "devices.h"
 #include "pocl_mem_management.h"
 #include "pocl_util.h"
@@ -142,6 +143,9 @@ cl_int pocl_tbb_init(unsigned j, cl_device_id device, const char *parameters) {
   pocl_init_kernel_run_command_manager();
   tbb_scheduler_init(device);
 
+  /* command buffers are replayed by the scheduler from prepared graphs */
+  device->native_command_buffers = CL_TRUE;
+
   POCL_MSG_PRINT_INFO ("TBB device %u initialized\n", j);
   device->available = &tbb_available;
   return err;
@@ -170,6 +174,8 @@ tbb_scheduler_init (cl_device_id device)
 
   POCL_INIT_COND (dd->wake_meta_thread);
 
+  pocl_cpu_wg_profiling_init ();
+
   dd->printf_buf_size = device->printf_buffer_size;
   assert (device->printf_buffer_size > 0);
 
@@ -27,6 +27,7 @@
 #endif
 
 #include <algorithm>
+#include <atomic>
 #include <pthread.h>
 #include <string.h>
 #include <unistd.h>
@@ -34,6 +35,7 @@
 // required for older versions of TBB
 #define TBB_PREVIEW_NUMA_SUPPORT 1
 
+#include <tbb/blocked_range.h>
 #include <tbb/blocked_range3d.h>
 #include <tbb/parallel_for.h>
 #include <tbb/partitioner.h>
@@ -42,10 +44,13 @@
 #include "common.h"
 #include "common_driver.h"
 #include "common_utils.h"
+#include "cpu_cmdbuf.h"
+#include "cpu_wg_profiling.h"
 #include "pocl_builtin_kernels.h"
 #include "pocl_cl.h"
 #include "pocl_mem_management.h"
 #include "pocl_runtime_config.h"
+#include "pocl_timing.h"
 #include "pocl_util.h"
 #include "tbb_scheduler.h"
 #include "utlist.h"
@@ -124,30 +129,59 @@ public:
     assert(PC.printf_buffer_capacity > 0);
     assert(PC.printf_buffer_position != NULL);
 
+    std::vector<char> FusedState(pocl_cpu_fused_state_size(K));
+    pocl_cpu_fused_wg *Fused =
+        reinterpret_cast<pocl_cpu_fused_wg *>(FusedState.data());
+    unsigned NumFused = pocl_cpu_fused_setup(K, Fused, LocalMem,
+                                             SchedData->local_mem_size, &PC);
+
     pocl_cpu_setup_rm_and_ftz(RunCmd->device, K->kernel->program);
 
+    // Each body run is a chunk of the WG profile; TBB doesn't expose the
+    // steals, but the chunks of a thread show how the partitioner split
+    // the range and who ended up running the pieces.
+    pocl_cpu_wg_profile *Prof =
+        reinterpret_cast<pocl_cpu_wg_profile *>(K->wg_profile);
+    uint64_t ChunkStart = Prof ? pocl_gettimemono_ns() : 0;
+
     for (size_t X = r.pages().begin(); X != r.pages().end(); X++) {
       for (size_t Y = r.rows().begin(); Y != r.rows().end(); Y++) {
         for (size_t Z = r.cols().begin(); Z != r.cols().end(); Z++) {
           K->workgroup((uint8_t *)Arguments.data(), (uint8_t *)&PC, X, Y, Z);
           ExecutionFailed |= PC.execution_failed;
+          if (NumFused)
+            ExecutionFailed |=
+                pocl_cpu_fused_run_wg(Fused, NumFused, X, Y, Z);
         }
       }
     }
     POCL_ATOMIC_OR(RunCmd->execution_failed, ExecutionFailed);
 
+    if (Prof) {
+      size_t RowSize = K->pc.num_groups[0];
+      size_t SliceSize = RowSize * K->pc.num_groups[1];
+      uint64_t FirstWG = r.cols().begin() * SliceSize +
+                         r.rows().begin() * RowSize + r.pages().begin();
+      pocl_cpu_wg_profile_chunk(Prof, CurThreadID, FirstWG,
+                                r.pages().size() * r.rows().size() *
+                                    r.cols().size(),
+                                ChunkStart, pocl_gettimemono_ns());
+    }
+
 #ifndef ENABLE_PRINTF_IMMEDIATE_FLUSH
     pocl_write_printf_buffer((char *)PC.printf_buffer, Position);
 #endif
 
     pocl_free_kernel_arg_array_with_locals(Arguments.data(), Arguments2.data(),
                                            K);
+    pocl_cpu_fused_teardown(Fused, NumFused);
   }
   WorkGroupScheduler(kernel_run_command *K, const pocl_tbb_scheduler_data *D)
       : RunCmd(K), SchedData(D) {}
 };
 
 static void finalizeKernelCommand(kernel_run_command *RunCmd) {
+  pocl_cpu_wg_profile_end(RunCmd);
   pocl_free_kernel_arg_array(RunCmd);
 
   pocl_release_dlhandle_cache(RunCmd->cmd->command.run.device_data);
@@ -220,16 +254,47 @@ prepareKernelCommand(pocl_tbb_scheduler_data *SchedData,
   RunCmd->next = NULL;
   RunCmd->ref_count = 0;
   RunCmd->execution_failed = 0;
-
-  pocl_setup_kernel_arg_array(RunCmd);
+  RunCmd->cmdbuf_exec = NULL;
+  RunCmd->fused_next = NULL;
 
   pocl_update_event_running(Cmd->sync.event.event);
 
+  if (pocl_setup_kernel_arg_array(RunCmd) != CL_SUCCESS) {
+    pocl_release_dlhandle_cache(ci);
+    free_kernel_run_command(RunCmd);
+    POCL_UPDATE_EVENT_FAILED_MSG(CL_OUT_OF_HOST_MEMORY, Cmd->sync.event.event,
+                                 "CPU: failed to allocate the kernel "
+                                 "argument arrays");
+    return NULL;
+  }
+  RunCmd->wg_profile =
+      pocl_cpu_wg_profile_begin(RunCmd, SchedData->num_tbb_threads);
+
   return RunCmd;
 }
 
+/* Runs the chunks of a split DBK launch in parallel. Returns false if any
+ * of them failed. */
+static bool runDBKChunks(pocl_cpu_dbk_partition &Part) {
+  std::atomic<bool> Failed(false);
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, Part.num_chunks),
+                    [&Part, &Failed](const tbb::blocked_range<size_t> &R) {
+                      if (Part.run(Part.state, R.begin(), R.size()) !=
+                          CL_SUCCESS)
+                        Failed = true;
+                    });
+  return !Failed;
+}
+
 static void execCommand(pocl_tbb_scheduler_data *SchedData,
                         kernel_run_command *RunCmd) {
+  /* a DBK of a command buffer level */
+  if (RunCmd->dbk.run) {
+    if (!runDBKChunks(RunCmd->dbk))
+      RunCmd->execution_failed = 1;
+    return;
+  }
+
   /* Note: Grain size variation could be allowed for each dimension
    * individually. */
   if (SchedData->grain_size) {
@@ -314,6 +379,62 @@ static void execCommand(pocl_tbb_scheduler_data *SchedData,
   }
 }
 
+/* Executes a DBK launch, in parallel over its chunks if the DBK can be split
+ * (see pocl_cpu_partition_dbk ()). */
+static void execDBKCommand(pocl_tbb_scheduler_data *SchedData,
+                           _cl_command_node *Cmd) {
+  cl_kernel Kernel = Cmd->command.run.kernel;
+  cl_program Program = Kernel->program;
+  pocl_kernel_metadata_t *Meta = Kernel->meta;
+  cl_uint DevI = Cmd->program_device_i;
+  TBBArena *TBBA = SchedData->tbb_arena;
+  pocl_cpu_dbk_partition Part;
+
+  pocl_update_event_running(Cmd->sync.event.event);
+
+  int Err = pocl_cpu_partition_dbk(Program, Kernel, Meta, DevI,
+                                   Cmd->command.run.arguments, &Part);
+  if (Err == CL_INVALID_OPERATION) {
+    TBBA->Arena.execute([&]() {
+      Err = pocl_cpu_execute_dbk(Program, Kernel, Meta, DevI,
+                                 Cmd->command.run.arguments);
+    });
+  } else if (Err == CL_SUCCESS) {
+    TBBA->Arena.execute([&Part, &Err]() {
+      if (!runDBKChunks(Part))
+        Err = CL_FAILED;
+    });
+  }
+  if (Part.finish)
+    Part.finish(Part.state);
+
+  if (Err != CL_SUCCESS)
+    POCL_UPDATE_EVENT_FAILED_MSG(CL_FAILED, Cmd->sync.event.event,
+                                 "Builtin Kernel        ");
+  else
+    POCL_UPDATE_EVENT_COMPLETE_MSG(Cmd->sync.event.event,
+                                   "Builtin Kernel        ");
+}
+
+/* The kernels of a command buffer level are independent of each other, so
+ * they're run as one parallel_for, each nesting its own WG parallel_for. */
+static void cmdbufLaunch(void *Data, pocl_cpu_cmdbuf_exec *Exec,
+                         kernel_run_command **Runs, unsigned NumRuns) {
+  pocl_tbb_scheduler_data *SchedData = (pocl_tbb_scheduler_data *)Data;
+  TBBArena *TBBA = SchedData->tbb_arena;
+  TBBA->Arena.execute([SchedData, Runs, NumRuns]() {
+    if (NumRuns == 1) {
+      execCommand(SchedData, Runs[0]);
+      return;
+    }
+    tbb::parallel_for(0u, NumRuns, [SchedData, Runs](unsigned I) {
+      execCommand(SchedData, Runs[I]);
+    });
+  });
+}
+
+static void cmdbufWait(void *Data, pocl_cpu_cmdbuf_exec *Exec) {}
+
 static int runSingleCommand(pocl_tbb_scheduler_data *SchedData) {
   _cl_command_node *Cmd;
   kernel_run_command *RunCmd;
@@ -333,7 +454,10 @@ RETRY:
 
     assert(pocl_command_is_ready(Cmd->sync.event.event));
 
-    if (Cmd->type == CL_COMMAND_NDRANGE_KERNEL) {
+    if (Cmd->type == CL_COMMAND_NDRANGE_KERNEL &&
+        Cmd->command.run.kernel->program->builtin_kernel_attributes) {
+      execDBKCommand(SchedData, Cmd);
+    } else if (Cmd->type == CL_COMMAND_NDRANGE_KERNEL) {
       assert((void *)SchedData == (void *)Cmd->device->data);
       RunCmd = prepareKernelCommand(SchedData, Cmd);
       if (RunCmd) {
@@ -341,6 +465,9 @@ RETRY:
             [RunCmd, SchedData]() { execCommand(SchedData, RunCmd); });
         finalizeKernelCommand(RunCmd);
       }
+    } else if (Cmd->type == CL_COMMAND_COMMAND_BUFFER_KHR) {
+      pocl_cpu_exec_command_buffer(Cmd, SchedData, SchedData->printf_buf_size,
+                                   cmdbufLaunch, cmdbufWait);
     } else {
       TBBA->Arena.execute([Cmd]() { pocl_exec_command(Cmd); });
     }
@@ -116,6 +116,11 @@
 #define MAX_BUF_DESCRIPTORS 4096
 #define MAX_UBO_DESCRIPTORS 1024
 #define MAX_DESC_SETS 1024
+/* max vkCmdDispatch calls recorded into a command buffer before submitting */
+#define MAX_CB_DISPATCHES 2048
+/* max NDRange commands in a batch; two batches of kernels with MAX_BUFS
+ * buffer arguments use all MAX_BUF_DESCRIPTORS */
+#define MAX_BATCH_LAUNCHES 16
 
 #include "memfill64.h"
 #include "memfill128.h"
@@ -201,9 +206,35 @@ typedef struct pocl_vulkan_kernel_data_s
 
 } pocl_vulkan_kernel_data_t;
 
+/* Vulkan objects of an NDRange command, freed after it has finished. */
+typedef struct pocl_vulkan_launch_s
+{
+  _cl_command_node *cmd;
+  pocl_vulkan_kernel_data_t *kdata;
+  VkPipeline pipeline;
+  VkPipelineLayout pipeline_layout;
+  VkDescriptorSet descriptor_sets[2];
+  VkDescriptorSetLayout descriptor_set_layouts[2];
+} pocl_vulkan_launch_t;
+
+/* NDRange commands recorded into a single command buffer, submitted
+ * together and completed when the fence is signaled. */
+typedef struct pocl_vulkan_batch_s
+{
+  VkCommandBuffer cb;
+  VkFence fence;
+  unsigned num_launches;
+  uint32_t num_dispatches;
+  pocl_vulkan_launch_t launches[MAX_BATCH_LAUNCHES];
+} pocl_vulkan_batch_t;
+
 typedef struct pocl_vulkan_event_data_s
 {
   pthread_cond_t event_cond;
+  /* set when the command was pushed to the driver thread */
+  int pushed;
+  /* set when a dependency failed after the command was pushed */
+  int dep_failed;
 } pocl_vulkan_event_data_t;
 
 typedef struct pocl_vulkan_mem_data_s
@@ -269,6 +300,17 @@ typedef struct pocl_vulkan_device_data_s
   VkCommandBuffer tmp_command_buffer;
 
   VkPipelineCache cache;
+  /* the pipeline cache is saved to this file when a program is released
+   * and at device teardown, if it has grown */
+  char pipeline_cache_path[POCL_MAX_PATHNAME_LENGTH];
+  size_t pipeline_cache_saved_size;
+  pocl_lock_t pipeline_cache_lock;
+
+  /* NDRange commands are recorded into one batch while the other one
+   * executes. Only accessed by the driver thread. */
+  pocl_vulkan_batch_t batches[2];
+  pocl_vulkan_batch_t *recording;
+  pocl_vulkan_batch_t *in_flight;
 
   /* integrated GPUs have different Vulkan memory layout */
   int device_is_iGPU;
@@ -1077,6 +1119,36 @@ pocl_vulkan_setup_memfill_kernels (cl_device_id dev,
 
 static const char* VULKAN_SERIALIZE_ENTRIES[2] = { "/program.spv", "/program.map" };
 
+/* Writes the pipeline cache to disk if pipelines were added to it. */
+static void
+pocl_vulkan_save_pipeline_cache (pocl_vulkan_device_data_t *d)
+{
+  size_t size = 0;
+  char *data = NULL;
+
+  if (d->pipeline_cache_path[0] == 0)
+    return;
+
+  POCL_LOCK (d->pipeline_cache_lock);
+  if (vkGetPipelineCacheData (d->device, d->cache, &size, NULL) != VK_SUCCESS
+      || size <= d->pipeline_cache_saved_size)
+    goto EXIT;
+
+  data = malloc (size);
+  if (data == NULL)
+    goto EXIT;
+  if (vkGetPipelineCacheData (d->device, d->cache, &size, data) == VK_SUCCESS
+      && pocl_write_file (d->pipeline_cache_path, data, size, 0) == 0)
+    {
+      POCL_MSG_PRINT_VULKAN ("saved %zu bytes of pipeline cache\n", size);
+      d->pipeline_cache_saved_size = size;
+    }
+  free (data);
+
+EXIT:
+  POCL_UNLOCK (d->pipeline_cache_lock);
+}
+
 cl_int
 pocl_vulkan_init (unsigned j, cl_device_id dev, const char *parameters)
 {
@@ -1617,14 +1689,41 @@ pocl_vulkan_init (unsigned j, cl_device_id dev, const char *parameters)
     }
   /************************************************************************/
 
+  /* The pipeline cache is kept in the kernel cache directory, one file per
+   * device model and driver version. Vulkan validates the header of the
+   * initial data and ignores it if it doesn't match the device. */
+  char *cache_data = NULL;
+  uint64_t cache_data_size = 0;
+  char cache_name[128];
+  int name_len = snprintf (cache_name, sizeof (cache_name), "%04x_%04x_",
+                           d->dev_props.vendorID, d->dev_props.deviceID);
+  for (unsigned i = 0; i < VK_UUID_SIZE; ++i)
+    name_len += snprintf (cache_name + name_len, 3, "%02x",
+                          d->dev_props.pipelineCacheUUID[i]);
+  if (pocl_cache_device_data_path (d->pipeline_cache_path, "vulkan",
+                                   cache_name)
+      != 0)
+    d->pipeline_cache_path[0] = 0;
+  else if (pocl_exists (d->pipeline_cache_path))
+    {
+      if (pocl_read_file (d->pipeline_cache_path, &cache_data,
+                          &cache_data_size)
+          != 0)
+        cache_data_size = 0;
+      POCL_MSG_PRINT_VULKAN ("loaded %zu bytes of pipeline cache\n",
+                             (size_t)cache_data_size);
+    }
+
   VkPipelineCacheCreateInfo cache_create_info = {
     VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
     NULL,
     0, // flags
-    0, NULL
+    (size_t)cache_data_size, cache_data
   };
   VULKAN_CHECK_ABORT (
       vkCreatePipelineCache (d->device, &cache_create_info, NULL, &d->cache));
+  d->pipeline_cache_saved_size = cache_data_size;
+  POCL_MEM_FREE (cache_data);
 
   VkCommandPoolCreateInfo pool_cinfo;
   pool_cinfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
@@ -1646,6 +1745,20 @@ pocl_vulkan_init (unsigned j, cl_device_id dev, const char *parameters)
   d->command_buffer = tmp[0];
   d->tmp_command_buffer = tmp[1];
 
+  VULKAN_CHECK_ABORT (vkAllocateCommandBuffers (d->device, &alloc_cinfo, tmp));
+  VkFenceCreateInfo fence_cinfo
+      = { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, NULL, 0 };
+  for (unsigned i = 0; i < 2; ++i)
+    {
+      d->batches[i].cb = tmp[i];
+      d->batches[i].num_launches = 0;
+      d->batches[i].num_dispatches = 0;
+      VULKAN_CHECK_ABORT (vkCreateFence (d->device, &fence_cinfo, NULL,
+                                         &d->batches[i].fence));
+    }
+  d->recording = &d->batches[0];
+  d->in_flight = NULL;
+
   d->submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
   d->submit_info.pNext = NULL;
   d->submit_info.waitSemaphoreCount = 0;
@@ -1679,6 +1792,7 @@ pocl_vulkan_init (unsigned j, cl_device_id dev, const char *parameters)
   POCL_INIT_COND (d->wakeup_cond);
 
   POCL_INIT_LOCK (d->wq_lock_fast);
+  POCL_INIT_LOCK (d->pipeline_cache_lock);
 
   d->work_queue = NULL;
 
@@ -2261,6 +2375,8 @@ pocl_vulkan_free_program (cl_device_id device, cl_program program,
   /* vpd can be NULL if compilation fails */
   if (vpd)
     {
+      /* the pipelines of the program's kernels are in the cache by now */
+      pocl_vulkan_save_pipeline_cache (d);
       POCL_MEM_FREE (vpd->clspv_map_filename);
       pocl_vulkan_kernel_data_t *el, *tmp;
       DL_FOREACH_SAFE (vpd->vk_kernel_meta_list, el, tmp)
@@ -2839,22 +2955,81 @@ static void
 vulkan_push_command (cl_device_id dev, _cl_command_node *cmd)
 {
   pocl_vulkan_device_data_t *d = (pocl_vulkan_device_data_t *)dev->data;
+  pocl_vulkan_event_data_t *e_d = cmd->sync.event.event->data;
   POCL_LOCK (d->wq_lock_fast);
   DL_APPEND (d->work_queue, cmd);
+  /* set under the lock, so the dependents are appended after it */
+  POCL_ATOMIC_STORE (e_d->pushed, 1);
   POCL_SIGNAL_COND (d->wakeup_cond);
   POCL_UNLOCK (d->wq_lock_fast);
 }
 
+/* Returns 1 if all the unfinished dependencies of the event were pushed to
+ * the same device. The driver thread executes the commands in the order
+ * they were pushed and completes them in order, so the command can be
+ * pushed before they finish. Must be called with the event locked. */
+static int
+vulkan_deps_pushed (cl_event event)
+{
+  event_node *n;
+
+  LL_FOREACH (event->wait_list, n)
+    {
+      cl_event dep = n->event;
+      if (dep->queue == NULL || dep->queue->device != event->queue->device)
+        return 0;
+      pocl_vulkan_event_data_t *dep_e_d = POCL_ATOMIC_LOAD (dep->data);
+      if (dep_e_d == NULL || POCL_ATOMIC_LOAD (dep_e_d->pushed) == 0)
+        return 0;
+    }
+  return 1;
+}
+
+/* Called after the event's command was pushed; pushes the commands waiting
+ * only for pushed commands. */
+static void
+vulkan_push_dependents (cl_event event)
+{
+  event_node *n;
+
+  POCL_LOCK_OBJ (event);
+  LL_FOREACH (event->notify_list, n)
+    {
+      cl_event target = n->event;
+      POCL_LOCK_OBJ (target);
+      _cl_command_node *node = target->command;
+      pocl_vulkan_event_data_t *e_d = target->data;
+      if (node != NULL && e_d != NULL && target->status == CL_QUEUED
+          && node->device == event->queue->device
+          && node->state == POCL_COMMAND_READY
+          && POCL_ATOMIC_LOAD (e_d->pushed) == 0
+          && vulkan_deps_pushed (target))
+        {
+          pocl_update_event_submitted (target);
+          vulkan_push_command (node->device, node);
+        }
+      POCL_UNLOCK_OBJ (target);
+    }
+  POCL_UNLOCK_OBJ (event);
+}
+
 void
 pocl_vulkan_submit (_cl_command_node *node, cl_command_queue cq)
 {
+  cl_event event = node->sync.event.event;
+  int pushed = 0;
+
   node->state = POCL_COMMAND_READY;
-  if (pocl_command_is_ready (node->sync.event.event))
+  if (pocl_command_is_ready (event) || vulkan_deps_pushed (event))
     {
-      pocl_update_event_submitted (node->sync.event.event);
+      pocl_update_event_submitted (event);
       vulkan_push_command (cq->device, node);
+      pushed = 1;
     }
-  POCL_UNLOCK_OBJ (node->sync.event.event);
+  POCL_UNLOCK_OBJ (event);
+
+  if (pushed)
+    vulkan_push_dependents (event);
   return;
 }
 
@@ -2933,6 +3108,16 @@ void
 pocl_vulkan_notify (cl_device_id device, cl_event event, cl_event finished)
 {
   _cl_command_node *node = event->command;
+  pocl_vulkan_event_data_t *e_d = event->data;
+
+  /* Already pushed after its dependencies; the driver thread fails it
+   * instead of executing it. */
+  if (e_d != NULL && POCL_ATOMIC_LOAD (e_d->pushed))
+    {
+      if (finished->status < CL_COMPLETE)
+        POCL_ATOMIC_STORE (e_d->dep_failed, 1);
+      return;
+    }
 
   if (finished->status < CL_COMPLETE)
     {
@@ -2974,12 +3159,12 @@ pocl_vulkan_update_event (cl_device_id device, cl_event event)
   pocl_vulkan_event_data_t *e_d = NULL;
   if (event->data == NULL && event->status == CL_QUEUED)
     {
-      e_d = (pocl_vulkan_event_data_t *)malloc (
-          sizeof (pocl_vulkan_event_data_t));
+      e_d = (pocl_vulkan_event_data_t *)calloc (
+          1, sizeof (pocl_vulkan_event_data_t));
       assert (e_d);
 
       POCL_INIT_COND (e_d->event_cond);
-      event->data = (void *)e_d;
+      POCL_ATOMIC_STORE (event->data, (void *)e_d);
     }
 }
 
@@ -2999,6 +3184,22 @@ pocl_vulkan_wait_event (cl_device_id device, cl_event event)
 
 /****************************************************************************************/
 
+static void
+vulkan_wait_fence (pocl_vulkan_device_data_t *d, VkFence fence)
+{
+  VkResult res = vkWaitForFences (d->device, 1, &fence, VK_TRUE, 1000000000U);
+  if (res == VK_TIMEOUT)
+    {
+      while (res == VK_TIMEOUT)
+        {
+          res = vkWaitForFences (d->device, 1, &fence, VK_TRUE, 0U);
+          if (res == VK_TIMEOUT)
+            usleep(5000);
+        }
+    }
+  VULKAN_CHECK_ABORT (res);
+}
+
 static void submit_CB (pocl_vulkan_device_data_t *d, VkCommandBuffer *cmdbuf_p)
 {
   VkFence fence;
@@ -3012,17 +3213,7 @@ static void submit_CB (pocl_vulkan_device_data_t *d, VkCommandBuffer *cmdbuf_p)
   VULKAN_CHECK_ABORT (
       vkQueueSubmit (d->compute_queue, 1, &d->submit_info, fence));
 
-  VkResult res = vkWaitForFences (d->device, 1, &fence, VK_TRUE, 1000000000U);
-  if (res == VK_TIMEOUT)
-    {
-      while (res == VK_TIMEOUT)
-        {
-          res = vkWaitForFences (d->device, 1, &fence, VK_TRUE, 0U);
-          if (res == VK_TIMEOUT)
-            usleep(5000);
-        }
-    }
-  VULKAN_CHECK_ABORT (res);
+  vulkan_wait_fence (d, fence);
 
   vkDestroyFence (d->device, fence, NULL);
 }
@@ -3563,6 +3754,20 @@ pocl_vulkan_unmap_mem (void *data, pocl_mem_identifier *dst_mem_id,
 
 /****************************************************************************************/
 
+static pocl_vulkan_kernel_data_t *
+pocl_vulkan_find_kernel_data (cl_kernel kernel, unsigned program_device_i)
+{
+  pocl_vulkan_program_data_t *pdata = kernel->program->data[program_device_i];
+  pocl_vulkan_kernel_data_t *el = NULL;
+  DL_FOREACH (pdata->vk_kernel_meta_list, el)
+  {
+    if (strcmp (el->name, kernel->name) == 0)
+      return el;
+  }
+  assert (0 && "kernel metadata not found");
+  return NULL;
+}
+
 static void
 pocl_vulkan_setup_kernel_arguments (
     pocl_vulkan_device_data_t *d, cl_device_id dev, unsigned program_device_i,
@@ -3582,16 +3787,8 @@ pocl_vulkan_setup_kernel_arguments (
   unsigned dev_i = program_device_i;
 
   pocl_vulkan_program_data_t *pdata = kernel->program->data[dev_i];
-  pocl_vulkan_kernel_data_t *el = NULL, *kdata = NULL;
-  DL_FOREACH (pdata->vk_kernel_meta_list, el)
-  {
-    if (strcmp (el->name, kernel->name) == 0)
-      {
-        kdata = el;
-        break;
-      }
-  }
-  assert (kdata != NULL);
+  pocl_vulkan_kernel_data_t *kdata
+      = pocl_vulkan_find_kernel_data (kernel, dev_i);
   assert (pdata->shader != NULL);
   *compute_shader = pdata->shader;
 
@@ -4061,33 +4258,17 @@ pocl_vulkan_setup_kernel_arguments (
     }
 }
 
-void
-pocl_vulkan_run (void *data, _cl_command_node *cmd)
+/* Sets up the arguments, the pipeline layout and the pipeline of an NDRange
+ * command. */
+static void
+vulkan_setup_launch (pocl_vulkan_device_data_t *d, _cl_command_node *cmd,
+                     pocl_vulkan_launch_t *launch,
+                     VkPushConstantRange *pushc_range, char *pushc_data,
+                     char **goffs_start)
 {
-  pocl_vulkan_device_data_t *d = data;
   _cl_command_run *co = &cmd->command.run;
-  cl_device_id dev = cmd->device;
-  assert (cmd->type == CL_COMMAND_NDRANGE_KERNEL);
-  cl_kernel kernel = cmd->command.run.kernel;
-
-  struct pocl_context *pc = &co->pc;
-  uint32_t total_wg_x = pc->num_groups[0];
-  uint32_t total_wg_y = pc->num_groups[1];
-  uint32_t total_wg_z = pc->num_groups[2];
-  uint32_t start_offs_x = pc->global_offset[0];
-  uint32_t start_offs_y = pc->global_offset[1];
-  uint32_t start_offs_z = pc->global_offset[2];
-
-  size_t total_wgs = total_wg_x * total_wg_y * total_wg_z;
-  if (total_wgs == 0)
-    return;
-
-  POCL_MSG_PRINT_VULKAN ("WG X %u Y %u Z %u ||| OFFS X %u Y %u Z %u\n",
-                         total_wg_x, total_wg_y, total_wg_z,
-                         start_offs_x, start_offs_y, start_offs_z);
+  cl_kernel kernel = co->kernel;
 
-  VkDescriptorSet descriptor_sets[2] = { NULL, NULL };
-  VkDescriptorSetLayout descriptor_set_layouts[2];
   VkSpecializationInfo specInfo;
   uint32_t spec_data[128];
   VkSpecializationMapEntry entries[128];
@@ -4096,20 +4277,22 @@ pocl_vulkan_run (void *data, _cl_command_node *cmd)
   VkDescriptorBufferInfo pod_ubo_info = { NULL, 0, 0 };
   VkDescriptorSetLayoutBinding const_binding = { 0, 0, 0, 0, NULL };
   VkDescriptorBufferInfo const_descriptor_buffer_info = { 0 };
-
-  VkPipelineLayout pipeline_layout;
-  VkPipeline pipeline;
   VkShaderModule compute_shader = NULL;
-  VkPushConstantRange pushc_range;
-  char *pushc_data = alloca (d->max_pushc_size);
-  char *goffs_start = NULL;
+  VkDescriptorSet *descriptor_sets = launch->descriptor_sets;
+  VkDescriptorSetLayout *descriptor_set_layouts
+      = launch->descriptor_set_layouts;
+
+  launch->cmd = cmd;
+  launch->kdata = pocl_vulkan_find_kernel_data (kernel, cmd->program_device_i);
+  descriptor_sets[0] = descriptor_sets[1] = NULL;
+  *goffs_start = NULL;
 
   pocl_vulkan_setup_kernel_arguments (
       d, cmd->device, cmd->program_device_i, co, &compute_shader,
       descriptor_sets, descriptor_sets + 1,
       descriptor_set_layouts, descriptor_set_layouts + 1,
       &specInfo, spec_data,
-      &pushc_range, pushc_data, &goffs_start,
+      pushc_range, pushc_data, goffs_start,
       entries, bindings,
       descriptor_buffer_info, &pod_ubo_info,
       &const_binding, &const_descriptor_buffer_info);
@@ -4128,9 +4311,9 @@ pocl_vulkan_run (void *data, _cl_command_node *cmd)
       = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
   pipeline_layout_create_info.pNext = NULL;
   pipeline_layout_create_info.flags = 0;
-  if (pushc_range.size > 0)
+  if (pushc_range->size > 0)
     {
-      pipeline_layout_create_info.pPushConstantRanges = &pushc_range;
+      pipeline_layout_create_info.pPushConstantRanges = pushc_range;
       pipeline_layout_create_info.pushConstantRangeCount = 1;
     }
   else
@@ -4144,42 +4327,89 @@ pocl_vulkan_run (void *data, _cl_command_node *cmd)
     pipeline_layout_create_info.setLayoutCount = 1;
   pipeline_layout_create_info.pSetLayouts = descriptor_set_layouts;
   VULKAN_CHECK_ABORT (vkCreatePipelineLayout (
-      d->device, &pipeline_layout_create_info, NULL, &pipeline_layout));
+      d->device, &pipeline_layout_create_info, NULL, &launch->pipeline_layout));
 
   VkComputePipelineCreateInfo pipeline_create_info;
   pipeline_create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
   pipeline_create_info.pNext = NULL;
   pipeline_create_info.flags = 0;
   pipeline_create_info.stage = shader_stage_info;
-  pipeline_create_info.layout = pipeline_layout;
+  pipeline_create_info.layout = launch->pipeline_layout;
   pipeline_create_info.basePipelineIndex = 0;
   pipeline_create_info.basePipelineHandle = 0;
 
   VULKAN_CHECK_ABORT (vkCreateComputePipelines (
-      d->device, d->cache, 1, &pipeline_create_info, NULL, &pipeline));
+      d->device, d->cache, 1, &pipeline_create_info, NULL, &launch->pipeline));
 
-  VkCommandBuffer cb = d->command_buffer;
-  uint32_t commands_recorded = 0;
-  uint32_t wg_x = 0, wg_y = 0, wg_z = 0;
-  uint32_t goffs_x = 0, goffs_y = 0, goffs_z = 0;
-  if (goffs_start != NULL)
+  if (*goffs_start != NULL)
     {
-      assert (goffs_start >= pushc_data);
-      assert (goffs_start < pushc_data + d->max_pushc_size);
+      assert (*goffs_start >= pushc_data);
+      assert (*goffs_start < pushc_data + d->max_pushc_size);
     }
+}
 
-  VkCommandBufferBeginInfo begin_info;
-  begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-  begin_info.pNext = NULL;
-  begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-  begin_info.pInheritanceInfo = NULL;
+static void
+vulkan_free_launch (pocl_vulkan_device_data_t *d, pocl_vulkan_launch_t *launch)
+{
+  VkDescriptorSet *descriptor_sets = launch->descriptor_sets;
 
-  VULKAN_CHECK_ABORT (vkResetCommandBuffer (cb, 0));
-  VULKAN_CHECK_ABORT (vkBeginCommandBuffer (cb, &begin_info));
-  vkCmdBindPipeline (cb, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
-  vkCmdBindDescriptorSets (cb, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout,
-                           0, ((descriptor_sets[1] ? 2 : 1)), descriptor_sets,
-                           0, NULL);
+  if (descriptor_sets[0]) {
+      VULKAN_CHECK_ABORT (vkFreeDescriptorSets (
+          d->device, d->buf_descriptor_pool, 1, descriptor_sets));
+      vkDestroyDescriptorSetLayout (d->device,
+                                    launch->descriptor_set_layouts[0], NULL);
+  }
+  if (descriptor_sets[1]) {
+      VULKAN_CHECK_ABORT (vkFreeDescriptorSets (
+          d->device, d->buf_descriptor_pool, 1, descriptor_sets + 1));
+      vkDestroyDescriptorSetLayout (d->device,
+                                    launch->descriptor_set_layouts[1], NULL);
+  }
+
+  vkDestroyPipelineLayout (d->device, launch->pipeline_layout, NULL);
+  vkDestroyPipeline (d->device, launch->pipeline, NULL);
+}
+
+static void
+vulkan_bind_launch (VkCommandBuffer cb, pocl_vulkan_launch_t *launch)
+{
+  vkCmdBindPipeline (cb, VK_PIPELINE_BIND_POINT_COMPUTE, launch->pipeline);
+  vkCmdBindDescriptorSets (cb, VK_PIPELINE_BIND_POINT_COMPUTE,
+                           launch->pipeline_layout, 0,
+                           ((launch->descriptor_sets[1] ? 2 : 1)),
+                           launch->descriptor_sets, 0, NULL);
+}
+
+/* Number of vkCmdDispatch calls needed for the grid, which can exceed the
+ * WG count limits of the device. */
+static uint32_t
+vulkan_num_dispatches (pocl_vulkan_device_data_t *d, struct pocl_context *pc)
+{
+  uint32_t n = 1;
+  for (unsigned i = 0; i < 3; ++i)
+    n *= (pc->num_groups[i] + d->max_wg_count[i] - 1) / d->max_wg_count[i];
+  return n;
+}
+
+/* Records the dispatches of a launch into the (begun) command buffer. If
+ * submit_full is set, the command buffer is submitted and waited for every
+ * MAX_CB_DISPATCHES dispatches. Returns the number of dispatches recorded
+ * since the last such submit. */
+static uint32_t
+vulkan_record_launch (pocl_vulkan_device_data_t *d, VkCommandBuffer cb,
+                      pocl_vulkan_launch_t *launch,
+                      VkPushConstantRange *pushc_range, char *pushc_data,
+                      char *goffs_start, int submit_full)
+{
+  struct pocl_context *pc = &launch->cmd->command.run.pc;
+  uint32_t total_wg_x = pc->num_groups[0];
+  uint32_t total_wg_y = pc->num_groups[1];
+  uint32_t total_wg_z = pc->num_groups[2];
+  uint32_t commands_recorded = 0;
+  uint32_t wg_x = 0, wg_y = 0, wg_z = 0;
+  uint32_t goffs_x = 0, goffs_y = 0, goffs_z = 0;
+
+  vulkan_bind_launch (cb, launch);
 
   for (uint32_t wg_z_offs = 0; wg_z_offs < total_wg_z;
        wg_z_offs += d->max_wg_count[2])
@@ -4199,7 +4429,7 @@ pocl_vulkan_run (void *data, _cl_command_node *cmd)
                   wg_x = min (d->max_wg_count[0], total_wg_x - wg_x_offs);
                   goffs_x = wg_x_offs * pc->local_size[0];
 
-                  if (pushc_range.size > 0)
+                  if (pushc_range->size > 0)
                     {
                       // global offset sometimes is optimized out, even
                       // if we compile with --global-offsets option
@@ -4213,9 +4443,9 @@ pocl_vulkan_run (void *data, _cl_command_node *cmd)
                                   sizeof (uint32_t));
                         }
                       // upload the arg data to the GPU via push constants
-                      vkCmdPushConstants (cb, pipeline_layout,
+                      vkCmdPushConstants (cb, launch->pipeline_layout,
                                           VK_SHADER_STAGE_COMPUTE_BIT, 0,
-                                          pushc_range.size, pushc_data);
+                                          pushc_range->size, pushc_data);
                     }
 
                   vkCmdDispatch (cb, wg_x, wg_y, wg_z);
@@ -4223,20 +4453,15 @@ pocl_vulkan_run (void *data, _cl_command_node *cmd)
                   /* TODO find out what's the limit of submit commands in a
                    * single command buffer.
                    */
-                  if (commands_recorded == 2048)
+                  if (submit_full && commands_recorded == MAX_CB_DISPATCHES)
                     {
                       commands_recorded = 0;
                       VULKAN_CHECK_ABORT (vkEndCommandBuffer (cb));
                       submit_CB (d, &cb);
                       VULKAN_CHECK_ABORT (vkResetCommandBuffer (cb, 0));
                       VULKAN_CHECK_ABORT (
-                          vkBeginCommandBuffer (cb, &begin_info));
-                      vkCmdBindPipeline (cb, VK_PIPELINE_BIND_POINT_COMPUTE,
-                                         pipeline);
-                      vkCmdBindDescriptorSets (
-                          cb, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout,
-                          0, ((descriptor_sets[1] ? 2 : 1)), descriptor_sets,
-                          0, NULL);
+                          vkBeginCommandBuffer (cb, &d->cmd_buf_begin_info));
+                      vulkan_bind_launch (cb, launch);
                     }
                   else
                     ++commands_recorded;
@@ -4246,27 +4471,184 @@ pocl_vulkan_run (void *data, _cl_command_node *cmd)
       }
     }
 
+  return commands_recorded;
+}
+
+/* Runs an NDRange command synchronously. */
+void
+pocl_vulkan_run (void *data, _cl_command_node *cmd)
+{
+  pocl_vulkan_device_data_t *d = data;
+  _cl_command_run *co = &cmd->command.run;
+  assert (cmd->type == CL_COMMAND_NDRANGE_KERNEL);
+
+  struct pocl_context *pc = &co->pc;
+  size_t total_wgs = pc->num_groups[0] * pc->num_groups[1] * pc->num_groups[2];
+  if (total_wgs == 0)
+    return;
+
+  POCL_MSG_PRINT_VULKAN ("WG X %zu Y %zu Z %zu ||| OFFS X %zu Y %zu Z %zu\n",
+                         pc->num_groups[0], pc->num_groups[1],
+                         pc->num_groups[2], pc->global_offset[0],
+                         pc->global_offset[1], pc->global_offset[2]);
+
+  pocl_vulkan_launch_t launch;
+  VkPushConstantRange pushc_range;
+  char *pushc_data = alloca (d->max_pushc_size);
+  char *goffs_start = NULL;
+  vulkan_setup_launch (d, cmd, &launch, &pushc_range, pushc_data,
+                       &goffs_start);
+
+  VkCommandBuffer cb = d->command_buffer;
+  VULKAN_CHECK_ABORT (vkResetCommandBuffer (cb, 0));
+  VULKAN_CHECK_ABORT (vkBeginCommandBuffer (cb, &d->cmd_buf_begin_info));
+  uint32_t commands_recorded = vulkan_record_launch (
+      d, cb, &launch, &pushc_range, pushc_data, goffs_start, 1);
+
   if (commands_recorded > 0)
     {
       VULKAN_CHECK_ABORT (vkEndCommandBuffer (cb));
       submit_CB (d, &cb);
     }
 
-  if (descriptor_sets[0]) {
-      VULKAN_CHECK_ABORT (vkFreeDescriptorSets (
-          d->device, d->buf_descriptor_pool, 1, descriptor_sets));
-      vkDestroyDescriptorSetLayout (d->device, descriptor_set_layouts[0],
-                                    NULL);
-  }
-  if (descriptor_sets[1]) {
-      VULKAN_CHECK_ABORT (vkFreeDescriptorSets (
-          d->device, d->buf_descriptor_pool, 1, descriptor_sets + 1));
-      vkDestroyDescriptorSetLayout (d->device, descriptor_set_layouts[1],
-                                    NULL);
-  }
+  vulkan_free_launch (d, &launch);
+}
+
+/****************************************************************************************/
+
+/* Waits for the submitted batch, frees its resources and completes its
+ * events. */
+static void
+vulkan_batch_wait (pocl_vulkan_device_data_t *d)
+{
+  pocl_vulkan_batch_t *b = d->in_flight;
+  if (b == NULL)
+    return;
+
+  vulkan_wait_fence (d, b->fence);
+  VULKAN_CHECK_ABORT (vkResetFences (d->device, 1, &b->fence));
+  d->in_flight = NULL;
+
+  /* the resources must be freed first, completing the events can release
+   * the kernels and programs */
+  for (unsigned i = 0; i < b->num_launches; ++i)
+    vulkan_free_launch (d, &b->launches[i]);
+  for (unsigned i = 0; i < b->num_launches; ++i)
+    POCL_UPDATE_EVENT_COMPLETE_MSG (b->launches[i].cmd->sync.event.event,
+                                    "Event Enqueue NDRange       ");
+  POCL_MSG_PRINT_VULKAN ("completed a batch of %u NDRange commands\n",
+                         b->num_launches);
+  b->num_launches = 0;
+  b->num_dispatches = 0;
+}
+
+/* Submits the batch being recorded, after the previous one finished. */
+static void
+vulkan_batch_submit (pocl_vulkan_device_data_t *d)
+{
+  pocl_vulkan_batch_t *b = d->recording;
+  if (b->num_launches == 0)
+    return;
+
+  vulkan_batch_wait (d);
+
+  VULKAN_CHECK_ABORT (vkEndCommandBuffer (b->cb));
+  d->submit_info.pCommandBuffers = &b->cb;
+  VULKAN_CHECK_ABORT (
+      vkQueueSubmit (d->compute_queue, 1, &d->submit_info, b->fence));
+  d->in_flight = b;
+  d->recording = (b == &d->batches[0]) ? &d->batches[1] : &d->batches[0];
+}
+
+/* Waits until all the recorded NDRange commands have finished. */
+static void
+vulkan_batch_flush (pocl_vulkan_device_data_t *d)
+{
+  vulkan_batch_submit (d);
+  vulkan_batch_wait (d);
+}
+
+static int
+vulkan_batch_uses_kernel (pocl_vulkan_batch_t *b,
+                          pocl_vulkan_kernel_data_t *kdata)
+{
+  if (b == NULL)
+    return 0;
+  for (unsigned i = 0; i < b->num_launches; ++i)
+    if (b->launches[i].kdata == kdata)
+      return 1;
+  return 0;
+}
+
+/* NDRange commands are recorded into batches unless the POD arguments
+ * need the staging buffer, which is shared by all launches. */
+static int
+vulkan_can_batch (pocl_vulkan_device_data_t *d, _cl_command_node *cmd)
+{
+  if (cmd->type != CL_COMMAND_NDRANGE_KERNEL || !d->kernarg_is_mappable)
+    return 0;
+  struct pocl_context *pc = &cmd->command.run.pc;
+  if (pc->num_groups[0] == 0 || pc->num_groups[1] == 0
+      || pc->num_groups[2] == 0)
+    return 0;
+  return vulkan_num_dispatches (d, pc) <= MAX_CB_DISPATCHES;
+}
+
+/* Records an NDRange command into the current batch. The batch is submitted
+ * first if it's full, or if the kernel is in a batch not yet finished: the
+ * POD arguments are in a buffer owned by the kernel. */
+static void
+vulkan_batch_add (pocl_vulkan_device_data_t *d, _cl_command_node *cmd)
+{
+  pocl_vulkan_batch_t *b = d->recording;
+  struct pocl_context *pc = &cmd->command.run.pc;
+  uint32_t num_dispatches = vulkan_num_dispatches (d, pc);
+  pocl_vulkan_kernel_data_t *kdata = pocl_vulkan_find_kernel_data (
+      cmd->command.run.kernel, cmd->program_device_i);
+
+  if (b->num_launches == MAX_BATCH_LAUNCHES
+      || b->num_dispatches + num_dispatches > MAX_CB_DISPATCHES
+      || (kdata->num_pods > 0 && vulkan_batch_uses_kernel (b, kdata)))
+    {
+      vulkan_batch_submit (d);
+      b = d->recording;
+    }
+  if (kdata->num_pods > 0 && vulkan_batch_uses_kernel (d->in_flight, kdata))
+    vulkan_batch_wait (d);
+
+  pocl_update_event_running (cmd->sync.event.event);
+
+  if (b->num_launches == 0)
+    {
+      VULKAN_CHECK_ABORT (vkResetCommandBuffer (b->cb, 0));
+      VULKAN_CHECK_ABORT (vkBeginCommandBuffer (b->cb, &d->cmd_buf_begin_info));
+    }
 
-  vkDestroyPipelineLayout (d->device, pipeline_layout, NULL);
-  vkDestroyPipeline (d->device, pipeline, NULL);
+  pocl_vulkan_launch_t *launch = &b->launches[b->num_launches++];
+  VkPushConstantRange pushc_range;
+  char *pushc_data = alloca (d->max_pushc_size);
+  char *goffs_start = NULL;
+  vulkan_setup_launch (d, cmd, launch, &pushc_range, pushc_data,
+                       &goffs_start);
+
+  /* the commands were only pushed after their dependencies, but those can
+   * still be executing in this or the previous batch */
+  VkMemoryBarrier memory_barrier;
+  memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  memory_barrier.pNext = NULL;
+  memory_barrier.srcAccessMask
+      = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+  memory_barrier.dstAccessMask
+      = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier (b->cb,
+                        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+                            | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                        &memory_barrier, 0, NULL, 0, NULL);
+
+  vulkan_record_launch (d, b->cb, launch, &pushc_range, pushc_data,
+                        goffs_start, 0);
+  b->num_dispatches += num_dispatches;
 }
 
 static size_t
@@ -4286,16 +4668,42 @@ RETRY:
       DL_DELETE (d->work_queue, cmd);
       POCL_UNLOCK (d->wq_lock_fast);
 
-      assert (pocl_command_is_ready (cmd->sync.event.event));
-      assert (cmd->sync.event.event->status == CL_SUBMITTED);
+      cl_event event = cmd->sync.event.event;
+      pocl_vulkan_event_data_t *e_d = event->data;
+      assert (event->status == CL_SUBMITTED);
 
-      pocl_exec_command (cmd);
+      if (POCL_ATOMIC_LOAD (e_d->dep_failed))
+        {
+          vulkan_batch_flush (d);
+          POCL_UPDATE_EVENT_FAILED (CL_FAILED, event);
+        }
+      else if (vulkan_can_batch (d, cmd))
+        vulkan_batch_add (d, cmd);
+      else
+        {
+          /* the other commands access the memory from the host or
+           * complete immediately, so everything before them must be done */
+          vulkan_batch_flush (d);
+          pocl_exec_command (cmd);
+        }
 
       POCL_LOCK (d->wq_lock_fast);
     }
 
   if ((cmd == NULL) && (do_exit == 0))
     {
+      /* Nothing more to record: submit the batch, and then wait for it
+       * unless new commands arrived meanwhile. */
+      if (d->recording->num_launches > 0 || d->in_flight != NULL)
+        {
+          POCL_UNLOCK (d->wq_lock_fast);
+          if (d->recording->num_launches > 0)
+            vulkan_batch_submit (d);
+          else
+            vulkan_batch_wait (d);
+          POCL_LOCK (d->wq_lock_fast);
+          goto RETRY;
+        }
       POCL_WAIT_COND (d->wakeup_cond, d->wq_lock_fast);
       /* since cond_wait returns with locked mutex, might as well retry */
       goto RETRY;
@@ -4303,6 +4711,9 @@ RETRY:
 
   POCL_UNLOCK (d->wq_lock_fast);
 
+  if (do_exit)
+    vulkan_batch_flush (d);
+
   return do_exit;
 }
 
@@ -4320,6 +4731,11 @@ pocl_vulkan_driver_pthread (void *cldev)
 
 EXIT_PTHREAD:
 
+  pocl_vulkan_save_pipeline_cache (d);
+  vkDestroyPipelineCache (d->device, d->cache, NULL);
+  POCL_DESTROY_LOCK (d->pipeline_cache_lock);
+  vkDestroyFence (d->device, d->batches[0].fence, NULL);
+  vkDestroyFence (d->device, d->batches[1].fence, NULL);
   vkDestroyCommandPool (d->device, d->command_pool, NULL);
   vkDestroyDescriptorPool (d->device, d->buf_descriptor_pool, NULL);
   /* destroy logical device */
@@ -361,6 +361,72 @@ pocl_cache_write_header (char *header_path,
   return pocl_write_file (header_path, header_content, header_size, 0);
 }
 
+int
+pocl_cache_pch_path (char *pch_path, cl_device_id device,
+                     const char *build_options)
+{
+  if (!use_kernel_cache)
+    return -1;
+
+  SHA1_CTX hash_ctx;
+  uint8_t digest[SHA1_DIGEST_SIZE];
+  static const char *seed = POCL_VERSION_BASE POCL_BUILD_TIMESTAMP
+#ifdef ENABLE_LLVM
+      LLVM_VERSION POCL_KERNELLIB_SHA1
+#endif
+      ;
+
+  pocl_SHA1_Init (&hash_ctx);
+  pocl_SHA1_Update (&hash_ctx, (uint8_t *)seed, strlen (seed));
+  pocl_SHA1_Update (&hash_ctx, (uint8_t *)build_options,
+                    strlen (build_options));
+  if (device->ops->build_hash)
+    {
+      char *dev_hash = device->ops->build_hash (device);
+      pocl_SHA1_Update (&hash_ctx, (const uint8_t *)dev_hash,
+                        strlen (dev_hash));
+      free (dev_hash);
+    }
+  pocl_SHA1_Final (&hash_ctx, digest);
+
+  char hashstr[SHA1_DIGEST_SIZE * 2 + 1];
+  for (unsigned i = 0; i < SHA1_DIGEST_SIZE; i++)
+    {
+      hashstr[i * 2] = (digest[i] & 0x0F) + 65;
+      hashstr[i * 2 + 1] = ((digest[i] & 0xF0) >> 4) + 65;
+    }
+  hashstr[SHA1_DIGEST_SIZE * 2] = 0;
+
+  int bytes_written = snprintf (pch_path, POCL_MAX_PATHNAME_LENGTH, "%s/pch",
+                                cache_topdir);
+  assert (bytes_written > 0 && bytes_written < POCL_MAX_PATHNAME_LENGTH);
+  if (pocl_mkdir_p (pch_path))
+    return -1;
+
+  bytes_written = snprintf (pch_path, POCL_MAX_PATHNAME_LENGTH, "%s/pch/%s.pch",
+                            cache_topdir, hashstr);
+  assert (bytes_written > 0 && bytes_written < POCL_MAX_PATHNAME_LENGTH);
+  return 0;
+}
+
+int
+pocl_cache_device_data_path (char *path, const char *subdir, const char *name)
+{
+  if (!use_kernel_cache)
+    return -1;
+
+  int bytes_written = snprintf (path, POCL_MAX_PATHNAME_LENGTH, "%s/%s",
+                                cache_topdir, subdir);
+  assert (bytes_written > 0 && bytes_written < POCL_MAX_PATHNAME_LENGTH);
+  if (pocl_mkdir_p (path))
+    return -1;
+
+  bytes_written = snprintf (path, POCL_MAX_PATHNAME_LENGTH, "%s/%s/%s",
+                            cache_topdir, subdir, name);
+  assert (bytes_written > 0 && bytes_written < POCL_MAX_PATHNAME_LENGTH);
+  return 0;
+}
+
 /******************************************************************************/
 
 int pocl_cache_update_program_last_access(cl_program program,
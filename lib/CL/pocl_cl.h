@@ -422,6 +422,10 @@ struct _pocl_buffer_migration_info
   /* If the buffer is declared read-only at creation or in kernel argument
    * list. */
   char read_only;
+  /* The byte range the command writes to, if known. write_size == 0 means
+   * the whole buffer (or unknown). Used for the dirty range tracking. */
+  uint64_t write_offset;
+  uint64_t write_size;
   /* For utlist.h linked lists. */
   struct _pocl_buffer_migration_info *prev, *next;
 };
@@ -1770,6 +1774,16 @@ struct _cl_mem {
    * get their latest_version synchronized to the parent version. */
   uint64_t latest_version;
 
+  /* The byte ranges written by the latest versions, for migrating only the
+   * modified bytes (POCL_MIGRATE_DIRTY_RANGES). Allocated at the first
+   * tracked write. */
+  struct pocl_dirty_log *dirty_log;
+
+  /* The sources and readiness events of the copies of the latest version
+   * made for read-only uses on several devices (POCL_MIGRATE_BROADCAST).
+   * Allocated at the first broadcast of the buffer. */
+  struct pocl_broadcast_state *broadcast;
+
   /* The event (denotes a command here) that last wrote to the buffer,
    * this is used as the dependency source for migration commands. */
   cl_event last_updater;
@@ -2046,6 +2060,11 @@ struct _cl_kernel {
      will be synchronized to the device. */
   char can_access_all_raw_buffers_indirectly;
 
+  /* Argument arrays of the CPU drivers prepared by earlier launches of the
+     kernel, reused by the later ones. Protected by the object lock, see
+     pocl_setup_kernel_arg_array (). */
+  void *cpu_arg_blocks;
+
   /* for program's linked list of kernels */
   struct _cl_kernel *next;
 };
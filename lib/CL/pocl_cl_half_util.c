@@ -51,7 +51,7 @@ static int32_t const maxC = 0x23bff;
  * static int32_t const minC = 0x1c400;
  * static int32_t const signC = signN >> shiftSign; // flt16 sign bit
  */
-static int32_t const signC = 0x40000; /* flt16 sign bit */
+static int32_t const signC = 0x08000; /* flt16 sign bit */
 
 static int32_t const mulN = 0x52000000; /* (1 << 23) / minN */
 static int32_t const mulC = 0x33800000; /* minN / (1 << (23 - shift)) */
@@ -0,0 +1,291 @@
+/* pocl_host_mem_pool.c - pool of large host allocations backing cl_mems
+
+   Copyright (c) 2026 PoCL developers
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+*/
+
+#include <stdint.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#include "pocl_debug.h"
+#include "pocl_host_mem_pool.h"
+#include "pocl_runtime_config.h"
+#include "pocl_threads.h"
+#include "pocl_util.h"
+
+#define POOL_MIN_SIZE ((size_t)128 << 10)
+#define POOL_PAGE_SIZE ((size_t)4096)
+#define HUGE_PAGE_SIZE ((size_t)2 << 20)
+#define MAX_SIZE_CLASSES 64
+#define DEFAULT_MAX_RETAINED_MB 256
+
+typedef struct free_chunk free_chunk;
+struct free_chunk
+{
+  free_chunk *next;
+};
+
+typedef struct size_class
+{
+  size_t size;
+  free_chunk *free_list;
+  unsigned num_free;
+} size_class;
+
+typedef struct host_mem_pool
+{
+  pocl_lock_t lock;
+  int enabled;
+  int use_hugetlb;
+  size_t max_retained;
+  unsigned num_classes;
+  size_class classes[MAX_SIZE_CLASSES];
+
+  /* statistics */
+  uint64_t allocs;
+  uint64_t reused;
+  uint64_t mapped;
+  uint64_t unmapped;
+  uint64_t hugetlb_bytes;
+  uint64_t thp_bytes;
+  size_t retained;
+  size_t max_ever_retained;
+} host_mem_pool;
+
+static host_mem_pool pool;
+
+#ifdef __linux__
+
+/* The size classes are powers of two up to 2 MiB, and above that four per
+ * power of two rounded up to whole huge pages, which wastes at most a quarter
+ * of the allocation. */
+static size_t
+size_class_of (size_t size)
+{
+  size_t c = POOL_MIN_SIZE;
+  if (size <= HUGE_PAGE_SIZE)
+    {
+      while (c < size)
+        c <<= 1;
+      return c;
+    }
+  c = HUGE_PAGE_SIZE;
+  while (c * 2 < size)
+    c <<= 1;
+  size_t step = c / 4;
+  size = c + (size - c + step - 1) / step * step;
+  return (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+}
+
+/* Must be called with the pool locked. */
+static size_class *
+find_size_class (size_t size, int create)
+{
+  for (unsigned i = 0; i < pool.num_classes; ++i)
+    if (pool.classes[i].size == size)
+      return &pool.classes[i];
+  if (!create || pool.num_classes == MAX_SIZE_CLASSES)
+    return NULL;
+  size_class *sc = &pool.classes[pool.num_classes++];
+  sc->size = size;
+  sc->free_list = NULL;
+  sc->num_free = 0;
+  return sc;
+}
+
+static void *
+map_huge (size_t size)
+{
+  void *p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  if (POCL_ATOMIC_LOAD (pool.use_hugetlb))
+    {
+      p = mmap (NULL, size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (p != MAP_FAILED)
+        {
+          POCL_LOCK (pool.lock);
+          pool.hugetlb_bytes += size;
+          POCL_UNLOCK (pool.lock);
+          return p;
+        }
+      /* no huge pages reserved (or left), don't try again */
+      POCL_MSG_PRINT_MEMORY ("MAP_HUGETLB failed, using transparent huge "
+                             "pages for the host buffers\n");
+      POCL_ATOMIC_STORE (pool.use_hugetlb, 0);
+    }
+#endif
+
+  /* map an extra huge page to align the region to the huge page size */
+  char *base = mmap (NULL, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED)
+    return NULL;
+  char *aligned = (char *)(((uintptr_t)base + HUGE_PAGE_SIZE - 1)
+                           & ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+  if (aligned > base)
+    munmap (base, aligned - base);
+  size_t tail = (base + size + HUGE_PAGE_SIZE) - (aligned + size);
+  if (tail > 0)
+    munmap (aligned + size, tail);
+#ifdef MADV_HUGEPAGE
+  madvise (aligned, size, MADV_HUGEPAGE);
+#endif
+  POCL_LOCK (pool.lock);
+  pool.thp_bytes += size;
+  POCL_UNLOCK (pool.lock);
+  return aligned;
+}
+
+static void *
+map_pages (size_t size)
+{
+  if (size >= HUGE_PAGE_SIZE)
+    return map_huge (size);
+  void *p = mmap (NULL, size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return (p == MAP_FAILED) ? NULL : p;
+}
+
+#endif
+
+void
+pocl_host_mem_pool_init (void)
+{
+  POCL_INIT_LOCK (pool.lock);
+#ifdef __linux__
+  pool.enabled = pocl_get_bool_option ("POCL_HOST_MEM_POOL", 1);
+#endif
+  pool.use_hugetlb = pocl_get_bool_option ("POCL_HOST_MEM_POOL_HUGETLB", 1);
+  int max_mb = pocl_get_int_option ("POCL_HOST_MEM_POOL_MAX_MB",
+                                    DEFAULT_MAX_RETAINED_MB);
+  pool.max_retained = (max_mb > 0) ? ((size_t)max_mb << 20) : 0;
+}
+
+static int
+is_pooled (size_t align, size_t size)
+{
+  return pool.enabled && size >= POOL_MIN_SIZE && align <= POOL_PAGE_SIZE;
+}
+
+void *
+pocl_host_mem_alloc (size_t align, size_t size)
+{
+  if (!is_pooled (align, size))
+    return pocl_aligned_malloc (align, size);
+
+#ifdef __linux__
+  size_t class_size = size_class_of (size);
+  void *p = NULL;
+
+  POCL_LOCK (pool.lock);
+  ++pool.allocs;
+  size_class *sc = find_size_class (class_size, 0);
+  if (sc != NULL && sc->free_list != NULL)
+    {
+      free_chunk *c = sc->free_list;
+      sc->free_list = c->next;
+      --sc->num_free;
+      pool.retained -= class_size;
+      ++pool.reused;
+      p = c;
+    }
+  else
+    ++pool.mapped;
+  POCL_UNLOCK (pool.lock);
+
+  if (p == NULL)
+    p = map_pages (class_size);
+  return p;
+#else
+  return NULL;
+#endif
+}
+
+void
+pocl_host_mem_free (void *ptr, size_t align, size_t size)
+{
+  if (ptr == NULL)
+    return;
+  if (!is_pooled (align, size))
+    {
+      pocl_aligned_free (ptr);
+      return;
+    }
+
+#ifdef __linux__
+  size_t class_size = size_class_of (size);
+  int keep = 0;
+
+  POCL_LOCK (pool.lock);
+  if (pool.retained + class_size <= pool.max_retained)
+    {
+      size_class *sc = find_size_class (class_size, 1);
+      if (sc != NULL)
+        {
+          free_chunk *c = (free_chunk *)ptr;
+          c->next = sc->free_list;
+          sc->free_list = c;
+          ++sc->num_free;
+          pool.retained += class_size;
+          if (pool.retained > pool.max_ever_retained)
+            pool.max_ever_retained = pool.retained;
+          keep = 1;
+        }
+    }
+  if (!keep)
+    ++pool.unmapped;
+  POCL_UNLOCK (pool.lock);
+
+  if (!keep)
+    munmap (ptr, class_size);
+#endif
+}
+
+void
+pocl_host_mem_pool_print_stats (void)
+{
+  if (!pool.enabled)
+    return;
+
+  POCL_LOCK (pool.lock);
+  POCL_MSG_PRINT_F (MEMORY, INFO, "",
+                    "____ Host buffer pool allocations    : %10" PRIu64 "\n"
+                    " ____ Reused from the pool            : %10" PRIu64 "\n"
+                    " ____ Mapped / unmapped               : %10" PRIu64
+                    " / %" PRIu64 "\n"
+                    " ____ Mapped with MAP_HUGETLB / THP   : %10" PRIu64
+                    " / %" PRIu64 " KB\n"
+                    " ____ Currently retained (max)        : %10zu"
+                    " (%zu) KB\n",
+                    pool.allocs, pool.reused, pool.mapped, pool.unmapped,
+                    pool.hugetlb_bytes >> 10, pool.thp_bytes >> 10,
+                    pool.retained >> 10, pool.max_ever_retained >> 10);
+  for (unsigned i = 0; i < pool.num_classes; ++i)
+    if (pool.classes[i].num_free > 0)
+      POCL_MSG_PRINT_F (MEMORY, INFO, "",
+                        "____ size class %10zu KB: %u free\n",
+                        pool.classes[i].size >> 10,
+                        pool.classes[i].num_free);
+  POCL_UNLOCK (pool.lock);
+}
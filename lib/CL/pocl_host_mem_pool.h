@@ -0,0 +1,63 @@
+/* pocl_host_mem_pool.h - pool of large host allocations backing cl_mems
+
+   Copyright (c) 2026 PoCL developers
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+*/
+
+#ifndef POCL_HOST_MEM_POOL_H
+#define POCL_HOST_MEM_POOL_H
+
+#include <stddef.h>
+
+#include "pocl_export.h"
+
+/* The mem_host_ptr of cl_mems (which is also the device memory of the CPU
+ * drivers) is allocated from this pool. Allocations of at least 128 KiB are
+ * mmapped in size classes, those of 2 MiB or more backed by 2 MiB huge pages
+ * (MAP_HUGETLB if the system has them reserved, otherwise transparent huge
+ * pages), and freed allocations are kept for reuse by the same size class up
+ * to POCL_HOST_MEM_POOL_MAX_MB. Smaller allocations and those needing more
+ * than page alignment use pocl_aligned_malloc. */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Reads the POCL_HOST_MEM_POOL* options, called at the platform init before
+ * any allocation. */
+void pocl_host_mem_pool_init (void);
+
+/* Allocates size bytes aligned to at least align. Returns NULL on failure. */
+POCL_EXPORT
+void *pocl_host_mem_alloc (size_t align, size_t size);
+
+/* Frees ptr allocated by pocl_host_mem_alloc with the same align and size. */
+POCL_EXPORT
+void pocl_host_mem_free (void *ptr, size_t align, size_t size);
+
+/* Prints the pool statistics with POCL_DEBUG=memory. */
+void pocl_host_mem_pool_print_stats (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
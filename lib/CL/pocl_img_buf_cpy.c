@@ -268,6 +268,18 @@ pocl_rect_copy (cl_command_buffer_khr command_buffer,
   pocl_buffer_migration_info *migr_infos
     = pocl_append_unique_migration_info (NULL, src, 1);
   pocl_append_unique_migration_info (migr_infos, dst, 0);
+  if (!dst_is_image)
+    {
+      /* The bounding span of the rows written to. */
+      size_t write_start = mod_dst_origin[0]
+                           + mod_dst_origin[1] * *dst_row_pitch
+                           + mod_dst_origin[2] * *dst_slice_pitch;
+      size_t write_end = write_start + (mod_region[2] - 1) * *dst_slice_pitch
+                         + (mod_region[1] - 1) * *dst_row_pitch
+                         + mod_region[0];
+      pocl_set_migration_write_range (migr_infos, dst, write_start,
+                                      write_end - write_start);
+    }
   if (src->size_buffer != NULL)
     {
       pocl_append_unique_migration_info (migr_infos, src->size_buffer, 1);
@@ -189,6 +189,29 @@ extern "C" {
    */
   unsigned pocl_llvm_get_kernel_count (cl_program program, unsigned device_i);
 
+  /* How a kernel accesses one of its pointer arguments. */
+  typedef struct pocl_kernel_arg_access
+  {
+    /* > 0: only arg[get_global_id(0)] with this element size in bytes is
+     * accessed; -1: any other access; 0: not accessed / not a pointer */
+    long stride;
+    int writes;
+  } pocl_kernel_arg_access;
+
+  /**
+   * Analyzes the accesses of the kernel to its pointer arguments, to find
+   * element-wise kernels that can be fused at work-group granularity.
+   *
+   * Returns 0 and fills the access[num_args] array on success; -1 if the
+   * kernel was not found or has side effects other than the loads & stores
+   * through its arguments (atomics, calls, non-constant globals...).
+   */
+  POCL_EXPORT
+  int pocl_llvm_get_kernel_arg_access (cl_program program, unsigned device_i,
+                                       const char *kernel_name,
+                                       unsigned num_args,
+                                       pocl_kernel_arg_access *access);
+
   /**
   * \brief Compile the kernel in infile from LLVM bitcode to native object file for
   * device, into outfile.
@@ -320,19 +343,16 @@ extern "C" {
   /**
    * \brief sets up the SPIR-V SpecConstants in the program struct
    *
-   * The same input is provided twice, once as a path to file, then as memory
-   * buffer (void* + size). The implementation (llvm-spirv, LLVMSPIRVLib) then
-   * uses the more suitable version to extract the SpecConstants
+   * The SpecConstants are found with the SPIR-V parser, without translating
+   * the module.
    *
    * \param program [in,out] the program which we're setting up
-   * \param spirv_path [in] path to tempfile which contains the SPIR-V
    * \param spirv_content [in] memory buffer with SPIR-V content
    * \param spirv_len [in] # of bytes in spirv_content
    * \returns 0 on success
    *
    */
   int pocl_get_program_spec_constants (cl_program program,
-                                       char *spirv_path,
                                        const void *spirv_content,
                                        size_t spirv_len);
 
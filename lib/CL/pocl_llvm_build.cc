@@ -46,6 +46,7 @@ IGNORE_COMPILER_WARNING("-Wstrict-aliasing")
 #endif
 
 IGNORE_COMPILER_WARNING("-Wcomment")
+#include <llvm/Bitcode/BitcodeReader.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Verifier.h>
@@ -59,6 +60,7 @@ POP_COMPILER_DIAGS
 
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <regex>
 #include <sstream>
 
@@ -73,6 +75,7 @@ POP_COMPILER_DIAGS
 #include "pocl_cache.h"
 #include "LLVMUtils.h"
 #include "pocl_util.h"
+#include "pocl_timing.h"
 
 #ifdef ENABLE_HEADER_BUNDLING
 #include "HeaderBundle/_clang_opencl.h"
@@ -288,6 +291,65 @@ static void addHeaderInclude(PreprocessorOptions &po, FrontendOptions &fe,
   po.Includes.push_back(Result);
 }
 
+/* Generates a precompiled header of the default OpenCL C headers, which
+ * the Invocation -include's, to PchPath. The PCH is written to a temporary
+ * file first, so concurrent builds never see a partial one. */
+static bool generatePCH(const CompilerInvocation &Invocation,
+                        const char *PchPath) {
+  char StubPath[POCL_MAX_PATHNAME_LENGTH];
+  char TempPchPath[POCL_MAX_PATHNAME_LENGTH];
+  static const char Stub[] = "/* precompiled OpenCL C headers */\n";
+
+  if (pocl_cache_tempname(StubPath, ".h", NULL) != 0 ||
+      pocl_write_file(StubPath, Stub, sizeof(Stub) - 1, 0) != 0)
+    return false;
+  if (pocl_cache_tempname(TempPchPath, ".pch", NULL) != 0) {
+    pocl_remove(StubPath);
+    return false;
+  }
+
+  llvm::IntrusiveRefCntPtr<clang::DiagnosticIDs> DiagID =
+      new clang::DiagnosticIDs();
+  clang::TextDiagnosticBuffer *DiagsBuffer = new clang::TextDiagnosticBuffer();
+#if LLVM_MAJOR < 21
+  llvm::IntrusiveRefCntPtr<clang::DiagnosticOptions> DiagOpts =
+      new clang::DiagnosticOptions();
+  llvm::IntrusiveRefCntPtr<clang::DiagnosticsEngine> Diags(
+      new clang::DiagnosticsEngine(DiagID, &*DiagOpts, DiagsBuffer));
+#else
+  clang::DiagnosticOptions DiagOpts{};
+  llvm::IntrusiveRefCntPtr<clang::DiagnosticsEngine> Diags(
+      new clang::DiagnosticsEngine(DiagID, DiagOpts, DiagsBuffer));
+#endif
+
+  CompilerInstance PchCI;
+  CompilerInvocation &PchInvocation = PchCI.getInvocation();
+  PchInvocation = Invocation;
+  FrontendOptions &Fe = PchInvocation.getFrontendOpts();
+  Fe.Inputs.clear();
+  Fe.Inputs.push_back(FrontendInputFile(
+      StubPath, clang::InputKind(clang::Language::OpenCL).getHeader()));
+  Fe.OutputFile.assign(TempPchPath);
+  PchInvocation.getPreprocessorOpts().ImplicitPCHInclude.clear();
+#if LLVM_MAJOR < 22
+  PchCI.setDiagnostics(&*Diags);
+#else
+  PchCI.setDiagnostics(Diags);
+#endif
+
+  clang::GeneratePCHAction GeneratePCH;
+  bool Success = PchCI.ExecuteAction(GeneratePCH);
+  pocl_remove(StubPath);
+
+  if (Success)
+    Success = (pocl_rename(TempPchPath, PchPath) == 0);
+  if (!Success) {
+    POCL_MSG_WARN("Failed to generate the precompiled headers %s\n", PchPath);
+    pocl_remove(TempPchPath);
+  }
+  return Success;
+}
+
 int pocl_llvm_build_program(cl_program program,
                             unsigned device_i,
                             cl_uint num_input_headers,
@@ -640,6 +702,10 @@ int pocl_llvm_build_program(cl_program program,
   // The CreateFromArgs created an stdin input which we should remove first.
   fe.Inputs.clear();
 
+  // The default headers are -include'd after any user given ones; they are
+  // replaced by a precompiled header when emitting the LLVM IR.
+  size_t FirstDefaultHeader = po.Includes.size();
+
   if (device->use_only_clang_opencl_headers) {
 #ifdef ENABLE_HEADER_BUNDLING
     po.Macros.push_back(
@@ -659,6 +725,18 @@ int pocl_llvm_build_program(cl_program program,
     addHeaderInclude(po, fe, "_kernel.h", false);
   }
 
+  // The PCH has to be built with the same options that affect parsing of
+  // the headers: everything except the include paths, which only matter
+  // for the program's own headers.
+  std::string PchKey;
+  for (const std::string &Item : itemstrs)
+    if (Item.compare(0, 2, "-I") != 0)
+      PchKey += Item + ' ';
+  for (size_t i = FirstDefaultHeader; i < po.Includes.size(); ++i)
+    PchKey += po.Includes[i] + ' ';
+  for (const auto &Macro : po.Macros)
+    PchKey += (Macro.second ? "-U" : "-D") + Macro.first + ' ';
+
   clang::TargetOptions &ta = pocl_build.getTargetOpts();
   ta.Triple = device->llvm_target_triplet;
   if (device->llvm_cpu != NULL)
@@ -778,9 +856,20 @@ int pocl_llvm_build_program(cl_program program,
     return CL_SUCCESS;
   }
 
-  // TODO: use pch: it is possible to disable the strict checking for
-  // the compilation flags used to compile it and the current translation
-  // unit via the preprocessor options directly.
+  // Parsing the default headers dominates the frontend time of small
+  // programs. Their PCH is keyed by the build options in the cache, so the
+  // clang's own checking of the options it was built with can be skipped.
+  char PchPath[POCL_MAX_PATHNAME_LENGTH];
+  if (pocl_get_bool_option("POCL_CLANG_PCH", 1) &&
+      pocl_cache_pch_path(PchPath, device, PchKey.c_str()) == 0 &&
+      (pocl_exists(PchPath) || generatePCH(pocl_build, PchPath))) {
+    POCL_MSG_PRINT_LLVM("Using precompiled headers %s\n", PchPath);
+    po.Includes.erase(po.Includes.begin() + FirstDefaultHeader,
+                      po.Includes.end());
+    po.ImplicitPCHInclude = PchPath;
+    po.DisablePCHOrModuleValidation = DisableValidationForModuleKind::PCH;
+  }
+
   clang::EmitLLVMOnlyAction EmitLLVM(llvm_ctx->Context);
   success = CI.ExecuteAction(EmitLLVM);
 
@@ -1024,6 +1113,72 @@ int pocl_llvm_link_program(cl_program program, unsigned device_i,
   return CL_SUCCESS;
 }
 
+/* The kernel library bitcode files, read once per process and shared by
+ * all the LLVM contexts. The lazily loaded modules reference the buffers,
+ * so they are kept until the process exits. */
+static std::map<std::string, std::unique_ptr<llvm::MemoryBuffer>>
+    KernelLibraryBuffers;
+static std::mutex KernelLibraryBuffersLock;
+
+/**
+ * Load the kernel library at Path into the given context lazily.
+ *
+ * Only the module level records (globals, declarations, metadata and the
+ * function offset index of the bitcode) are parsed here; the function bodies
+ * are materialized by the linker on demand, so only the transitive closure
+ * of the builtins a program actually calls is read into the context.
+ * POCL_KERNEL_LIB_LAZY=0 materializes the whole library here instead, for
+ * comparing the load time and memory use against the lazy loading.
+ */
+static llvm::Module *loadKernelLibraryLazy(const std::string &Path,
+                                           llvm::LLVMContext *Context) {
+  uint64_t StartTime = pocl_gettimemono_ns();
+  llvm::MemoryBufferRef BufRef;
+  {
+    std::lock_guard<std::mutex> LockGuard(KernelLibraryBuffersLock);
+    auto It = KernelLibraryBuffers.find(Path);
+    if (It == KernelLibraryBuffers.end()) {
+      ErrorOr<std::unique_ptr<MemoryBuffer>> Buf =
+          MemoryBuffer::getFile(Path, /*IsText=*/false,
+                                /*RequiresNullTerminator=*/false);
+      if (!Buf) {
+        POCL_MSG_ERR("Can't read the kernel library %s: %s\n", Path.c_str(),
+                     Buf.getError().message().c_str());
+        return nullptr;
+      }
+      It = KernelLibraryBuffers.emplace(Path, std::move(Buf.get())).first;
+    }
+    BufRef = It->second->getMemBufferRef();
+  }
+
+  Expected<std::unique_ptr<Module>> Mod =
+      getLazyBitcodeModule(BufRef, *Context);
+  if (!Mod) {
+    POCL_MSG_ERR("Can't load the kernel library %s: %s\n", Path.c_str(),
+                 toString(Mod.takeError()).c_str());
+    return nullptr;
+  }
+  if (Error E = (*Mod)->materializeMetadata()) {
+    POCL_MSG_ERR("Can't load the metadata of the kernel library %s: %s\n",
+                 Path.c_str(), toString(std::move(E)).c_str());
+    return nullptr;
+  }
+  bool Lazy = pocl_get_bool_option("POCL_KERNEL_LIB_LAZY", 1);
+  if (!Lazy) {
+    if (Error E = (*Mod)->materializeAll()) {
+      POCL_MSG_ERR("Can't load the kernel library %s: %s\n", Path.c_str(),
+                   toString(std::move(E)).c_str());
+      return nullptr;
+    }
+  }
+
+  uint64_t LoadTime = pocl_gettimemono_ns() - StartTime;
+  POCL_MSG_PRINT_LLVM("Loaded %s of %zu built-in lib functions in %lu us.\n",
+                      Lazy ? "the index" : "the bodies", (*Mod)->size(),
+                      (unsigned long)(LoadTime / 1000));
+  return Mod->release();
+}
+
 /**
  * Return the OpenCL C built-in function library bitcode
  * for the given device.
@@ -1068,14 +1223,14 @@ static llvm::Module *getKernelLibrary(cl_device_id device,
   if (pocl_exists(BuiltinLibrary.c_str())) {
     POCL_MSG_PRINT_LLVM("Using %s as the built-in lib.\n",
                         BuiltinLibrary.c_str());
-    BuiltinLibModule = parseModuleIR(BuiltinLibrary.c_str(), llvmContext);
+    BuiltinLibModule = loadKernelLibraryLazy(BuiltinLibrary, llvmContext);
   } else {
     if (device->kernellib_fallback_name &&
         pocl_exists(BuiltinLibraryFallback.c_str())) {
       POCL_MSG_WARN("Using fallback %s as the built-in lib.\n",
                     BuiltinLibraryFallback.c_str());
       BuiltinLibModule =
-          parseModuleIR(BuiltinLibraryFallback.c_str(), llvmContext);
+          loadKernelLibraryLazy(BuiltinLibraryFallback, llvmContext);
     } else
       POCL_MSG_ERR("Can't find either kernel library file %s or fallback %s.\n",
                    BuiltinLibrary.c_str(), BuiltinLibraryFallback.c_str());
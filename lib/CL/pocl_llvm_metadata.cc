@@ -34,6 +34,9 @@ IGNORE_COMPILER_WARNING("-Wunused-parameter")
 #include <llvm/IR/Function.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/DataLayout.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/Analysis/ValueTracking.h>
 #include <llvm/ADT/SmallVector.h>
 
 #include <iostream>
@@ -45,6 +48,7 @@ IGNORE_COMPILER_WARNING("-Wunused-parameter")
 #include "pocl_llvm_api.h"
 #include "pocl_cache.h"
 #include "LLVMUtils.h"
+#include "KernelCompilerUtils.h"
 
 using namespace llvm;
 
@@ -763,3 +767,171 @@ unsigned pocl_llvm_get_kernel_count(cl_program program, unsigned device_i) {
     return kernel_count;
   }
 }
+
+/* Returns true if V is get_global_id(0), possibly through integer casts. */
+static bool isGlobalIdX(const Value *V) {
+  while (const CastInst *C = dyn_cast<CastInst>(V)) {
+    if (!isa<SExtInst>(C) && !isa<ZExtInst>(C) && !isa<TruncInst>(C))
+      return false;
+    V = C->getOperand(0);
+  }
+  const CallInst *Call = dyn_cast<CallInst>(V);
+  if (Call == nullptr || Call->getCalledFunction() == nullptr ||
+      Call->getCalledFunction()->getName() != GID_BUILTIN_NAME)
+    return false;
+  const ConstantInt *Dim = dyn_cast<ConstantInt>(Call->getArgOperand(0));
+  return Dim != nullptr && Dim->isZero();
+}
+
+/* Returns the constant multiplier of get_global_id(0) in a GEP index
+ * (1 for the plain id, C for id * C or id << log2(C)), 0 if the index
+ * is something else. */
+static uint64_t globalIdXScale(const Value *Idx) {
+  if (isGlobalIdX(Idx))
+    return 1;
+  const BinaryOperator *BO = dyn_cast<BinaryOperator>(Idx);
+  if (BO == nullptr)
+    return 0;
+  const ConstantInt *C = dyn_cast<ConstantInt>(BO->getOperand(1));
+  if (C == nullptr || !isGlobalIdX(BO->getOperand(0)) ||
+      C->getValue().getActiveBits() > 32)
+    return 0;
+  if (BO->getOpcode() == Instruction::Mul)
+    return C->getZExtValue();
+  if (BO->getOpcode() == Instruction::Shl)
+    return (uint64_t)1 << C->getZExtValue();
+  return 0;
+}
+
+/* Walks the uses of a pointer argument (or a value derived from it). The
+ * only accepted pattern is Ptr[get_global_id(0)] accessed with loads and
+ * stores that are not wider than the element, which means that each
+ * work-item only touches its own Stride-sized slot of the buffer. */
+static bool walkArgUses(const Value *V, bool Indexed, uint64_t &Stride,
+                        bool &Writes, const DataLayout &DL) {
+  for (const User *U : V->users()) {
+    if (isa<BitCastInst>(U) || isa<AddrSpaceCastInst>(U)) {
+      if (!walkArgUses(U, Indexed, Stride, Writes, DL))
+        return false;
+    } else if (isa<ICmpInst>(U)) {
+      continue;
+    } else if (const GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(U)) {
+      if (Indexed || GEP->getPointerOperand() != V ||
+          GEP->getNumIndices() != 1)
+        return false;
+      uint64_t Scale = globalIdXScale(GEP->getOperand(1));
+      uint64_t ElemStride =
+          Scale * DL.getTypeAllocSize(GEP->getSourceElementType());
+      if (ElemStride == 0 || (Stride != 0 && Stride != ElemStride))
+        return false;
+      Stride = ElemStride;
+      if (!walkArgUses(U, true, Stride, Writes, DL))
+        return false;
+    } else if (const LoadInst *LI = dyn_cast<LoadInst>(U)) {
+      if (!Indexed || !LI->isSimple() ||
+          DL.getTypeStoreSize(LI->getType()) > Stride)
+        return false;
+    } else if (const StoreInst *SI = dyn_cast<StoreInst>(U)) {
+      if (!Indexed || !SI->isSimple() || SI->getValueOperand() == V ||
+          DL.getTypeStoreSize(SI->getValueOperand()->getType()) > Stride)
+        return false;
+      Writes = true;
+    } else
+      return false;
+  }
+  return true;
+}
+
+static bool isWorkItemBuiltin(StringRef Name) {
+  static const char *Builtins[] = {
+      GID_BUILTIN_NAME,       GS_BUILTIN_NAME,         GROUP_ID_BUILTIN_NAME,
+      LID_BUILTIN_NAME,       LS_BUILTIN_NAME,         GOFF_BUILTIN_NAME,
+      ENQUEUE_LS_BUILTIN_NAME, NGROUPS_BUILTIN_NAME,   WDIM_BUILTIN_NAME,
+      GLID_BUILTIN_NAME,      LLID_BUILTIN_NAME,       "_Z15get_global_sizej"};
+  for (const char *B : Builtins)
+    if (Name == B)
+      return true;
+  return false;
+}
+
+/* Checks that the kernel has no side effects other than the loads and
+ * stores through its own arguments, private variables and constants. */
+static bool kernelMemoryIsLocal(const Function &F) {
+  for (const BasicBlock &BB : F) {
+    for (const Instruction &I : BB) {
+      if (isa<AtomicRMWInst>(I) || isa<AtomicCmpXchgInst>(I) ||
+          isa<FenceInst>(I))
+        return false;
+      if (const CallInst *Call = dyn_cast<CallInst>(&I)) {
+        const Function *Callee = Call->getCalledFunction();
+        if (Callee != nullptr && isWorkItemBuiltin(Callee->getName()))
+          continue;
+        if (isa<DbgInfoIntrinsic>(Call) || Call->isLifetimeStartOrEnd())
+          continue;
+        if (Call->doesNotAccessMemory() && !Call->isConvergent())
+          continue;
+        return false;
+      }
+      if (isa<InvokeInst>(I) || isa<CallBrInst>(I))
+        return false;
+
+      const Value *Ptr = nullptr;
+      bool IsStore = false;
+      if (const LoadInst *LI = dyn_cast<LoadInst>(&I))
+        Ptr = LI->getPointerOperand();
+      else if (const StoreInst *SI = dyn_cast<StoreInst>(&I)) {
+        Ptr = SI->getPointerOperand();
+        IsStore = true;
+      } else
+        continue;
+
+      const Value *Obj = getUnderlyingObject(Ptr);
+      if (isa<Argument>(Obj) || isa<AllocaInst>(Obj))
+        continue;
+      const GlobalVariable *GV = dyn_cast<GlobalVariable>(Obj);
+      if (GV != nullptr && GV->isConstant() && !IsStore)
+        continue;
+      return false;
+    }
+  }
+  return true;
+}
+
+int pocl_llvm_get_kernel_arg_access(cl_program program, unsigned device_i,
+                                    const char *kernel_name,
+                                    unsigned num_args,
+                                    pocl_kernel_arg_access *access) {
+
+  cl_context ctx = program->context;
+  PoclLLVMContextData *llvm_ctx = (PoclLLVMContextData *)ctx->llvm_context_data;
+  PoclCompilerMutexGuard lockHolder(&llvm_ctx->Lock);
+
+  if (program->llvm_irs == nullptr || program->llvm_irs[device_i] == nullptr)
+    return -1;
+  llvm::Module *mod = static_cast<llvm::Module *>(program->llvm_irs[device_i]);
+  llvm::Function *F = mod->getFunction(kernel_name);
+  if (F == nullptr || F->isDeclaration() || F->arg_size() != num_args)
+    return -1;
+
+  if (!kernelMemoryIsLocal(*F))
+    return -1;
+
+  const DataLayout &DL = mod->getDataLayout();
+  for (unsigned i = 0; i < num_args; ++i) {
+    const Argument *Arg = F->getArg(i);
+    access[i].stride = 0;
+    access[i].writes = 0;
+    if (!Arg->getType()->isPointerTy())
+      continue;
+    uint64_t Stride = 0;
+    bool Writes = false;
+    if (walkArgUses(Arg, false, Stride, Writes, DL)) {
+      access[i].stride = Stride;
+      access[i].writes = Writes;
+    } else {
+      access[i].stride = -1;
+      access[i].writes = 1;
+    }
+  }
+  return 0;
+}
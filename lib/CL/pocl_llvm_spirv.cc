@@ -46,6 +46,7 @@ POP_COMPILER_DIAGS
 #include "pocl_cache.h"
 #include "pocl_compiler_macros.h"
 #include "pocl_file_util.h"
+#include "pocl_hash.h"
 #include "pocl_llvm.h"
 #include "pocl_llvm_api.h"
 #include "pocl_run_command.h"
@@ -53,12 +54,15 @@ POP_COMPILER_DIAGS
 #include "pocl_util.h"
 
 #include <iostream>
+#include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <regex>
 #include <sstream>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 #ifdef HAVE_LLVM_SPIRV_LIB
@@ -219,13 +223,158 @@ SPIRV::TranslatorOpts setupTranslOpts(const std::string &SupportedSPVExts,
 }
 #endif
 
-/* max number of lines in output of 'llvm-spirv --spec-const-info' */
-#define MAX_SPEC_CONSTANT_LINES 4096
-/* max bytes in output of 'llvm-spirv --spec-const-info' */
-#define MAX_OUTPUT_BYTES 65536
 #define MAX_SPEC_CONST_CMDLINE_LEN 8192
 #define MAX_SPEC_CONST_OPT_LEN 256
 
+#define DEFAULT_TRANSLATION_CACHE_MB 64
+
+/* In-memory cache of SPIR-V -> LLVM bitcode translations, keyed by a hash of
+ * the SPIR-V, the translation options and the specialization constant
+ * values. SYCL and HIP runtimes create programs from the same SPIR-V modules
+ * repeatedly; with this they translate each only once per process, also when
+ * the kernel cache is disabled or misses because of different build options.
+ * The least recently used translations are dropped when the total size
+ * exceeds POCL_SPIRV_TRANSLATION_CACHE_MB. */
+class SPIRVTranslationCache {
+public:
+  SPIRVTranslationCache() {
+    int MaxMB = pocl_get_int_option("POCL_SPIRV_TRANSLATION_CACHE_MB",
+                                    DEFAULT_TRANSLATION_CACHE_MB);
+    MaxBytes = (MaxMB > 0) ? ((size_t)MaxMB << 20) : 0;
+  }
+
+  // Returns a malloc'd copy of the cached translation.
+  bool lookup(const std::string &Key, char **Content, uint64_t *Size) {
+    if (MaxBytes == 0)
+      return false;
+    std::lock_guard<std::mutex> Guard(Lock);
+    auto It = Index.find(Key);
+    if (It == Index.end())
+      return false;
+    Entries.splice(Entries.begin(), Entries, It->second);
+    const std::string &Bitcode = It->second->second;
+    *Content = (char *)malloc(Bitcode.size());
+    if (*Content == nullptr)
+      return false;
+    memcpy(*Content, Bitcode.data(), Bitcode.size());
+    *Size = Bitcode.size();
+    return true;
+  }
+
+  void insert(const std::string &Key, const char *Content, uint64_t Size) {
+    if (Size > MaxBytes)
+      return;
+    std::lock_guard<std::mutex> Guard(Lock);
+    if (Index.find(Key) != Index.end())
+      return;
+    Entries.emplace_front(Key, std::string(Content, Size));
+    Index[Key] = Entries.begin();
+    TotalBytes += Size;
+    while (TotalBytes > MaxBytes) {
+      TotalBytes -= Entries.back().second.size();
+      Index.erase(Entries.back().first);
+      Entries.pop_back();
+    }
+  }
+
+private:
+  typedef std::list<std::pair<std::string, std::string>> EntryList;
+  std::mutex Lock;
+  EntryList Entries; // most recently used first
+  std::unordered_map<std::string, EntryList::iterator> Index;
+  size_t TotalBytes = 0;
+  size_t MaxBytes;
+};
+
+[[maybe_unused]] static SPIRVTranslationCache &getTranslationCache() {
+  static SPIRVTranslationCache Cache;
+  return Cache;
+}
+
+/* Hashes everything the result of a SPIR-V -> bitcode translation depends
+ * on. Program is used for the specialization constants, can be NULL. */
+[[maybe_unused]] static std::string
+getTranslationKey(const char *Kind, const char *Spirv, uint64_t SpirvSize,
+                  const char *SPVExtensions, bool GenericAS,
+                  cl_program Program) {
+  SHA1_CTX HashCtx;
+  uint8_t Digest[SHA1_DIGEST_SIZE];
+  pocl_SHA1_Init(&HashCtx);
+  pocl_SHA1_Update(&HashCtx, (const uint8_t *)Kind, strlen(Kind) + 1);
+  if (SPVExtensions != nullptr)
+    pocl_SHA1_Update(&HashCtx, (const uint8_t *)SPVExtensions,
+                     strlen(SPVExtensions));
+  uint8_t GenericASByte = GenericAS;
+  pocl_SHA1_Update(&HashCtx, &GenericASByte, 1);
+  if (Program != nullptr) {
+    for (unsigned I = 0; I < Program->num_spec_consts; ++I) {
+      if (!Program->spec_const_is_set[I])
+        continue;
+      pocl_SHA1_Update(&HashCtx,
+                       (const uint8_t *)&Program->spec_const_ids[I],
+                       sizeof(cl_uint));
+      pocl_SHA1_Update(&HashCtx,
+                       (const uint8_t *)&Program->spec_const_values[I],
+                       sizeof(uint64_t));
+    }
+  }
+  pocl_SHA1_Update(&HashCtx, (const uint8_t *)Spirv, SpirvSize);
+  pocl_SHA1_Final(&HashCtx, Digest);
+  return std::string((const char *)Digest, SHA1_DIGEST_SIZE);
+}
+
+[[maybe_unused]] static void setProgramBinary(cl_program Program,
+                                              cl_uint DeviceI, char *Content,
+                                              uint64_t ContentSize) {
+  if (Program->binaries[DeviceI])
+    POCL_MEM_FREE(Program->binaries[DeviceI]);
+  Program->binaries[DeviceI] = (unsigned char *)Content;
+  Program->binary_sizes[DeviceI] = ContentSize;
+}
+
+/* Writes Content into Path if it's non-NULL, creating a temporary file name
+ * into it if it's empty (like handleInOutPathArgs). */
+[[maybe_unused]] static int writeRequestedFile(char *Path, const char *Suffix,
+                                               const char *Content,
+                                               uint64_t Size) {
+  if (Path == nullptr)
+    return 0;
+  if (Path[0] == 0)
+    pocl_cache_tempname(Path, Suffix, NULL);
+  return pocl_write_file(Path, Content, Size, 0);
+}
+
+/* Sets up the program's SPIR-V SpecConstants using the SPIR-V parser. */
+int pocl_get_program_spec_constants(cl_program program,
+                                    const void *spirv_content,
+                                    size_t spirv_len) {
+  std::vector<SPIRVParser::SpecConstInfo> SpecConsts;
+  program->num_spec_consts = 0;
+  if (!SPIRVParser::getSpecConstants((const int32_t *)spirv_content,
+                                     spirv_len / sizeof(int32_t),
+                                     SpecConsts)) {
+    POCL_MSG_ERR("Can't parse the SPIR-V spec constants\n");
+    return CL_INVALID_BINARY;
+  }
+
+  size_t NumConst = SpecConsts.size();
+  program->num_spec_consts = NumConst;
+  if (NumConst > 0) {
+    program->spec_const_ids = (cl_uint *)calloc(NumConst, sizeof(cl_uint));
+    program->spec_const_sizes = (cl_uint *)calloc(NumConst, sizeof(cl_uint));
+    program->spec_const_values =
+        (uint64_t *)calloc(NumConst, sizeof(uint64_t));
+    program->spec_const_is_set = (char *)calloc(NumConst, sizeof(char));
+    for (unsigned i = 0; i < program->num_spec_consts; ++i) {
+      program->spec_const_ids[i] = SpecConsts[i].ID;
+      program->spec_const_sizes[i] = SpecConsts[i].Size;
+      program->spec_const_values[i] = 0;
+      program->spec_const_is_set[i] = CL_FALSE;
+    }
+  }
+  return CL_SUCCESS;
+}
+
 
 #if defined(HAVE_LLVM_SPIRV_LIB)
 
@@ -234,6 +383,18 @@ SPIRV::TranslatorOpts setupTranslOpts(const std::string &SupportedSPVExts,
 int pocl_regen_spirv_binary(cl_program Program, cl_uint DeviceI) {
   cl_device_id Device = Program->devices[DeviceI];
 
+  std::string Key = getTranslationKey(
+      "regen", (const char *)Program->program_il, Program->program_il_size,
+      Device->supported_spirv_extensions, Device->generic_as_support,
+      Program);
+  char *Content = nullptr;
+  uint64_t ContentSize = 0;
+  if (getTranslationCache().lookup(Key, &Content, &ContentSize)) {
+    POCL_MSG_PRINT_LLVM("Reusing an earlier translation of the SPIR-V\n");
+    setProgramBinary(Program, DeviceI, Content, ContentSize);
+    return CL_SUCCESS;
+  }
+
   bool UnrecognizedVersion = false;
   // Don't limit the Max SPIR-V version when doing reverse translation
   pocl_version_t MaxSupportedVersion = MaxSPIRVLibSupportedVersion;
@@ -263,8 +424,6 @@ int pocl_regen_spirv_binary(cl_program Program, cl_uint DeviceI) {
   std::string InputS((char *)Program->program_il, Program->program_il_size);
   std::stringstream InputSS(InputS);
   llvm::Module *Mod = nullptr;
-  char *Content = nullptr;
-  uint64_t ContentSize = 0;
 
   if (!readSpirv(LLVMCtx, Opts, InputSS, Mod, Errors)) {
     POCL_MSG_ERR("LLVMSPIRVLib failed to read SPIR-V with errors:\n%s\n",
@@ -281,41 +440,12 @@ int pocl_regen_spirv_binary(cl_program Program, cl_uint DeviceI) {
   ContentSize = OutputBC.size();
   delete Mod;
 
-  if (Program->binaries[DeviceI])
-    POCL_MEM_FREE(Program->binaries[DeviceI]);
-  Program->binaries[DeviceI] = (unsigned char *)Content;
-  Program->binary_sizes[DeviceI] = ContentSize;
+  getTranslationCache().insert(Key, Content, ContentSize);
+  setProgramBinary(Program, DeviceI, Content, ContentSize);
 
   return CL_SUCCESS;
 }
 
-int pocl_get_program_spec_constants(cl_program program, char *spirv_path,
-                                    const void *spirv_content,
-                                    size_t spirv_len) {
-  std::string InputS((const char *)spirv_content, spirv_len);
-  std::stringstream InputSS(InputS);
-  std::vector<llvm::SpecConstInfoTy> SpecConstInfoVec;
-  if (!llvm::getSpecConstInfo(InputSS, SpecConstInfoVec))
-    return CL_INVALID_BINARY;
-
-  size_t NumConst = SpecConstInfoVec.size();
-  program->num_spec_consts = NumConst;
-  if (NumConst > 0) {
-    program->spec_const_ids = (cl_uint *)calloc(NumConst, sizeof(cl_uint));
-    program->spec_const_sizes = (cl_uint *)calloc(NumConst, sizeof(cl_uint));
-    program->spec_const_values =
-        (uint64_t *)calloc(NumConst, sizeof(uint64_t));
-    program->spec_const_is_set = (char *)calloc(NumConst, sizeof(char));
-    for (unsigned i = 0; i < program->num_spec_consts; ++i) {
-      program->spec_const_ids[i] = SpecConstInfoVec[i].ID;
-      program->spec_const_sizes[i] = SpecConstInfoVec[i].Size;
-      program->spec_const_values[i] = 0;
-      program->spec_const_is_set[i] = CL_FALSE;
-    }
-  }
-  return CL_SUCCESS;
-}
-
 #elif defined(HAVE_LLVM_SPIRV)
 
 /* if some SPIR-V spec constants were changed, use llvm-spirv --spec-const=...
@@ -333,6 +463,18 @@ int pocl_regen_spirv_binary(cl_program program, cl_uint device_i) {
   program_bc_spirv[0] = 0;
   unlinked_program_bc_temp[0] = 0;
 
+  std::string Key = getTranslationKey(
+      "regen", (const char *)program->program_il, program->program_il_size,
+      Device->supported_spirv_extensions, Device->generic_as_support,
+      program);
+  char *Content = nullptr;
+  uint64_t ContentSize = 0;
+  if (getTranslationCache().lookup(Key, &Content, &ContentSize)) {
+    POCL_MSG_PRINT_LLVM("Reusing an earlier translation of the SPIR-V\n");
+    setProgramBinary(program, device_i, Content, ContentSize);
+    return CL_SUCCESS;
+  }
+
   // Don't limit the Max SPIR-V version when doing reverse translation
 
   /* using --spirv-target-env=CL2.0 here enables llvm-spirv to produce proper
@@ -398,6 +540,8 @@ int pocl_regen_spirv_binary(cl_program program, cl_uint device_i) {
       (pocl_reload_program_bc(unlinked_program_bc_temp, program, device_i)),
       CL_INVALID_VALUE, "Can't read llvm-spirv converted bitcode file\n");
 
+  getTranslationCache().insert(Key, (const char *)program->binaries[device_i],
+                               program->binary_sizes[device_i]);
   errcode = CL_SUCCESS;
 
 ERROR:
@@ -410,80 +554,8 @@ ERROR:
   return errcode;
 }
 
-int pocl_get_program_spec_constants(cl_program program, char *spirv_path,
-                                    [[maybe_unused]] const void *spirv_content,
-                                    [[maybe_unused]] size_t spirv_len) {
-  const char *args[] = {pocl_get_path("LLVM_SPIRV", LLVM_SPIRV),
-                        "--spec-const-info", spirv_path, NULL};
-  char captured_output[MAX_OUTPUT_BYTES];
-  size_t captured_bytes = MAX_OUTPUT_BYTES;
-  int errcode = CL_SUCCESS;
-  unsigned num_const = 0;
-
-  errcode =
-      pocl_run_command_capture_output(captured_output, &captured_bytes, args);
-  POCL_RETURN_ERROR_ON((errcode != 0), CL_INVALID_BINARY,
-                       "External command "
-                       "(llvm-spirv --spec-const-info) failed!\n");
-
-  captured_output[captured_bytes] = 0;
-  char *lines[MAX_SPEC_CONSTANT_LINES];
-  unsigned num_lines = 0;
-  char delim[2] = {0x0A, 0x0};
-  char *token = strtok(captured_output, delim);
-  while (num_lines < MAX_SPEC_CONSTANT_LINES && token != NULL) {
-    lines[num_lines++] = strdup(token);
-    token = strtok(NULL, delim);
-  }
-  POCL_GOTO_ERROR_ON((num_lines == 0 || num_lines >= MAX_SPEC_CONSTANT_LINES),
-                     CL_INVALID_BINARY, "Can't parse output from llvm-spirv\n");
-
-  errcode = sscanf(
-      lines[0], "Number of scalar specialization constants in the module = %u",
-      &num_const);
-  POCL_GOTO_ERROR_ON((errcode < 1 || num_const > num_lines), CL_INVALID_BINARY,
-                     "Can't parse first line of output");
-
-  program->num_spec_consts = num_const;
-  if (num_const > 0) {
-    program->spec_const_ids = (cl_uint *)calloc(num_const, sizeof(cl_uint));
-    program->spec_const_sizes = (cl_uint *)calloc(num_const, sizeof(cl_uint));
-    program->spec_const_values =
-        (uint64_t *)calloc(num_const, sizeof(uint64_t));
-    program->spec_const_is_set = (char *)calloc(num_const, sizeof(char));
-    for (unsigned i = 0; i < program->num_spec_consts; ++i) {
-      unsigned spec_id, spec_size;
-      int r = sscanf(lines[i + 1], "Spec const id = %u, size in bytes = %u",
-                     &spec_id, &spec_size);
-      POCL_GOTO_ERROR_ON((r < 2), CL_INVALID_BINARY,
-                         "Can't parse %u-th line of output:\n%s\n", i + 1,
-                         lines[i + 1]);
-      program->spec_const_ids[i] = spec_id;
-      program->spec_const_sizes[i] = spec_size;
-      program->spec_const_values[i] = 0;
-      program->spec_const_is_set[i] = CL_FALSE;
-    }
-  }
-  errcode = CL_SUCCESS;
-ERROR:
-  for (unsigned i = 0; i < num_lines; ++i)
-    free(lines[i]);
-  if (errcode != CL_SUCCESS) {
-    program->num_spec_consts = 0;
-  }
-  return errcode;
-}
-
 #else
 
-int pocl_get_program_spec_constants(cl_program program, char *spirv_path,
-                                    const void *spirv_content,
-                                    size_t spirv_len) {
-  POCL_MSG_ERR("No way to parse spec constants from SPIRV\n");
-  program->num_spec_consts = 0;
-  return CL_INVALID_OPERATION;
-}
-
 int pocl_regen_spirv_binary(cl_program program, cl_uint device_i) {
   POCL_MSG_ERR("No way to regenerate SPIRV with new SpecConstants\n");
   return CL_INVALID_OPERATION;
@@ -539,13 +611,25 @@ static int convertBCorSPV(char *InputPath,
 #endif
   int r = -1;
 
-  handleInOutPathArgs(keepOutputPath, OutputPath, HiddenOutputPath, Reverse,
-                      OutContent);
+#ifdef HAVE_LLVM_SPIRV_LIB
+  // LLVMSPIRVLib translates in memory, files are only written if the caller
+  // asked for them.
+  const bool UseTempFiles = false;
+#else
+  const bool UseTempFiles = true;
+#endif
+  keepOutputPath = keepInputPath = false;
+  HiddenOutputPath[0] = HiddenInputPath[0] = 0;
 
-  handleInOutPathArgs(keepInputPath, InputPath, HiddenInputPath, Reverse,
-                      &InputContent);
+  if (UseTempFiles || OutputPath)
+    handleInOutPathArgs(keepOutputPath, OutputPath, HiddenOutputPath, Reverse,
+                        OutContent);
 
-  if (InputContent && InputSize) {
+  if (UseTempFiles || InputPath)
+    handleInOutPathArgs(keepInputPath, InputPath, HiddenInputPath, Reverse,
+                        &InputContent);
+
+  if (InputContent && InputSize && HiddenInputPath[0]) {
     r = pocl_write_file(HiddenInputPath, InputContent, InputSize, 0);
     if (r != 0) {
       BuildLog->append("failed to write input file for llvm-spirv\n");
@@ -695,9 +779,9 @@ FINISHED:
                         HiddenInputPath, HiddenOutputPath);
 #endif
   } else {
-    if (!keepInputPath)
+    if (!keepInputPath && HiddenInputPath[0])
       pocl_remove(HiddenInputPath);
-    if (!keepOutputPath)
+    if (!keepOutputPath && HiddenOutputPath[0])
       pocl_remove(HiddenOutputPath);
   }
 
@@ -869,6 +953,25 @@ int pocl_convert_spirv_to_bitcode(char *TempSpirvPath, const char *SpirvContent,
 
   std::string BuildLog;
 
+  bool Cacheable = SpirvContent != nullptr && SpirvSize > 0 &&
+                   BitcodeContent != nullptr && BitcodeSize != nullptr;
+  std::string Key;
+  if (Cacheable) {
+    Key = getTranslationKey("convert", SpirvContent, SpirvSize, SPVExtensions,
+                            true, nullptr);
+    if (getTranslationCache().lookup(Key, BitcodeContent, BitcodeSize)) {
+      POCL_MSG_PRINT_LLVM("Reusing an earlier translation of the SPIR-V\n");
+      // still produce the files the caller asked for
+      if (writeRequestedFile(TempSpirvPath, ".spv", SpirvContent, SpirvSize) ||
+          writeRequestedFile(TempBitcodePathOut, ".bc", *BitcodeContent,
+                             *BitcodeSize)) {
+        POCL_MEM_FREE(*BitcodeContent);
+        return -1;
+      }
+      return 0;
+    }
+  }
+
   int R = convertBCorSPV(
       TempSpirvPath, SpirvContent, SpirvSize, &BuildLog, SPVExtensions,
       1, // = Reverse.
@@ -881,6 +984,8 @@ int pocl_convert_spirv_to_bitcode(char *TempSpirvPath, const char *SpirvContent,
   if (!BuildLog.empty())
     pocl_append_to_buildlog(Program, DeviceI, strdup(BuildLog.c_str()),
                             BuildLog.size());
+  if (R == 0 && Cacheable)
+    getTranslationCache().insert(Key, *BitcodeContent, *BitcodeSize);
   return R;
 }
 
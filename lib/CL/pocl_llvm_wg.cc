@@ -322,6 +322,15 @@ public:
   void run(llvm::Module &Bitcode);
 };
 
+// Returns true if the work-item loops of the work-group functions are
+// vectorized in the second stage.
+static bool vectorizesWorkItemLoops(cl_device_id Dev) {
+  // Let's assume SPMD devices do their own vectorization at (SPIR-V) JIT time
+  // if they see it beneficial.
+  return (CurrentWgMethod == "loopvec" || CurrentWgMethod == "cbs") &&
+         (!Dev->spmd);
+}
+
 llvm::Error TwoStagePoCLModulePassManager::build(
     cl_device_id Dev, const std::string &Stage1Pipeline, unsigned Stage1OLevel,
     unsigned Stage1SLevel, const std::string &Stage2Pipeline,
@@ -346,10 +355,7 @@ llvm::Error TwoStagePoCLModulePassManager::build(
   if (E1)
     return E1;
 
-  // Let's assume SPMD devices do their own vectorization at (SPIR-V) JIT time
-  // if they see it beneficial.
-  Vectorize = ((CurrentWgMethod == "loopvec" || CurrentWgMethod == "cbs") &&
-               (!Dev->spmd));
+  Vectorize = vectorizesWorkItemLoops(Dev);
 
   return Stage2.build(Stage2Pipeline, Stage2OLevel, Stage2SLevel, Vectorize,
 #ifndef PER_STAGE_TARGET_MACHINE
@@ -580,6 +586,12 @@ static void addStage2PassesToPipeline(cl_device_id Dev,
     // Remove the (pseudo) barriers.   They have no use anymore due to the
     // work-item loop control taking care of them.
     addPass(Passes, "remove-barriers");
+
+    // Move the uniform values out of the work-item loops while the
+    // uniformity analysis results are still available. The standard LICM
+    // cannot hoist the uniform loads as the loops store to the id pseudo
+    // variables which may alias the kernel arguments.
+    addPass(Passes, "hoist-uniforms");
   }
 
   // verify & print the module
@@ -927,6 +939,8 @@ pocl_llvm_run_pocl_passes(llvm::Module *Bitcode,
   if (Program->compiler_options)
     Opts.assign(Program->compiler_options);
   bool Optimize = (Opts.find("-cl-opt-disable") == std::string::npos);
+  setModuleBoolMetadata(Bitcode, "WGVectorizeLoops",
+                        Optimize && vectorizesWorkItemLoops(Device));
 #ifdef DUMP_LLVM_PASS_TIMINGS
   llvm::TimePassesIsEnabled = true;
 #endif
@@ -23,7 +23,10 @@
 */
 
 #include "pocl_mem_management.h"
+#include "devices.h"
 #include "pocl.h"
+#include "pocl_host_mem_pool.h"
+#include "pocl_runtime_config.h"
 #include "pocl_util.h"
 
 #include "utlist.h"
@@ -597,6 +600,345 @@ update_subbuffer_versioning_data (cl_mem updated_buf)
     }
 }
 
+/* Dirty range tracking.
+ *
+ * Each tracked buffer logs the byte ranges written by its latest versions.
+ * A location (device memory or mem_host_ptr) holding version v can then be
+ * brought up to date by copying only the ranges logged for the versions
+ * after v. A write of an unknown range, a gap in the logged versions (the
+ * version was bumped without logging) and dropping the oldest entries of a
+ * full log all move base_version up, and locations older than it copy the
+ * whole buffer. */
+
+#define DIRTY_LOG_ENTRIES 16
+
+typedef struct pocl_dirty_log
+{
+  /* Locations with a version below this need a full migration. */
+  uint64_t base_version;
+  /* The version of the newest entry (or base_version). */
+  uint64_t last_version;
+  unsigned first;
+  unsigned num;
+  struct
+  {
+    uint64_t version;
+    uint64_t start;
+    uint64_t end;
+  } entries[DIRTY_LOG_ENTRIES];
+} pocl_dirty_log;
+
+static int dirty_ranges_enabled = 0;
+
+void
+pocl_init_dirty_range_tracking (void)
+{
+  dirty_ranges_enabled
+    = pocl_get_bool_option ("POCL_MIGRATE_DIRTY_RANGES", 0);
+}
+
+void
+pocl_interval_set_add (pocl_interval_set *set, uint64_t start, uint64_t end)
+{
+  if (start >= end)
+    return;
+
+  /* Find the first range that ends at or after start. */
+  unsigned i = 0;
+  while (i < set->num && set->end[i] < start)
+    ++i;
+
+  /* Merge all the ranges touching [start, end) into it. */
+  unsigned j = i;
+  while (j < set->num && set->start[j] <= end)
+    {
+      if (set->start[j] < start)
+        start = set->start[j];
+      if (set->end[j] > end)
+        end = set->end[j];
+      ++j;
+    }
+
+  if (j > i)
+    {
+      /* Replace ranges i..j-1 with the merged one. */
+      set->start[i] = start;
+      set->end[i] = end;
+      unsigned removed = j - i - 1;
+      for (unsigned k = i + 1; k + removed < set->num; ++k)
+        {
+          set->start[k] = set->start[k + removed];
+          set->end[k] = set->end[k + removed];
+        }
+      set->num -= removed;
+      return;
+    }
+
+  if (set->num == POCL_MAX_MIGRATION_RANGES)
+    {
+      /* Full: add the range to the list anyway by merging the two closest
+         neighbours (which can include the new range) first. */
+      uint64_t new_start = start, new_end = end;
+      unsigned best = 0;
+      uint64_t best_gap = UINT64_MAX;
+      for (unsigned k = 0; k + 1 < set->num; ++k)
+        {
+          uint64_t gap = set->start[k + 1] - set->end[k];
+          if (gap < best_gap)
+            {
+              best_gap = gap;
+              best = k;
+            }
+        }
+      if (i > 0 && start - set->end[i - 1] < best_gap)
+        {
+          set->end[i - 1] = end;
+          return;
+        }
+      if (i < set->num && set->start[i] - end < best_gap)
+        {
+          set->start[i] = start;
+          return;
+        }
+      set->end[best] = set->end[best + 1];
+      for (unsigned k = best + 1; k + 1 < set->num; ++k)
+        {
+          set->start[k] = set->start[k + 1];
+          set->end[k] = set->end[k + 1];
+        }
+      --set->num;
+      pocl_interval_set_add (set, new_start, new_end);
+      return;
+    }
+
+  for (unsigned k = set->num; k > i; --k)
+    {
+      set->start[k] = set->start[k - 1];
+      set->end[k] = set->end[k - 1];
+    }
+  set->start[i] = start;
+  set->end[i] = end;
+  ++set->num;
+}
+
+/* Returns the number of bytes covered by the set. */
+static uint64_t
+interval_set_bytes (const pocl_interval_set *set)
+{
+  uint64_t bytes = 0;
+  for (unsigned i = 0; i < set->num; ++i)
+    bytes += set->end[i] - set->start[i];
+  return bytes;
+}
+
+static int
+is_dirty_range_tracked (cl_mem mem)
+{
+  /* Sub-buffers and their parents are versioned together, images are
+     migrated with rect commands and the content size buffers limit the
+     migrations by themselves. */
+  return dirty_ranges_enabled && !mem->is_image && mem->parent == NULL
+         && mem->sub_buffers == NULL && mem->size_buffer == NULL
+         && mem->content_buffer == NULL;
+}
+
+/* Logs a write of [offset, offset + size) creating the given version of the
+   buffer. size == 0 means the whole buffer. Must be called with the buffer
+   locked. */
+static void
+dirty_log_add (cl_mem mem, uint64_t version, uint64_t offset, uint64_t size)
+{
+  if (!is_dirty_range_tracked (mem))
+    return;
+
+  pocl_dirty_log *log = mem->dirty_log;
+  if (log == NULL)
+    {
+      log = (pocl_dirty_log *)calloc (1, sizeof (pocl_dirty_log));
+      if (log == NULL)
+        return;
+      mem->dirty_log = log;
+      size = 0;
+    }
+
+  if (size == 0 || size >= mem->size || log->last_version + 1 != version)
+    {
+      log->base_version = version;
+      log->last_version = version;
+      log->first = 0;
+      log->num = 0;
+      return;
+    }
+
+  if (log->num == DIRTY_LOG_ENTRIES)
+    {
+      log->base_version = log->entries[log->first].version;
+      log->first = (log->first + 1) % DIRTY_LOG_ENTRIES;
+      --log->num;
+    }
+  unsigned e = (log->first + log->num) % DIRTY_LOG_ENTRIES;
+  log->entries[e].version = version;
+  log->entries[e].start = offset;
+  log->entries[e].end = offset + size;
+  ++log->num;
+  log->last_version = version;
+}
+
+/* Collects the ranges written after the given version of the buffer to
+   ranges. Leaves ranges empty if the whole buffer must be migrated. Must be
+   called with the buffer locked. */
+static void
+dirty_ranges_since (cl_mem mem, uint64_t version, pocl_interval_set *ranges)
+{
+  ranges->num = 0;
+  pocl_dirty_log *log = mem->dirty_log;
+  if (!is_dirty_range_tracked (mem) || log == NULL
+      || log->last_version != mem->latest_version
+      || version < log->base_version || version >= mem->latest_version)
+    return;
+
+  for (unsigned i = 0; i < log->num; ++i)
+    {
+      unsigned e = (log->first + i) % DIRTY_LOG_ENTRIES;
+      if (log->entries[e].version > version)
+        pocl_interval_set_add (ranges, log->entries[e].start,
+                               log->entries[e].end);
+    }
+}
+
+/* Broadcast migrations.
+ *
+ * When several devices read the same version of a buffer, each of them would
+ * import it from the device that produced the version, which makes the link
+ * of that device the bottleneck. With broadcast tracking the devices which
+ * have already received the version are used as sources for the later ones,
+ * choosing the source that can send its next copy in the earliest "round".
+ * The copies then spread along a binomial tree: the number of holders doubles
+ * every round and no device sends more than log2(N) copies. A D2D import of
+ * a read-only use waits only for its source's copy to be ready instead of all
+ * the previous migrations of the buffer, so that the copies of a round can
+ * run in parallel. */
+
+typedef struct pocl_broadcast_gmem
+{
+  /* The import which brought the version to this global memory, NULL for
+     the memories which had it when the broadcast started. */
+  cl_event ready;
+  /* The round in which the version arrived here (0 for the original holders)
+     and the last round in which this memory was the source of a copy. */
+  unsigned round;
+  unsigned busy;
+} pocl_broadcast_gmem;
+
+typedef struct pocl_broadcast_state
+{
+  /* The buffer version being broadcast. */
+  uint64_t version;
+  /* The original holders of the version have it after this event. */
+  cl_event base_event;
+  unsigned num_gmems;
+  pocl_broadcast_gmem gmems[];
+} pocl_broadcast_state;
+
+static int broadcast_enabled = 0;
+
+void
+pocl_init_broadcast_migrations (void)
+{
+  broadcast_enabled = pocl_get_bool_option ("POCL_MIGRATE_BROADCAST", 0);
+}
+
+static int
+is_broadcast_tracked (cl_mem mem)
+{
+  /* Sub-buffers share the versioning of their parents and the content size
+     buffers are migrated in two phases, keep them fully serialized. */
+  return broadcast_enabled && mem->parent == NULL && mem->sub_buffers == NULL
+         && mem->size_buffer == NULL && mem->content_buffer == NULL;
+}
+
+/* Releases the events held by the broadcast state. Must be called with the
+   buffer locked, or when it's being freed. */
+static void
+broadcast_reset (pocl_broadcast_state *bc)
+{
+  if (bc->base_event != NULL)
+    POname (clReleaseEvent) (bc->base_event);
+  bc->base_event = NULL;
+  for (unsigned i = 0; i < bc->num_gmems; ++i)
+    {
+      if (bc->gmems[i].ready != NULL)
+        POname (clReleaseEvent) (bc->gmems[i].ready);
+      bc->gmems[i].ready = NULL;
+      bc->gmems[i].round = 0;
+      bc->gmems[i].busy = 0;
+    }
+  bc->version = 0;
+}
+
+void
+pocl_free_broadcast_state (cl_mem mem)
+{
+  if (mem->broadcast == NULL)
+    return;
+  broadcast_reset (mem->broadcast);
+  POCL_MEM_FREE (mem->broadcast);
+}
+
+/* Returns the broadcast state of the buffer if it is tracking the latest
+   version of it, NULL otherwise. */
+static pocl_broadcast_state *
+broadcast_current (cl_mem mem)
+{
+  pocl_broadcast_state *bc = mem->broadcast;
+  if (bc == NULL || bc->base_event == NULL
+      || bc->version != mem->latest_version)
+    return NULL;
+  return bc;
+}
+
+/* Returns the broadcast state of the latest version of the buffer, starting
+   a new broadcast after base_event if needed. Returns NULL if the buffer is
+   not tracked or base_event is NULL (the version has no pending producer to
+   order the copies after). Must be called with the buffer locked. */
+static pocl_broadcast_state *
+broadcast_start (cl_mem mem, cl_event base_event)
+{
+  pocl_broadcast_state *bc = broadcast_current (mem);
+  if (bc != NULL)
+    return bc;
+  if (!is_broadcast_tracked (mem) || base_event == NULL)
+    return NULL;
+
+  bc = mem->broadcast;
+  if (bc == NULL)
+    {
+      unsigned num_gmems = POCL_ATOMIC_LOAD (pocl_num_devices);
+      bc = (pocl_broadcast_state *)calloc (
+        1, sizeof (pocl_broadcast_state)
+             + num_gmems * sizeof (pocl_broadcast_gmem));
+      if (bc == NULL)
+        return NULL;
+      bc->num_gmems = num_gmems;
+      mem->broadcast = bc;
+    }
+  else
+    broadcast_reset (bc);
+
+  bc->version = mem->latest_version;
+  POname (clRetainEvent) (base_event);
+  bc->base_event = base_event;
+  return bc;
+}
+
+/* The round in which the global memory could send its next copy. */
+static unsigned
+broadcast_next_round (pocl_broadcast_state *bc, cl_device_id d)
+{
+  pocl_broadcast_gmem *g = &bc->gmems[d->global_mem_id];
+  return max (g->round, g->busy) + 1;
+}
+
 /**
  * Creates the necessary implicit migration commands to ensure data is
  * where it's supposed to be according to the semantics of the program
@@ -612,6 +954,9 @@ update_subbuffer_versioning_data (cl_mem updated_buf)
  * \param mem The buffer to migrate.
  * \param gmem Identifier of the global memory where the mem should be
  * migrated.
+ * \param write_offset Start of the byte range the user command writes to.
+ * \param write_size Size of the byte range the user command writes to, 0 if
+ *                   the whole buffer or unknown.
  * \param migration_size Max number of bytes to migrate (caller has to read
  *                       content size from mem->size_buffer if applicable).
  * \param last_migr_event Input/output for dep-chaining the created migration
@@ -625,6 +970,8 @@ pocl_create_migration_commands (cl_device_id dev,
                                 cl_mem mem,
                                 pocl_mem_identifier *gmem,
                                 const char readonly,
+                                uint64_t write_offset,
+                                uint64_t write_size,
                                 cl_command_type command_type,
                                 cl_mem_migration_flags mig_flags,
                                 uint64_t migration_size,
@@ -639,6 +986,13 @@ pocl_create_migration_commands (cl_device_id dev,
   cl_command_queue ex_cq = NULL, dev_cq = NULL;
   int can_directly_mig = 0;
   size_t i;
+  /* The dirty byte ranges to export / import, empty for the whole buffer */
+  pocl_interval_set export_ranges = { 0 }, import_ranges = { 0 };
+  /* The broadcast of the latest version, and the event after which ex_dev
+   * has its copy of it (if it differs from the previous last event). */
+  pocl_broadcast_state *bc = NULL;
+  cl_event src_ready = NULL;
+  int broadcast = 0;
 
   POCL_MSG_PRINT_MEMORY ("Analyzing implicit migration of buf %zu %s(latest "
                          "v%zu) to device %zu (has v%zu) host has v%zu.\n",
@@ -682,6 +1036,9 @@ pocl_create_migration_commands (cl_device_id dev,
   previous_last_event = mem->last_updater;
   mem->last_updater = user_cmd;
 
+  if (is_broadcast_tracked (mem))
+    bc = broadcast_current (mem);
+
   /* Find the device/gmem with the latest copy of the data and that has the
    * fastest migration route.
    * ex_dev = device with the latest copy _other than dev_
@@ -701,8 +1058,13 @@ pocl_create_migration_commands (cl_device_id dev,
             cur_d2d_mig_priority = d->ops->can_migrate_d2d (dev, d);
 
           /* If we can directly migrate, and we found a better device, use it.
-           */
-          if (cur_d2d_mig_priority > highest_d2d_mig_priority)
+           * Among equally good ones, prefer the broadcast source which can
+           * send its next copy earliest. */
+          if (cur_d2d_mig_priority > highest_d2d_mig_priority
+              || (bc != NULL && cur_d2d_mig_priority > 0
+                  && cur_d2d_mig_priority == highest_d2d_mig_priority
+                  && broadcast_next_round (bc, d)
+                       < broadcast_next_round (bc, ex_dev)))
             {
               ex_dev = d;
               ex_cq = cq;
@@ -744,6 +1106,29 @@ pocl_create_migration_commands (cl_device_id dev,
     assert ((gmem->version == mem->latest_version)
             || (mem->mem_host_ptr_version == mem->latest_version));
 
+  /* A copy received in a broadcast is not ordered before the buffer's last
+   * event, the commands reading it must wait for its import. */
+  if (bc != NULL && ex_dev != NULL)
+    {
+      src_ready = bc->gmems[ex_dev->global_mem_id].ready;
+      if (src_ready != NULL)
+        POname (clRetainEvent) (src_ready);
+    }
+
+  /* The same holds for the copy in the destination: the command must wait
+   * for its import also when no migration is needed. A write additionally
+   * waits for all the copies of the broadcast, as they may still be reading
+   * the destination's copy, before the state is reset below. */
+  if (bc != NULL)
+    {
+      for (unsigned g = 0; g < bc->num_gmems; ++g)
+        {
+          if (bc->gmems[g].ready != NULL
+              && (!readonly || g == dev->global_mem_id))
+            pocl_create_event_sync (bc->gmems[g].ready, user_cmd);
+        }
+    }
+
   /*****************************************************************/
 
   /* buffer must be already allocated on this device's globalmem */
@@ -757,6 +1142,7 @@ pocl_create_migration_commands (cl_device_id dev,
       do_need_hostptr = 1;
       if (mem->mem_host_ptr_version < mem->latest_version)
         {
+          dirty_ranges_since (mem, mem->mem_host_ptr_version, &export_ranges);
           mem->mem_host_ptr_version = mem->latest_version;
           /* migrate content only if needed */
           if ((mig_flags & CL_MIGRATE_MEM_OBJECT_CONTENT_UNDEFINED) == 0
@@ -816,6 +1202,8 @@ pocl_create_migration_commands (cl_device_id dev,
       /* because the two migrate commands will clRelease the buffer */
       POCL_RETAIN_OBJECT_UNLOCKED (mem);
       POCL_RETAIN_OBJECT_UNLOCKED (mem);
+      dirty_ranges_since (mem, mem->mem_host_ptr_version, &export_ranges);
+      dirty_ranges_since (mem, gmem->version, &import_ranges);
       mem->mem_host_ptr_version = mem->latest_version;
       gmem->version = mem->latest_version;
     }
@@ -832,15 +1220,33 @@ pocl_create_migration_commands (cl_device_id dev,
 
       /* because the corresponding migrate command will clRelease the buffer */
       POCL_RETAIN_OBJECT_UNLOCKED (mem);
+      if (!can_directly_mig)
+        dirty_ranges_since (mem, gmem->version, &import_ranges);
       gmem->version = mem->latest_version;
+
+      /* A read-only use copying from another device joins the broadcast of
+       * the version; its import only waits for the source's copy. */
+      if (can_directly_mig && readonly)
+        {
+          bc = broadcast_start (mem, previous_last_event);
+          broadcast = (bc != NULL);
+          if (broadcast && src_ready == NULL)
+            {
+              src_ready = bc->base_event;
+              POname (clRetainEvent) (src_ready);
+            }
+        }
     }
 
 FINISH_VER_SETUP:
   /* If the command is a write-use, increase the version. */
   if (!readonly)
     {
+      if (mem->broadcast != NULL)
+        broadcast_reset (mem->broadcast);
       ++gmem->version;
       mem->latest_version = gmem->version;
+      dirty_log_add (mem, gmem->version, write_offset, write_size);
       if (mem->sub_buffers != NULL)
         {
           /* A parent buffer update implicitly updates the sub-buffers. Make
@@ -874,7 +1280,7 @@ FINISH_VER_SETUP:
           size_t align = max (mem->context->min_buffer_alignment, 16);
           /* Always allocate mem_host_ptr for the full size of the buffer to
            * guard against applications forgetting to check content size. */
-          mem->mem_host_ptr = pocl_aligned_malloc (align, mem->size);
+          mem->mem_host_ptr = pocl_host_mem_alloc (align, mem->size);
           assert ((mem->mem_host_ptr != NULL)
                   && "Cannot allocate backing memory for mem_host_ptr!\n");
         }
@@ -888,11 +1294,16 @@ FINISH_VER_SETUP:
     {
       assert (ex_cq);
       assert (ex_dev);
+      cl_event export_wait[2];
+      cl_uint num_export_wait = 0;
+      if (previous_last_event)
+        export_wait[num_export_wait++] = previous_last_event;
+      if (src_ready)
+        export_wait[num_export_wait++] = src_ready;
       errcode = pocl_create_command_struct (
         &cmd_export, ex_cq, CL_COMMAND_MIGRATE_MEM_OBJECTS,
         &ev_export, // event_p
-        (previous_last_event ? 1 : 0),
-        (previous_last_event ? &previous_last_event : NULL), // waitlist
+        num_export_wait, (num_export_wait ? export_wait : NULL), // waitlist
         NULL);
       assert (errcode == CL_SUCCESS);
       if (do_need_hostptr)
@@ -901,6 +1312,7 @@ FINISH_VER_SETUP:
       cmd_export->command.migrate.type = ENQUEUE_MIGRATE_TYPE_D2H;
       cmd_export->command.migrate.implicit = 1;
       cmd_export->command.migrate.migration_size = migration_size;
+      cmd_export->command.migrate.ranges = export_ranges;
       cmd_export->command.migrate.num_buffers = 1;
       cmd_export->migr_infos
         = pocl_append_unique_migration_info (NULL, mem, 0);
@@ -920,14 +1332,21 @@ FINISH_VER_SETUP:
     {
       /* the import command must depend on (wait for) either the export
        * command, or the buffer's previous last event. Can be NULL if there's
-       * no last event or export command */
-      cl_event import_wait_ev = (ev_export ? ev_export : previous_last_event);
+       * no last event or export command. In a broadcast, it waits for the
+       * source's copy instead. */
+      cl_event import_wait[2];
+      cl_uint num_import_wait = 0;
+      if (ev_export)
+        import_wait[num_import_wait++] = ev_export;
+      else if (previous_last_event && !broadcast)
+        import_wait[num_import_wait++] = previous_last_event;
+      if (src_ready && can_directly_mig)
+        import_wait[num_import_wait++] = src_ready;
 
       errcode = pocl_create_command_struct (
         &cmd_import, dev_cq, CL_COMMAND_MIGRATE_MEM_OBJECTS,
         &ev_import, // event_p
-        (import_wait_ev ? 1 : 0),
-        (import_wait_ev ? &import_wait_ev : NULL), // waitlist
+        num_import_wait, (num_import_wait ? import_wait : NULL), // waitlist
         NULL);
       assert (errcode == CL_SUCCESS);
       if (do_need_hostptr)
@@ -948,6 +1367,7 @@ FINISH_VER_SETUP:
           cmd_import->command.migrate.type = ENQUEUE_MIGRATE_TYPE_H2D;
           cmd_import->command.migrate.implicit = 1;
           cmd_import->command.migrate.migration_size = migration_size;
+          cmd_import->command.migrate.ranges = import_ranges;
         }
       cmd_import->command.migrate.num_buffers = 1;
       cmd_import->migr_infos
@@ -957,9 +1377,29 @@ FINISH_VER_SETUP:
       if (ev_export)
         POname (clReleaseEvent) (ev_export);
 
+      if (broadcast)
+        {
+          pocl_broadcast_gmem *src = &bc->gmems[ex_dev->global_mem_id];
+          pocl_broadcast_gmem *dst = &bc->gmems[dev->global_mem_id];
+          unsigned round = broadcast_next_round (bc, ex_dev);
+          src->busy = round;
+          dst->round = round;
+          if (dst->ready != NULL)
+            POname (clReleaseEvent) (dst->ready);
+          POname (clRetainEvent) (ev_import);
+          dst->ready = ev_import;
+          POCL_MSG_PRINT_MEMORY ("Broadcast of buf %zu v%zu: device %zu -> "
+                                 "%zu in round %u\n",
+                                 mem->id, mem->latest_version, ex_dev->id,
+                                 dev->id, round);
+        }
+
       last_migration_event = ev_import;
     }
 
+  if (src_ready)
+    POname (clReleaseEvent) (src_ready);
+
   /* we don't need it anymore. */
   if (previous_last_event)
     POname (clReleaseEvent (previous_last_event));
@@ -1001,7 +1441,9 @@ FINISH_VER_SETUP:
     {
       POCL_MSG_PRINT_MEMORY (
         "Queuing a %zu-byte device-to-host migration for buf %zu%s\n",
-        migration_size, mem->id, mem->parent != NULL ? " (sub-buffer)" : "");
+        export_ranges.num ? interval_set_bytes (&export_ranges)
+                          : migration_size,
+        mem->id, mem->parent != NULL ? " (sub-buffer)" : "");
 
       pocl_command_enqueue (ex_cq, cmd_export);
     }
@@ -1010,7 +1452,9 @@ FINISH_VER_SETUP:
     {
       POCL_MSG_PRINT_MEMORY (
         "Queuing a %zu-byte host-to-device migration for buf %zu%s\n",
-        migration_size, mem->id, mem->parent != NULL ? " (sub-buffer)" : "");
+        import_ranges.num ? interval_set_bytes (&import_ranges)
+                          : migration_size,
+        mem->id, mem->parent != NULL ? " (sub-buffer)" : "");
 
       pocl_command_enqueue (dev_cq, cmd_import);
     }
@@ -1036,6 +1480,8 @@ pocl_deep_copy_migration_info_list (pocl_buffer_migration_info *list,
         POname (clRetainMemObject (mi->buffer));
       new_list = pocl_append_unique_migration_info (new_list, mi->buffer,
                                                     mi->read_only);
+      pocl_set_migration_write_range (new_list, mi->buffer, mi->write_offset,
+                                      mi->write_size);
     }
   return new_list;
 }
@@ -1080,6 +1526,31 @@ pocl_append_unique_migration_info (pocl_buffer_migration_info *list,
   return list;
 }
 
+/**
+ * Sets the byte range the command writes to in the migration info of the
+ * given buffer in the list.
+ *
+ * The range is used for tracking the modified parts of the buffer, the
+ * default (size 0) is the whole buffer.
+ */
+void
+pocl_set_migration_write_range (pocl_buffer_migration_info *list,
+                                cl_mem buffer,
+                                uint64_t offset,
+                                uint64_t size)
+{
+  pocl_buffer_migration_info *mi;
+  LL_FOREACH (list, mi)
+    {
+      if (mi->buffer == buffer)
+        {
+          mi->write_offset = offset;
+          mi->write_size = size;
+          return;
+        }
+    }
+}
+
 pocl_raw_ptr *
 pocl_find_raw_ptr_with_vm_ptr (cl_context context, const void *host_ptr)
 {
@@ -87,16 +87,36 @@ cl_event pocl_mem_manager_new_event ();
 pocl_buffer_migration_info *pocl_append_unique_migration_info (
   pocl_buffer_migration_info *list, cl_mem buffer, char read_only);
 
+void pocl_set_migration_write_range (pocl_buffer_migration_info *list,
+                                     cl_mem buffer,
+                                     uint64_t offset,
+                                     uint64_t size);
+
 pocl_buffer_migration_info *
 pocl_deep_copy_migration_info_list (pocl_buffer_migration_info *list,
                                     int retain);
 
+/* Reads the POCL_MIGRATE_DIRTY_RANGES option. */
+void pocl_init_dirty_range_tracking (void);
+
+/* Reads the POCL_MIGRATE_BROADCAST option. */
+void pocl_init_broadcast_migrations (void);
+
+/* Releases the broadcast tracking state of a buffer being freed. */
+void pocl_free_broadcast_state (cl_mem mem);
+
+void pocl_interval_set_add (pocl_interval_set *set,
+                            uint64_t start,
+                            uint64_t end);
+
 int pocl_create_migration_commands (cl_device_id dev,
                                     cl_event *ev_export_p,
                                     cl_event user_cmd,
                                     cl_mem mem,
                                     pocl_mem_identifier *gmem,
                                     const char readonly,
+                                    uint64_t write_offset,
+                                    uint64_t write_size,
                                     cl_command_type command_type,
                                     cl_mem_migration_flags mig_flags,
                                     uint64_t migration_size,
@@ -34,6 +34,8 @@
 #include <string.h>
 #include <sys/socket.h>
 #include <sys/time.h>
+#include <sys/uio.h>
+#include <unistd.h>
 #include <ctype.h>
 
 #ifdef HAVE_LINUX_VSOCK_H
@@ -226,6 +228,9 @@ pocl_remote_client_set_socket_options (int socket_fd, int bufsize, int is_fast,
                         -1, "setsockopt(SO_SNDTIMEO) returned errno: %i\n",
                         errno);
 
+  /* The rest are TCP options */
+  if (ai_family == AF_UNIX)
+    return 0;
 #ifdef HAVE_LINUX_VSOCK_H
   if (ai_family == AF_VSOCK)
     {
@@ -276,3 +281,88 @@ pocl_remote_client_set_socket_options (int socket_fd, int bufsize, int is_fast,
 
   return 0;
 }
+
+ssize_t
+pocl_send_with_fd (int socket_fd, const void *buf, size_t len, int fd)
+{
+  struct iovec iov;
+  iov.iov_base = (void *)buf;
+  iov.iov_len = len;
+
+  union
+  {
+    char buf[CMSG_SPACE (sizeof (int))];
+    struct cmsghdr align;
+  } control;
+  memset (&control, 0, sizeof (control));
+
+  struct msghdr msg;
+  memset (&msg, 0, sizeof (msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof (control.buf);
+
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR (&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN (sizeof (int));
+  memcpy (CMSG_DATA (cmsg), &fd, sizeof (int));
+
+  ssize_t res;
+  do
+    res = sendmsg (socket_fd, &msg, 0);
+  while (res < 0 && errno == EINTR);
+  return res;
+}
+
+ssize_t
+pocl_recv_with_fd (int socket_fd, void *buf, size_t len, int *fd)
+{
+  struct iovec iov;
+  iov.iov_base = buf;
+  iov.iov_len = len;
+
+  union
+  {
+    char buf[CMSG_SPACE (sizeof (int))];
+    struct cmsghdr align;
+  } control;
+
+  struct msghdr msg;
+  memset (&msg, 0, sizeof (msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof (control.buf);
+
+  int flags = 0;
+#ifdef MSG_CMSG_CLOEXEC
+  flags |= MSG_CMSG_CLOEXEC;
+#endif
+  ssize_t res = recvmsg (socket_fd, &msg, flags);
+  if (res <= 0)
+    return res;
+
+  struct cmsghdr *cmsg;
+  for (cmsg = CMSG_FIRSTHDR (&msg); cmsg != NULL;
+       cmsg = CMSG_NXTHDR (&msg, cmsg))
+    {
+      if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+        continue;
+      size_t num_fds = (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (int);
+      for (size_t i = 0; i < num_fds; ++i)
+        {
+          int received;
+          memcpy (&received, CMSG_DATA (cmsg) + i * sizeof (int),
+                  sizeof (int));
+          /* Keep the first one, the sender is expected to pass only one
+             fd per message. */
+          if (*fd < 0)
+            *fd = received;
+          else
+            close (received);
+        }
+    }
+  return res;
+}
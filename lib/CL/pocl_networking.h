@@ -23,6 +23,7 @@
 */
 
 #include <stdint.h>
+#include <sys/types.h>
 
 #ifndef POCL_NETWORKING_H
 #define POCL_NETWORKING_H
@@ -109,6 +110,23 @@ extern "C"
    */
   extern struct addrinfo *vsock_hostname_addrinfo (const char *hostname,
                                                    uint16_t port);
+
+  /**
+   * Sends len bytes of buf over a Unix domain socket with the file descriptor
+   * fd attached as SCM_RIGHTS ancillary data. Returns the number of bytes
+   * sent like sendmsg(2), which may be less than len; the fd is delivered
+   * with the first byte.
+   */
+  extern ssize_t pocl_send_with_fd (int socket_fd, const void *buf, size_t len,
+                                    int fd);
+
+  /**
+   * Like read(2), but also receives a file descriptor passed with
+   * pocl_send_with_fd() into *fd, unless *fd is already a valid fd (>= 0).
+   * Any other received fds are closed.
+   */
+  extern ssize_t pocl_recv_with_fd (int socket_fd, void *buf, size_t len,
+                                    int *fd);
 #ifdef __cplusplus
 }
 #endif
@@ -357,6 +357,7 @@ pocl_tensor_type_is_int (cl_tensor_datatype_exp dtype)
     case CL_TENSOR_DTYPE_FP64_EXP:
     case CL_TENSOR_DTYPE_FP32_EXP:
     case CL_TENSOR_DTYPE_FP16_EXP:
+    case CL_TENSOR_DTYPE_BFLOAT16_EXP:
     case CL_TENSOR_DTYPE_FP8E4M3_EXP:
     case CL_TENSOR_DTYPE_FP8E5M2_EXP:
       return 0;
@@ -393,6 +394,7 @@ pocl_tensor_type_size (cl_tensor_datatype_exp dtype)
     case CL_TENSOR_DTYPE_UINT32_EXP:
       return 4;
     case CL_TENSOR_DTYPE_FP16_EXP:
+    case CL_TENSOR_DTYPE_BFLOAT16_EXP:
     case CL_TENSOR_DTYPE_INT16_EXP:
     case CL_TENSOR_DTYPE_UINT16_EXP:
       return 2;
@@ -471,6 +473,70 @@ pocl_tensor_data_is_contiguous (const cl_tensor_desc_exp *tensor)
   return 0;
 }
 
+/**
+ * Stores the strides, in elements, of the dimensions of a tensor with a
+ * BLAS, pitched BLAS or ML data layout into strides[0 .. rank - 1].
+ *
+ * The first leading dimension is contiguous and each following one (the
+ * last one is implied) is strided by the extent of the previous ones, or by
+ * the leading stride of the previous one in the pitched layout. The ML
+ * layouts are stored densely with the last dimension varying fastest.
+ * Returns CL_INVALID_TENSOR_LAYOUT_EXP for the opaque layout.
+ */
+POCL_EXPORT
+int
+pocl_tensor_get_strides (const cl_tensor_desc_exp *t, size_t *strides)
+{
+  assert (t);
+  assert (strides);
+
+  if (t->layout == NULL)
+    return CL_INVALID_TENSOR_LAYOUT_EXP;
+
+  switch (t->layout_type)
+    {
+    default:
+      return CL_INVALID_TENSOR_LAYOUT_EXP;
+    case CL_TENSOR_LAYOUT_ML_EXP:
+      {
+        size_t stride = 1;
+        for (unsigned i = t->rank; i-- > 0;)
+          {
+            strides[i] = stride;
+            stride *= t->shape[i];
+          }
+        return CL_SUCCESS;
+      }
+    case CL_TENSOR_LAYOUT_BLAS_EXP:
+    case CL_TENSOR_LAYOUT_BLAS_PITCHED_EXP:
+      {
+        const cl_tensor_dim_exp *ld;
+        const cl_tensor_stride_exp *ls = NULL;
+        if (t->layout_type == CL_TENSOR_LAYOUT_BLAS_EXP)
+          ld = ((const cl_tensor_layout_blas_exp *)t->layout)->leading_dims;
+        else
+          {
+            const cl_tensor_layout_blas_pitched_exp *pl = t->layout;
+            ld = pl->leading_dims;
+            ls = pl->leading_strides;
+          }
+
+        unsigned defined_dims = 0;
+        size_t stride = 1;
+        for (unsigned i = 0; i + 1 < t->rank; i++)
+          {
+            strides[ld[i]] = stride;
+            defined_dims |= (1u << ld[i]);
+            stride = ls ? ls[i] : stride * t->shape[ld[i]];
+          }
+        for (unsigned dim = 0; dim < t->rank; dim++)
+          if (!(defined_dims & (1u << dim)))
+            strides[dim] = stride;
+        return CL_SUCCESS;
+      }
+    }
+}
+
 cl_bool
 pocl_tensor_dtype_value_equals (const cl_tensor_datatype_exp dtype,
                                 const cl_tensor_datatype_value_exp *value,
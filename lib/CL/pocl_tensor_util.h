@@ -64,6 +64,9 @@ size_t pocl_tensor_data_size (const cl_tensor_desc_exp *t);
 POCL_EXPORT
 int pocl_tensor_data_is_contiguous (const cl_tensor_desc_exp *t);
 
+POCL_EXPORT
+int pocl_tensor_get_strides (const cl_tensor_desc_exp *t, size_t *strides);
+
 cl_bool
 pocl_tensor_dtype_value_equals (const cl_tensor_datatype_exp dtype,
                                 const cl_tensor_datatype_value_exp *value,
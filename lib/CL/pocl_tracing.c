@@ -25,6 +25,7 @@
 #define _DEFAULT_SOURCE
 
 #include <fcntl.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/stat.h>
@@ -36,6 +37,7 @@
 #include "pocl_tracing.h"
 #include "pocl_timing.h"
 #include "pocl_runtime_config.h"
+#include "utlist.h"
 
 #include "devices.h"
 
@@ -317,11 +319,447 @@ text_tracer_event_updated (cl_event event, int status)
   POCL_UNLOCK (text_tracer_lock);
 }
 
+static void
+text_tracer_wg_chunk (cl_event event, unsigned thread, uint64_t first_wg,
+                      uint64_t num_wgs, uint64_t start_ns, uint64_t end_ns)
+{
+  if (!text_tracer_file)
+    return;
+
+  POCL_LOCK (text_tracer_lock);
+  fprintf (text_tracer_file,
+           "%" PRIu64 " | EV ID %" PRIu64 " | DEV %" PRIu64
+           " | WG CHUNK | THREAD %u | WG %" PRIu64 "..%" PRIu64
+           " | end=%" PRIu64 "\n",
+           start_ns, event->id, event->queue->device->id, thread, first_wg,
+           first_wg + num_wgs - 1, end_ns);
+  POCL_UNLOCK (text_tracer_lock);
+}
+
 static const struct pocl_event_tracer text_logger = {
   "text",
   text_tracer_init,
   text_tracer_destroy,
   text_tracer_event_updated,
+  text_tracer_wg_chunk,
+};
+
+//#################################################################
+/* Binary tracer. Every finished event is stored as one or more fixed-size
+ * records into a ring buffer of the thread that finished it, without any
+ * locking or formatting. A background thread appends the filled part of
+ * the rings to the output file periodically and at exit.
+ *
+ * The file starts with a pocl_trace_file_header followed by the records.
+ * tools/scripts/pocl_trace_to_chrome.py converts it to the Chrome trace
+ * JSON format, which can be viewed with Perfetto or chrome://tracing.
+ * Keep the two in sync when changing the layout. */
+
+#define POCL_TRACE_MAGIC "POCLTRC"
+#define POCL_TRACE_VERSION 1
+/* dependencies stored per record, the rest continue in extra records */
+#define POCL_TRACE_REC_DEPS 8
+#define POCL_TRACE_NAME_LEN 56
+/* the record continues the dependency list of the previous one */
+#define POCL_TRACE_FLAG_DEPS_CONT 1
+/* the record is a chunk of WGs run by one CPU worker thread: ts[2..3] is
+ * the time it ran, obj_ids[0] the first WG, obj_ids[1] the thread index and
+ * size the number of WGs */
+#define POCL_TRACE_FLAG_WG_CHUNK 2
+
+typedef struct pocl_trace_file_header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+} pocl_trace_file_header;
+
+typedef struct pocl_trace_record
+{
+  uint64_t event_id;
+  uint64_t queue_id;
+  uint64_t device_id;
+  /* queued, submitted, running, complete */
+  uint64_t ts[4];
+  /* kernel id / source and destination mem ids, 0 if n/a */
+  uint64_t obj_ids[2];
+  /* bytes transferred, 0 if n/a */
+  uint64_t size;
+  uint64_t dep_ids[POCL_TRACE_REC_DEPS];
+  uint32_t command_type;
+  int16_t status;
+  uint8_t num_deps;
+  uint8_t flags;
+  /* kernel name or the command type, truncated */
+  char name[POCL_TRACE_NAME_LEN];
+} pocl_trace_record;
+
+/* records per thread, must be a power of two */
+#define BINARY_TRACER_RING_SIZE 2048
+/* microseconds between the flushes */
+#define BINARY_TRACER_FLUSH_INTERVAL 10000
+
+#ifdef _MSC_VER
+#define BINARY_TRACER_TLS __declspec (thread)
+#else
+#define BINARY_TRACER_TLS __thread
+#endif
+
+typedef struct binary_tracer_ring binary_tracer_ring;
+struct binary_tracer_ring
+{
+  pocl_trace_record *records;
+  /* advanced only by the owner thread */
+  uint64_t head;
+  /* advanced only by the flusher */
+  uint64_t tail;
+  /* records lost because the ring was full */
+  uint64_t dropped;
+  /* non-zero while the owner thread writes records */
+  uint64_t active;
+  binary_tracer_ring *next;
+};
+
+static FILE *binary_tracer_file = NULL;
+static BINARY_TRACER_TLS binary_tracer_ring *binary_tracer_thread_ring = NULL;
+/* protects the list of rings and the output file */
+static pocl_lock_t binary_tracer_lock;
+static pocl_cond_t binary_tracer_cond;
+static pocl_thread_t binary_tracer_thread;
+static binary_tracer_ring *binary_tracer_rings = NULL;
+static int binary_tracer_exit = 0;
+static uint64_t binary_tracer_running = 0;
+
+/* Must be called with binary_tracer_lock held. */
+static void
+binary_tracer_drain ()
+{
+  binary_tracer_ring *ring;
+  LL_FOREACH (binary_tracer_rings, ring)
+    {
+      uint64_t head = POCL_ATOMIC_LOAD (ring->head);
+      uint64_t tail = ring->tail;
+      while (tail != head)
+        {
+          uint64_t start = tail & (BINARY_TRACER_RING_SIZE - 1);
+          uint64_t n = head - tail;
+          if (start + n > BINARY_TRACER_RING_SIZE)
+            n = BINARY_TRACER_RING_SIZE - start;
+          fwrite (ring->records + start, sizeof (pocl_trace_record), n,
+                  binary_tracer_file);
+          tail += n;
+        }
+      POCL_ATOMIC_STORE (ring->tail, tail);
+    }
+}
+
+static void *
+binary_tracer_flush_thread (void *data)
+{
+  POCL_LOCK (binary_tracer_lock);
+  while (!binary_tracer_exit)
+    {
+      POCL_TIMEDWAIT_COND (binary_tracer_cond, binary_tracer_lock,
+                           BINARY_TRACER_FLUSH_INTERVAL);
+      binary_tracer_drain ();
+    }
+  POCL_UNLOCK (binary_tracer_lock);
+  return NULL;
+}
+
+static void
+binary_tracer_destroy ()
+{
+  if (!POCL_ATOMIC_LOAD (binary_tracer_running))
+    return;
+  POCL_ATOMIC_STORE (binary_tracer_running, 0);
+
+  POCL_LOCK (binary_tracer_lock);
+  binary_tracer_exit = 1;
+  POCL_SIGNAL_COND (binary_tracer_cond);
+  POCL_UNLOCK (binary_tracer_lock);
+  POCL_JOIN_THREAD (binary_tracer_thread);
+
+  /* Threads still running see that the tracer has stopped before they
+   * touch their records (see binary_tracer_begin ()), so the records can be
+   * freed once the writes in progress are done. The ring headers stay, the
+   * threads still point to them. */
+  uint64_t dropped = 0;
+  POCL_LOCK (binary_tracer_lock);
+  binary_tracer_ring *ring;
+  LL_FOREACH (binary_tracer_rings, ring)
+    while (POCL_ATOMIC_LOAD (ring->active))
+      ;
+  binary_tracer_drain ();
+  LL_FOREACH (binary_tracer_rings, ring)
+    {
+      dropped += POCL_ATOMIC_LOAD (ring->dropped);
+      pocl_aligned_free (ring->records);
+      ring->records = NULL;
+    }
+  fclose (binary_tracer_file);
+  binary_tracer_file = NULL;
+  POCL_UNLOCK (binary_tracer_lock);
+
+  if (dropped)
+    POCL_MSG_WARN ("Binary tracer dropped %" PRIu64 " records, the "
+                   "tracing rate exceeded the flushing rate\n",
+                   dropped);
+}
+
+static void
+binary_tracer_init ()
+{
+  POCL_INIT_LOCK (binary_tracer_lock);
+  POCL_INIT_COND (binary_tracer_cond);
+
+  const char *output
+      = pocl_get_string_option ("POCL_TRACING_OPT", "pocl_trace_events.bin");
+  binary_tracer_file = fopen (output, "wb");
+  if (!binary_tracer_file)
+    {
+      POCL_MSG_ERR ("Failed to open binary tracer output %s\n", output);
+      return;
+    }
+
+  pocl_trace_file_header header;
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, POCL_TRACE_MAGIC, sizeof (POCL_TRACE_MAGIC));
+  header.version = POCL_TRACE_VERSION;
+  header.record_size = sizeof (pocl_trace_record);
+  fwrite (&header, sizeof (header), 1, binary_tracer_file);
+
+  POCL_ATOMIC_STORE (binary_tracer_running, 1);
+  POCL_CREATE_THREAD (binary_tracer_thread, binary_tracer_flush_thread, NULL);
+  /* pocl_uninit_devices () is not called at exit by default */
+  atexit (binary_tracer_destroy);
+}
+
+static binary_tracer_ring *
+binary_tracer_get_ring ()
+{
+  binary_tracer_ring *ring = binary_tracer_thread_ring;
+  if (ring)
+    return ring;
+
+  ring = (binary_tracer_ring *)calloc (1, sizeof (binary_tracer_ring));
+  if (ring)
+    ring->records = (pocl_trace_record *)pocl_aligned_malloc (
+        HOST_CPU_CACHELINE_SIZE,
+        BINARY_TRACER_RING_SIZE * sizeof (pocl_trace_record));
+  if (ring == NULL || ring->records == NULL)
+    {
+      free (ring);
+      return NULL;
+    }
+
+  /* the tracer may have stopped meanwhile, in which case the ring would
+   * not be freed */
+  POCL_LOCK (binary_tracer_lock);
+  if (!POCL_ATOMIC_LOAD (binary_tracer_running))
+    {
+      POCL_UNLOCK (binary_tracer_lock);
+      pocl_aligned_free (ring->records);
+      free (ring);
+      return NULL;
+    }
+  LL_PREPEND (binary_tracer_rings, ring);
+  POCL_UNLOCK (binary_tracer_lock);
+  binary_tracer_thread_ring = ring;
+  return ring;
+}
+
+/* Returns the ring of the calling thread marked as being written, NULL if
+ * the tracer has stopped. Must be paired with binary_tracer_end (). */
+static binary_tracer_ring *
+binary_tracer_begin ()
+{
+  if (!POCL_ATOMIC_LOAD (binary_tracer_running))
+    return NULL;
+  binary_tracer_ring *ring = binary_tracer_get_ring ();
+  if (ring == NULL)
+    return NULL;
+  /* pairs with the stores in binary_tracer_destroy (): either it waits for
+   * this write to finish, or the write sees that the tracer has stopped */
+  POCL_ATOMIC_STORE (ring->active, 1);
+  if (!POCL_ATOMIC_LOAD (binary_tracer_running))
+    {
+      POCL_ATOMIC_STORE (ring->active, 0);
+      return NULL;
+    }
+  return ring;
+}
+
+static void
+binary_tracer_end (binary_tracer_ring *ring)
+{
+  POCL_ATOMIC_STORE (ring->active, 0);
+}
+
+/* Returns the next free record of the ring, NULL if it's full. */
+static pocl_trace_record *
+binary_tracer_reserve (binary_tracer_ring *ring)
+{
+  uint64_t tail = POCL_ATOMIC_LOAD (ring->tail);
+  if (ring->head - tail >= BINARY_TRACER_RING_SIZE)
+    {
+      POCL_ATOMIC_INC (ring->dropped);
+      return NULL;
+    }
+  return ring->records + (ring->head & (BINARY_TRACER_RING_SIZE - 1));
+}
+
+static void
+binary_tracer_event_updated (cl_event event, int status)
+{
+  /* same as the text tracer, the timestamps are complete only at finish */
+  if (status > CL_COMPLETE)
+    return;
+
+  _cl_command_node *node = event->command;
+  if (node == NULL)
+    return;
+
+  binary_tracer_ring *ring = binary_tracer_begin ();
+  if (ring == NULL)
+    return;
+  pocl_trace_record *rec = binary_tracer_reserve (ring);
+  if (rec == NULL)
+    goto END;
+
+  rec->event_id = event->id;
+  rec->queue_id = event->queue->id;
+  rec->device_id = event->queue->device->id;
+  rec->ts[0] = event->time_queue;
+  rec->ts[1] = event->time_submit;
+  rec->ts[2] = event->time_start;
+  rec->ts[3] = event->time_end;
+  rec->obj_ids[0] = rec->obj_ids[1] = 0;
+  rec->size = 0;
+  rec->command_type = event->command_type;
+  rec->status = (int16_t)status;
+  rec->flags = 0;
+
+  const char *name = NULL;
+  switch (event->command_type)
+    {
+    case CL_COMMAND_NDRANGE_KERNEL:
+      rec->obj_ids[0] = node->command.run.kernel->id;
+      name = node->command.run.kernel->name;
+      break;
+    case CL_COMMAND_READ_BUFFER:
+      rec->obj_ids[0] = node->command.read.src->id;
+      rec->size = node->command.read.size;
+      break;
+    case CL_COMMAND_WRITE_BUFFER:
+      rec->obj_ids[1] = node->command.write.dst->id;
+      rec->size = node->command.write.size;
+      break;
+    case CL_COMMAND_COPY_BUFFER:
+      rec->obj_ids[0] = node->command.copy.src->id;
+      rec->obj_ids[1] = node->command.copy.dst->id;
+      rec->size = node->command.copy.size;
+      break;
+    case CL_COMMAND_FILL_BUFFER:
+      rec->obj_ids[1] = node->command.memfill.dst->id;
+      rec->size = node->command.memfill.size;
+      break;
+    case CL_COMMAND_MIGRATE_MEM_OBJECTS:
+      rec->obj_ids[0] = node->migr_infos->buffer->id;
+      break;
+    case CL_COMMAND_MAP_BUFFER:
+      rec->obj_ids[0] = node->command.map.buffer->id;
+      rec->size = node->command.map.mapping->size;
+      break;
+    case CL_COMMAND_UNMAP_MEM_OBJECT:
+      rec->obj_ids[0] = node->command.unmap.buffer->id;
+      break;
+    case CL_COMMAND_READ_BUFFER_RECT:
+      rec->obj_ids[0] = node->command.read_rect.src->id;
+      break;
+    case CL_COMMAND_WRITE_BUFFER_RECT:
+      rec->obj_ids[1] = node->command.write_rect.dst->id;
+      break;
+    case CL_COMMAND_COPY_BUFFER_RECT:
+      rec->obj_ids[0] = node->command.copy_rect.src->id;
+      rec->obj_ids[1] = node->command.copy_rect.dst->id;
+      break;
+    default:
+      break;
+    }
+  if (name == NULL)
+    name = pocl_command_to_str (event->command_type);
+  strncpy (rec->name, name, POCL_TRACE_NAME_LEN - 1);
+  rec->name[POCL_TRACE_NAME_LEN - 1] = 0;
+
+  pocl_event_md *md = event->meta_data;
+  size_t num_deps = md ? md->num_deps : 0;
+  size_t d = 0;
+  while (1)
+    {
+      unsigned n = 0;
+      while (d < num_deps && n < POCL_TRACE_REC_DEPS)
+        rec->dep_ids[n++] = md->dep_ids[d++];
+      rec->num_deps = n;
+      POCL_ATOMIC_STORE (ring->head, ring->head + 1);
+      if (d == num_deps)
+        break;
+
+      pocl_trace_record *cont = binary_tracer_reserve (ring);
+      if (cont == NULL)
+        break;
+      memcpy (cont, rec, offsetof (pocl_trace_record, dep_ids));
+      cont->command_type = rec->command_type;
+      cont->status = rec->status;
+      cont->flags = POCL_TRACE_FLAG_DEPS_CONT;
+      cont->name[0] = 0;
+      rec = cont;
+    }
+
+  if (ring->head - POCL_ATOMIC_LOAD (ring->tail)
+      > BINARY_TRACER_RING_SIZE / 2)
+    POCL_SIGNAL_COND (binary_tracer_cond);
+
+END:
+  binary_tracer_end (ring);
+}
+
+static void
+binary_tracer_wg_chunk (cl_event event, unsigned thread, uint64_t first_wg,
+                        uint64_t num_wgs, uint64_t start_ns, uint64_t end_ns)
+{
+  binary_tracer_ring *ring = binary_tracer_begin ();
+  if (ring == NULL)
+    return;
+  pocl_trace_record *rec = binary_tracer_reserve (ring);
+  if (rec == NULL)
+    {
+      binary_tracer_end (ring);
+      return;
+    }
+
+  memset (rec, 0, offsetof (pocl_trace_record, name));
+  rec->event_id = event->id;
+  rec->queue_id = event->queue->id;
+  rec->device_id = event->queue->device->id;
+  rec->ts[2] = start_ns;
+  rec->ts[3] = end_ns;
+  rec->obj_ids[0] = first_wg;
+  rec->obj_ids[1] = thread;
+  rec->size = num_wgs;
+  rec->command_type = event->command_type;
+  rec->flags = POCL_TRACE_FLAG_WG_CHUNK;
+  rec->name[0] = 0;
+  POCL_ATOMIC_STORE (ring->head, ring->head + 1);
+  binary_tracer_end (ring);
+}
+
+static const struct pocl_event_tracer binary_tracer = {
+  "binary",
+  binary_tracer_init,
+  binary_tracer_destroy,
+  binary_tracer_event_updated,
+  binary_tracer_wg_chunk,
 };
 
 static const struct pocl_event_tracer cq_profiler
@@ -511,6 +949,7 @@ static const struct pocl_event_tracer lttng_tracer = {
  */
 static const struct pocl_event_tracer *pocl_event_tracers[]
     = { &text_logger,
+        &binary_tracer,
 #ifdef HAVE_LTTNG_UST
         &lttng_tracer,
 #endif
@@ -552,6 +991,16 @@ EVENT_INIT_OUT:
   tracing_initialized = 1;
 }
 
+void
+pocl_event_trace_wg_chunk (cl_event event, unsigned thread, uint64_t first_wg,
+                           uint64_t num_wgs, uint64_t start_ns,
+                           uint64_t end_ns)
+{
+  if (event_tracer && event_tracer->wg_chunk)
+    event_tracer->wg_chunk (event, thread, first_wg, num_wgs, start_ns,
+                            end_ns);
+}
+
 int pocl_is_tracing_enabled ()
 {
   return event_tracer != NULL;
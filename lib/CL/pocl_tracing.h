@@ -48,6 +48,14 @@ void pocl_event_tracing_init ();
 /* Stops event tracing system */
 void pocl_event_tracing_finish ();
 
+/* Reports a chunk of work-groups of the kernel command of the event run by
+ * one worker thread of a CPU device (POCL_CPU_WG_PROFILING). first_wg is
+ * the linear index of the first WG of the chunk. */
+POCL_EXPORT
+void pocl_event_trace_wg_chunk (cl_event event, unsigned thread,
+                                uint64_t first_wg, uint64_t num_wgs,
+                                uint64_t start_ns, uint64_t end_ns);
+
 /* Struct of trace handlers. */
 struct pocl_event_tracer
 {
@@ -59,6 +67,10 @@ struct pocl_event_tracer
   void (*destroy) ();
   /* Callback called when an event has been updated */
   void (*event_updated) (cl_event /* event */ , int /* status */ );
+  /* Optional, see pocl_event_trace_wg_chunk () */
+  void (*wg_chunk) (cl_event /* event */, unsigned /* thread */,
+                    uint64_t /* first_wg */, uint64_t /* num_wgs */,
+                    uint64_t /* start_ns */, uint64_t /* end_ns */);
 };
 
 #ifdef __cplusplus
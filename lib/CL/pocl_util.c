@@ -62,6 +62,7 @@
 #include "pocl_cache.h"
 #include "pocl_dynlib.h"
 #include "pocl_file_util.h"
+#include "pocl_host_mem_pool.h"
 #include "pocl_llvm.h"
 #include "pocl_local_size.h"
 #include "pocl_mem_management.h"
@@ -246,6 +247,18 @@ pocl_aligned_free (void *ptr)
   pocl_memalign_free (ptr);
 }
 
+void
+pocl_free_kernel_arg_blocks (cl_kernel kernel)
+{
+  pocl_kernel_arg_block *b, *tmp;
+
+  LL_FOREACH_SAFE ((pocl_kernel_arg_block *)kernel->cpu_arg_blocks, b, tmp)
+  {
+    pocl_aligned_free (b);
+  }
+  kernel->cpu_arg_blocks = NULL;
+}
+
 void
 pocl_lock_events_inorder (cl_event ev1, cl_event ev2)
 {
@@ -630,7 +643,7 @@ pocl_create_command_full (_cl_command_node **cmd,
           pocl_create_migration_commands (
             dev, &size_events[i], final_event, mi->buffer->size_buffer,
             &(mi->buffer->size_buffer)->device_ptrs[dev->global_mem_id],
-            mi->read_only, command_type, mig_flags,
+            mi->read_only, 0, 0, command_type, mig_flags,
             mi->buffer->size_buffer->size, NULL);
         }
       ++i;
@@ -676,7 +689,8 @@ pocl_create_command_full (_cl_command_node **cmd,
       pocl_create_migration_commands (
         dev, NULL, final_event, mi->buffer,
         &mi->buffer->device_ptrs[dev->global_mem_id], mi->read_only,
-        command_type, mig_flags, migration_size, &prev_migr_event);
+        mi->write_offset, mi->write_size, command_type, mig_flags,
+        migration_size, &prev_migr_event);
 
       /* Hold the last updater events of the parent buffers so we can refer
          to the event in potential implicit sub-buffer migrations. */
@@ -802,7 +816,7 @@ pocl_alloc_or_retain_mem_host_ptr (cl_mem mem)
   if (mem->mem_host_ptr == NULL)
     {
       size_t align = max (mem->context->min_buffer_alignment, 16);
-      mem->mem_host_ptr = pocl_aligned_malloc (align, mem->size);
+      mem->mem_host_ptr = pocl_host_mem_alloc (align, mem->size);
       if (mem->mem_host_ptr == NULL)
         return -1;
       mem->mem_host_ptr_version = 0;
@@ -819,7 +833,8 @@ pocl_release_mem_host_ptr (cl_mem mem)
   --mem->mem_host_ptr_refcount;
   if (mem->mem_host_ptr_refcount == 0 && mem->mem_host_ptr != NULL)
     {
-      pocl_aligned_free (mem->mem_host_ptr);
+      size_t align = max (mem->context->min_buffer_alignment, 16);
+      pocl_host_mem_free (mem->mem_host_ptr, align, mem->size);
       mem->mem_host_ptr = NULL;
       mem->mem_host_ptr_version = 0;
     }
@@ -91,6 +91,27 @@ void *pocl_aligned_malloc(size_t alignment, size_t size);
 POCL_EXPORT
 void pocl_aligned_free (void *ptr);
 
+/* The argument arrays of a launch of the CPU drivers are kept in a block
+ * which is returned to the kernel at the end of the launch and reused by its
+ * next launches on the same device, so that the arrays and the image
+ * descriptors are allocated only once, and only the arguments which changed
+ * since the previous launch are resolved again. See
+ * pocl_setup_kernel_arg_array (). */
+typedef struct pocl_kernel_arg_block pocl_kernel_arg_block;
+struct pocl_kernel_arg_block
+{
+  pocl_kernel_arg_block *next;
+  cl_device_id device;
+  /* the id of the cl_mem or cl_sampler each image and sampler argument slot
+   * was filled for */
+  uint64_t *keys;
+  struct dev_image_t *images;
+};
+
+/* Frees the argument blocks cached in the kernel for all devices. Called
+ * when the kernel is released, so no launch can be using them. */
+void pocl_free_kernel_arg_blocks (cl_kernel kernel);
+
 /* locks / unlocks two events in order of their event-id.
  * This avoids any potential deadlocks of threads should
  * they try to lock events in opposite order. */
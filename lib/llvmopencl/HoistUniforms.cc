@@ -0,0 +1,273 @@
+// LLVM function pass to hoist work-group uniform values out of the
+// work-item loops.
+//
+// Copyright (c) 2026 PoCL developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "CompilerWarnings.h"
+IGNORE_COMPILER_WARNING("-Wmaybe-uninitialized")
+#include <llvm/ADT/Twine.h>
+POP_COMPILER_DIAGS
+IGNORE_COMPILER_WARNING("-Wunused-parameter")
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Analysis/LoopIterator.h>
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/IR/Module.h>
+
+#include "HoistUniforms.h"
+#include "KernelCompilerUtils.h"
+#include "LLVMUtils.h"
+#include "VariableUniformityAnalysis.h"
+#include "VariableUniformityAnalysisResult.hh"
+#include "Workgroup.h"
+#include "WorkitemHandlerChooser.h"
+#include "pocl_runtime_config.h"
+POP_COMPILER_DIAGS
+
+#define PASS_NAME "hoist-uniforms"
+#define PASS_CLASS pocl::HoistUniforms
+#define PASS_DESC "Hoists work-group uniform values out of work-item loops."
+
+namespace pocl {
+
+using namespace llvm;
+
+using ValueSet = SmallPtrSet<const Value *, 8>;
+
+// Returns true if the loop is a work-item loop created by WorkitemLoops,
+// that is, its latch compares one of the local id pseudo variables against
+// the local size.
+static bool isWorkItemLoop(Loop &L, const ValueSet &LocalIdVars) {
+  BasicBlock *Latch = L.getLoopLatch();
+  if (Latch == nullptr)
+    return false;
+  BranchInst *Br = dyn_cast<BranchInst>(Latch->getTerminator());
+  if (Br == nullptr || !Br->isConditional())
+    return false;
+  ICmpInst *Cmp = dyn_cast<ICmpInst>(Br->getCondition());
+  if (Cmp == nullptr)
+    return false;
+  LoadInst *Id = dyn_cast<LoadInst>(Cmp->getOperand(0));
+  return Id != nullptr && LocalIdVars.count(Id->getPointerOperand());
+}
+
+// Collects the memory objects written inside the loop to Written. Returns
+// false if the loop might write memory which is not private to the
+// work-item (or the id pseudo variables), in which case no load can be
+// hoisted from it.
+static bool collectPrivateWrites(Loop &L, const ValueSet &PseudoVars,
+                                 ValueSet &Written) {
+  for (BasicBlock *BB : L.blocks()) {
+    for (Instruction &I : *BB) {
+      if (!I.mayWriteToMemory())
+        continue;
+      const Value *Ptr = nullptr;
+      if (StoreInst *SI = dyn_cast<StoreInst>(&I)) {
+        if (!SI->isSimple())
+          return false;
+        Ptr = SI->getPointerOperand();
+      } else if (MemIntrinsic *MI = dyn_cast<MemIntrinsic>(&I)) {
+        if (MI->isVolatile())
+          return false;
+        Ptr = MI->getRawDest();
+      } else if (I.isLifetimeStartOrEnd()) {
+        CallBase &CB = cast<CallBase>(I);
+        Ptr = CB.getArgOperand(CB.arg_size() - 1);
+      } else if (CallBase *CB = dyn_cast<CallBase>(&I)) {
+        // E.g. llvm.assume which only models the control dependence.
+        if (CB->onlyAccessesInaccessibleMemory())
+          continue;
+        return false;
+      } else {
+        return false;
+      }
+      const Value *Obj = getUnderlyingObject(Ptr);
+      if (!isa<AllocaInst>(Obj) && !PseudoVars.count(Obj))
+        return false;
+      Written.insert(Obj);
+    }
+  }
+  return true;
+}
+
+// Returns true if no instruction of the loop can stop the execution before
+// the loop exits, that is, the blocks dominating the exiting blocks are
+// executed in every iteration.
+static bool alwaysReachesExits(Loop &L) {
+  for (BasicBlock *BB : L.blocks()) {
+    for (Instruction &I : *BB) {
+      if (isa<ReturnInst>(I) || isa<UnreachableInst>(I) ||
+          !isGuaranteedToTransferExecutionToSuccessor(&I))
+        return false;
+    }
+  }
+  return true;
+}
+
+// Returns true if the call computes its value from its arguments only and
+// can thus be executed once for all the work-items.
+static bool isPureCall(CallBase &CB) {
+  return !CB.isInlineAsm() && !CB.isConvergent() &&
+         CB.doesNotAccessMemory() && CB.doesNotThrow() && CB.willReturn();
+}
+
+// Moves the uniform instructions of the work-item loop L, which do not
+// depend on anything computed inside the loop, to the loop preheader.
+// Only the blocks not belonging to any inner loop are scanned; the inner
+// work-item loops have been processed before and their hoisted instructions
+// are now in their preheaders, which belong to L.
+static bool hoistFromWorkItemLoop(Function &F, Loop &L, LoopInfo &LI,
+                                  DominatorTree &DT,
+                                  VariableUniformityAnalysisResult &VUA,
+                                  const ValueSet &PseudoVars) {
+
+  // The first iteration peeled loops of the dynamic local size WG functions
+  // branch conditionally to the loop and thus do not have a preheader to
+  // which the code could be moved unconditionally.
+  BasicBlock *Preheader = L.getLoopPreheader();
+  if (Preheader == nullptr)
+    return false;
+
+  ValueSet Written;
+  bool OnlyPrivateWrites = collectPrivateWrites(L, PseudoVars, Written);
+  bool ReachesExits = alwaysReachesExits(L);
+
+  SmallVector<BasicBlock *, 4> ExitingBlocks;
+  L.getExitingBlocks(ExitingBlocks);
+
+  LoopBlocksRPO RPOT(&L);
+  RPOT.perform(&LI);
+
+  bool Changed = false;
+  for (BasicBlock *BB : RPOT) {
+    if (LI.getLoopFor(BB) != &L)
+      continue;
+
+    // The WI loops iterate at least once, thus the instructions in blocks
+    // executed in every iteration can be executed in the preheader even if
+    // they are not speculatable.
+    bool AlwaysExecuted =
+        ReachesExits && llvm::all_of(ExitingBlocks, [&](BasicBlock *Exiting) {
+          return DT.dominates(BB, Exiting);
+        });
+
+    for (Instruction &I : llvm::make_early_inc_range(*BB)) {
+      if (isa<PHINode>(I) || isa<AllocaInst>(I) || I.isTerminator() ||
+          I.isEHPad() || isa<DbgInfoIntrinsic>(I))
+        continue;
+      if (!L.hasLoopInvariantOperands(&I))
+        continue;
+
+      if (LoadInst *Load = dyn_cast<LoadInst>(&I)) {
+        if (!Load->isSimple() || !AlwaysExecuted || !OnlyPrivateWrites ||
+            !VUA.isUniform(&F, Load))
+          continue;
+        const Value *Obj = getUnderlyingObject(Load->getPointerOperand());
+        if (!isa<Argument>(Obj) && !isa<GlobalVariable>(Obj) &&
+            !isa<AllocaInst>(Obj))
+          continue;
+        if (Written.count(Obj))
+          continue;
+      } else if (CallBase *CB = dyn_cast<CallBase>(&I)) {
+        if (!isPureCall(*CB))
+          continue;
+        if (!AlwaysExecuted && !isSafeToSpeculativelyExecute(&I))
+          continue;
+      } else {
+        if (I.mayHaveSideEffects() || I.mayReadFromMemory() ||
+            !VUA.isUniform(&F, &I))
+          continue;
+        if (!AlwaysExecuted && !isSafeToSpeculativelyExecute(&I))
+          continue;
+      }
+
+#if LLVM_MAJOR < 20
+      I.moveBefore(Preheader->getTerminator());
+#else
+      I.moveBefore(Preheader->getTerminator()->getIterator());
+#endif
+      // The instruction is not part of the parallel loop anymore.
+      I.setMetadata(LLVMContext::MD_access_group, nullptr);
+      Changed = true;
+    }
+  }
+  return Changed;
+}
+
+static bool hoistUniforms(Function &F, LoopInfo &LI, DominatorTree &DT,
+                          VariableUniformityAnalysisResult &VUA) {
+
+  Module *M = F.getParent();
+  ValueSet LocalIdVars;
+  ValueSet PseudoVars;
+  for (int Dim = 0; Dim < 3; ++Dim) {
+    if (GlobalVariable *LID = M->getGlobalVariable(LID_G_NAME(Dim))) {
+      LocalIdVars.insert(LID);
+      PseudoVars.insert(LID);
+    }
+    if (GlobalVariable *GID = M->getGlobalVariable(GID_G_NAME(Dim)))
+      PseudoVars.insert(GID);
+  }
+  if (LocalIdVars.empty())
+    return false;
+
+  // Process the innermost loops first so the values hoisted to the
+  // preheader of an inner WI loop are considered for the outer WI loops.
+  bool Changed = false;
+  SmallVector<Loop *, 8> Loops = LI.getLoopsInPreorder();
+  for (Loop *L : llvm::reverse(Loops)) {
+    if (isWorkItemLoop(*L, LocalIdVars))
+      Changed |= hoistFromWorkItemLoop(F, *L, LI, DT, VUA, PseudoVars);
+  }
+  return Changed;
+}
+
+llvm::PreservedAnalyses HoistUniforms::run(llvm::Function &F,
+                                           llvm::FunctionAnalysisManager &AM) {
+  if (!isKernelToProcess(F))
+    return PreservedAnalyses::all();
+
+  // The CBS work-item loops are left as is, see HoistUniforms.h.
+  WorkitemHandlerType WIH = AM.getResult<WorkitemHandlerChooser>(F).WIH;
+  if (WIH != WorkitemHandlerType::LOOPS)
+    return PreservedAnalyses::all();
+
+  if (!pocl_get_bool_option("POCL_WILOOPS_HOIST_UNIFORMS", true))
+    return PreservedAnalyses::all();
+
+  auto &DT = AM.getResult<llvm::DominatorTreeAnalysis>(F);
+  auto &LI = AM.getResult<llvm::LoopAnalysis>(F);
+  auto &VUA = AM.getResult<VariableUniformityAnalysis>(F);
+
+  PreservedAnalyses PAChanged = PreservedAnalyses::none();
+  PAChanged.preserveSet<CFGAnalyses>();
+  PAChanged.preserve<VariableUniformityAnalysis>();
+  PAChanged.preserve<WorkitemHandlerChooser>();
+  return hoistUniforms(F, LI, DT, VUA) ? PAChanged : PreservedAnalyses::all();
+}
+
+REGISTER_NEW_FPASS(PASS_NAME, PASS_CLASS, PASS_DESC);
+
+} // namespace pocl
@@ -0,0 +1,53 @@
+// Header for HoistUniforms function pass.
+//
+// Copyright (c) 2026 PoCL developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef POCL_HOIST_UNIFORMS_H
+#define POCL_HOIST_UNIFORMS_H
+
+#include <llvm/IR/Function.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/Pass.h>
+#include <llvm/Passes/PassBuilder.h>
+
+// Moves the work-group uniform computations out of the work-item loops
+// produced by WorkitemLoops. Uniform loads cannot be hoisted by the standard
+// LICM since the loops store to the local and global id pseudo variables,
+// which the alias analysis cannot separate from the kernel argument buffers.
+// The sub-CFG formation (CBS) work-item loops are not handled: that pass
+// already loads the uniform values live across barriers in the uniform load
+// block of each sub-CFG, and its loops iterate over induction variables
+// instead of the local id pseudo variables which the uniformity analysis
+// and the work-item loop detection here rely on.
+
+namespace pocl {
+
+class HoistUniforms : public llvm::PassInfoMixin<HoistUniforms> {
+public:
+  static void registerWithPB(llvm::PassBuilder &B);
+  llvm::PreservedAnalyses run(llvm::Function &F,
+                              llvm::FunctionAnalysisManager &AM);
+  static bool isRequired() { return true; }
+};
+
+} // namespace pocl
+
+#endif
@@ -44,6 +44,7 @@ IGNORE_COMPILER_WARNING("-Wunused-parameter")
 #include "FlattenBarrierSubs.hh"
 #include "FlattenGlobals.hh"
 #include "HandleSamplerInitialization.h"
+#include "HoistUniforms.h"
 #include "ImplicitConditionalBarriers.h"
 #include "ImplicitLoopBarriers.h"
 #include "InlineKernels.hh"
@@ -683,6 +684,7 @@ void registerPassBuilderPasses(llvm::PassBuilder &PB) {
   FlattenBarrierSubs::registerWithPB(PB);
   FlattenGlobals::registerWithPB(PB);
   HandleSamplerInitialization::registerWithPB(PB);
+  HoistUniforms::registerWithPB(PB);
   ImplicitConditionalBarriers::registerWithPB(PB);
   ImplicitLoopBarriers::registerWithPB(PB);
   InlineKernels::registerWithPB(PB);
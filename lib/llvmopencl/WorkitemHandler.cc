@@ -93,6 +93,8 @@ void WorkitemHandler::Initialize(Kernel *K_) {
   getModuleBoolMetadata(*M, "WGDynamicLocalSize", WGDynamicLocalSize);
   getModuleBoolMetadata(*M, "WGAssumeZeroGlobalOffset",
                         WGAssumeZeroGlobalOffset);
+  WGVectorizeLoops = false;
+  getModuleBoolMetadata(*M, "WGVectorizeLoops", WGVectorizeLoops);
 
   if (WGLocalSizeX == 0)
     WGLocalSizeX = 1;
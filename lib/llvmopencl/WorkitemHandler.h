@@ -122,6 +122,7 @@ protected:
   unsigned long AddressBits;
   bool WGAssumeZeroGlobalOffset;
   bool WGDynamicLocalSize;
+  bool WGVectorizeLoops;
   bool DeviceUsingArgBufferLauncher;
   bool DeviceIsSPMD;
   unsigned long WGLocalSizeX;
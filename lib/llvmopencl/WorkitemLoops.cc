@@ -32,6 +32,7 @@ IGNORE_COMPILER_WARNING("-Wunused-parameter")
 #include <llvm/Analysis/PostDominators.h>
 #include <llvm/IR/DataLayout.h>
 #include <llvm/IR/DebugInfoMetadata.h>
+#include <llvm/IR/GetElementPtrTypeIterator.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/IntrinsicInst.h>
@@ -59,6 +60,7 @@ POP_COMPILER_DIAGS
 #include <array>
 #include <iostream>
 #include <map>
+#include <set>
 #include <sstream>
 #include <vector>
 
@@ -124,6 +126,11 @@ private:
 
   StrInstructionMap ContextArrays;
 
+  // The context arrays created for non-alloca values in their creation
+  // order. These can share storage with each other.
+  std::vector<std::pair<llvm::Instruction *, llvm::AllocaInst *>>
+      ValueContextArrays;
+
   // Temporary global_id_* iteration variables updated by the work-item
   // loops.
   std::array<llvm::GlobalVariable *, 3> GlobalIdIterators;
@@ -131,9 +138,16 @@ private:
   bool processFunction(llvm::Function &F);
 
   void fixMultiRegionVariables(ParallelRegion *Region);
+  void allocateContextSlots();
+  std::set<ParallelRegion *>
+  getContextArrayLiveRegions(llvm::AllocaInst *ContextArray);
   void addContextSaveRestore(llvm::Instruction *instruction);
   void releaseParallelRegions();
 
+  bool getLocalIdStride(llvm::Value *V, int Dim, ParallelRegion &Region,
+                        int64_t &Stride, unsigned Depth = 0);
+  std::array<int, 3> chooseLoopOrder(ParallelRegion &Region);
+
   // Returns an instruction in the entry block which computes the
   // total size of work-items in the work-group. If it doesn't
   // exist, creates it to the end of the entry block.
@@ -209,6 +223,7 @@ bool WorkitemLoopsImpl::runOnFunction(Function &Func) {
   Changed |= fixUndominatedVariableUses(DT, Func);
 
   ContextArrays.clear();
+  ValueContextArrays.clear();
   TempInstructionIds.clear();
 
   releaseParallelRegions();
@@ -451,6 +466,184 @@ void WorkitemLoopsImpl::releaseParallelRegions() {
   }
 }
 
+/// Computes the change of the given integer or pointer value in the region
+/// when the local id of the dimension Dim is incremented by one.
+///
+/// \returns false in case the stride is not a compile-time constant.
+bool WorkitemLoopsImpl::getLocalIdStride(llvm::Value *V, int Dim,
+                                         ParallelRegion &Region,
+                                         int64_t &Stride, unsigned Depth) {
+  Stride = 0;
+  if (isa<ConstantInt>(V) || isa<Argument>(V))
+    return true;
+
+  llvm::Instruction *Inst = dyn_cast<Instruction>(V);
+  if (Inst == nullptr || !Region.hasBlock(Inst->getParent()) || Depth > 8) {
+    // The work-items share the stack frame, thus the context arrays and
+    // the other allocas outside the region have the same base address.
+    return isa<AllocaInst>(V) || VUA.isUniform(F, V);
+  }
+
+  if (LoadInst *Load = dyn_cast<LoadInst>(Inst)) {
+    for (int D = 0; D < 3; ++D) {
+      if (Load->getPointerOperand() == LocalIdGlobals[D] ||
+          Load->getPointerOperand() == GlobalIdIterators[D]) {
+        Stride = D == Dim;
+        return true;
+      }
+    }
+    return VUA.isUniform(F, V);
+  }
+
+  int64_t S0, S1;
+  switch (Inst->getOpcode()) {
+  case Instruction::Add:
+  case Instruction::Sub:
+    if (!getLocalIdStride(Inst->getOperand(0), Dim, Region, S0, Depth + 1) ||
+        !getLocalIdStride(Inst->getOperand(1), Dim, Region, S1, Depth + 1))
+      return false;
+    Stride = Inst->getOpcode() == Instruction::Add ? S0 + S1 : S0 - S1;
+    return true;
+  case Instruction::Mul:
+    if (!getLocalIdStride(Inst->getOperand(0), Dim, Region, S0, Depth + 1) ||
+        !getLocalIdStride(Inst->getOperand(1), Dim, Region, S1, Depth + 1))
+      return false;
+    if (S0 == 0 && S1 == 0)
+      return true;
+    // A multiplication with a non-constant uniform value produces an
+    // unknown stride (e.g. the row pitch argument of a 2D kernel).
+    if (S1 == 0 && isa<ConstantInt>(Inst->getOperand(1))) {
+      Stride = S0 * cast<ConstantInt>(Inst->getOperand(1))->getSExtValue();
+      return true;
+    }
+    if (S0 == 0 && isa<ConstantInt>(Inst->getOperand(0))) {
+      Stride = S1 * cast<ConstantInt>(Inst->getOperand(0))->getSExtValue();
+      return true;
+    }
+    return false;
+  case Instruction::Shl:
+    if (!isa<ConstantInt>(Inst->getOperand(1)) ||
+        cast<ConstantInt>(Inst->getOperand(1))->getZExtValue() > 32 ||
+        !getLocalIdStride(Inst->getOperand(0), Dim, Region, S0, Depth + 1))
+      return false;
+    Stride = S0 << cast<ConstantInt>(Inst->getOperand(1))->getZExtValue();
+    return true;
+  case Instruction::SExt:
+  case Instruction::ZExt:
+  case Instruction::Trunc:
+  case Instruction::BitCast:
+  case Instruction::AddrSpaceCast:
+    return getLocalIdStride(Inst->getOperand(0), Dim, Region, Stride,
+                            Depth + 1);
+  case Instruction::GetElementPtr: {
+    GetElementPtrInst *GEP = cast<GetElementPtrInst>(Inst);
+    if (!getLocalIdStride(GEP->getPointerOperand(), Dim, Region, Stride,
+                          Depth + 1))
+      return false;
+    const DataLayout &DL = M->getDataLayout();
+    for (gep_type_iterator GTI = gep_type_begin(GEP), E = gep_type_end(GEP);
+         GTI != E; ++GTI) {
+      // Struct field indices are constants.
+      if (GTI.isStruct())
+        continue;
+      if (!getLocalIdStride(GTI.getOperand(), Dim, Region, S0, Depth + 1))
+        return false;
+      if (S0 == 0)
+        continue;
+      TypeSize ElementSize = DL.getTypeAllocSize(GTI.getIndexedType());
+      if (ElementSize.isScalable())
+        return false;
+      Stride += S0 * (int64_t)ElementSize.getKnownMinValue();
+    }
+    return true;
+  }
+  default:
+    return VUA.isUniform(F, V);
+  }
+}
+
+/// Chooses the order of the work-item loops created around the region.
+///
+/// The dimension in which the most memory accesses of the region have unit
+/// stride becomes the innermost loop, so the loop vectorizer gets contiguous
+/// accesses also for the kernels which index the rows with the local id
+/// of the Y dimension. Ties are broken by the longer trip count, then by
+/// the lower dimension. Only the static local size work-groups are
+/// reordered as the trip counts of the dynamic ones are not known.
+///
+/// \returns the dimensions from the innermost loop to the outermost.
+std::array<int, 3> WorkitemLoopsImpl::chooseLoopOrder(ParallelRegion &Region) {
+
+  std::array<int, 3> Order = {0, 1, 2};
+  if (WGDynamicLocalSize ||
+      !pocl_get_bool_option("POCL_WILOOPS_INTERCHANGE", true))
+    return Order;
+
+  size_t LocalSizes[] = {WGLocalSizeX, WGLocalSizeY, WGLocalSizeZ};
+  int Score[3] = {0, 0, 0};
+  bool Varying = false;
+  const DataLayout &DL = M->getDataLayout();
+  for (llvm::BasicBlock *BB : Region) {
+    for (llvm::Instruction &I : *BB) {
+      llvm::Value *Ptr;
+      llvm::Type *AccessType;
+      if (LoadInst *Load = dyn_cast<LoadInst>(&I)) {
+        Ptr = Load->getPointerOperand();
+        AccessType = Load->getType();
+      } else if (StoreInst *Store = dyn_cast<StoreInst>(&I)) {
+        Ptr = Store->getPointerOperand();
+        AccessType = Store->getValueOperand()->getType();
+      } else {
+        continue;
+      }
+      // The id pseudo variables and other scalar globals.
+      if (isa<GlobalVariable>(Ptr))
+        continue;
+      TypeSize AccessSize = DL.getTypeStoreSize(AccessType);
+      if (AccessSize.isScalable())
+        continue;
+      for (int Dim = 0; Dim < 3; ++Dim) {
+        if (LocalSizes[Dim] < 2)
+          continue;
+        int64_t Stride;
+        bool Known = getLocalIdStride(Ptr, Dim, Region, Stride);
+        if (Known && Stride == 0)
+          continue;
+        Varying = true;
+        if (Known && (uint64_t)std::abs(Stride) ==
+                         AccessSize.getKnownMinValue())
+          ++Score[Dim];
+        else
+          --Score[Dim];
+      }
+    }
+  }
+
+  // Nothing depends on the local ids, keep the default order.
+  if (!Varying)
+    return Order;
+
+  int Inner = 0;
+  for (int Dim = 1; Dim < 3; ++Dim) {
+    if (LocalSizes[Dim] < 2)
+      continue;
+    if (LocalSizes[Inner] < 2 || Score[Dim] > Score[Inner] ||
+        (Score[Dim] == Score[Inner] && LocalSizes[Dim] > LocalSizes[Inner]))
+      Inner = Dim;
+  }
+  if (Inner == 0)
+    return Order;
+
+  LLVM_DEBUG(dbgs() << "Making dimension " << Inner
+                    << " the innermost work-item loop\n");
+  Order[0] = Inner;
+  for (int Dim = 0, Pos = 1; Dim < 3; ++Dim) {
+    if (Dim != Inner)
+      Order[Pos++] = Dim;
+  }
+  return Order;
+}
+
 bool WorkitemLoopsImpl::processFunction(Function &F) {
 
   releaseParallelRegions();
@@ -505,6 +698,8 @@ bool WorkitemLoopsImpl::processFunction(Function &F) {
     fixMultiRegionVariables(Region);
   }
 
+  allocateContextSlots();
+
 #if 0
   std::cerr << "### After context code addition:" << std::endl;
   F.viewCFG();
@@ -626,24 +821,22 @@ bool WorkitemLoopsImpl::processFunction(Function &F) {
                            gv);
 
     } else {
-      if (WGLocalSizeX > 1) {
-        l = createLoopAround(*PRegion, l.first, l.second, PeelFirst, 0,
-                             !Unrolled);
-      } else {
-        // Ensure the global id for a 1-size dimension is initialized.
-        getGlobalIdOrigin(0);
-      }
-
-      if (WGLocalSizeY > 1) {
-        l = createLoopAround(*PRegion, l.first, l.second, false, 1);
-      } else {
-        getGlobalIdOrigin(1);
-      }
-
-      if (WGLocalSizeZ > 1) {
-        l = createLoopAround(*PRegion, l.first, l.second, false, 2);
-      } else {
-        getGlobalIdOrigin(2);
+      // The peeled and unrolled regions rely on the X loop being the
+      // innermost one.
+      std::array<int, 3> LoopOrder = {0, 1, 2};
+      if (!PeelFirst && !Unrolled)
+        LoopOrder = chooseLoopOrder(*PRegion);
+
+      size_t LocalSizes[] = {WGLocalSizeX, WGLocalSizeY, WGLocalSizeZ};
+      for (int Dim : LoopOrder) {
+        if (LocalSizes[Dim] > 1) {
+          l = createLoopAround(*PRegion, l.first, l.second,
+                               Dim == 0 && PeelFirst, Dim,
+                               Dim != 0 || !Unrolled);
+        } else {
+          // Ensure the global id for a 1-size dimension is initialized.
+          getGlobalIdOrigin(Dim);
+        }
       }
     }
 
@@ -902,8 +1095,189 @@ llvm::AllocaInst *WorkitemLoopsImpl::getContextArray(llvm::Instruction *Inst,
     return ContextArrays[CArrayName];
 
   BasicBlock &Entry = K->getEntryBlock();
-  return ContextArrays[CArrayName] = createAlignedAndPaddedContextAlloca(
-             Inst, &*(Entry.getFirstInsertionPt()), CArrayName, PaddingAdded);
+  llvm::AllocaInst *ContextArray = createAlignedAndPaddedContextAlloca(
+      Inst, &*(Entry.getFirstInsertionPt()), CArrayName, PaddingAdded);
+  if (!isa<AllocaInst>(Inst) && !PaddingAdded)
+    ValueContextArrays.push_back(std::make_pair(Inst, ContextArray));
+  return ContextArrays[CArrayName] = ContextArray;
+}
+
+/// Returns the parallel regions in which the value stored in the given
+/// context array is live.
+///
+/// These are the regions with blocks on the paths from the context save to
+/// the context restores. Nothing else accesses the array in the other
+/// regions, thus another value can use the same storage there.
+std::set<ParallelRegion *>
+WorkitemLoopsImpl::getContextArrayLiveRegions(llvm::AllocaInst *ContextArray) {
+
+  std::set<llvm::BasicBlock *> LiveBlocks;
+  BasicBlockVector Worklist;
+  for (llvm::User *U : ContextArray->users()) {
+    for (llvm::User *GEPUser : U->users()) {
+      llvm::Instruction *Access = cast<Instruction>(GEPUser);
+      if (isa<StoreInst>(Access))
+        LiveBlocks.insert(Access->getParent());
+      else
+        Worklist.push_back(Access->getParent());
+    }
+  }
+
+  // The save dominates the restores, thus walking backwards from the
+  // restores stops at the block of the save.
+  while (!Worklist.empty()) {
+    llvm::BasicBlock *BB = Worklist.back();
+    Worklist.pop_back();
+    if (!LiveBlocks.insert(BB).second)
+      continue;
+    for (llvm::BasicBlock *Pred : predecessors(BB))
+      Worklist.push_back(Pred);
+  }
+
+  std::set<ParallelRegion *> LiveRegions;
+  for (ParallelRegion *Region : OriginalParallelRegions) {
+    for (llvm::BasicBlock *BB : *Region) {
+      if (LiveBlocks.count(BB)) {
+        LiveRegions.insert(Region);
+        break;
+      }
+    }
+  }
+  return LiveRegions;
+}
+
+/// Reduces the stack footprint of the context arrays of the non-alloca
+/// values.
+///
+/// Values of the same type which are never live in the same parallel region
+/// share one context array (a greedy coloring of the interference graph of
+/// the values). The arrays live in the same regions are then packed into one
+/// array of structs, which makes a work-item's context data adjacent in
+/// memory, if the values are accessed by each work-item as a whole: the
+/// scalar values of vectorized work-item loops keep their per-value (SoA)
+/// arrays since the vectorizer turns their accesses into consecutive vector
+/// loads and stores, whereas the vector and aggregate values and all the
+/// values of scalar work-item loops are accessed one work-item at a time.
+void WorkitemLoopsImpl::allocateContextSlots() {
+
+  if (!pocl_get_bool_option("POCL_WILOOPS_CONTEXT_SLOTS", true)) {
+    ValueContextArrays.clear();
+    return;
+  }
+
+  struct ContextSlot {
+    llvm::Type *ValueType;
+    std::set<ParallelRegion *> LiveRegions;
+    std::vector<llvm::AllocaInst *> Arrays;
+  };
+  std::vector<ContextSlot> Slots;
+
+  for (auto &ValueArray : ValueContextArrays) {
+    llvm::AllocaInst *ContextArray = ValueArray.second;
+    // Debug info refers to the array of the variable, keep it separate.
+    if (ContextArray->isUsedByMetadata())
+      continue;
+
+    llvm::Type *ValueType = ValueArray.first->getType();
+    std::set<ParallelRegion *> Live = getContextArrayLiveRegions(ContextArray);
+    ContextSlot *Slot = nullptr;
+    for (ContextSlot &Candidate : Slots) {
+      if (Candidate.ValueType != ValueType)
+        continue;
+      bool Interferes = false;
+      for (ParallelRegion *Region : Live)
+        Interferes |= Candidate.LiveRegions.count(Region) > 0;
+      if (!Interferes) {
+        Slot = &Candidate;
+        break;
+      }
+    }
+    if (Slot == nullptr) {
+      Slots.push_back(ContextSlot{ValueType, {}, {}});
+      Slot = &Slots.back();
+    }
+    Slot->LiveRegions.insert(Live.begin(), Live.end());
+    Slot->Arrays.push_back(ContextArray);
+  }
+  ValueContextArrays.clear();
+
+  std::set<llvm::AllocaInst *> Removed;
+  for (ContextSlot &Slot : Slots) {
+    for (size_t I = 1; I < Slot.Arrays.size(); ++I) {
+      LLVM_DEBUG(dbgs() << "Sharing the context array of\n");
+      LLVM_DEBUG(Slot.Arrays[I]->dump());
+      Slot.Arrays[I]->replaceAllUsesWith(Slot.Arrays[0]);
+      Removed.insert(Slot.Arrays[I]);
+      Slot.Arrays[I]->eraseFromParent();
+    }
+    Slot.Arrays.resize(1);
+  }
+
+  bool Vectorized = WGVectorizeLoops && canAnnotateParallelLoops();
+  auto AccessedPerWorkItem = [&](const ContextSlot &Slot) {
+    return !Vectorized || Slot.ValueType->isVectorTy() ||
+           Slot.ValueType->isAggregateType();
+  };
+
+  std::vector<bool> Packed(Slots.size(), false);
+  for (size_t I = 0; I < Slots.size(); ++I) {
+    if (Packed[I] || !AccessedPerWorkItem(Slots[I]))
+      continue;
+    std::vector<size_t> Group = {I};
+    for (size_t J = I + 1; J < Slots.size(); ++J) {
+      if (!Packed[J] && AccessedPerWorkItem(Slots[J]) &&
+          Slots[J].LiveRegions == Slots[I].LiveRegions)
+        Group.push_back(J);
+    }
+    if (Group.size() < 2)
+      continue;
+
+    std::vector<llvm::Type *> Fields;
+    for (size_t J : Group) {
+      Fields.push_back(Slots[J].ValueType);
+      Packed[J] = true;
+    }
+    llvm::LLVMContext &C = K->getContext();
+    llvm::Type *ContextType = StructType::get(C, Fields);
+    if (!WGDynamicLocalSize)
+      ContextType = ArrayType::get(
+          ArrayType::get(ArrayType::get(ContextType, WGLocalSizeX),
+                         WGLocalSizeY),
+          WGLocalSizeZ);
+
+    llvm::AllocaInst *First = Slots[I].Arrays[0];
+    IRBuilder<> Builder(First);
+    llvm::AllocaInst *PackedArray = Builder.CreateAlloca(
+        ContextType, WGDynamicLocalSize ? First->getArraySize() : nullptr,
+        ".pocl_context.packed");
+    PackedArray->setAlignment(First->getAlign());
+
+    // Address the field of the value in the work-item's struct instead of
+    // the work-item's element in the value's array.
+    for (size_t Field = 0; Field < Group.size(); ++Field) {
+      llvm::AllocaInst *ContextArray = Slots[Group[Field]].Arrays[0];
+      for (llvm::User *U : make_early_inc_range(ContextArray->users())) {
+        GetElementPtrInst *GEP = cast<GetElementPtrInst>(U);
+        SmallVector<llvm::Value *, 5> Indices(GEP->indices());
+        Indices.push_back(ConstantInt::get(Type::getInt32Ty(C), Field));
+        IRBuilder<> GEPBuilder(GEP);
+        llvm::Value *FieldGEP =
+            GEPBuilder.CreateGEP(ContextType, PackedArray, Indices);
+        FieldGEP->takeName(GEP);
+        GEP->replaceAllUsesWith(FieldGEP);
+        GEP->eraseFromParent();
+      }
+      Removed.insert(ContextArray);
+      ContextArray->eraseFromParent();
+    }
+  }
+
+  for (auto CA = ContextArrays.begin(); CA != ContextArrays.end();) {
+    if (Removed.count(CA->second))
+      CA = ContextArrays.erase(CA);
+    else
+      ++CA;
+  }
 }
 
 /// Tries to rematerialize the given value-defining instruction.
@@ -961,6 +1335,16 @@ llvm::Value *WorkitemLoopsImpl::tryToRematerialize(
   if (Depth != nullptr && *Depth > 10)
     UNABLE_TO_REMAT("too deep");
 
+  // Uniform values are not context saved, but referred to directly in all
+  // the regions. The rematerialized code can do the same, which makes
+  // WI-id-derived values computed from uniform loads and calls cheap to
+  // recompute.
+  if (isa<Instruction>(Def) &&
+      !VUA.shouldBePrivatized(cast<Instruction>(Def)->getFunction(), Def)) {
+    ABLE_TO_REMAT();
+    return Def;
+  }
+
   if (llvm::CallInst *Call = dyn_cast<CallInst>(Def)) {
     auto *Callee = Call->getCalledFunction();
     if (Callee == nullptr || (Callee->getName() != GID_BUILTIN_NAME &&
@@ -258,6 +258,17 @@ static void fixCallingConv(llvm::Module *Mod, std::string &Log) {
 
 using SmallFunctionSet = llvm::SmallSet<llvm::Function *, 8>;
 
+// The kernel library is loaded lazily (see getKernelLibrary()), so the body
+// of a library function is read from the bitcode only when it is first
+// reached from the program's call graph.
+static void materializeBody(llvm::Function *F) {
+  if (!F->isMaterializable())
+    return;
+  if (llvm::Error E = F->materialize())
+    POCL_MSG_ERR("Failed to materialize %s from the kernel library: %s\n",
+                 F->getName().data(), toString(std::move(E)).c_str());
+}
+
 // Find all functions in the calltree of F, including declarations.
 // Returns the list of Functions called in CalledFuncList,
 // in depth-first order (to make cloning simpler);
@@ -266,6 +277,7 @@ static llvm::Function *
 find_called_functions(llvm::Function *F,
                       llvm::SmallVector<llvm::Function *> &CalledFuncList,
                       SmallFunctionSet &CallStack) {
+  materializeBody(F);
   if (F->isDeclaration()) {
     DB_PRINT("it's a declaration, return\n");
     return nullptr;
@@ -325,6 +337,7 @@ static void CopyFunc(const llvm::StringRef Name, const llvm::Module *From,
   llvm::Function *SrcFunc = From->getFunction(Name);
   // TODO: is this the linker error "not found", and not an assert?
   assert(SrcFunc && "Did not find function to copy in kernel library");
+  materializeBody(SrcFunc);
   llvm::Function *DstFunc = To->getFunction(Name);
 
   if (DstFunc == NULL) {
@@ -0,0 +1,138 @@
+/* build_cache.cc - a cache of program builds shared by the pocld sessions
+
+   Copyright (c) 2026 PoCL developers
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+*/
+
+#include <cstring>
+
+#include "build_cache.hh"
+#include "pocl_debug.h"
+#include "pocl_runtime_config.h"
+
+#define DEFAULT_BUILD_CACHE_MB 256
+
+bool BuildCacheEntry::matchesKernels(
+    const std::vector<std::string> &KernelNames) const {
+  if (KernelNames.size() != KernelMeta.size())
+    return false;
+  for (size_t i = 0; i < KernelNames.size(); ++i) {
+    if (std::strncmp(KernelNames[i].c_str(), KernelMeta[i].meta.name,
+                     MAX_PACKED_STRING_LEN - 1) != 0)
+      return false;
+  }
+  return true;
+}
+
+ProgramBuildCache &ProgramBuildCache::instance() {
+  static ProgramBuildCache Cache;
+  return Cache;
+}
+
+ProgramBuildCache::ProgramBuildCache() {
+  int MB = pocl_get_int_option("POCLD_BUILD_CACHE_MB", DEFAULT_BUILD_CACHE_MB);
+  MaxBytes = MB > 0 ? (uint64_t)MB << 20 : 0;
+}
+
+static void hashField(SHA1_CTX *Ctx, const void *Data, uint64_t Size) {
+  // prefix each field with its size so that they can't run into each other
+  pocl_SHA1_Update(Ctx, (const uint8_t *)&Size, sizeof(Size));
+  pocl_SHA1_Update(Ctx, (const uint8_t *)Data, Size);
+}
+
+ProgramBuildCache::Key
+ProgramBuildCache::makeKey(char Kind, const void *Input, size_t InputSize,
+                           const std::string &Options,
+                           const std::vector<std::string> &DeviceIds) {
+  SHA1_CTX Ctx;
+  pocl_SHA1_Init(&Ctx);
+  hashField(&Ctx, &Kind, 1);
+  hashField(&Ctx, Input, InputSize);
+  hashField(&Ctx, Options.data(), Options.size());
+  for (const std::string &Id : DeviceIds)
+    hashField(&Ctx, Id.data(), Id.size());
+  Key K;
+  pocl_SHA1_Final(&Ctx, K.data());
+  return K;
+}
+
+static uint64_t entrySize(const BuildCacheEntry &E) {
+  uint64_t Size = sizeof(E);
+  for (const auto &B : E.Binaries)
+    Size += B.size();
+  for (const auto &L : E.BuildLogs)
+    Size += L.size();
+  for (const auto &M : E.KernelMeta)
+    Size += sizeof(M) + M.arg_meta.size() * sizeof(ArgumentInfo_t);
+  return Size;
+}
+
+std::shared_ptr<const BuildCacheEntry>
+ProgramBuildCache::lookup(const Key &K) {
+  std::unique_lock<std::mutex> L(Lock);
+  auto It = Entries.find(K);
+  if (It == Entries.end()) {
+    ++Misses;
+    return nullptr;
+  }
+  LRU.splice(LRU.begin(), LRU, It->second.LRUPos);
+  ++Hits;
+  return It->second.Entry;
+}
+
+void ProgramBuildCache::insert(const Key &K,
+                               std::shared_ptr<const BuildCacheEntry> E) {
+  uint64_t Size = entrySize(*E);
+  if (Size > MaxBytes)
+    return;
+
+  std::unique_lock<std::mutex> L(Lock);
+  auto It = Entries.find(K);
+  if (It != Entries.end()) {
+    // built concurrently by another session
+    CurBytes -= It->second.Size;
+    LRU.erase(It->second.LRUPos);
+    Entries.erase(It);
+  }
+  evictLocked(MaxBytes - Size);
+  LRU.push_front(K);
+  Entries[K] = Slot{std::move(E), Size, LRU.begin()};
+  CurBytes += Size;
+}
+
+void ProgramBuildCache::remove(const Key &K) {
+  std::unique_lock<std::mutex> L(Lock);
+  auto It = Entries.find(K);
+  if (It == Entries.end())
+    return;
+  CurBytes -= It->second.Size;
+  LRU.erase(It->second.LRUPos);
+  Entries.erase(It);
+}
+
+void ProgramBuildCache::evictLocked(uint64_t Limit) {
+  while (CurBytes > Limit && !LRU.empty()) {
+    auto It = Entries.find(LRU.back());
+    CurBytes -= It->second.Size;
+    Entries.erase(It);
+    LRU.pop_back();
+    ++Evictions;
+  }
+}
@@ -0,0 +1,115 @@
+/* build_cache.hh - a cache of program builds shared by the pocld sessions
+
+   Copyright (c) 2026 PoCL developers
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+*/
+
+#ifndef POCL_REMOTE_BUILD_CACHE_HH
+#define POCL_REMOTE_BUILD_CACHE_HH
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "common_cl.hh"
+#include "pocl_hash.h"
+
+#ifdef __GNUC__
+#pragma GCC visibility push(hidden)
+#endif
+
+/** The result of building a program for a list of backend devices: what is
+ * needed to recreate the program from binaries and to reply to the client
+ * as if it had been built again. */
+struct BuildCacheEntry {
+  /// The binaries and build logs, in the order of the device list.
+  std::vector<std::vector<unsigned char>> Binaries;
+  std::vector<std::string> BuildLogs;
+  std::vector<clKernelMetadata> KernelMeta;
+
+  /// Returns true if KernelNames, the kernels of the program recreated from
+  /// the binaries, are the cached kernels in the same order.
+  bool matchesKernels(const std::vector<std::string> &KernelNames) const;
+};
+
+/** Program builds shared by all the sessions of the daemon, so that a client
+ * building the same program as an earlier one (or itself in an earlier
+ * session) gets it from the binaries instead of compiling it again. Entries
+ * are keyed by a hash of the source or IL, the build options and the
+ * identity of the backend devices, and the least recently used ones are
+ * evicted when the total size exceeds POCLD_BUILD_CACHE_MB. */
+class ProgramBuildCache {
+public:
+  typedef std::array<uint8_t, SHA1_DIGEST_SIZE> Key;
+
+  static ProgramBuildCache &instance();
+
+  bool enabled() const { return MaxBytes > 0; }
+
+  /// Computes the key of a build. Kind distinguishes the sources from IL,
+  /// DeviceIds are the identity strings of the devices in the device list.
+  static Key makeKey(char Kind, const void *Input, size_t InputSize,
+                     const std::string &Options,
+                     const std::vector<std::string> &DeviceIds);
+
+  /// Returns the entry for the key and marks it as recently used, or nullptr.
+  std::shared_ptr<const BuildCacheEntry> lookup(const Key &K);
+  void insert(const Key &K, std::shared_ptr<const BuildCacheEntry> E);
+  /// Drops an entry whose binaries the backend did not accept.
+  void remove(const Key &K);
+
+  uint64_t hits() const { return Hits; }
+  uint64_t misses() const { return Misses; }
+  uint64_t evictions() const { return Evictions; }
+  uint64_t bytes() const { return CurBytes; }
+
+private:
+  ProgramBuildCache();
+
+  struct Slot {
+    std::shared_ptr<const BuildCacheEntry> Entry;
+    uint64_t Size;
+    std::list<Key>::iterator LRUPos;
+  };
+
+  void evictLocked(uint64_t Limit);
+
+  std::mutex Lock;
+  std::map<Key, Slot> Entries;
+  /// Most recently used first.
+  std::list<Key> LRU;
+  uint64_t MaxBytes;
+  std::atomic_uint64_t CurBytes{0};
+  std::atomic_uint64_t Hits{0};
+  std::atomic_uint64_t Misses{0};
+  std::atomic_uint64_t Evictions{0};
+};
+
+#ifdef __GNUC__
+#pragma GCC visibility pop
+#endif
+
+#endif
@@ -101,6 +101,9 @@ void CommandQueue::RunCommand(Request *request) {
 #else
     slow = 1;
 #endif
+    // the data is in the shared memory, the reply is small
+    if (request->Body.m.read.use_shm)
+      slow = 0;
     break;
 
   case MessageType_WriteBuffer:
@@ -173,6 +176,15 @@ void CommandQueue::RunCommand(Request *request) {
   // TODO: move this to reply thread?
   // Probably not necessary since we can only have the real event by this
   // point...
+  if (request->Body.message_type == MessageType_MigrateD2D &&
+      request->Body.m.migrate.more_chunks) {
+    // Intermediate chunks of a streamed migration only write their data, the
+    // client gets a single reply after the last one.
+    backend->waitAndDeleteEvent(request->Body.event_id);
+    delete reply;
+    return;
+  }
+
   EventPair p = backend->getEventPairForId(request->Body.event_id);
   // If the command failed or was a migration to this server, there won't be a
   // native event.
@@ -234,6 +246,38 @@ void CommandQueue::MigrateMemObj(uint32_t queue_id, Request *req, Reply *rep) {
       TP_WRITE_IMAGE_RECT(req->Body.msg_id, req->Body.client_did, queue_id,
                           req->Body.obj_id, m.width, m.height, m.depth,
                           CL_FINISHED);
+    } else if (m.chunk_size != 0) {
+      // A chunk of a migration streamed from another server. A failure of an
+      // intermediate chunk is reported with the last one, as is a failure to
+      // read the chunk at the source server.
+      int err = CL_SUCCESS;
+      {
+        std::unique_lock<std::mutex> l(MigrationChunkMutex);
+        auto it = MigrationChunkErrors.find(req->Body.msg_id);
+        if (it != MigrationChunkErrors.end()) {
+          err = it->second;
+          if (!m.more_chunks)
+            MigrationChunkErrors.erase(it);
+        }
+      }
+      if (err == CL_SUCCESS)
+        err = m.source_error;
+      if (err == CL_SUCCESS) {
+        TP_WRITE_BUFFER(req->Body.msg_id, req->Body.client_did, queue_id,
+                        req->Body.obj_id, m.chunk_size, CL_RUNNING);
+        err = backend->writeBuffer(req->Body.event_id, queue_id,
+                                   req->Body.obj_id, 0, m.chunk_size,
+                                   m.chunk_offset, host_ptr, evt_timing,
+                                   req->Body.waitlist_size,
+                                   req->Waitlist.data());
+        TP_WRITE_BUFFER(req->Body.msg_id, req->Body.client_did, queue_id,
+                        req->Body.obj_id, m.chunk_size, CL_FINISHED);
+        if (err != CL_SUCCESS && m.more_chunks) {
+          std::unique_lock<std::mutex> l(MigrationChunkMutex);
+          MigrationChunkErrors.insert({uint64_t(req->Body.msg_id), err});
+        }
+      }
+      RETURN_IF_ERR;
     } else {
       TP_WRITE_BUFFER(req->Body.msg_id, req->Body.client_did, queue_id,
                       req->Body.obj_id, m.size, CL_RUNNING);
@@ -273,15 +317,22 @@ void CommandQueue::ReadBuffer(uint32_t queue_id, Request *req, Reply *rep) {
   */
   rep->extra_size = m.size;
   char *host_ptr = nullptr;
+  if (m.use_shm) {
+    // Read directly into the memory shared with the client, extra_data is
+    // left empty so that nothing follows the reply.
+    host_ptr = backend->clientSharedMemory(m.shm_offset, m.size);
+    RETURN_IF_ERR_CODE(host_ptr ? CL_SUCCESS : CL_INVALID_VALUE);
+  } else {
 #ifdef ENABLE_RDMA
-  if (!backend->clientUsesRdma()) {
-    rep->extra_data.resize(rep->extra_size);
-    host_ptr = (char*)rep->extra_data.data();
-  }
+    if (!backend->clientUsesRdma()) {
+      rep->extra_data.resize(rep->extra_size);
+      host_ptr = (char *)rep->extra_data.data();
+    }
 #else
-  rep->extra_data.resize(rep->extra_size);
-  host_ptr = (char*)rep->extra_data.data();
+    rep->extra_data.resize(rep->extra_size);
+    host_ptr = (char *)rep->extra_data.data();
 #endif
+  }
 
   TP_READ_BUFFER(req->Body.msg_id, req->Body.client_did, queue_id,
                  req->Body.obj_id, m.size, CL_RUNNING);
@@ -304,6 +355,10 @@ void CommandQueue::WriteBuffer(uint32_t queue_id, Request *req, Reply *rep) {
 #else
   void *data = req->ExtraData.data();
 #endif
+  if (m.use_shm) {
+    data = backend->clientSharedMemory(m.shm_offset, m.size);
+    RETURN_IF_ERR_CODE(data ? CL_SUCCESS : CL_INVALID_VALUE);
+  }
 
   TP_WRITE_BUFFER(req->Body.msg_id, req->Body.client_did, queue_id,
                   req->Body.obj_id, m.size, CL_RUNNING);
@@ -446,11 +501,19 @@ void CommandQueue::RunKernel(uint32_t queue_id, Request *req, Reply *rep) {
 
   TP_NDRANGE_KERNEL(req->Body.msg_id, req->Body.client_did, queue_id, ker_id,
                     CL_RUNNING);
+  // the changed arguments are followed by their indices before the is-SVM
+  // flags
+  uint8_t *Args = req->ExtraData.data();
+  uint32_t *ArgIndices = nullptr;
+  unsigned char *IsSVM = Args + m.args_num * sizeof(uint64_t);
+  if (m.has_new_args == RUN_KERNEL_ARGS_CHANGED) {
+    ArgIndices = (uint32_t *)IsSVM;
+    IsSVM += m.args_num * sizeof(uint32_t);
+  }
   RETURN_IF_ERR_CODE(backend->runKernel(
       req->Body.event_id, queue_id, dev_id, m.has_new_args, m.args_num,
-      (uint64_t *)req->ExtraData.data(),
-      (unsigned char *)req->ExtraData.data() + m.args_num * sizeof(uint64_t),
-      m.pod_arg_size, (char *)req->ExtraData2.data(), evt_timing,
+      (uint64_t *)Args, IsSVM, ArgIndices, m.pod_arg_size,
+      (char *)req->ExtraData2.data(), evt_timing,
       req->Body.obj_id, req->Body.waitlist_size, req->Waitlist.data(), dim,
       offset, global, (m.has_local ? &local : nullptr)));
   TP_NDRANGE_KERNEL(req->Body.msg_id, req->Body.client_did, queue_id, ker_id,
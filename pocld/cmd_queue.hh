@@ -42,6 +42,10 @@ class CommandQueue {
   uint32_t dev_id;
   ReplyQueueThread *write_slow, *write_fast;
   std::vector<Request *> pending;
+  /// Errors of the chunks of streamed migrations whose last chunk has not
+  /// been written yet, by message ID
+  std::unordered_map<uint64_t, int> MigrationChunkErrors;
+  std::mutex MigrationChunkMutex;
 
 public:
   CommandQueue(SharedContextBase *b, uint32_t queue_id, uint32_t did,
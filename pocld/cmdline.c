@@ -38,6 +38,8 @@ const char *gengetopt_args_info_help[]
         "  -p, --port=INT           Listen port",
         "  -s, --vsock              Whether use VSOCK rather than TCP  "
         "(default=off)",
+        "  -u, --unix_socket=STRING Also listen on a Unix domain socket at this "
+        "path",
         "  -v, --log_filter=STRING  Program log category filter",
         0 };
 
@@ -67,6 +69,7 @@ clear_given (struct gengetopt_args_info *args_info)
   args_info->address_given = 0;
   args_info->port_given = 0;
   args_info->vsock_given = 0;
+  args_info->unix_socket_given = 0;
   args_info->log_filter_given = 0;
 }
 
@@ -78,6 +81,8 @@ clear_args (struct gengetopt_args_info *args_info)
   args_info->address_orig = NULL;
   args_info->port_orig = NULL;
   args_info->vsock_flag = 0;
+  args_info->unix_socket_arg = NULL;
+  args_info->unix_socket_orig = NULL;
   args_info->log_filter_arg = NULL;
   args_info->log_filter_orig = NULL;
 }
@@ -91,7 +96,8 @@ init_args_info (struct gengetopt_args_info *args_info)
   args_info->address_help = gengetopt_args_info_help[2];
   args_info->port_help = gengetopt_args_info_help[3];
   args_info->vsock_help = gengetopt_args_info_help[4];
-  args_info->log_filter_help = gengetopt_args_info_help[5];
+  args_info->unix_socket_help = gengetopt_args_info_help[5];
+  args_info->log_filter_help = gengetopt_args_info_help[6];
 }
 
 void
@@ -189,6 +195,8 @@ cmdline_parser_release (struct gengetopt_args_info *args_info)
   free_string_field (&(args_info->address_arg));
   free_string_field (&(args_info->address_orig));
   free_string_field (&(args_info->port_orig));
+  free_string_field (&(args_info->unix_socket_arg));
+  free_string_field (&(args_info->unix_socket_orig));
   free_string_field (&(args_info->log_filter_arg));
   free_string_field (&(args_info->log_filter_orig));
 
@@ -232,6 +240,8 @@ cmdline_parser_dump (FILE *outfile, struct gengetopt_args_info *args_info)
     write_into_file (outfile, "port", args_info->port_orig, 0);
   if (args_info->vsock_given)
     write_into_file (outfile, "vsock", 0, 0);
+  if (args_info->unix_socket_given)
+    write_into_file (outfile, "unix_socket", args_info->unix_socket_orig, 0);
   if (args_info->log_filter_given)
     write_into_file (outfile, "log_filter", args_info->log_filter_orig, 0);
 
@@ -1154,6 +1164,7 @@ cmdline_parser_internal (int argc, char **argv,
                                               { "address", 1, NULL, 'a' },
                                               { "port", 1, NULL, 'p' },
                                               { "vsock", 0, NULL, 's' },
+                                              { "unix_socket", 1, NULL, 'u' },
                                               { "log_filter", 1, NULL, 'v' },
                                               { 0, 0, 0, 0 } };
 
@@ -1162,7 +1173,7 @@ cmdline_parser_internal (int argc, char **argv,
       custom_opterr = opterr;
       custom_optopt = optopt;
 
-      c = custom_getopt_long (argc, argv, "hVa:p:sv:", long_options,
+      c = custom_getopt_long (argc, argv, "hVa:p:su:v:", long_options,
                               &option_index);
 
       optarg = custom_optarg;
@@ -1215,6 +1226,17 @@ cmdline_parser_internal (int argc, char **argv,
                           's', additional_error))
             goto failure;
 
+          break;
+        case 'u': /* Also listen on a Unix domain socket at this path.  */
+
+          if (update_arg ((void *)&(args_info->unix_socket_arg),
+                          &(args_info->unix_socket_orig),
+                          &(args_info->unix_socket_given),
+                          &(local_args_info.unix_socket_given), optarg, 0, 0,
+                          ARG_STRING, check_ambiguity, override, 0, 0,
+                          "unix_socket", 'u', additional_error))
+            goto failure;
+
           break;
         case 'v': /* Program log category filter.  */
 
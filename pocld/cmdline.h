@@ -53,6 +53,13 @@ extern "C"
                                (default=off).  */
     const char *vsock_help; /**< @brief Whether use VSOCK rather than TCP help
                                description.  */
+    char *unix_socket_arg;  /**< @brief Also listen on a Unix domain socket
+                               at this path.  */
+    char *unix_socket_orig; /**< @brief Also listen on a Unix domain socket
+                               at this path original value given at command
+                               line.  */
+    const char *unix_socket_help; /**< @brief Also listen on a Unix domain
+                                     socket at this path help description.  */
     char *log_filter_arg;   /**< @brief Program log category filter.  */
     char *log_filter_orig;  /**< @brief Program log category filter original
                                value given at command line.  */
@@ -64,6 +71,8 @@ extern "C"
     unsigned int address_given;    /**< @brief Whether address was given.  */
     unsigned int port_given;       /**< @brief Whether port was given.  */
     unsigned int vsock_given;      /**< @brief Whether vsock was given.  */
+    unsigned int unix_socket_given; /**< @brief Whether unix_socket was
+                                       given.  */
     unsigned int log_filter_given; /**< @brief Whether log_filter was given. */
   };
 
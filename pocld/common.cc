@@ -33,6 +33,7 @@
 #endif
 #include <netdb.h>
 #include <sys/uio.h>
+#include <sys/un.h>
 #include <unistd.h>
 
 void replyID(Reply *rep, ReplyMessageType t, uint32_t id) {
@@ -114,6 +115,14 @@ std::string describe_sockaddr(struct sockaddr *addr, unsigned addr_size) {
     return ip_str;
   }
 #endif
+  else if (addr->sa_family == AF_UNIX) {
+    // clients connect from unnamed sockets
+    size_t path_offset = offsetof(struct sockaddr_un, sun_path);
+    const char *path = ((struct sockaddr_un *)addr)->sun_path;
+    if (addr_size <= path_offset || path[0] == 0)
+      return "unix:[unnamed]";
+    return "unix:" + std::string(path, strnlen(path, addr_size - path_offset));
+  }
   else
     ip_str = "[unknown address family " + std::to_string(addr->sa_family) + "]";
   const char *end =
@@ -52,6 +52,7 @@ using float_time_point = std::chrono::time_point<Time, float_sec>;
 #include "pocl_debug.h"
 #include "pocl_networking.h"
 #include "request.hh"
+#include "shared_memory.hh"
 
 #ifdef ENABLE_RDMA
 #include "rdma.hh"
@@ -290,6 +291,8 @@ struct ClientConnections_t {
   std::mutex *incoming_peer_mutex;
   std::pair<std::condition_variable, std::vector<PeerConnection>>
       *incoming_peer_queue;
+  // memfd region passed by a client connected over a Unix socket, or null
+  std::shared_ptr<SharedMemoryRegion> shm;
 #ifdef ENABLE_RDMA
   // TODO this does not really work with reconnecting
   std::shared_ptr<RdmaConnection> rdma;
@@ -323,7 +326,7 @@ class Reply {
 public:
   ReplyMsg_t rep;
   std::unique_ptr<Request> req;
-  std::vector<uint8_t> extra_data;
+  PayloadBuffer extra_data;
   size_t extra_size;
   cl::Event event;
   // server host timestamps for network comm
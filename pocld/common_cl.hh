@@ -58,8 +58,22 @@ typedef int (*fakeBuiltinKernelCallback)(void *SharedCLContext, void *side_thr,
                                          cl::Event *event);
 
 typedef std::vector<PoclRemoteArgType> clKernelArgTypeVector;
+/// The arguments of the last NDRange launch of a kernel on a device. Launches
+/// which change only some of them send just those, which are merged into it.
+typedef struct clLaunchTemplate {
+  std::vector<uint64_t> Args;
+  std::vector<unsigned char> IsSVM;
+  std::vector<char> POD;
+  /// Offsets of the POD arguments in POD.
+  std::vector<size_t> PODOffsets;
+  bool Valid = false;
+  /// Set when a command buffer has set other arguments to the kernel.
+  bool Clobbered = false;
+} clLaunchTemplate;
+
 typedef struct clKernelStruct {
   std::vector<cl::Kernel> perDeviceKernels;
+  std::vector<clLaunchTemplate> launchTemplates;
   clFakeKernelPtrArgs fakeKernelPtrArgs;
   clFakeKernelArgsPOD fakeKernelPODArgs;
   clKernelMetadata *metaData;
@@ -38,6 +38,8 @@ Connection::Connection(transport_domain_t Domain, int Fd,
 Connection::~Connection() {
   shutdown(Fd, SHUT_RDWR);
   close(Fd);
+  if (ReceivedFd >= 0)
+    close(ReceivedFd);
 }
 
 void Connection::configure(bool LowLatency) {
@@ -82,6 +84,18 @@ ssize_t Connection::writeFull(const void *Source, size_t Bytes) {
   return 0;
 }
 
+ssize_t Connection::readSome(void *Destination, size_t Bytes) {
+  if (Domain == TransportDomain_Unix)
+    return pocl_recv_with_fd(Fd, Destination, Bytes, &ReceivedFd);
+  return ::read(Fd, Destination, Bytes);
+}
+
+int Connection::takeReceivedFd() {
+  int Ret = ReceivedFd;
+  ReceivedFd = -1;
+  return Ret;
+}
+
 int Connection::readFull(void *Destination, size_t Bytes) {
   size_t readb = 0;
   ssize_t res;
@@ -90,7 +104,7 @@ int Connection::readFull(void *Destination, size_t Bytes) {
     Meter->rxRequested(Bytes);
   while (readb < Bytes) {
     size_t Remain = Bytes - readb;
-    res = ::read(Fd, Ptr + readb, Remain);
+    res = readSome(Ptr + readb, Remain);
     if (res < 0) {
       int e = errno;
       if (e == EAGAIN || e == EWOULDBLOCK || e == EINTR)
@@ -115,7 +129,7 @@ int Connection::readReentrant(void *Destination, size_t Bytes,
     return 0;
 
   ssize_t readb;
-  readb = ::read(Fd, (char *)Destination + *Tracker, Bytes - *Tracker);
+  readb = readSome((char *)Destination + *Tracker, Bytes - *Tracker);
   if (readb < 0)
     return errno;
 
@@ -24,8 +24,11 @@
 #ifndef POCL_CONNECTION_HH
 #define POCL_CONNECTION_HH
 
+#include <cstdint>
 #include <memory>
 #include <unistd.h>
+#include <utility>
+#include <vector>
 
 #include "pocl_networking.h"
 #include "traffic_monitor.hh"
@@ -34,6 +37,23 @@
 #pragma GCC visibility push(hidden)
 #endif
 
+/** Allocator that leaves the bytes uninitialized when a buffer is resized,
+ * so that the payload buffers are not zeroed before the data is read or
+ * copied into them. */
+template <typename T> struct DefaultInitAllocator : std::allocator<T> {
+  template <typename U> struct rebind {
+    typedef DefaultInitAllocator<U> other;
+  };
+  using std::allocator<T>::allocator;
+  template <typename U> void construct(U *P) { ::new ((void *)P) U; }
+  template <typename U, typename... Args>
+  void construct(U *P, Args &&...A) {
+    ::new ((void *)P) U(std::forward<Args>(A)...);
+  }
+};
+
+typedef std::vector<uint8_t, DefaultInitAllocator<uint8_t>> PayloadBuffer;
+
 class Connection {
 public:
   struct Parameters {
@@ -54,11 +74,17 @@ public:
   transport_domain_t domain() { return Domain; }
   void setMeter(std::shared_ptr<TrafficMonitor> M) { Meter = M; }
   std::shared_ptr<TrafficMonitor> meter() { return Meter; }
+  /// Returns the file descriptor that was passed over a Unix domain socket
+  /// with the data read so far, or -1. The caller takes its ownership.
+  int takeReceivedFd();
 
 private:
+  ssize_t readSome(void *Destination, size_t Bytes);
+
   std::shared_ptr<TrafficMonitor> Meter;
   transport_domain_t Domain;
   int Fd;
+  int ReceivedFd = -1;
   // TODO: also wrap RdmaConnection?
 };
 
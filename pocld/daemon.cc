@@ -32,6 +32,7 @@
 #include <random>
 #include <set>
 #include <sys/poll.h>
+#include <sys/un.h>
 #include <unistd.h>
 
 #include "common_cl.hh"
@@ -489,6 +490,8 @@ PoclDaemon::~PoclDaemon() {
   if (pl_rdma_event_th.joinable())
     pl_rdma_event_th.join();
 #endif
+  if (!UnixSocketPath.empty())
+    unlink(UnixSocketPath.c_str());
 }
 
 VirtualContextBase *createVirtualContext(PoclDaemon *d,
@@ -537,8 +540,36 @@ static std::string find_default_ip_address() {
   return Ret;
 }
 
+/** Creates a listener socket at the given path. Both the command and the
+ * stream connections of the clients arrive at it, the handshake tells them
+ * apart. Returns -1 on error. */
+static int listen_unix_socket(const std::string &Path) {
+  struct sockaddr_un Addr = {};
+  Addr.sun_family = AF_UNIX;
+  if (Path.size() >= sizeof(Addr.sun_path)) {
+    POCL_MSG_ERR("Unix socket path '%s' is too long\n", Path.c_str());
+    return -1;
+  }
+  std::memcpy(Addr.sun_path, Path.c_str(), Path.size());
+
+  int Fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (Fd < 0) {
+    POCL_MSG_ERR("unix socket: %s\n", strerror(errno));
+    return -1;
+  }
+  // remove the socket file left behind by a previous instance
+  unlink(Path.c_str());
+  if (bind(Fd, (struct sockaddr *)&Addr, sizeof(Addr)) < 0 ||
+      listen(Fd, 10) < 0) {
+    POCL_MSG_ERR("unix socket %s: %s\n", Path.c_str(), strerror(errno));
+    close(Fd);
+    return -1;
+  }
+  return Fd;
+}
+
 int PoclDaemon::launch(std::string ListenAddress, struct ServerPorts &Ports,
-                       bool UseVsock) {
+                       bool UseVsock, std::string UnixSocketPath) {
 #define PERROR_SKIP(cond, str)                                                 \
   do {                                                                         \
     if (cond) {                                                                \
@@ -698,6 +729,19 @@ int PoclDaemon::launch(std::string ListenAddress, struct ServerPorts &Ports,
 #endif
     freeaddrinfo(ResolvedAddress);
 
+  if (!UnixSocketPath.empty()) {
+    int FdUnix = listen_unix_socket(UnixSocketPath);
+    if (FdUnix < 0)
+      return -1;
+    this->UnixSocketPath = UnixSocketPath;
+    POCL_MSG_PRINT_GENERAL("Server PID=%d listening for client connections on "
+                           "unix:%s\n",
+                           server_pid, UnixSocketPath.c_str());
+    ++NumListenFds;
+    OpenClientConnections.push_back(std::shared_ptr<Connection>(
+        new Connection(TransportDomain_Unix, FdUnix, nullptr)));
+  }
+
   if (NumListenFds == 0) {
     POCL_MSG_ERR("Could not bind any socket address for '%s'\n",
                  Address.c_str());
@@ -747,11 +791,21 @@ PoclDaemon::performSessionSetup(std::shared_ptr<Connection> Conn, Request *R) {
   else
     connections.bulk_throughput = Conn;
 
+  // A client on a Unix socket passes a memfd with the handshake for the
+  // buffer transfers. Closed here if not requested or not mappable.
+  int ShmFd = Conn->takeReceivedFd();
+  if (R->Body.m.get_session.use_shm && ShmFd >= 0)
+    connections.shm =
+        SharedMemoryRegion::map(ShmFd, R->Body.m.get_session.shm_size);
+  else if (ShmFd >= 0)
+    close(ShmFd);
+
   ReplyMsg_t Reply = {};
   Reply.message_type = MessageType_CreateOrAttachSessionReply;
   Reply.m.get_session.session = session;
   Reply.m.get_session.peer_port = ListenPorts.peer;
   Reply.m.get_session.use_rdma = 0;
+  Reply.m.get_session.use_shm = connections.shm ? 1 : 0;
   memcpy(Reply.m.get_session.authkey, authkey.data(), AUTHKEY_LENGTH);
   authkey_hex =
       std::accumulate(authkey.begin(), authkey.end(), std::string(), hexdigits);
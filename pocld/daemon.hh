@@ -70,10 +70,12 @@ public:
    * begins listening for connection requests. Launches threads for listening
    * for P2P server connections and RDMAcm connections (both client and server)
    * and finally launches the main I/O thread running
-   * `readAllClientSocketsThread()`
+   * `readAllClientSocketsThread()`. If UnixSocketPath is not empty, clients
+   * on the same host can also connect over a Unix domain socket at that path
+   * and transfer buffer contents via shared memory.
    */
   int launch(std::string ListenAddress, struct ServerPorts &ports,
-             bool UseVsock = false);
+             bool UseVsock = false, std::string UnixSocketPath = "");
 
   /**
    * Main function of the client I/O thread. Polls client sockets for new
@@ -126,6 +128,8 @@ private:
    * disconnects if reconnecting is not allowed. */
   std::vector<VirtualContextBase *> SocketContexts;
   size_t NumListenFds;
+  /** Path of the Unix domain socket listener, unlinked at exit */
+  std::string UnixSocketPath;
   std::mutex SessionListMtx;
   std::unordered_map<uint64_t, VirtualContextBase *> ClientSessions;
   std::unordered_map<uint64_t, std::array<uint8_t, AUTHKEY_LENGTH>> SessionKeys;
@@ -82,7 +82,20 @@ void Peer::pushRequest(Request *r) {
     rdma_out_queue.push(r);
   else
 #endif
+  {
+    {
+      std::unique_lock<std::mutex> l(QueuedDataMutex);
+      QueuedDataBytes += r->ExtraDataSize;
+    }
     out_queue.push(r);
+  }
+}
+
+void Peer::waitForQueuedData(uint64_t Limit) {
+  std::unique_lock<std::mutex> l(QueuedDataMutex);
+  // Time out periodically so that a dead connection does not block forever
+  while (QueuedDataBytes > Limit && !eh->exit_requested())
+    QueuedDataCond.wait_for(l, std::chrono::milliseconds(100));
 }
 
 void Peer::writerThread() {
@@ -129,6 +142,12 @@ void Peer::writerThread() {
                   "PHW");
     }
 
+    {
+      std::unique_lock<std::mutex> l(QueuedDataMutex);
+      QueuedDataBytes -= r->ExtraDataSize;
+    }
+    QueuedDataCond.notify_all();
+
     delete r;
   } while (!eh->exit_requested());
 }
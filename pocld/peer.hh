@@ -51,6 +51,10 @@ class Peer {
   ExitHelper *eh;
 
   GuardedQueue<Request *> out_queue;
+  /// Payload bytes of the requests in out_queue that are not written yet
+  uint64_t QueuedDataBytes = 0;
+  std::mutex QueuedDataMutex;
+  std::condition_variable QueuedDataCond;
 
   RequestQueueThreadUPtr reader;
   void writerThread();
@@ -79,6 +83,11 @@ public:
 
   void pushRequest(Request *r);
 
+  /// Blocks until at most Limit bytes of request payloads are waiting to be
+  /// written to the peer. Used for bounding the staging memory of streamed
+  /// migrations.
+  void waitForQueuedData(uint64_t Limit);
+
 #ifdef ENABLE_RDMA
   bool rdmaRegisterBuffer(uint32_t id, char *buf, size_t size);
   void rdmaUnregisterBuffer(uint32_t id);
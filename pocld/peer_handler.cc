@@ -209,6 +209,15 @@ void PeerHandler::pushRequest(Request *r, uint32_t peer_id) {
   }
 }
 
+void PeerHandler::waitForQueuedData(uint32_t peer_id, uint64_t limit) {
+  std::unique_lock<std::mutex> lock(PeermapMutex);
+  auto it = Peers.find(peer_id);
+  if (it != Peers.end()) {
+    lock.unlock();
+    it->second->waitForQueuedData(limit);
+  }
+}
+
 void PeerHandler::broadcast(const Request &r) {
   std::unique_lock<std::mutex> lock(PeermapMutex);
   for (auto &it : Peers) {
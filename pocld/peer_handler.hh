@@ -68,6 +68,7 @@ public:
                      uint64_t session,
                      const std::array<uint8_t, AUTHKEY_LENGTH> &authkey);
   void pushRequest(Request *r, uint32_t peer_id);
+  void waitForQueuedData(uint32_t peer_id, uint64_t limit);
   void broadcast(const Request &r);
 #ifdef ENABLE_RDMA
   GuardedQueue<rdma_cm_event *> cm_event_queue;
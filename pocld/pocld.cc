@@ -124,7 +124,8 @@ int main(int argc, char *argv[]) {
   }
   if ((error = server.launch(
            std::string(ai.address_arg ? ai.address_arg : ""),
-           listen_ports, UseVsock)))
+           listen_ports, UseVsock,
+           std::string(ai.unix_socket_arg ? ai.unix_socket_arg : ""))))
     return error;
 
   server.waitForExit();
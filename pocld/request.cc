@@ -222,7 +222,9 @@ template <class T> bool RequestReadImpl(Request *Req, T *Source) {
 
   switch (Body->message_type) {
   case MessageType_WriteBuffer:
-    Req->ExtraDataSize = Body->m.write.size;
+    // the data is in the memory shared with the client
+    if (!Body->m.write.use_shm)
+      Req->ExtraDataSize = Body->m.write.size;
     break;
   case MessageType_WriteBufferRect:
     Req->ExtraDataSize = Body->m.write_rect.host_bytes;
@@ -232,7 +234,9 @@ template <class T> bool RequestReadImpl(Request *Req, T *Source) {
     break;
   case MessageType_MigrateD2D:
     if (Body->m.migrate.is_external) {
-      Req->ExtraDataSize = Body->m.migrate.size;
+      Req->ExtraDataSize = Body->m.migrate.chunk_size
+                               ? Body->m.migrate.chunk_size
+                               : Body->m.migrate.size;
     }
     break;
   case MessageType_FillBuffer:
@@ -249,6 +253,9 @@ template <class T> bool RequestReadImpl(Request *Req, T *Source) {
          SVM pointer or not. */
       Req->ExtraDataSize = Body->m.run_kernel.args_num * sizeof(uint64_t) +
                            Body->m.run_kernel.args_num * sizeof(unsigned char);
+      /* Only the changed arguments are sent, with their indices. */
+      if (Body->m.run_kernel.has_new_args == RUN_KERNEL_ARGS_CHANGED)
+        Req->ExtraDataSize += Body->m.run_kernel.args_num * sizeof(uint32_t);
       Req->ExtraData2Size = Body->m.run_kernel.pod_arg_size;
     }
     break;
@@ -73,7 +73,7 @@ public:
 
   /// Auxiliary data required for the Request (buffer contents, program binaries
   /// etc)
-  std::vector<uint8_t> ExtraData;
+  PayloadBuffer ExtraData;
   /// Size of the auxiliary data buffer
   uint64_t ExtraDataSize = 0;
   /// Tracker for how many bytes of the auxiliary data buffer have been read
@@ -81,7 +81,7 @@ public:
   size_t ExtraDataBytesRead = 0;
 
   /// Second auxiliary data required for the Request
-  std::vector<uint8_t> ExtraData2;
+  PayloadBuffer ExtraData2;
   /// Size of the auxiliary data buffer
   uint64_t ExtraData2Size = 0;
   /// Tracker for how many bytes of the second auxiliary data buffer have been
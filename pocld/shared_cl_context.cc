@@ -39,6 +39,7 @@
 #include "CL/cl_platform.h"
 #include "CL/opencl.hpp"
 #include "bufalloc.h"
+#include "build_cache.hh"
 #include "cmd_queue.hh"
 #include "common.hh"
 #include "common_cl.hh"
@@ -155,6 +156,9 @@ class SharedCLContext final : public SharedContextBase {
   bool hasImageSupport;
   std::string name;
 
+  // Identifies the backend devices in the program build cache keys
+  std::vector<std::string> DeviceBuildIds;
+
   struct SVMRegion {
     // The size and start of the memory region.
     size_t Size;
@@ -191,10 +195,27 @@ class SharedCLContext final : public SharedContextBase {
   // system.
   const size_t SVMMaxAllowedWasteSpace = (size_t)16 * 1024 * 1024 * 1024;
 
+  int setKernelArg(cl::Kernel *k, clKernelStruct *kernel, cl_uint i,
+                   uint64_t arg, unsigned char is_svm_ptr, const char *pod);
+
   int setKernelArgs(cl::Kernel *k, clKernelStruct *kernel, size_t arg_count,
                     uint64_t *args, unsigned char *is_svm_ptr, size_t pod_size,
                     char *pod_buf);
 
+  int updateKernelArgs(cl::Kernel *k, clKernelStruct *kernel,
+                       clLaunchTemplate &T, size_t changed_count,
+                       uint32_t *arg_indices, uint64_t *args,
+                       unsigned char *is_svm_ptr, size_t pod_size,
+                       char *pod_buf);
+
+  int buildProgramFromCache(
+      clProgramStruct *program, const BuildCacheEntry &Cached,
+      std::vector<uint32_t> &DeviceList, const std::string &opts,
+      std::unordered_map<uint64_t, std::vector<unsigned char>>
+          &output_binaries,
+      std::unordered_map<uint64_t, std::string> &build_logs,
+      size_t &num_kernels);
+
 public:
   SharedCLContext(cl::Platform *p, unsigned plat_id, VirtualContextBase *v,
                   ReplyQueueThread *s, ReplyQueueThread *f);
@@ -213,7 +234,7 @@ public:
 
   virtual bool isCommandReceived(uint64_t id) override;
 
-  virtual int writeKernelMeta(uint32_t ProgramId, std::vector<uint8_t> &Buffer,
+  virtual int writeKernelMeta(uint32_t ProgramId, PayloadBuffer &Buffer,
                               size_t *Written) override;
 
   virtual EventPair getEventPairForId(uint64_t event_id) override;
@@ -223,6 +244,10 @@ public:
   virtual std::vector<cl::Event> remapWaitlist(size_t num_events, uint64_t *ids,
                                                uint64_t dep) override;
 
+  virtual char *clientSharedMemory(uint64_t Offset, uint64_t Size) override {
+    return ParentCtx->clientSharedMemory(Offset, Size);
+  }
+
 #ifdef ENABLE_RDMA
   virtual bool clientUsesRdma() override {
     return ParentCtx->clientUsesRdma();
@@ -348,11 +373,11 @@ public:
 
   virtual int runKernel(uint64_t ev_id, uint32_t cq_id, uint32_t device_id,
                         uint16_t has_new_args, size_t arg_count, uint64_t *args,
-                        unsigned char *is_svm_ptr, size_t pod_size,
-                        char *pod_buf, EventTiming_t &evt, uint32_t kernel_id,
-                        uint32_t waitlist_size, uint64_t *waitlist,
-                        unsigned dim, const sizet_vec3 &offset,
-                        const sizet_vec3 &global,
+                        unsigned char *is_svm_ptr, uint32_t *arg_indices,
+                        size_t pod_size, char *pod_buf, EventTiming_t &evt,
+                        uint32_t kernel_id, uint32_t waitlist_size,
+                        uint64_t *waitlist, unsigned dim,
+                        const sizet_vec3 &offset, const sizet_vec3 &global,
                         const sizet_vec3 *local = nullptr) override;
 
   virtual int runCommandBuffer(uint64_t ev_id, EventTiming_t &evt,
@@ -648,6 +673,16 @@ SharedCLContext::SharedCLContext(cl::Platform *p, unsigned pid,
 
   std::string exts = p->getInfo<CL_PLATFORM_EXTENSIONS>();
 
+  std::string PlatformId = p->getInfo<CL_PLATFORM_NAME>() + "\n" +
+                           p->getInfo<CL_PLATFORM_VERSION>() + "\n";
+  for (auto &Dev : CLDevices) {
+    DeviceBuildIds.push_back(
+        PlatformId + Dev.getInfo<CL_DEVICE_NAME>() + "\n" +
+        Dev.getInfo<CL_DEVICE_VERSION>() + "\n" +
+        Dev.getInfo<CL_DRIVER_VERSION>() + "\n" +
+        std::to_string(Dev.getInfo<CL_DEVICE_VENDOR_ID>()));
+  }
+
   for (auto Dev : CLDevices) {
     if (Dev.getInfo<CL_DEVICE_IMAGE_SUPPORT>()) {
       hasImageSupport = true;
@@ -1516,6 +1551,45 @@ int SharedCLContext::buildOrLinkProgram(
      clGetKernelArgInfo.html*/
   opts += " -cl-kernel-arg-info";
 
+  // Full builds of sources and SPIR-V can be recreated from the binaries of
+  // an identical earlier build, possibly done by another session.
+  ProgramBuildCache &BuildCache = ProgramBuildCache::instance();
+  bool Cacheable = BuildCache.enabled() && !LinkOnly && !CompileOnly &&
+                   !is_binary && !is_builtin && !is_dbk &&
+                   SVMRegionOffset == 0;
+  ProgramBuildCache::Key CacheKey;
+  if (Cacheable) {
+    std::vector<std::string> DeviceIds;
+    for (auto i : DeviceList)
+      DeviceIds.push_back(DeviceBuildIds[i]);
+    if (is_spirv) {
+      const std::vector<unsigned char> &IL = InputBinaries.begin()->second;
+      CacheKey = ProgramBuildCache::makeKey('S', IL.data(), IL.size(), opts,
+                                            DeviceIds);
+    } else
+      CacheKey =
+          ProgramBuildCache::makeKey('C', src, src_size, opts, DeviceIds);
+
+    auto Cached = BuildCache.lookup(CacheKey);
+    if (Cached) {
+      err = buildProgramFromCache(program, *Cached, DeviceList, opts,
+                                  output_binaries, build_logs, num_kernels);
+      if (err == CL_SUCCESS) {
+        POCL_MSG_PRINT_INFO("P %u Program %" PRIu32
+                            " built from the build cache\n",
+                            plat_id, program_id);
+        std::unique_lock<std::mutex> lock(MainMutex);
+        ProgramIDmap[program_id] = std::move(program_uptr);
+        return CL_SUCCESS;
+      }
+      POCL_MSG_WARN("P %u Cached binaries of program %" PRIu32
+                    " were rejected (%d), rebuilding\n",
+                    plat_id, program_id, err);
+      BuildCache.remove(CacheKey);
+      err = CL_SUCCESS;
+    }
+  }
+
   if (LinkOnly) {
     // Collect the previously built programs from the server-side cache and link
     // them.
@@ -1969,6 +2043,19 @@ int SharedCLContext::buildOrLinkProgram(
   if (err)
     return err;
 
+  if (Cacheable) {
+    auto Entry = std::make_shared<BuildCacheEntry>();
+    for (auto Dev : DeviceList) {
+      uint64_t id = ((uint64_t)plat_id << 32) + Dev;
+      Entry->Binaries.push_back(output_binaries[id]);
+      auto Log = build_logs.find(id);
+      Entry->BuildLogs.push_back(Log != build_logs.end() ? Log->second
+                                                         : std::string());
+    }
+    Entry->KernelMeta = program->kernel_meta;
+    BuildCache.insert(CacheKey, std::move(Entry));
+  }
+
   // SUCCESS
   {
     std::unique_lock<std::mutex> lock(MainMutex);
@@ -1979,6 +2066,50 @@ int SharedCLContext::buildOrLinkProgram(
   return CL_SUCCESS;
 }
 
+/* Recreates a program from the binaries of an identical earlier build. The
+ * kernel metadata and build logs are taken from the cache entry, as the
+ * argument info of kernels built from binaries isn't always available. */
+int SharedCLContext::buildProgramFromCache(
+    clProgramStruct *program, const BuildCacheEntry &Cached,
+    std::vector<uint32_t> &DeviceList, const std::string &opts,
+    std::unordered_map<uint64_t, std::vector<unsigned char>> &output_binaries,
+    std::unordered_map<uint64_t, std::string> &build_logs,
+    size_t &num_kernels) {
+  if (Cached.Binaries.size() != DeviceList.size() ||
+      (num_kernels != 0 && num_kernels != Cached.KernelMeta.size()))
+    return CL_INVALID_BINARY;
+
+  cl_int err = CL_SUCCESS;
+  clProgramPtr pp(new cl::Program(ContextWithAllDevices, program->devices,
+                                  Cached.Binaries, nullptr, &err));
+  if (err != CL_SUCCESS)
+    return err;
+  err = pp->build(program->devices, opts.c_str());
+  if (err != CL_SUCCESS)
+    return err;
+
+  std::vector<cl::Kernel> kernels;
+  err = pp->createKernels(&kernels);
+  if (err != CL_SUCCESS)
+    return err;
+  // the cached metadata must describe the same kernels in the same order
+  std::vector<std::string> kernel_names;
+  for (cl::Kernel &k : kernels)
+    kernel_names.push_back(k.getInfo<CL_KERNEL_FUNCTION_NAME>());
+  if (!Cached.matchesKernels(kernel_names))
+    return CL_INVALID_BINARY;
+
+  program->uptr = std::move(pp);
+  program->kernel_meta = Cached.KernelMeta;
+  program->numKernels = num_kernels = Cached.KernelMeta.size();
+  for (size_t i = 0; i < DeviceList.size(); ++i) {
+    uint64_t id = ((uint64_t)plat_id << 32) + DeviceList[i];
+    output_binaries[id] = Cached.Binaries[i];
+    build_logs[id] = Cached.BuildLogs[i];
+  }
+  return CL_SUCCESS;
+}
+
 int SharedCLContext::freeProgram(uint32_t program_id) {
   {
     std::unique_lock<std::mutex> lock(MainMutex);
@@ -1992,7 +2123,7 @@ int SharedCLContext::freeProgram(uint32_t program_id) {
 }
 
 int SharedCLContext::writeKernelMeta(uint32_t ProgramId,
-                                     std::vector<uint8_t> &Buf,
+                                     PayloadBuffer &Buf,
                                      size_t *Written) {
   clProgramStruct *p = nullptr;
   size_t old_size = Buf.size();
@@ -2081,6 +2212,7 @@ int SharedCLContext::createKernel(uint32_t kernel_id, uint32_t program_id,
   // create a separate kernel for each device
   // this is because argument setting needs to be separate for each device
   k->perDeviceKernels.resize(CLDevices.size());
+  k->launchTemplates.resize(CLDevices.size());
   for (size_t ii = 0; ii < CLDevices.size(); ++ii) {
     k->perDeviceKernels[ii] = cl::Kernel(*p, name);
   }
@@ -2337,13 +2469,17 @@ int SharedCLContext::createCommandBuffer(
         cl::Kernel *k = nullptr;
         clKernelStruct *kernel = nullptr;
         { FIND_KERNEL; }
-        if (R->Body.m.run_kernel.has_new_args)
+        std::unique_lock<std::mutex> KernelLock(kernel->Lock);
+        if (R->Body.m.run_kernel.has_new_args) {
           err = setKernelArgs(
               k, kernel, R->Body.m.run_kernel.args_num,
               (uint64_t *)R->ExtraData.data(),
               (unsigned char *)R->ExtraData.data() +
                   R->Body.m.run_kernel.args_num * sizeof(uint64_t),
               R->Body.m.run_kernel.pod_arg_size, (char *)R->ExtraData2.data());
+          // the next NDRange launch must set its arguments again
+          kernel->launchTemplates[device_id].Clobbered = true;
+        }
         if (err != CL_SUCCESS)
           break;
         err = Cb.commandNDRangeKernel(
@@ -3127,126 +3263,211 @@ int SharedCLContext::fillBuffer(uint64_t ev_id, uint32_t cq_id,
   EVENT_TIMING_POST("fillBuffer");
 }
 
+int SharedCLContext::setKernelArg(cl::Kernel *k, clKernelStruct *kernel,
+                                  cl_uint i, uint64_t arg,
+                                  unsigned char is_svm_ptr, const char *pod) {
+  cl_int err;
+
+  switch (kernel->metaData->arg_meta[i].type) {
+
+  case PoclRemoteArgType::Local: {
+    POCL_MSG_PRINT_GENERAL("Setting ARG %u type Local \n", i);
+    cl::size_type size = arg;
+    err = k->setArg(i, size, nullptr);
+    assert(err == CL_SUCCESS);
+    break;
+  }
+
+  case PoclRemoteArgType::Image: {
+    uint32_t img_id = static_cast<uint32_t>(arg);
+    POCL_MSG_PRINT_GENERAL("Setting ARG %u type IMAGE  image id: %" PRIu32
+                           " ARGS[i]: %" PRIu64 " \n",
+                           i, img_id, arg);
+    cl::Image *img = findImage(img_id);
+    assert(img);
+    err = k->setArg<>(i, (*img));
+    assert(err == CL_SUCCESS);
+    break;
+  }
+  case PoclRemoteArgType::Sampler: {
+    uint32_t samp_id = static_cast<uint32_t>(arg);
+    POCL_MSG_PRINT_GENERAL(
+        "Setting ARG %u type SAMPLER  sampler id: %" PRIu32
+        " ARGS[i]: %" PRIu64 "\n",
+        i, samp_id, arg);
+    cl::Sampler *samp = findSampler(samp_id);
+    assert(samp);
+    err = k->setArg<>(i, (*samp));
+    assert(err == CL_SUCCESS);
+    break;
+  }
+  case PoclRemoteArgType::Pointer: {
+    if (is_svm_ptr) {
+      void *svm_ptr = (void *)(arg);
+      POCL_MSG_PRINT_GENERAL("Setting ARG %u type POINTER (SVM), %p\n", i,
+                             svm_ptr);
+      err = ::clSetKernelArgSVMPointer(k->get(), i, svm_ptr);
+      if (err != CL_SUCCESS) {
+        POCL_MSG_ERR(
+            "SVM pointer arg %d could not be set to '%p' error code: %d.\n",
+            i, svm_ptr, err);
+      }
+      // Assert in a server based on input data is a bit... smelly.
+      assert(err == CL_SUCCESS);
+    } else if (kernel->metaData->arg_meta[i].address_qualifier ==
+               CL_KERNEL_ARG_ADDRESS_LOCAL) {
+      POCL_MSG_PRINT_GENERAL(
+          "Setting ARG %u type POINTER (LOCAL), size: %" PRIu64 "\n", i, arg);
+      err = k->setArg(i, static_cast<size_t>(arg), nullptr);
+      assert(err == CL_SUCCESS);
+    } else {
+      uint32_t buffer_id = static_cast<uint32_t>(arg);
+      POCL_MSG_PRINT_GENERAL(
+          "Setting ARG %u type POINTER, buffer id: %" PRIu32
+          " ARGS[i]: %" PRIu64 "\n",
+          i, buffer_id, arg);
+      if (buffer_id == 0) {
+        POCL_MSG_WARN("NULL PTR ARG DETECTED: KERNEL %s ARG %u / %s \n",
+                      kernel->metaData->meta.name, i,
+                      kernel->metaData->arg_meta[i].name);
+        err = k->setArg(i, cl::Buffer());
+        assert(err == CL_SUCCESS);
+      } else {
+        cl::Buffer *b = findBuffer(buffer_id);
+        assert(b);
+        err = k->setArg<>(i, (*b));
+        assert(err == CL_SUCCESS);
+      }
+    }
+    break;
+  }
+  case PoclRemoteArgType::POD: {
+    cl::size_type size = arg;
+    if (size == 4) {
+      int32_t jjj = *(const int32_t *)pod;
+      POCL_MSG_PRINT_GENERAL(
+          "Setting ARG %u type POD to int32_t: %" PRId32 " \n", i, jjj);
+    } else
+      POCL_MSG_PRINT_GENERAL(
+          "Setting ARG %u type POD to size: %" PRIuS " \n", i, size);
+    if (size > 0) {
+      err = k->setArg(i, size, (const void *)pod);
+      assert(err == CL_SUCCESS);
+    }
+    break;
+  }
+  }
+
+  return CL_SUCCESS;
+}
+
 int SharedCLContext::setKernelArgs(cl::Kernel *k, clKernelStruct *kernel,
                                    size_t arg_count, uint64_t *args,
                                    unsigned char *is_svm_ptr, size_t pod_size,
                                    char *pod_buf) {
-  cl_int err;
-
   assert(arg_count == kernel->numArgs);
 
   if (arg_count == 0)
     return CL_SUCCESS;
 
   const char *pod_tmp = pod_buf;
-  {
-    for (cl_uint i = 0; i < arg_count; ++i) {
+  for (cl_uint i = 0; i < arg_count; ++i) {
+    int r = setKernelArg(k, kernel, i, args[i], is_svm_ptr[i], pod_tmp);
+    if (r != CL_SUCCESS)
+      return r;
+    if (kernel->metaData->arg_meta[i].type == PoclRemoteArgType::POD)
+      pod_tmp += args[i];
+  }
 
-      switch (kernel->metaData->arg_meta[i].type) {
+  POCL_MSG_PRINT_GENERAL("DONE SETTING ARGS\n");
 
-      case PoclRemoteArgType::Local: {
-        POCL_MSG_PRINT_GENERAL("Setting ARG %u type Local \n", i);
-        cl::size_type size = args[i];
-        err = k->setArg(i, size, nullptr);
-        assert(err == CL_SUCCESS);
-        break;
-      }
+  return CL_SUCCESS;
+}
 
-      case PoclRemoteArgType::Image: {
-        uint32_t img_id = static_cast<uint32_t>(args[i]);
-        POCL_MSG_PRINT_GENERAL("Setting ARG %u type IMAGE  image id: %" PRIu32
-                               " ARGS[i]: %" PRIu64 " \n",
-                               i, img_id, args[i]);
-        cl::Image *img = findImage(img_id);
-        assert(img);
-        err = k->setArg<>(i, (*img));
-        assert(err == CL_SUCCESS);
-        break;
-      }
-      case PoclRemoteArgType::Sampler: {
-        uint32_t samp_id = static_cast<uint32_t>(args[i]);
-        POCL_MSG_PRINT_GENERAL(
-            "Setting ARG %u type SAMPLER  sampler id: %" PRIu32
-            " ARGS[i]: %" PRIu64 "\n",
-            i, samp_id, args[i]);
-        cl::Sampler *samp = findSampler(samp_id);
-        assert(samp);
-        err = k->setArg<>(i, (*samp));
-        assert(err == CL_SUCCESS);
-        break;
-      }
-      case PoclRemoteArgType::Pointer: {
-        if (is_svm_ptr[i]) {
-          void *svm_ptr = (void *)(args[i]);
-          POCL_MSG_PRINT_GENERAL("Setting ARG %u type POINTER (SVM), %p\n", i,
-                                 svm_ptr);
-          err = ::clSetKernelArgSVMPointer(k->get(), i, svm_ptr);
-          if (err != CL_SUCCESS) {
-            POCL_MSG_ERR(
-                "SVM pointer arg %d could not be set to '%p' error code: %d.\n",
-                i, svm_ptr, err);
-          }
-          // Assert in a server based on input data is a bit... smelly.
-          assert(err == CL_SUCCESS);
-        } else if (kernel->metaData->arg_meta[i].address_qualifier ==
-                   CL_KERNEL_ARG_ADDRESS_LOCAL) {
-          POCL_MSG_PRINT_GENERAL(
-              "Setting ARG %u type POINTER (LOCAL), size: %" PRIu64 "\n", i,
-              args[i]);
-          err = k->setArg(i, static_cast<size_t>(args[i]), nullptr);
-          assert(err == CL_SUCCESS);
-        } else {
-          uint32_t buffer_id = static_cast<uint32_t>(args[i]);
-          POCL_MSG_PRINT_GENERAL(
-              "Setting ARG %u type POINTER, buffer id: %" PRIu32
-              " ARGS[i]: %" PRIu64 "\n",
-              i, buffer_id, args[i]);
-          if (buffer_id == 0) {
-            POCL_MSG_WARN("NULL PTR ARG DETECTED: KERNEL %s ARG %u / %s \n",
-                          kernel->metaData->meta.name, i,
-                          kernel->metaData->arg_meta[i].name);
-            err = k->setArg(i, cl::Buffer());
-            assert(err == CL_SUCCESS);
-          } else {
-            cl::Buffer *b = findBuffer(buffer_id);
-            assert(b);
-            err = k->setArg<>(i, (*b));
-            assert(err == CL_SUCCESS);
-          }
-        }
-        break;
-      }
-      case PoclRemoteArgType::POD: {
-        cl::size_type size = args[i];
-        if (size == 4) {
-          int32_t jjj = *(int32_t *)pod_tmp;
-          POCL_MSG_PRINT_GENERAL(
-              "Setting ARG %u type POD to int32_t: %" PRId32 " \n", i, jjj);
-        } else
-          POCL_MSG_PRINT_GENERAL(
-              "Setting ARG %u type POD to size: %" PRIuS " \n", i, size);
-        if (size > 0) {
-          err = k->setArg(i, size, (const void *)pod_tmp);
-          assert(err == CL_SUCCESS);
-          pod_tmp += size;
-        }
-        break;
-      }
-      }
+static void storeLaunchTemplate(clKernelStruct *kernel, clLaunchTemplate &T,
+                                size_t arg_count, uint64_t *args,
+                                unsigned char *is_svm_ptr, size_t pod_size,
+                                char *pod_buf) {
+  T.Args.assign(args, args + arg_count);
+  T.IsSVM.assign(is_svm_ptr, is_svm_ptr + arg_count);
+  T.POD.assign(pod_buf, pod_buf + pod_size);
+  T.PODOffsets.assign(arg_count, 0);
+  size_t Offset = 0;
+  for (size_t i = 0; i < arg_count; ++i) {
+    if (kernel->metaData->arg_meta[i].type == PoclRemoteArgType::POD) {
+      T.PODOffsets[i] = Offset;
+      Offset += args[i];
+    }
+  }
+  T.Valid = true;
+  T.Clobbered = false;
+}
+
+int SharedCLContext::updateKernelArgs(cl::Kernel *k, clKernelStruct *kernel,
+                                      clLaunchTemplate &T,
+                                      size_t changed_count,
+                                      uint32_t *arg_indices, uint64_t *args,
+                                      unsigned char *is_svm_ptr,
+                                      size_t pod_size, char *pod_buf) {
+  if (!T.Valid) {
+    POCL_MSG_ERR("Got changed arguments of kernel %s without a previous "
+                 "launch\n",
+                 kernel->metaData->meta.name);
+    return CL_INVALID_KERNEL_ARGS;
+  }
+
+  // Validate all the changes before applying any, so that a rejected launch
+  // leaves the template as the previous launch left it.
+  size_t pod_used = 0;
+  for (size_t j = 0; j < changed_count; ++j) {
+    uint32_t i = arg_indices[j];
+    if (i >= kernel->numArgs)
+      return CL_INVALID_ARG_INDEX;
+    if (kernel->metaData->arg_meta[i].type == PoclRemoteArgType::POD) {
+      // the layout of the POD arguments is fixed by the first launch
+      if (args[j] != T.Args[i] || args[j] > pod_size - pod_used)
+        return CL_INVALID_ARG_SIZE;
+      pod_used += args[j];
     }
   }
 
-  POCL_MSG_PRINT_GENERAL("DONE SETTING ARGS\n");
+  const char *pod_tmp = pod_buf;
+  for (size_t j = 0; j < changed_count; ++j) {
+    uint32_t i = arg_indices[j];
+    if (kernel->metaData->arg_meta[i].type == PoclRemoteArgType::POD) {
+      std::memcpy(T.POD.data() + T.PODOffsets[i], pod_tmp, args[j]);
+      pod_tmp += args[j];
+    }
+    T.Args[i] = args[j];
+    T.IsSVM[i] = is_svm_ptr[j];
+  }
 
+  if (T.Clobbered) {
+    int r = setKernelArgs(k, kernel, T.Args.size(), T.Args.data(),
+                          T.IsSVM.data(), T.POD.size(), T.POD.data());
+    if (r == CL_SUCCESS)
+      T.Clobbered = false;
+    return r;
+  }
+  for (size_t j = 0; j < changed_count; ++j) {
+    uint32_t i = arg_indices[j];
+    int r = setKernelArg(k, kernel, i, T.Args[i], T.IsSVM[i],
+                         T.POD.data() + T.PODOffsets[i]);
+    if (r != CL_SUCCESS) {
+      // some of the changes may have been set, set all of them next time
+      T.Clobbered = true;
+      return r;
+    }
+  }
   return CL_SUCCESS;
 }
 
 int SharedCLContext::runKernel(
     uint64_t ev_id, uint32_t cq_id, uint32_t device_id, uint16_t has_new_args,
     size_t arg_count, uint64_t *args, unsigned char *is_svm_ptr,
-    size_t pod_size, char *pod_buf, EventTiming_t &evt, uint32_t kernel_id,
-    uint32_t waitlist_size, uint64_t *waitlist, unsigned dim,
-    const sizet_vec3 &offset, const sizet_vec3 &global,
+    uint32_t *arg_indices, size_t pod_size, char *pod_buf, EventTiming_t &evt,
+    uint32_t kernel_id, uint32_t waitlist_size, uint64_t *waitlist,
+    unsigned dim, const sizet_vec3 &offset, const sizet_vec3 &global,
     const sizet_vec3 *local) {
   cl::Kernel *k = nullptr;
   clKernelStruct *kernel = nullptr;
@@ -3267,10 +3488,30 @@ int SharedCLContext::runKernel(
   cl::NDRange g3(global[0], global[1], global[2]);
 
   std::unique_lock<std::mutex> kernelLock(kernel->Lock);
-  if (has_new_args) {
+  clLaunchTemplate &T = kernel->launchTemplates[device_id];
+  if (has_new_args == RUN_KERNEL_ARGS_CHANGED) {
+    int r = updateKernelArgs(k, kernel, T, arg_count, arg_indices, args,
+                             is_svm_ptr, pod_size, pod_buf);
+    if (r != CL_SUCCESS)
+      return r;
+  } else if (has_new_args) {
     int r = setKernelArgs(k, kernel, arg_count, args, is_svm_ptr, pod_size,
                           pod_buf);
-    assert(r == CL_SUCCESS);
+    // the client bases its next changes on these arguments also if the launch
+    // fails, only the kernel has to be set again
+    storeLaunchTemplate(kernel, T, arg_count, args, is_svm_ptr, pod_size,
+                        pod_buf);
+    if (r != CL_SUCCESS) {
+      T.Clobbered = true;
+      return r;
+    }
+  } else if (T.Valid && T.Clobbered) {
+    // a command buffer has set other arguments since the previous launch
+    int r = setKernelArgs(k, kernel, T.Args.size(), T.Args.data(),
+                          T.IsSVM.data(), T.POD.size(), T.POD.data());
+    if (r != CL_SUCCESS)
+      return r;
+    T.Clobbered = false;
   }
 
   {
@@ -3526,13 +3767,17 @@ int SharedCLContext::runCommandBuffer(uint64_t ev_id, EventTiming_t &evt,
         cl::Kernel *k = nullptr;
         clKernelStruct *kernel = nullptr;
         { FIND_KERNEL; }
-        if (R->Body.m.run_kernel.has_new_args)
+        std::unique_lock<std::mutex> KernelLock(kernel->Lock);
+        if (R->Body.m.run_kernel.has_new_args) {
           err = setKernelArgs(k, kernel, R->Body.m.run_kernel.args_num,
                               (uint64_t *)R->ExtraData.data(),
                               (unsigned char *)R->ExtraData.data() +
                                   R->Body.m.run_kernel.args_num *
                                       sizeof(uint64_t),
                               R->ExtraData2Size, (char *)R->ExtraData2.data());
+          // the next NDRange launch must set its arguments again
+          kernel->launchTemplates[device_id].Clobbered = true;
+        }
         if (err != CL_SUCCESS)
           break;
         err = Queues[R->Body.cq_id].enqueueNDRangeKernel(
@@ -49,7 +49,7 @@ public:
 
   virtual size_t numDevices() const = 0;
 
-  virtual int writeKernelMeta(uint32_t ProgramID, std::vector<uint8_t> &Buffer,
+  virtual int writeKernelMeta(uint32_t ProgramID, PayloadBuffer &Buffer,
                               size_t *Written) = 0;
 
   virtual EventPair getEventPairForId(uint64_t event_id) = 0;
@@ -59,6 +59,11 @@ public:
   virtual std::vector<cl::Event> remapWaitlist(size_t num_events, uint64_t *ids,
                                                uint64_t dep) = 0;
 
+  /// Returns the address of a transfer at Offset of the memory region shared
+  /// with the client, or nullptr if the client has none or the transfer does
+  /// not fit in it.
+  virtual char *clientSharedMemory(uint64_t Offset, uint64_t Size) = 0;
+
 #ifdef ENABLE_RDMA
   virtual bool clientUsesRdma() = 0;
 
@@ -178,11 +183,11 @@ public:
 
   virtual int runKernel(uint64_t ev_id, uint32_t cq_id, uint32_t device_id,
                         uint16_t has_new_args, size_t arg_count, uint64_t *args,
-                        unsigned char *is_svm_ptr, size_t pod_size,
-                        char *pod_buf, EventTiming_t &evt, uint32_t kernel_id,
-                        uint32_t waitlist_size, uint64_t *waitlist,
-                        unsigned dim, const sizet_vec3 &offset,
-                        const sizet_vec3 &global,
+                        unsigned char *is_svm_ptr, uint32_t *arg_indices,
+                        size_t pod_size, char *pod_buf, EventTiming_t &evt,
+                        uint32_t kernel_id, uint32_t waitlist_size,
+                        uint64_t *waitlist, unsigned dim,
+                        const sizet_vec3 &offset, const sizet_vec3 &global,
                         const sizet_vec3 *local = nullptr) = 0;
 
   virtual int runCommandBuffer(uint64_t ev_id, EventTiming_t &evt,
@@ -0,0 +1,68 @@
+/* shared_memory.cc - a memory region shared with a client connected over a
+   Unix domain socket
+
+   Copyright (c) 2026 PoCL developers
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+*/
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pocl_debug.h"
+#include "shared_memory.hh"
+
+std::shared_ptr<SharedMemoryRegion> SharedMemoryRegion::map(int Fd,
+                                                            uint64_t Size) {
+  struct stat St;
+  if (fstat(Fd, &St) != 0 || !S_ISREG(St.st_mode) ||
+      (uint64_t)St.st_size < Size || Size == 0) {
+    POCL_MSG_ERR("Client passed an invalid shared memory fd\n");
+    close(Fd);
+    return nullptr;
+  }
+
+#ifdef F_SEAL_SHRINK
+  // Without the seal the client could truncate the file and make accesses
+  // to the mapping raise SIGBUS in the daemon.
+  int Seals = fcntl(Fd, F_GET_SEALS);
+  if (Seals < 0 || !(Seals & F_SEAL_SHRINK)) {
+    POCL_MSG_ERR("Client shared memory is not sealed against shrinking\n");
+    close(Fd);
+    return nullptr;
+  }
+#endif
+
+  void *Base = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_SHARED, Fd, 0);
+  close(Fd);
+  if (Base == MAP_FAILED) {
+    POCL_MSG_ERR("Mapping the client shared memory failed: %s\n",
+                 strerror(errno));
+    return nullptr;
+  }
+
+  return std::shared_ptr<SharedMemoryRegion>(
+      new SharedMemoryRegion(static_cast<char *>(Base), Size));
+}
+
+SharedMemoryRegion::~SharedMemoryRegion() { munmap(Base, RegionSize); }
@@ -0,0 +1,66 @@
+/* shared_memory.hh - a memory region shared with a client connected over a
+   Unix domain socket
+
+   Copyright (c) 2026 PoCL developers
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+*/
+
+#ifndef POCL_REMOTE_SHARED_MEMORY_HH
+#define POCL_REMOTE_SHARED_MEMORY_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#ifdef __GNUC__
+#pragma GCC visibility push(hidden)
+#endif
+
+/** Maps the memfd the client passed at session creation. ReadBuffer and
+ * WriteBuffer commands of the session refer to offsets in it instead of
+ * carrying their payload through the socket. */
+class SharedMemoryRegion {
+public:
+  /// Takes the ownership of Fd and maps Size bytes of it. Returns nullptr if
+  /// the fd is not a sealed memory file of at least Size bytes.
+  static std::shared_ptr<SharedMemoryRegion> map(int Fd, uint64_t Size);
+  ~SharedMemoryRegion();
+
+  /// Returns the address of Size bytes at Offset of the region, or nullptr if
+  /// they are not within the region.
+  char *at(uint64_t Offset, uint64_t Size) const {
+    if (Offset > RegionSize || Size > RegionSize - Offset)
+      return nullptr;
+    return Base + Offset;
+  }
+  size_t size() const { return RegionSize; }
+
+private:
+  SharedMemoryRegion(char *Base, size_t Size) : Base(Base), RegionSize(Size) {}
+
+  char *Base;
+  size_t RegionSize;
+};
+
+#ifdef __GNUC__
+#pragma GCC visibility pop
+#endif
+
+#endif
@@ -27,6 +27,7 @@
 #include <sstream>
 #include <thread>
 
+#include "build_cache.hh"
 #include "common.hh"
 #include "pocl_debug.h"
 #include "traffic_monitor.hh"
@@ -60,16 +61,20 @@ void TrafficMonitor::fileWriterThread() {
 
   std::ofstream f(base_path / filename.str(), std::ios::out | std::ios::trunc);
   f << "timestamp,tx_bytes_submitted,tx_bytes_confirmed,rx_bytes_requested,rx_"
-       "bytes_confirmed"
+       "bytes_confirmed,build_cache_hits,build_cache_misses,build_cache_"
+       "evictions,build_cache_bytes"
     << std::endl;
   std::string fieldsep = ",";
   std::string linesep = "\n";
+  // the build cache is shared by all the sessions, its counters are global
+  ProgramBuildCache &BuildCache = ProgramBuildCache::instance();
 
   while (!eh->exit_requested()) {
     f << std::chrono::steady_clock::now().time_since_epoch().count() << fieldsep
       << tx_bytes_submitted << fieldsep << tx_bytes_confirmed << fieldsep
       << rx_bytes_requested << fieldsep << rx_bytes_confirmed << fieldsep
-      << linesep;
+      << BuildCache.hits() << fieldsep << BuildCache.misses() << fieldsep
+      << BuildCache.evictions() << fieldsep << BuildCache.bytes() << linesep;
 
     using std::chrono::operator""ms;
     std::this_thread::sleep_for(10ms);
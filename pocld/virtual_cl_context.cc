@@ -22,6 +22,7 @@
    IN THE SOFTWARE.
 */
 
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <cstdio>
@@ -47,6 +48,7 @@
 #include "traffic_monitor.hh"
 
 #include "messages.h"
+#include "pocl_runtime_config.h"
 
 SharedContextBase *createSharedCLContext(cl::Platform *platform, size_t pid,
                                          VirtualContextBase *v,
@@ -82,6 +84,16 @@ SharedContextBase *createSharedCLContext(cl::Platform *platform, size_t pid,
 
 typedef std::vector<SharedContextBase *> ContextVector;
 
+/* Size of the chunks buffer migrations to other servers are streamed in */
+#define DEFAULT_MIGRATION_CHUNK_MB 8
+/* Number of chunks of a migration held in memory at the source server */
+#define MIGRATION_CHUNKS_IN_FLIGHT 4
+/* Event ID for an intermediate chunk of a streamed migration; made up like
+ * the other migration event IDs but unique per chunk as the destination
+ * may have several of them queued at a time. */
+#define MIGRATION_CHUNK_EVENT_ID(msg_id, chunk)                                \
+  ((1ULL << 63) | ((uint64_t)(msg_id) << 24) | (uint64_t)(chunk))
+
 #ifdef ENABLE_RDMA
 class SVMDeleter {
   cl_context _c;
@@ -128,6 +140,7 @@ class VirtualCLContext : public VirtualContextBase {
   std::mutex client_regions_mutex;
   uint32_t client_uses_rdma;
 #endif
+  std::shared_ptr<SharedMemoryRegion> client_shm;
   std::shared_ptr<TrafficMonitor> netstat;
 
   std::unordered_set<uint32_t> BufferIDset;
@@ -176,6 +189,10 @@ public:
 
   virtual void queuedPush(Request *req) override;
 
+  virtual char *clientSharedMemory(uint64_t Offset, uint64_t Size) override {
+    return client_shm ? client_shm->at(Offset, Size) : nullptr;
+  }
+
 #ifdef ENABLE_RDMA
   virtual bool clientUsesRdma() override { return (client_uses_rdma != 0); };
 
@@ -240,6 +257,10 @@ private:
   void DeviceInfo(Request *req, Reply *rep);
 
   void MigrateD2D(Request *req);
+
+#ifndef ENABLE_RDMA
+  void streamMigrationToPeer(Request *req, uint64_t ChunkSize);
+#endif
 };
 
 #ifdef __GNUC__
@@ -254,6 +275,7 @@ size_t VirtualCLContext::init(PoclDaemon *d, ClientConnections_t conns,
   current_printf_position = 0;
   TotalDevices = 0;
   peer_id = params.peer_id;
+  client_shm = conns.shm;
 #ifdef ENABLE_RDMA
   client_uses_rdma = params.use_rdma;
   if (client_uses_rdma) {
@@ -1097,6 +1119,18 @@ void VirtualCLContext::MigrateD2D(Request *req) {
     // totally made up, but we immediately delete the event from EventMap
     uint64_t fake_ev_id = r.msg_id + (1UL << 50);
 
+#ifndef ENABLE_RDMA
+    uint64_t ChunkSize =
+        (uint64_t)pocl_get_int_option("POCLD_MIGRATION_CHUNK_MB",
+                                      DEFAULT_MIGRATION_CHUNK_MB)
+        << 20;
+    if (m.source_peer_id == peer_id && m.dest_peer_id != peer_id &&
+        m.is_image == 0 && ChunkSize > 0 && m.size > ChunkSize) {
+      streamMigrationToPeer(req, ChunkSize);
+      return;
+    }
+#endif
+
     if (m.source_peer_id == peer_id) {
       POCL_MSG_PRINT_GENERAL(
           "MigrateD2D: %s READ on PID: %" PRIu32 ", DID: %" PRIu32
@@ -1146,8 +1180,9 @@ void VirtualCLContext::MigrateD2D(Request *req) {
     }
 
     /* Write extra_size after possible content size has been read, just before
-     * pushing the request on */
-    req->ExtraDataSize = m.size;
+     * pushing the request on. Streamed chunks already carry their size. */
+    if (m.chunk_size == 0)
+      req->ExtraDataSize = m.size;
 
     // .... and now we can push the writeBuffer to the queue
     if (m.dest_peer_id == peer_id) {
@@ -1158,6 +1193,95 @@ void VirtualCLContext::MigrateD2D(Request *req) {
   }
 }
 
+#ifndef ENABLE_RDMA
+/* Reads the source buffer of a migration to another server in chunks and
+ * pushes each of them to the peer as soon as it has been read, so that
+ * reading, sending and writing them at the destination overlap. At most
+ * MIGRATION_CHUNKS_IN_FLIGHT chunks are staged in memory at a time. Every
+ * chunk carries the waitlist of the migration; the destination completes the
+ * migration event with the last one. */
+void VirtualCLContext::streamMigrationToPeer(Request *req, uint64_t ChunkSize) {
+  MigrateD2DMsg_t &m = req->Body.m.migrate;
+  RequestMsg_t &r = req->Body;
+  EventTiming_t evt{};
+  uint32_t def_queue_id = DEFAULT_QUE_ID + m.source_did;
+  uint64_t fake_ev_id = r.msg_id + (1UL << 50);
+  SharedContextBase *src = SharedContextList[m.source_pid];
+  // A failed read ends the stream with a chunk carrying the error, which
+  // fails the migration event at the destination.
+  int err = CL_SUCCESS;
+
+  uint64_t TotalSize = m.size;
+  if (m.size_id != 0) {
+    uint64_t content_bytes = 0;
+    err = src->readBuffer(fake_ev_id, def_queue_id, m.size_id, 0, 0,
+                          sizeof(content_bytes), 0, &content_bytes, nullptr,
+                          evt, 0, nullptr);
+    if (err == CL_SUCCESS)
+      err = src->waitAndDeleteEvent(fake_ev_id);
+    // the last chunk must have some data to write at the destination
+    if (err == CL_SUCCESS)
+      TotalSize =
+          std::max<uint64_t>(1, std::min<uint64_t>(m.size, content_bytes));
+  }
+  m.size = TotalSize;
+
+  POCL_MSG_PRINT_GENERAL("MigrateD2D: streaming %" PRIu64
+                         " bytes to peer %" PRIu32 " in %" PRIu64
+                         " byte chunks\n",
+                         TotalSize, uint32_t(m.dest_peer_id), ChunkSize);
+
+  uint64_t ChunkIndex = 0;
+  for (uint64_t Offset = 0; Offset < TotalSize;
+       Offset += ChunkSize, ++ChunkIndex) {
+    uint64_t Len = std::min(ChunkSize, TotalSize - Offset);
+    bool Last = (Offset + Len == TotalSize);
+
+    // wait until the peer writer has room for another chunk
+    peers->waitForQueuedData(m.dest_peer_id,
+                             (MIGRATION_CHUNKS_IN_FLIGHT - 1) * ChunkSize);
+    if (ExitSignal.exit_requested()) {
+      delete req;
+      return;
+    }
+
+    Request *Chunk = Last ? req : new Request(*req);
+    Chunk->ExtraData.resize(Len);
+    if (err == CL_SUCCESS) {
+      err = src->readBuffer(fake_ev_id, def_queue_id, r.obj_id, 0, 0, Len,
+                            Offset, Chunk->ExtraData.data(), nullptr, evt, 0,
+                            nullptr);
+      if (err == CL_SUCCESS)
+        err = src->waitAndDeleteEvent(fake_ev_id);
+    }
+    if (err != CL_SUCCESS && !Last) {
+      POCL_MSG_ERR("MigrateD2D: reading the chunk at %" PRIu64
+                   " failed with %d\n",
+                   Offset, err);
+      delete Chunk;
+      Chunk = req;
+      Chunk->ExtraData.resize(Len);
+      Last = true;
+    }
+
+    MigrateD2DMsg_t &cm = Chunk->Body.m.migrate;
+    cm.chunk_offset = Offset;
+    cm.chunk_size = Len;
+    cm.more_chunks = !Last;
+    cm.source_error = err;
+    // the destination needs a distinct event for each intermediate chunk
+    if (!Last)
+      Chunk->Body.event_id = MIGRATION_CHUNK_EVENT_ID(r.msg_id, ChunkIndex);
+    Chunk->ExtraDataSize = Len;
+
+    uint32_t DestPeer = cm.dest_peer_id;
+    peers->pushRequest(Chunk, DestPeer);
+    if (Last)
+      break;
+  }
+}
+#endif
+
 /****************************************************************************************************************/
 /****************************************************************************************************************/
 
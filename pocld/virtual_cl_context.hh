@@ -45,6 +45,8 @@ public:
 
   virtual void queuedPush(Request *req) = 0;
 
+  virtual char *clientSharedMemory(uint64_t Offset, uint64_t Size) = 0;
+
 #ifdef ENABLE_RDMA
   virtual bool clientUsesRdma() = 0;
 
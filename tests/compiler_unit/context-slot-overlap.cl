@@ -0,0 +1,9 @@
+kernel void test_context_slot_overlap(__global float* in, __global float* out)
+{
+  size_t i = get_global_id(0);
+  float a = in[i];
+  barrier(CLK_GLOBAL_MEM_FENCE);
+  float b = in[i + 1];
+  barrier(CLK_GLOBAL_MEM_FENCE);
+  out[i] = a + b;
+}
@@ -0,0 +1,12 @@
+kernel void test_context_slot_packing(__global float4* in4, __global float* in,
+                                      __global float4* out4, __global float* out)
+{
+  size_t i = get_global_id(0);
+  float4 a = in4[2 * i];
+  float4 b = in4[2 * i + 1];
+  float x = in[2 * i];
+  float y = in[2 * i + 1];
+  barrier(CLK_GLOBAL_MEM_FENCE);
+  out4[i] = a * b;
+  out[i] = x * y;
+}
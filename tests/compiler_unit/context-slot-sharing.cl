@@ -0,0 +1,11 @@
+kernel void test_context_slot_sharing(__global float* in, __global float* out)
+{
+  size_t i = get_global_id(0);
+  float a = in[i];
+  barrier(CLK_GLOBAL_MEM_FENCE);
+  out[i] = a;
+  barrier(CLK_GLOBAL_MEM_FENCE);
+  float b = in[i + 1];
+  barrier(CLK_GLOBAL_MEM_FENCE);
+  out[i + 1] = b;
+}
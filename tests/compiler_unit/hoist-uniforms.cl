@@ -0,0 +1,9 @@
+kernel void test_hoist_uniforms(__global float* in, __global float* out,
+                                float scale)
+{
+  size_t i = get_global_id(0);
+  float s = in[0] * scale;
+  float v = in[i] * s;
+  barrier(CLK_GLOBAL_MEM_FENCE);
+  out[i] = v;
+}
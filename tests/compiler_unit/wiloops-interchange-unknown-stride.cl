@@ -0,0 +1,8 @@
+kernel void test_wiloops_interchange_unknown_stride(__global float* in,
+                                                    __global float* out,
+                                                    int pitch)
+{
+  size_t x = get_local_id(0);
+  size_t y = get_local_id(1);
+  out[y * pitch + x] = in[y * pitch + x] * 2.0f;
+}
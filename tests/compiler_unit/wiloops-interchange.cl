@@ -0,0 +1,6 @@
+kernel void test_wiloops_interchange(__global float* in, __global float* out)
+{
+  size_t x = get_local_id(0);
+  size_t y = get_local_id(1);
+  out[x * 256 + y] = in[x * 256 + y] * 2.0f;
+}
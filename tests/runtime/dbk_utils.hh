@@ -168,14 +168,21 @@ public:
   unsigned elementSize() const noexcept {
     switch (Desc.dtype) {
     case CL_TENSOR_DTYPE_INT64_EXP:
+    case CL_TENSOR_DTYPE_UINT64_EXP:
     case CL_TENSOR_DTYPE_FP64_EXP:
       return 8;
     case CL_TENSOR_DTYPE_INT32_EXP:
+    case CL_TENSOR_DTYPE_UINT32_EXP:
     case CL_TENSOR_DTYPE_FP32_EXP:
       return 4;
     case CL_TENSOR_DTYPE_INT16_EXP:
+    case CL_TENSOR_DTYPE_UINT16_EXP:
     case CL_TENSOR_DTYPE_FP16_EXP:
+    case CL_TENSOR_DTYPE_BFLOAT16_EXP:
       return 2;
+    case CL_TENSOR_DTYPE_INT8_EXP:
+    case CL_TENSOR_DTYPE_UINT8_EXP:
+      return 1;
     default:
       assert(false && "Unknown element type!");
       return 1;
@@ -295,19 +302,21 @@ std::tuple<cl::Program, std::vector<cl::Kernel>> assertCreateDBKs(
 
 inline bool deviceHasDBK(cl::Device Dev, const std::string &DBK) {
   std::string DBKs = Dev.getInfo<CL_DEVICE_BUILT_IN_KERNELS>();
-  auto Pos = DBKs.find(DBK);
-  if (Pos == std::string::npos)
-    return false;
-
-  // Check we have a full match.
-  if (Pos && DBKs[Pos - 1] != ';')
-    return false;
-
-  auto EndPos = Pos + DBK.size();
-  if (EndPos < DBKs.size() && DBKs[EndPos] != ';')
-    return false;
+  // Look for a full match, the name can be a suffix of another DBK name
+  // (e.g. "convert_exp" and "img_color_convert_exp").
+  for (auto Pos = DBKs.find(DBK); Pos != std::string::npos;
+       Pos = DBKs.find(DBK, Pos + 1)) {
+    if (Pos && DBKs[Pos - 1] != ';')
+      continue;
+
+    auto EndPos = Pos + DBK.size();
+    if (EndPos < DBKs.size() && DBKs[EndPos] != ';')
+      continue;
+
+    return true;
+  }
 
-  return true;
+  return false;
 }
 
 inline std::tuple<cl::Platform, cl::Device, std::string>
@@ -0,0 +1,163 @@
+/* Tests the ordering of broadcast migrations of a buffer read by many devices.
+
+   Copyright (c) 2026 PoCL developers
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "poclu.h"
+
+/*
+  Read-read-write test of the broadcast migrations. The first device writes a
+  buffer, which all the other devices then read by copying it to buffers of
+  their own, so that the version is broadcast to them along a migration
+  tree. The third device then overwrites half of the buffer and the result is
+  read back through another queue of the same device. The broadcast copy to
+  the writer must not land after the write, and every reader must get the
+  first version.
+*/
+
+#define ITEMS (4 * 1024 * 1024)
+#define WRITER 2
+
+static int
+release_devices (cl_context context, cl_uint num_devices,
+                 cl_device_id *devices, cl_command_queue *queues)
+{
+  for (cl_uint i = 0; i < num_devices; ++i)
+    CHECK_CL_ERROR (clReleaseCommandQueue (queues[i]));
+  CHECK_CL_ERROR (clReleaseContext (context));
+  free (devices);
+  free (queues);
+  return CL_SUCCESS;
+}
+
+static int
+check_contents (const cl_uint *data, size_t num, cl_uint first_half,
+                cl_uint second_half, const char *what)
+{
+  for (size_t i = 0; i < num; ++i)
+    {
+      cl_uint expected = i < num / 2 ? first_half : second_half;
+      if (data[i] != expected)
+        {
+          printf ("%s: wrong value %u at %zu, expected %u\n", what, data[i], i,
+                  expected);
+          return 1;
+        }
+    }
+  return 0;
+}
+
+int
+main (void)
+{
+  cl_platform_id platform = NULL;
+  cl_context context = NULL;
+  cl_device_id *devices = NULL;
+  cl_command_queue *queues = NULL;
+  cl_command_queue reader_queue = NULL;
+  cl_mem buf = NULL, *copies = NULL;
+  cl_uint *data = NULL, *update = NULL;
+  cl_uint num_devices = 0;
+  cl_event write_ev = NULL;
+  int err, failed = 0;
+  const size_t size = ITEMS * sizeof (cl_uint);
+
+  setenv ("POCL_MIGRATE_BROADCAST", "1", 0);
+
+  err = poclu_get_multiple_devices (&platform, &context, 0, &num_devices,
+                                    &devices, &queues, 0);
+  CHECK_OPENCL_ERROR_IN ("poclu_get_multiple_devices");
+
+  if (num_devices <= WRITER)
+    {
+      printf ("NOT ENOUGH DEVICES! (need %d)\n", WRITER + 1);
+      release_devices (context, num_devices, devices, queues);
+      return 77;
+    }
+
+  data = (cl_uint *)malloc (size);
+  update = (cl_uint *)malloc (size / 2);
+  copies = (cl_mem *)calloc (num_devices, sizeof (cl_mem));
+  TEST_ASSERT (data != NULL && update != NULL && copies != NULL);
+
+  buf = clCreateBuffer (context, CL_MEM_READ_WRITE, size, NULL, &err);
+  CHECK_OPENCL_ERROR_IN ("clCreateBuffer");
+  for (cl_uint i = 1; i < num_devices; ++i)
+    {
+      copies[i] = clCreateBuffer (context, CL_MEM_READ_WRITE, size, NULL, &err);
+      CHECK_OPENCL_ERROR_IN ("clCreateBuffer");
+    }
+
+  reader_queue = clCreateCommandQueue (context, devices[WRITER], 0, &err);
+  CHECK_OPENCL_ERROR_IN ("clCreateCommandQueue");
+
+  for (size_t i = 0; i < ITEMS; ++i)
+    data[i] = 1;
+  CHECK_CL_ERROR (clEnqueueWriteBuffer (queues[0], buf, CL_TRUE, 0, size, data,
+                                        0, NULL, NULL));
+
+  /* The reads which broadcast the first version to all the other devices. */
+  for (cl_uint i = 1; i < num_devices; ++i)
+    CHECK_CL_ERROR (clEnqueueCopyBuffer (queues[i], buf, copies[i], 0, 0, size,
+                                         0, NULL, NULL));
+
+  for (size_t i = 0; i < ITEMS / 2; ++i)
+    update[i] = 2;
+  CHECK_CL_ERROR (clEnqueueWriteBuffer (queues[WRITER], buf, CL_FALSE, 0,
+                                        size / 2, update, 0, NULL, &write_ev));
+  CHECK_CL_ERROR (clFlush (queues[WRITER]));
+
+  memset (data, 0, size);
+  CHECK_CL_ERROR (clEnqueueReadBuffer (reader_queue, buf, CL_TRUE, 0, size,
+                                       data, 1, &write_ev, NULL));
+  failed |= check_contents (data, ITEMS, 2, 1, "written buffer");
+
+  for (cl_uint i = 1; i < num_devices; ++i)
+    {
+      memset (data, 0, size);
+      CHECK_CL_ERROR (clEnqueueReadBuffer (queues[i], copies[i], CL_TRUE, 0,
+                                           size, data, 0, NULL, NULL));
+      failed |= check_contents (data, ITEMS, 1, 1, "broadcast copy");
+    }
+
+  CHECK_CL_ERROR (clReleaseEvent (write_ev));
+  CHECK_CL_ERROR (clFinish (reader_queue));
+  CHECK_CL_ERROR (clReleaseCommandQueue (reader_queue));
+  for (cl_uint i = 1; i < num_devices; ++i)
+    CHECK_CL_ERROR (clReleaseMemObject (copies[i]));
+  CHECK_CL_ERROR (clReleaseMemObject (buf));
+  release_devices (context, num_devices, devices, queues);
+  free (copies);
+  free (update);
+  free (data);
+
+  if (failed)
+    {
+      printf ("FAIL\n");
+      return EXIT_FAILURE;
+    }
+  printf ("OK\n");
+  return EXIT_SUCCESS;
+}
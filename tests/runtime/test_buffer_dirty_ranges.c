@@ -0,0 +1,257 @@
+/* Tests the migration of the dirty ranges of buffers between devices
+
+   Copyright (c) 2026 PoCL developers
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "poclu.h"
+
+/*
+  With POCL_MIGRATE_DIRTY_RANGES=1, the migrations of a buffer copy only the
+  byte ranges written since the destination's version. Each round writes
+  disjoint, overlapping and rectangular sub-ranges of the buffer, fills one
+  and copies another buffer into one, all on one device, then reads the
+  whole buffer on the next device and compares it to a host mirror. One
+  round writes more ranges than the dirty log holds, which falls back to
+  whole-buffer migrations. The devices migrating through the host (such as
+  a remote and a local device) copy the dirty ranges.
+*/
+
+#define BUF_SIZE (1024 * 1024)
+#define ROW_PITCH 4096
+#define RECT_WIDTH 256
+#define RECT_ROWS 8
+#define RANGE_SIZE 512
+#define ROUNDS 8
+
+static unsigned rand_state = 12345;
+
+static unsigned
+next_rand (void)
+{
+  rand_state = rand_state * 1103515245 + 12345;
+  return (rand_state >> 8) & 0xffffff;
+}
+
+/* A random 4 byte aligned offset with room for size bytes after it. */
+static size_t
+rand_offset (size_t size)
+{
+  return (next_rand () % ((BUF_SIZE - size) / 4)) * 4;
+}
+
+static int
+write_range (cl_command_queue queue, cl_mem buf, unsigned char *expected,
+             size_t offset, size_t size, unsigned char value)
+{
+  unsigned char data[RANGE_SIZE * 2];
+  TEST_ASSERT (size <= sizeof (data));
+  memset (data, value, size);
+  memcpy (expected + offset, data, size);
+  CHECK_CL_ERROR (clEnqueueWriteBuffer (queue, buf, CL_TRUE, offset, size,
+                                        data, 0, NULL, NULL));
+  return CL_SUCCESS;
+}
+
+static int
+write_rect (cl_command_queue queue, cl_mem buf, unsigned char *expected,
+            size_t x, size_t y, unsigned char value)
+{
+  unsigned char data[RECT_WIDTH * RECT_ROWS];
+  for (size_t i = 0; i < sizeof (data); ++i)
+    data[i] = (unsigned char)(value + i);
+  for (size_t row = 0; row < RECT_ROWS; ++row)
+    memcpy (expected + (y + row) * ROW_PITCH + x, data + row * RECT_WIDTH,
+            RECT_WIDTH);
+
+  size_t buffer_origin[3] = { x, y, 0 };
+  size_t host_origin[3] = { 0, 0, 0 };
+  size_t region[3] = { RECT_WIDTH, RECT_ROWS, 1 };
+  CHECK_CL_ERROR (clEnqueueWriteBufferRect (
+      queue, buf, CL_TRUE, buffer_origin, host_origin, region, ROW_PITCH, 0,
+      RECT_WIDTH, 0, data, 0, NULL, NULL));
+  return CL_SUCCESS;
+}
+
+static int
+fill_range (cl_command_queue queue, cl_mem buf, unsigned char *expected,
+            size_t offset, size_t size, cl_uint pattern)
+{
+  for (size_t i = 0; i < size; i += sizeof (pattern))
+    memcpy (expected + offset + i, &pattern, sizeof (pattern));
+  CHECK_CL_ERROR (clEnqueueFillBuffer (queue, buf, &pattern, sizeof (pattern),
+                                       offset, size, 0, NULL, NULL));
+  CHECK_CL_ERROR (clFinish (queue));
+  return CL_SUCCESS;
+}
+
+static int
+copy_range (cl_command_queue queue, cl_mem src, const unsigned char *src_data,
+            cl_mem buf, unsigned char *expected, size_t offset, size_t size)
+{
+  memcpy (expected + offset, src_data, size);
+  CHECK_CL_ERROR (
+      clEnqueueCopyBuffer (queue, src, buf, 0, offset, size, 0, NULL, NULL));
+  CHECK_CL_ERROR (clFinish (queue));
+  return CL_SUCCESS;
+}
+
+static int
+check_buffer (cl_command_queue queue, cl_mem buf,
+              const unsigned char *expected, unsigned char *data,
+              const char *what, int round)
+{
+  memset (data, 0, BUF_SIZE);
+  CHECK_CL_ERROR (clEnqueueReadBuffer (queue, buf, CL_TRUE, 0, BUF_SIZE, data,
+                                       0, NULL, NULL));
+  for (size_t i = 0; i < BUF_SIZE; ++i)
+    {
+      if (data[i] != expected[i])
+        {
+          printf ("%s in round %d: wrong value %u at %zu, expected %u\n",
+                  what, round, data[i], i, expected[i]);
+          return 1;
+        }
+    }
+  return 0;
+}
+
+int
+main (void)
+{
+  cl_platform_id platform = NULL;
+  cl_context context = NULL;
+  cl_device_id *devices = NULL;
+  cl_command_queue *queues = NULL;
+  cl_uint num_devices = 0;
+  int err, failed = 0;
+
+  setenv ("POCL_MIGRATE_DIRTY_RANGES", "1", 0);
+
+  err = poclu_get_multiple_devices (&platform, &context, 0, &num_devices,
+                                    &devices, &queues, 0);
+  CHECK_OPENCL_ERROR_IN ("poclu_get_multiple_devices");
+
+  if (num_devices < 2)
+    {
+      printf ("NOT ENOUGH DEVICES! (need 2)\n");
+      for (cl_uint i = 0; i < num_devices; ++i)
+        CHECK_CL_ERROR (clReleaseCommandQueue (queues[i]));
+      CHECK_CL_ERROR (clReleaseContext (context));
+      free (devices);
+      free (queues);
+      return 77;
+    }
+
+  unsigned char *expected = (unsigned char *)malloc (BUF_SIZE);
+  unsigned char *data = (unsigned char *)malloc (BUF_SIZE);
+  unsigned char src_data[RANGE_SIZE];
+  TEST_ASSERT (expected != NULL && data != NULL);
+
+  for (size_t i = 0; i < BUF_SIZE; ++i)
+    expected[i] = (unsigned char)(i * 7);
+  for (size_t i = 0; i < RANGE_SIZE; ++i)
+    src_data[i] = (unsigned char)(255 - i);
+
+  cl_mem buf = clCreateBuffer (context, CL_MEM_READ_WRITE, BUF_SIZE, NULL,
+                               &err);
+  CHECK_OPENCL_ERROR_IN ("clCreateBuffer");
+  cl_mem src = clCreateBuffer (context,
+                               CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                               RANGE_SIZE, src_data, &err);
+  CHECK_OPENCL_ERROR_IN ("clCreateBuffer");
+
+  CHECK_CL_ERROR (clEnqueueWriteBuffer (queues[0], buf, CL_TRUE, 0, BUF_SIZE,
+                                        expected, 0, NULL, NULL));
+
+  for (int round = 0; round < ROUNDS && !failed; ++round)
+    {
+      cl_command_queue writer = queues[round % num_devices];
+      cl_command_queue reader = queues[(round + 1) % num_devices];
+      unsigned char value = (unsigned char)(round * 16 + 1);
+
+      if (round == ROUNDS / 2)
+        {
+          /* more writes than the dirty log holds */
+          for (int i = 0; i < 24; ++i)
+            failed |= write_range (writer, buf, expected,
+                                   rand_offset (RANGE_SIZE), RANGE_SIZE / 8,
+                                   (unsigned char)(value + i));
+        }
+      else
+        {
+          /* disjoint ranges */
+          failed |= write_range (writer, buf, expected, 0, RANGE_SIZE, value);
+          failed |= write_range (writer, buf, expected, BUF_SIZE / 2 + 64,
+                                 RANGE_SIZE, value + 1);
+          failed |= write_range (writer, buf, expected, BUF_SIZE - RANGE_SIZE,
+                                 RANGE_SIZE, value + 2);
+
+          /* overlapping ranges, the later write wins */
+          size_t offset = rand_offset (RANGE_SIZE * 2);
+          failed |= write_range (writer, buf, expected, offset,
+                                 RANGE_SIZE, value + 3);
+          failed |= write_range (writer, buf, expected,
+                                 offset + RANGE_SIZE / 2, RANGE_SIZE,
+                                 value + 4);
+
+          /* a rectangle, which also overlaps the previous one */
+          size_t x = (next_rand () % ((ROW_PITCH - RECT_WIDTH) / 4)) * 4;
+          size_t y = next_rand () % (BUF_SIZE / ROW_PITCH - RECT_ROWS);
+          failed |= write_rect (writer, buf, expected, x, y, value + 5);
+          failed |= write_rect (writer, buf, expected, x + RECT_WIDTH / 2,
+                                y + RECT_ROWS / 2, value + 6);
+
+          failed |= fill_range (writer, buf, expected,
+                                rand_offset (RANGE_SIZE), RANGE_SIZE,
+                                0x01020304u * (round + 1));
+          failed |= copy_range (writer, src, src_data, buf, expected,
+                                rand_offset (RANGE_SIZE), RANGE_SIZE);
+        }
+
+      failed |= check_buffer (reader, buf, expected, data, "reader", round);
+    }
+
+  /* all the devices must end up with the same contents */
+  for (cl_uint i = 0; i < num_devices && !failed; ++i)
+    failed |= check_buffer (queues[i], buf, expected, data, "final", ROUNDS);
+
+  CHECK_CL_ERROR (clReleaseMemObject (src));
+  CHECK_CL_ERROR (clReleaseMemObject (buf));
+  for (cl_uint i = 0; i < num_devices; ++i)
+    CHECK_CL_ERROR (clReleaseCommandQueue (queues[i]));
+  CHECK_CL_ERROR (clReleaseContext (context));
+  free (devices);
+  free (queues);
+  free (expected);
+  free (data);
+
+  if (failed)
+    {
+      printf ("FAIL\n");
+      return EXIT_FAILURE;
+    }
+  printf ("OK\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,244 @@
+/* Tests the WG interleaving of element-wise kernels in command buffers
+
+   Copyright (c) 2026 PoCL developers
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "poclu.h"
+
+#define STR(x) #x
+
+/*
+  Records a chain of kernels into a command buffer and replays it once with
+  POCL_CPU_CMDBUF_FUSION=0 and once with POCL_CPU_CMDBUF_FUSION=1, which is
+  read when the command buffer is finalized. The results must be the same and
+  match the host. The first three kernels are element-wise, so the CPU
+  drivers interleave their WGs; the last one reads the neighbouring WG's
+  elements, so it must not be interleaved with its predecessor.
+*/
+
+#define ITEMS (64 * 1024)
+#define LOCAL_SIZE 64
+
+static const char *source = STR (
+    kernel void scale (global const int *in, global int *out, int s) {
+      size_t i = get_global_id (0);
+      out[i] = in[i] * s + 1;
+    }
+
+    kernel void bias (global const int *in, global int *out, int b) {
+      size_t i = get_global_id (0);
+      out[i] = in[i] + b;
+    }
+
+    kernel void clamp_neg (global int *io) {
+      size_t i = get_global_id (0);
+      io[i] = max (io[i], 0);
+    }
+
+    kernel void shift (global const int *in, global int *out) {
+      size_t i = get_global_id (0);
+      size_t n = get_global_size (0);
+      out[i] = in[(i + get_local_size (0)) % n] - in[i];
+    });
+
+struct cmdbuf_ext
+{
+  clCreateCommandBufferKHR_fn clCreateCommandBufferKHR;
+  clCommandNDRangeKernelKHR_fn clCommandNDRangeKernelKHR;
+  clFinalizeCommandBufferKHR_fn clFinalizeCommandBufferKHR;
+  clEnqueueCommandBufferKHR_fn clEnqueueCommandBufferKHR;
+  clReleaseCommandBufferKHR_fn clReleaseCommandBufferKHR;
+};
+
+/* Records, finalizes and runs the kernel chain, reading the result to out. */
+static int
+run_chain (struct cmdbuf_ext *ext, cl_command_queue queue, cl_kernel *kernels,
+           unsigned num_kernels, cl_mem result, cl_int *out)
+{
+  cl_int err;
+  size_t global = ITEMS, local = LOCAL_SIZE;
+
+  cl_command_buffer_khr command_buffer
+      = ext->clCreateCommandBufferKHR (1, &queue, NULL, &err);
+  CHECK_CL_ERROR (err);
+
+  for (unsigned i = 0; i < num_kernels; ++i)
+    CHECK_CL_ERROR (ext->clCommandNDRangeKernelKHR (
+        command_buffer, NULL, NULL, kernels[i], 1, NULL, &global, &local, 0,
+        NULL, NULL, NULL));
+  CHECK_CL_ERROR (ext->clFinalizeCommandBufferKHR (command_buffer));
+
+  /* replay more than once, the arguments are checked at each replay */
+  for (unsigned r = 0; r < 2; ++r)
+    CHECK_CL_ERROR (ext->clEnqueueCommandBufferKHR (0, NULL, command_buffer,
+                                                    0, NULL, NULL));
+
+  memset (out, 0, ITEMS * sizeof (cl_int));
+  CHECK_CL_ERROR (clEnqueueReadBuffer (queue, result, CL_TRUE, 0,
+                                       ITEMS * sizeof (cl_int), out, 0, NULL,
+                                       NULL));
+  CHECK_CL_ERROR (ext->clReleaseCommandBufferKHR (command_buffer));
+  return CL_SUCCESS;
+}
+
+int
+main (void)
+{
+#if defined(cl_khr_command_buffer) && cl_khr_command_buffer == 1
+  cl_platform_id platform;
+  cl_device_id device;
+  cl_int err;
+  const size_t size = ITEMS * sizeof (cl_int);
+
+  CHECK_CL_ERROR (clGetPlatformIDs (1, &platform, NULL));
+  CHECK_CL_ERROR (
+      clGetDeviceIDs (platform, CL_DEVICE_TYPE_ALL, 1, &device, NULL));
+
+  struct cmdbuf_ext ext;
+  ext.clCreateCommandBufferKHR = clGetExtensionFunctionAddressForPlatform (
+      platform, "clCreateCommandBufferKHR");
+  if (ext.clCreateCommandBufferKHR == NULL)
+    {
+      printf ("Command buffers are not supported, skipping test\n");
+      return 77;
+    }
+  ext.clCommandNDRangeKernelKHR = clGetExtensionFunctionAddressForPlatform (
+      platform, "clCommandNDRangeKernelKHR");
+  ext.clFinalizeCommandBufferKHR = clGetExtensionFunctionAddressForPlatform (
+      platform, "clFinalizeCommandBufferKHR");
+  ext.clEnqueueCommandBufferKHR = clGetExtensionFunctionAddressForPlatform (
+      platform, "clEnqueueCommandBufferKHR");
+  ext.clReleaseCommandBufferKHR = clGetExtensionFunctionAddressForPlatform (
+      platform, "clReleaseCommandBufferKHR");
+
+  cl_context context = clCreateContext (NULL, 1, &device, NULL, NULL, &err);
+  CHECK_CL_ERROR (err);
+  cl_command_queue queue = clCreateCommandQueue (context, device, 0, &err);
+  CHECK_CL_ERROR (err);
+
+  size_t length = strlen (source);
+  cl_program program
+      = clCreateProgramWithSource (context, 1, &source, &length, &err);
+  CHECK_CL_ERROR (err);
+  CHECK_CL_ERROR (clBuildProgram (program, 1, &device, NULL, NULL, NULL));
+
+  cl_kernel kernels[4];
+  const char *names[4] = { "scale", "bias", "clamp_neg", "shift" };
+  for (unsigned i = 0; i < 4; ++i)
+    {
+      kernels[i] = clCreateKernel (program, names[i], &err);
+      CHECK_CL_ERROR (err);
+    }
+
+  cl_int *input = malloc (size);
+  cl_int *activations = malloc (size);
+  cl_int *expected = malloc (size);
+  cl_int *unfused = malloc (size);
+  cl_int *fused = malloc (size);
+  TEST_ASSERT (input != NULL && activations != NULL && expected != NULL
+               && unfused != NULL && fused != NULL);
+
+  for (cl_int i = 0; i < ITEMS; ++i)
+    input[i] = (i * 7919) % 1001 - 500;
+
+  cl_mem in_buf = clCreateBuffer (context, CL_MEM_READ_ONLY, size, NULL, &err);
+  CHECK_CL_ERROR (err);
+  cl_mem tmp_buf
+      = clCreateBuffer (context, CL_MEM_READ_WRITE, size, NULL, &err);
+  CHECK_CL_ERROR (err);
+  cl_mem act_buf
+      = clCreateBuffer (context, CL_MEM_READ_WRITE, size, NULL, &err);
+  CHECK_CL_ERROR (err);
+  cl_mem out_buf
+      = clCreateBuffer (context, CL_MEM_READ_WRITE, size, NULL, &err);
+  CHECK_CL_ERROR (err);
+  CHECK_CL_ERROR (clEnqueueWriteBuffer (queue, in_buf, CL_TRUE, 0, size,
+                                        input, 0, NULL, NULL));
+
+  cl_int s = 3, b = -100;
+  CHECK_CL_ERROR (clSetKernelArg (kernels[0], 0, sizeof (cl_mem), &in_buf));
+  CHECK_CL_ERROR (clSetKernelArg (kernels[0], 1, sizeof (cl_mem), &tmp_buf));
+  CHECK_CL_ERROR (clSetKernelArg (kernels[0], 2, sizeof (cl_int), &s));
+  CHECK_CL_ERROR (clSetKernelArg (kernels[1], 0, sizeof (cl_mem), &tmp_buf));
+  CHECK_CL_ERROR (clSetKernelArg (kernels[1], 1, sizeof (cl_mem), &act_buf));
+  CHECK_CL_ERROR (clSetKernelArg (kernels[1], 2, sizeof (cl_int), &b));
+  CHECK_CL_ERROR (clSetKernelArg (kernels[2], 0, sizeof (cl_mem), &act_buf));
+  CHECK_CL_ERROR (clSetKernelArg (kernels[3], 0, sizeof (cl_mem), &act_buf));
+  CHECK_CL_ERROR (clSetKernelArg (kernels[3], 1, sizeof (cl_mem), &out_buf));
+
+  for (cl_int i = 0; i < ITEMS; ++i)
+    {
+      cl_int v = input[i] * s + 1 + b;
+      activations[i] = v > 0 ? v : 0;
+    }
+  for (cl_int i = 0; i < ITEMS; ++i)
+    expected[i] = activations[(i + LOCAL_SIZE) % ITEMS] - activations[i];
+
+  setenv ("POCL_CPU_CMDBUF_FUSION", "0", 1);
+  if (run_chain (&ext, queue, kernels, 4, out_buf, unfused) != CL_SUCCESS)
+    return EXIT_FAILURE;
+  setenv ("POCL_CPU_CMDBUF_FUSION", "1", 1);
+  if (run_chain (&ext, queue, kernels, 4, out_buf, fused) != CL_SUCCESS)
+    return EXIT_FAILURE;
+
+  int failed = 0;
+  for (cl_int i = 0; i < ITEMS && !failed; ++i)
+    {
+      if (unfused[i] != expected[i] || fused[i] != unfused[i])
+        {
+          printf ("wrong value at %d: unfused %d fused %d expected %d\n", i,
+                  unfused[i], fused[i], expected[i]);
+          failed = 1;
+        }
+    }
+
+  CHECK_CL_ERROR (clReleaseMemObject (in_buf));
+  CHECK_CL_ERROR (clReleaseMemObject (tmp_buf));
+  CHECK_CL_ERROR (clReleaseMemObject (act_buf));
+  CHECK_CL_ERROR (clReleaseMemObject (out_buf));
+  for (unsigned i = 0; i < 4; ++i)
+    CHECK_CL_ERROR (clReleaseKernel (kernels[i]));
+  CHECK_CL_ERROR (clReleaseProgram (program));
+  CHECK_CL_ERROR (clReleaseCommandQueue (queue));
+  CHECK_CL_ERROR (clReleaseContext (context));
+  CHECK_CL_ERROR (clUnloadPlatformCompiler (platform));
+
+  free (input);
+  free (activations);
+  free (expected);
+  free (unfused);
+  free (fused);
+
+  if (failed)
+    {
+      printf ("FAIL\n");
+      return EXIT_FAILURE;
+    }
+  printf ("OK\n");
+  return EXIT_SUCCESS;
+#else
+  return 77;
+#endif
+}
@@ -31,46 +31,19 @@
 #include "poclu.h"
 
 /**
- * Program arguments (and defaults tram.rgb):
- * 1. width (640)
- * 2. height (480)
- * 3. source image path (input.nv12)
- * 4. reference image path (tram.rgb)
- * 5. (optional) output location of image
+ * Converts the 'input' yuv image to 'output' with a color convert DBK
+ * created for the given formats.
  */
-int
-main (int argc, char const *argv[])
+static int
+convert_image (cl_platform_id platform, cl_context context,
+               cl_device_id *devices, cl_uint num_devices,
+               cl_command_queue queue, int width, int height,
+               pocl_image_format input_format, pocl_image_format output_format,
+               const void *input, size_t input_size, void *output,
+               size_t output_size)
 {
-
-  TEST_ASSERT (argc >= 5);
-
-  errno = 0;
-  char *end_ptr;
-  int width = (int)strtol (argv[1], &end_ptr, 10);
-  printf ("errno: %d, %s, %d\n", errno, strerror (errno), *end_ptr);
-  TEST_ASSERT (errno == 0 && *end_ptr == '\0');
-  int height = (int)strtol (argv[2], &end_ptr, 10);
-  TEST_ASSERT (errno == 0 && *end_ptr == '\0');
-
-  const char *file_name = argv[3];
-  size_t bytes_read = 0;
-  char *input_data = poclu_read_binfile (file_name, &bytes_read);
-  size_t input_size = (size_t)height * width * 3 / 2;
-  TEST_ASSERT (bytes_read == input_size);
-
-  size_t rgb_size = (size_t)height * width * 3;
-
-  cl_platform_id platform = NULL;
-  cl_context context = NULL;
-  cl_device_id *devices = NULL;
-  cl_command_queue *queues = NULL;
-  cl_uint num_devices = 0;
   int status;
 
-  int err = poclu_get_multiple_devices (&platform, &context, 0, &num_devices,
-                                        &devices, &queues, 0);
-  CHECK_OPENCL_ERROR_IN ("poclu_get_multiple_devices");
-
   clCreateProgramWithDefinedBuiltInKernelsEXP_fn createProgramWithDBKs;
   createProgramWithDBKs = (clCreateProgramWithDefinedBuiltInKernelsEXP_fn)
     clGetExtensionFunctionAddressForPlatform (
@@ -81,9 +54,9 @@ main (int argc, char const *argv[])
 
   pocl_image_attr_t input_attrs
     = { width, height, POCL_COLOR_SPACE_BT709, POCL_CHANNEL_RANGE_FULL,
-        POCL_DF_IMAGE_NV12 };
+        input_format };
   pocl_image_attr_t output_attrs = input_attrs;
-  output_attrs.format = POCL_DF_IMAGE_RGB;
+  output_attrs.format = output_format;
   cl_dbk_attributes_img_color_convert_exp convert_attrs
     = { input_attrs, output_attrs };
   const void *attributes[] = { &convert_attrs };
@@ -93,15 +66,17 @@ main (int argc, char const *argv[])
     device_support, &status);
   TEST_ASSERT (status == CL_SUCCESS);
 
-  clBuildProgram (program, num_devices, devices, NULL, NULL, NULL);
+  status = clBuildProgram (program, num_devices, devices, NULL, NULL, NULL);
   TEST_ASSERT (status == CL_SUCCESS);
 
   /* setup kernel */
 
   cl_mem input_buf
     = clCreateBuffer (context, CL_MEM_READ_ONLY, input_size, NULL, &status);
-  cl_mem output_buf
-    = clCreateBuffer (context, CL_MEM_READ_WRITE, rgb_size, NULL, &status);
+  TEST_ASSERT (status == CL_SUCCESS);
+  cl_mem output_buf = clCreateBuffer (context, CL_MEM_READ_WRITE, output_size,
+                                      NULL, &status);
+  TEST_ASSERT (status == CL_SUCCESS);
 
   cl_kernel convert_kernel
     = clCreateKernel (program, kernel_names[0], &status);
@@ -113,44 +88,158 @@ main (int argc, char const *argv[])
 
   /* run kernel */
   cl_event write_event;
-  clEnqueueWriteBuffer (queues[0], input_buf, CL_TRUE, 0, input_size,
-                        input_data, 0, NULL, &write_event);
+  clEnqueueWriteBuffer (queue, input_buf, CL_TRUE, 0, input_size, input, 0,
+                        NULL, &write_event);
 
   size_t global_work_size[] = { 1 };
   cl_event wait_events[] = { write_event };
   size_t wait_event_size = sizeof (wait_events) / sizeof (wait_events[0]);
   cl_event enqueue_event;
 
-  clEnqueueNDRangeKernel (queues[0], convert_kernel, 1, NULL, global_work_size,
+  clEnqueueNDRangeKernel (queue, convert_kernel, 1, NULL, global_work_size,
                           NULL, wait_event_size, wait_events, &enqueue_event);
 
-  void *output_array = malloc (rgb_size);
-  clEnqueueReadBuffer (queues[0], output_buf, CL_TRUE, 0, rgb_size,
-                       output_array, 1, &enqueue_event, NULL);
-
-  if (argc > 5)
-    poclu_write_binfile (argv[5], output_array, rgb_size);
+  status = clEnqueueReadBuffer (queue, output_buf, CL_TRUE, 0, output_size,
+                                output, 1, &enqueue_event, NULL);
+  TEST_ASSERT (status == CL_SUCCESS);
 
   cl_event all_events[] = { enqueue_event, write_event };
   size_t all_events_size = sizeof (all_events) / sizeof (all_events[0]);
   clWaitForEvents (all_events_size, all_events);
   for (size_t i = 0; i < all_events_size; i++)
-      clReleaseEvent (all_events[i]);
+    clReleaseEvent (all_events[i]);
+
+  clReleaseMemObject (input_buf);
+  clReleaseMemObject (output_buf);
+  clReleaseKernel (convert_kernel);
+  clReleaseProgram (program);
+  return CL_SUCCESS;
+}
+
+/**
+ * Program arguments (and defaults tram.rgb):
+ * 1. width (640)
+ * 2. height (480)
+ * 3. source image path (input.nv12)
+ * 4. reference image path (tram.rgb)
+ * 5. (optional) output location of image
+ */
+int
+main (int argc, char const *argv[])
+{
+
+  TEST_ASSERT (argc >= 5);
+
+  errno = 0;
+  char *end_ptr;
+  int width = (int)strtol (argv[1], &end_ptr, 10);
+  printf ("errno: %d, %s, %d\n", errno, strerror (errno), *end_ptr);
+  TEST_ASSERT (errno == 0 && *end_ptr == '\0');
+  int height = (int)strtol (argv[2], &end_ptr, 10);
+  TEST_ASSERT (errno == 0 && *end_ptr == '\0');
+  /* the yuv formats are converted from nv12 assuming even sizes */
+  TEST_ASSERT (width % 2 == 0 && height % 2 == 0);
+
+  const char *file_name = argv[3];
+  size_t bytes_read = 0;
+  char *input_data = poclu_read_binfile (file_name, &bytes_read);
+  size_t tot_pixels = (size_t)height * width;
+  size_t input_size = tot_pixels * 3 / 2;
+  TEST_ASSERT (bytes_read == input_size);
+
+  size_t rgb_size = tot_pixels * 3;
+
+  cl_platform_id platform = NULL;
+  cl_context context = NULL;
+  cl_device_id *devices = NULL;
+  cl_command_queue *queues = NULL;
+  cl_uint num_devices = 0;
 
-  void *reference_data = malloc (rgb_size);
-  reference_data = poclu_read_binfile (argv[4], &bytes_read);
+  int err = poclu_get_multiple_devices (&platform, &context, 0, &num_devices,
+                                        &devices, &queues, 0);
+  CHECK_OPENCL_ERROR_IN ("poclu_get_multiple_devices");
+
+  uint8_t *output_array = malloc (rgb_size);
+  TEST_ASSERT (output_array != NULL);
+  convert_image (platform, context, devices, num_devices, queues[0], width,
+                 height, POCL_DF_IMAGE_NV12, POCL_DF_IMAGE_RGB, input_data,
+                 input_size, output_array, rgb_size);
+
+  if (argc > 5)
+    poclu_write_binfile (argv[5], (char *)output_array, rgb_size);
+
+  char *reference_data = poclu_read_binfile (argv[4], &bytes_read);
   TEST_ASSERT (rgb_size == bytes_read);
-  double psnr = calculate_PSNR (width, height, 3, (uint8_t *)output_array,
-                                reference_data);
+  double psnr = calculate_PSNR (width, height, 3, output_array,
+                                (uint8_t *)reference_data);
   TEST_ASSERT (psnr > 25);
 
+  /* The other yuv formats hold the same samples as the nv12 image, and the
+   * other rgb formats the same channels as the rgb result. */
+  size_t chroma_pixels = tot_pixels / 4;
+  char *yuv_data = malloc (input_size);
+  uint8_t *rgbx_array = malloc (tot_pixels * 4);
+  TEST_ASSERT (yuv_data != NULL && rgbx_array != NULL);
+  pocl_image_format input_formats[]
+    = { POCL_DF_IMAGE_NV12, POCL_DF_IMAGE_NV21, POCL_DF_IMAGE_IYUV };
+  pocl_image_format output_formats[]
+    = { POCL_DF_IMAGE_RGB, POCL_DF_IMAGE_RGBA, POCL_DF_IMAGE_BGRA };
+  for (size_t i = 0; i < sizeof (input_formats) / sizeof (input_formats[0]);
+       ++i)
+    {
+      memcpy (yuv_data, input_data, tot_pixels);
+      const char *uv = input_data + tot_pixels;
+      char *chroma = yuv_data + tot_pixels;
+      for (size_t c = 0; c < chroma_pixels; ++c)
+        {
+          switch (input_formats[i])
+            {
+            case POCL_DF_IMAGE_NV12:
+              chroma[2 * c] = uv[2 * c];
+              chroma[2 * c + 1] = uv[2 * c + 1];
+              break;
+            case POCL_DF_IMAGE_NV21:
+              chroma[2 * c] = uv[2 * c + 1];
+              chroma[2 * c + 1] = uv[2 * c];
+              break;
+            default:
+              chroma[c] = uv[2 * c];
+              chroma[chroma_pixels + c] = uv[2 * c + 1];
+              break;
+            }
+        }
+
+      for (size_t o = 0;
+           o < sizeof (output_formats) / sizeof (output_formats[0]); ++o)
+        {
+          int channels = output_formats[o] == POCL_DF_IMAGE_RGB ? 3 : 4;
+          int swap_rb = output_formats[o] == POCL_DF_IMAGE_BGRA;
+          convert_image (platform, context, devices, num_devices, queues[0],
+                         width, height, input_formats[i], output_formats[o],
+                         yuv_data, input_size, rgbx_array,
+                         tot_pixels * channels);
+          for (size_t p = 0; p < tot_pixels; ++p)
+            {
+              const uint8_t *px = rgbx_array + p * channels;
+              const uint8_t *ref = output_array + p * 3;
+              if (px[swap_rb ? 2 : 0] != ref[0] || px[1] != ref[1]
+                  || px[swap_rb ? 0 : 2] != ref[2]
+                  || (channels == 4 && px[3] != 255))
+                {
+                  printf ("FAIL: input format %d, output format %d, pixel "
+                          "%zu differs\n",
+                          input_formats[i], output_formats[o], p);
+                  return EXIT_FAILURE;
+                }
+            }
+        }
+    }
+
   free (input_data);
+  free (yuv_data);
   free (output_array);
+  free (rgbx_array);
   free (reference_data);
-  clReleaseMemObject (input_buf);
-  clReleaseMemObject (output_buf);
-  clReleaseKernel (convert_kernel);
-  clReleaseProgram (program);
   clReleaseContext (context);
   for (cl_uint i = 0; i < num_devices; i++)
     {
@@ -158,4 +247,4 @@ main (int argc, char const *argv[])
       clReleaseCommandQueue (queues[i]);
     }
   printf ("OK\n");
-}
\ No newline at end of file
+}
@@ -22,12 +22,25 @@
 
 #include "dbk_utils.hh"
 
+#include <algorithm>
 #include <iostream>
 #include <numeric>
 #include <random>
 #include <string>
 #include <vector>
 
+static bool checkResult(const std::vector<float> &Result) {
+  float Ref = 1.0f;
+  for (unsigned I = 0, E = Result.size(); I < E; I++, Ref += 1.0f) {
+    if (Result.at(I) != Ref) {
+      std::cerr << "error: mismatch at [" << I << "]: Expected '" << Ref
+                << "'. Got '" << Result.at(I) << "'\n";
+      return false;
+    }
+  }
+  return true;
+}
+
 int main() {
   cl_int Status;
   cl::Platform Platform;
@@ -91,14 +104,76 @@ int main() {
   Status = CmdQ.finish();
   TEST_ASSERT(Status == CL_SUCCESS);
 
-  float Ref = 1.0f;
-  for (unsigned I = 0, E = Result.size(); I < E; I++, Ref += 1.0f) {
-    if (Result.at(I) != Ref) {
-      std::cerr << "error: mismatch at [" << I << "]: Expected '" << Ref
-                << "'. Got '" << Result.at(I) << "'\n";
+  if (!checkResult(Result))
+    return 1;
+
+  // Replay the conversions from a command buffer, whose DBKs are executed
+  // by the CPU drivers separately from the enqueued ones.
+  if (Dev.getInfo<CL_DEVICE_EXTENSIONS>().find("cl_khr_command_buffer") ==
+      std::string::npos)
+    return 0;
+
+  cl_platform_id PlatformId = Platform();
+  auto CreateCommandBuffer =
+      reinterpret_cast<clCreateCommandBufferKHR_fn>(
+          clGetExtensionFunctionAddressForPlatform(
+              PlatformId, "clCreateCommandBufferKHR"));
+  auto CommandNDRangeKernel =
+      reinterpret_cast<clCommandNDRangeKernelKHR_fn>(
+          clGetExtensionFunctionAddressForPlatform(
+              PlatformId, "clCommandNDRangeKernelKHR"));
+  auto FinalizeCommandBuffer =
+      reinterpret_cast<clFinalizeCommandBufferKHR_fn>(
+          clGetExtensionFunctionAddressForPlatform(
+              PlatformId, "clFinalizeCommandBufferKHR"));
+  auto EnqueueCommandBuffer =
+      reinterpret_cast<clEnqueueCommandBufferKHR_fn>(
+          clGetExtensionFunctionAddressForPlatform(
+              PlatformId, "clEnqueueCommandBufferKHR"));
+  auto ReleaseCommandBuffer =
+      reinterpret_cast<clReleaseCommandBufferKHR_fn>(
+          clGetExtensionFunctionAddressForPlatform(
+              PlatformId, "clReleaseCommandBufferKHR"));
+  TEST_ASSERT(CreateCommandBuffer && CommandNDRangeKernel &&
+              FinalizeCommandBuffer && EnqueueCommandBuffer &&
+              ReleaseCommandBuffer);
+
+  cl_command_queue Queue = CmdQ();
+  cl_command_buffer_khr CmdBuf =
+      CreateCommandBuffer(1, &Queue, nullptr, &Status);
+  TEST_ASSERT(Status == CL_SUCCESS);
+
+  size_t GlobalSize[2] = {1, 1};
+  cl_sync_point_khr CvtSyncPoint;
+  Status = CommandNDRangeKernel(CmdBuf, nullptr, nullptr,
+                                ConvertKernels.at(0)(), 2, nullptr,
+                                GlobalSize, nullptr, 0, nullptr,
+                                &CvtSyncPoint, nullptr);
+  TEST_ASSERT(Status == CL_SUCCESS);
+  Status = CommandNDRangeKernel(CmdBuf, nullptr, nullptr,
+                                ConvertKernels.at(1)(), 2, nullptr,
+                                GlobalSize, nullptr, 1, &CvtSyncPoint,
+                                nullptr, nullptr);
+  TEST_ASSERT(Status == CL_SUCCESS);
+  Status = FinalizeCommandBuffer(CmdBuf);
+  TEST_ASSERT(Status == CL_SUCCESS);
+
+  for (unsigned Replay = 0; Replay < 2; ++Replay) {
+    std::fill(Result.begin(), Result.end(), 0.0f);
+    Status = CmdQ.enqueueWriteBuffer(OutputTensor, CL_FALSE, 0,
+                                     DescF32.getStorageSize(), Result.data());
+    TEST_ASSERT(Status == CL_SUCCESS);
+    Status = EnqueueCommandBuffer(0, nullptr, CmdBuf, 0, nullptr, nullptr);
+    TEST_ASSERT(Status == CL_SUCCESS);
+    Status = CmdQ.enqueueReadBuffer(OutputTensor, CL_TRUE, 0,
+                                    DescF32.getStorageSize(), Result.data());
+    TEST_ASSERT(Status == CL_SUCCESS);
+    if (!checkResult(Result))
       return 1;
-    }
   }
 
+  Status = ReleaseCommandBuffer(CmdBuf);
+  TEST_ASSERT(Status == CL_SUCCESS);
+
   return 0;
 }
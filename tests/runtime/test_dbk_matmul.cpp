@@ -216,6 +216,71 @@ static void testMatmulF16F32(int Case) {
                4);
 }
 
+// Test: batched row-major matmul with shapes which are not multiples of the
+// register and cache block sizes of the implementations. The elements are
+// small integers so the float results are exact.
+static void testBatchedMatmul(unsigned Batch, unsigned M, unsigned N,
+                              unsigned K) {
+  std::mt19937 Gen(1234);
+  std::uniform_int_distribution<int> Dist(-2, 2);
+  std::vector<float> AData(Batch * M * K), BData(Batch * K * N);
+  for (auto &X : AData)
+    X = Dist(Gen);
+  for (auto &X : BData)
+    X = Dist(Gen);
+  std::vector<float> Result(Batch * M * N, 9999.0f);
+
+  TensorDesc ATDesc({Batch, M, K}, CL_TENSOR_DTYPE_FP32_EXP);
+  TensorDesc BTDesc({Batch, K, N}, CL_TENSOR_DTYPE_FP32_EXP);
+  TensorDesc CTDesc({Batch, M, N}, CL_TENSOR_DTYPE_FP32_EXP);
+  TensorLayoutBLAS DL({2u, 1u});
+  ATDesc.setLayout(DL);
+  BTDesc.setLayout(DL);
+  CTDesc.setLayout(DL);
+
+  cl_dbk_attributes_matmul_exp Attrs;
+  memcpy(&Attrs.a, ATDesc.get(), sizeof(cl_tensor_desc_exp));
+  memcpy(&Attrs.b, BTDesc.get(), sizeof(cl_tensor_desc_exp));
+  memcpy(&Attrs.c, CTDesc.get(), sizeof(cl_tensor_desc_exp));
+  Attrs.trans_a = false;
+  Attrs.trans_b = false;
+  memset(Attrs.kernel_props, 0, sizeof(Attrs.kernel_props));
+
+  cl::Program MatmulProg;
+  cl::Kernel MatmulKernel;
+  std::tie(MatmulProg, MatmulKernel) =
+      assertCreateDBK(Ctx, Dev, CL_DBK_MATMUL_EXP, "batched_matmul", Attrs);
+
+  cl_int Status;
+  auto ATensor = createTensor(Ctx, ATDesc, AData.data(), &Status);
+  TEST_ASSERT(Status == CL_SUCCESS);
+  auto BTensor = createTensor(Ctx, BTDesc, BData.data(), &Status);
+  TEST_ASSERT(Status == CL_SUCCESS);
+  auto CTensor = createTensor(Ctx, CTDesc, Result.data(), &Status);
+  TEST_ASSERT(Status == CL_SUCCESS);
+
+  MatmulKernel.setArg(0, ATensor);
+  MatmulKernel.setArg(1, BTensor);
+  MatmulKernel.setArg(2, CTensor);
+
+  Status = CmdQ.enqueueNDRangeKernel(MatmulKernel, cl::NullRange,
+                                     cl::NDRange{1, 1}, cl::NullRange);
+  TEST_ASSERT(Status == CL_SUCCESS);
+  Status = CmdQ.enqueueReadBuffer(CTensor, CL_TRUE, 0,
+                                  CTDesc.getStorageSize(), Result.data());
+  TEST_ASSERT(Status == CL_SUCCESS);
+
+  std::vector<float> Expected(Batch * M * N, 0.0f);
+  for (unsigned B = 0; B < Batch; B++)
+    for (unsigned I = 0; I < M; I++)
+      for (unsigned P = 0; P < K; P++)
+        for (unsigned J = 0; J < N; J++)
+          Expected[(B * M + I) * N + J] +=
+              AData[(B * M + I) * K + P] * BData[(B * K + P) * N + J];
+
+  check2DSlice(Batch * M, N, Result, N, Expected, N);
+}
+
 int main() {
   std::tie(Platform, Dev, DevName) = findDeviceWithDBK("matmul_exp");
   bool isCustom = Dev.getInfo<CL_DEVICE_TYPE>() == CL_DEVICE_TYPE_CUSTOM;
@@ -366,6 +431,11 @@ int main() {
     check2DSlice(2, 2, Result, 2, {2.0f, -6.0f, 6.0f, 7.0f}, 2);
   }
 
+  if (DevSupportsRowMajor && !DevUsesLayoutTypeML) {
+    std::cout << "--- Matmul 9 ---" << std::endl;
+    testBatchedMatmul(3, 101, 263, 300);
+  }
+
   // CPU driver fails this test.
   if (DeviceIsIntelNPU) {
     std::cout << "--- Matmul 7  ---" << std::endl;
@@ -0,0 +1,201 @@
+/* Tests launches that change only some kernel arguments around command buffers
+
+   Copyright (c) 2026 PoCL developers
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "poclu.h"
+
+#define STR(x) #x
+
+/*
+  The remote driver sends only the changed arguments of a kernel launch, and
+  pocld merges them into the arguments of the previous launch. Command
+  buffers set other arguments to the same kernel on the server, when they
+  are recorded and, if pocld emulates them, at each replay. The launches
+  after them must still run with their own arguments. With two devices the
+  command buffer spans both of their queues, which pocld emulates on
+  backends without multi-device command buffers.
+*/
+
+#define ITEMS 1024
+
+static const char *source = STR (kernel void add (global int *out, int v) {
+  out[get_global_id (0)] += v;
+});
+
+static int
+check_buffer (cl_command_queue queue, cl_mem buf, cl_int expected,
+              const char *what)
+{
+  cl_int data[ITEMS];
+  CHECK_CL_ERROR (clEnqueueReadBuffer (queue, buf, CL_TRUE, 0, sizeof (data),
+                                       data, 0, NULL, NULL));
+  for (unsigned i = 0; i < ITEMS; ++i)
+    {
+      if (data[i] != expected)
+        {
+          printf ("%s: wrong value %d at %u, expected %d\n", what, data[i], i,
+                  expected);
+          return 1;
+        }
+    }
+  return 0;
+}
+
+int
+main (void)
+{
+#if defined(cl_khr_command_buffer) && cl_khr_command_buffer == 1
+  cl_platform_id platform = NULL;
+  cl_context context = NULL;
+  cl_device_id *devices = NULL;
+  cl_command_queue *queues = NULL;
+  cl_uint num_devices = 0;
+  size_t global = ITEMS;
+  int err, failed = 0;
+
+  err = poclu_get_multiple_devices (&platform, &context, 0, &num_devices,
+                                    &devices, &queues, 0);
+  CHECK_OPENCL_ERROR_IN ("poclu_get_multiple_devices");
+
+  clCreateCommandBufferKHR_fn createCommandBuffer
+      = clGetExtensionFunctionAddressForPlatform (platform,
+                                                  "clCreateCommandBufferKHR");
+  clCommandNDRangeKernelKHR_fn commandNDRangeKernel
+      = clGetExtensionFunctionAddressForPlatform (platform,
+                                                  "clCommandNDRangeKernelKHR");
+  clFinalizeCommandBufferKHR_fn finalizeCommandBuffer
+      = clGetExtensionFunctionAddressForPlatform (
+          platform, "clFinalizeCommandBufferKHR");
+  clEnqueueCommandBufferKHR_fn enqueueCommandBuffer
+      = clGetExtensionFunctionAddressForPlatform (platform,
+                                                  "clEnqueueCommandBufferKHR");
+  clReleaseCommandBufferKHR_fn releaseCommandBuffer
+      = clGetExtensionFunctionAddressForPlatform (platform,
+                                                  "clReleaseCommandBufferKHR");
+  if (createCommandBuffer == NULL)
+    {
+      printf ("Command buffers are not supported, skipping test\n");
+      return 77;
+    }
+
+  cl_program program = clCreateProgramWithSource (context, 1, &source, NULL,
+                                                  &err);
+  CHECK_OPENCL_ERROR_IN ("clCreateProgramWithSource");
+  CHECK_CL_ERROR (
+      clBuildProgram (program, num_devices, devices, NULL, NULL, NULL));
+  cl_kernel kernel = clCreateKernel (program, "add", &err);
+  CHECK_OPENCL_ERROR_IN ("clCreateKernel");
+
+  cl_int zero = 0;
+  cl_mem a = clCreateBuffer (context, CL_MEM_READ_WRITE,
+                             ITEMS * sizeof (cl_int), NULL, &err);
+  CHECK_OPENCL_ERROR_IN ("clCreateBuffer");
+  cl_mem b = clCreateBuffer (context, CL_MEM_READ_WRITE,
+                             ITEMS * sizeof (cl_int), NULL, &err);
+  CHECK_OPENCL_ERROR_IN ("clCreateBuffer");
+  CHECK_CL_ERROR (clEnqueueFillBuffer (queues[0], a, &zero, sizeof (zero), 0,
+                                       ITEMS * sizeof (cl_int), 0, NULL,
+                                       NULL));
+  CHECK_CL_ERROR (clEnqueueFillBuffer (queues[0], b, &zero, sizeof (zero), 0,
+                                       ITEMS * sizeof (cl_int), 0, NULL,
+                                       NULL));
+
+  /* the first launch sends all the arguments: a += 1 */
+  cl_int v = 1;
+  CHECK_CL_ERROR (clSetKernelArg (kernel, 0, sizeof (cl_mem), &a));
+  CHECK_CL_ERROR (clSetKernelArg (kernel, 1, sizeof (cl_int), &v));
+  CHECK_CL_ERROR (clEnqueueNDRangeKernel (queues[0], kernel, 1, NULL, &global,
+                                          NULL, 0, NULL, NULL));
+  CHECK_CL_ERROR (clFinish (queues[0]));
+
+  /* a command buffer running b += 10 */
+  v = 10;
+  CHECK_CL_ERROR (clSetKernelArg (kernel, 0, sizeof (cl_mem), &b));
+  CHECK_CL_ERROR (clSetKernelArg (kernel, 1, sizeof (cl_int), &v));
+  cl_command_buffer_khr cmdbuf = NULL;
+  if (num_devices > 1)
+    cmdbuf = createCommandBuffer (2, queues, NULL, &err);
+  if (cmdbuf == NULL)
+    {
+      cmdbuf = createCommandBuffer (1, queues, NULL, &err);
+      CHECK_OPENCL_ERROR_IN ("clCreateCommandBufferKHR");
+    }
+  CHECK_CL_ERROR (commandNDRangeKernel (cmdbuf, queues[0], NULL, kernel, 1,
+                                        NULL, &global, NULL, 0, NULL, NULL,
+                                        NULL));
+  CHECK_CL_ERROR (finalizeCommandBuffer (cmdbuf));
+  CHECK_CL_ERROR (enqueueCommandBuffer (0, NULL, cmdbuf, 0, NULL, NULL));
+  CHECK_CL_ERROR (clFinish (queues[0]));
+
+  /* back to a, which sends all the arguments again: a += 1 */
+  v = 1;
+  CHECK_CL_ERROR (clSetKernelArg (kernel, 0, sizeof (cl_mem), &a));
+  CHECK_CL_ERROR (clSetKernelArg (kernel, 1, sizeof (cl_int), &v));
+  CHECK_CL_ERROR (clEnqueueNDRangeKernel (queues[0], kernel, 1, NULL, &global,
+                                          NULL, 0, NULL, NULL));
+  CHECK_CL_ERROR (clFinish (queues[0]));
+
+  /* replay (b += 10), then a launch which changes only v: a += 3 */
+  CHECK_CL_ERROR (enqueueCommandBuffer (0, NULL, cmdbuf, 0, NULL, NULL));
+  CHECK_CL_ERROR (clFinish (queues[0]));
+  v = 3;
+  CHECK_CL_ERROR (clSetKernelArg (kernel, 1, sizeof (cl_int), &v));
+  CHECK_CL_ERROR (clEnqueueNDRangeKernel (queues[0], kernel, 1, NULL, &global,
+                                          NULL, 0, NULL, NULL));
+  CHECK_CL_ERROR (clFinish (queues[0]));
+
+  /* replay (b += 10), then a launch with unchanged arguments: a += 3 */
+  CHECK_CL_ERROR (enqueueCommandBuffer (0, NULL, cmdbuf, 0, NULL, NULL));
+  CHECK_CL_ERROR (clFinish (queues[0]));
+  CHECK_CL_ERROR (clEnqueueNDRangeKernel (queues[0], kernel, 1, NULL, &global,
+                                          NULL, 0, NULL, NULL));
+  CHECK_CL_ERROR (clFinish (queues[0]));
+
+  failed |= check_buffer (queues[0], a, 1 + 1 + 3 + 3, "a");
+  failed |= check_buffer (queues[0], b, 10 + 10 + 10, "b");
+
+  CHECK_CL_ERROR (releaseCommandBuffer (cmdbuf));
+  CHECK_CL_ERROR (clReleaseMemObject (a));
+  CHECK_CL_ERROR (clReleaseMemObject (b));
+  CHECK_CL_ERROR (clReleaseKernel (kernel));
+  CHECK_CL_ERROR (clReleaseProgram (program));
+  for (cl_uint i = 0; i < num_devices; ++i)
+    CHECK_CL_ERROR (clReleaseCommandQueue (queues[i]));
+  CHECK_CL_ERROR (clReleaseContext (context));
+  free (devices);
+  free (queues);
+
+  if (failed)
+    {
+      printf ("FAIL\n");
+      return EXIT_FAILURE;
+    }
+  printf ("OK\n");
+  return EXIT_SUCCESS;
+#else
+  return 77;
+#endif
+}
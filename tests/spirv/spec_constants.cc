@@ -0,0 +1,126 @@
+/* spec_constants.cc - Builds the same SPIR-V with different spec constants.
+
+   Copyright (c) 2026 PoCL developers
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+*/
+
+// The SPIR-V translations are cached in memory, keyed also by the values
+// of the specialization constants. Programs created from the same SPIR-V
+// with different values, and with the default one, must each get their own
+// translation, also when they are built one after another.
+
+#include <CL/cl.h>
+
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#define CHECK_ERR(X) do {					\
+    if ((X) != CL_SUCCESS) {					\
+      std::cerr << #X "ERROR at " << __LINE__ << std::endl;	\
+      abort();							\
+    } } while (0)
+
+#define ITEMS 64
+
+// Builds the SPIR-V setting SpecId 0 to Value (unless it's null), runs the
+// kernel and checks that every item stored the expected value.
+static bool runWithSpecConst(cl_context Context, cl_device_id Device,
+                             cl_command_queue Queue,
+                             const std::vector<char> &IL, const cl_uint *Value,
+                             cl_uint Expected) {
+  cl_int Err;
+  cl_program Program =
+      clCreateProgramWithIL(Context, IL.data(), IL.size(), &Err);
+  CHECK_ERR(Err);
+  if (Value != nullptr)
+    CHECK_ERR(clSetProgramSpecializationConstant(Program, 0, sizeof(cl_uint),
+                                                 Value));
+  CHECK_ERR(clBuildProgram(Program, 1, &Device, "", NULL, NULL));
+
+  cl_kernel Kernel = clCreateKernel(Program, "spec_const", &Err);
+  CHECK_ERR(Err);
+  cl_mem Buffer = clCreateBuffer(Context, CL_MEM_WRITE_ONLY,
+                                 ITEMS * sizeof(cl_uint), NULL, &Err);
+  CHECK_ERR(Err);
+  CHECK_ERR(clSetKernelArg(Kernel, 0, sizeof(cl_mem), &Buffer));
+
+  size_t GlobalSize = ITEMS;
+  CHECK_ERR(clEnqueueNDRangeKernel(Queue, Kernel, 1, NULL, &GlobalSize, NULL,
+                                   0, NULL, NULL));
+  std::vector<cl_uint> Result(ITEMS);
+  CHECK_ERR(clEnqueueReadBuffer(Queue, Buffer, CL_TRUE, 0,
+                                ITEMS * sizeof(cl_uint), Result.data(), 0,
+                                NULL, NULL));
+
+  CHECK_ERR(clReleaseMemObject(Buffer));
+  CHECK_ERR(clReleaseKernel(Kernel));
+  CHECK_ERR(clReleaseProgram(Program));
+
+  for (size_t i = 0; i < ITEMS; ++i) {
+    if (Result[i] != Expected) {
+      std::cout << "Wrong value " << Result[i] << " at " << i << ", expected "
+                << Expected << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int, char **) {
+
+  cl_platform_id Platform;
+  cl_device_id Device;
+  cl_int Err;
+
+  CHECK_ERR(clGetPlatformIDs(1, &Platform, NULL));
+  CHECK_ERR(clGetDeviceIDs(Platform, CL_DEVICE_TYPE_ALL, 1, &Device, NULL));
+
+  cl_context Context = clCreateContext(NULL, 1, &Device, NULL, NULL, &Err);
+  CHECK_ERR(Err);
+  cl_command_queue Queue =
+      clCreateCommandQueueWithProperties(Context, Device, 0, &Err);
+  CHECK_ERR(Err);
+
+  std::ifstream File(SRCDIR "/spec-constants.spv",
+                     std::ios::binary | std::ios::ate);
+  std::streamsize Binsize = File.tellg();
+  File.seekg(0, std::ios::beg);
+
+  std::vector<char> IL(Binsize);
+  if (!File.read(IL.data(), Binsize))
+    return EXIT_FAILURE;
+
+  const cl_uint First = 11, Second = 22;
+  bool Ok = runWithSpecConst(Context, Device, Queue, IL, &First, First) &&
+            runWithSpecConst(Context, Device, Queue, IL, &Second, Second) &&
+            runWithSpecConst(Context, Device, Queue, IL, nullptr, 7) &&
+            runWithSpecConst(Context, Device, Queue, IL, &First, First);
+
+  CHECK_ERR(clReleaseCommandQueue(Queue));
+  CHECK_ERR(clReleaseContext(Context));
+
+  if (!Ok) {
+    std::cout << "FAIL" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "OK" << std::endl;
+  return EXIT_SUCCESS;
+}
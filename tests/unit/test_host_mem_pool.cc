@@ -0,0 +1,160 @@
+// Check the reuse and release of the host buffer pool allocations.
+//
+// Copyright (c) 2026 PoCL Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "config.h"
+#include "pocl_host_mem_pool.h"
+
+#include <CL/cl.h>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#define TEST_ASSERT(expr)                                                      \
+  if (!(expr)) {                                                               \
+    std::cout << __FILE__ << ":" << __LINE__ << ": "                           \
+              << "Assertion failure: '" << #expr << std::endl;                 \
+    std::exit(1);                                                              \
+  }
+
+static const size_t KiB = 1024;
+static const size_t MiB = 1024 * KiB;
+static const size_t PageSize = 4096;
+
+// The pool keeps at most this much of the freed allocations.
+static const size_t MaxRetainedMB = 8;
+
+// Returns true if the page at Ptr is mapped.
+static bool isMapped(void *Ptr) {
+  unsigned char Vec;
+  return mincore(Ptr, PageSize, &Vec) == 0;
+}
+
+static void *allocAndTouch(size_t Size) {
+  void *Ptr = pocl_host_mem_alloc(PageSize, Size);
+  TEST_ASSERT(Ptr != nullptr);
+  TEST_ASSERT((uintptr_t)Ptr % PageSize == 0);
+  std::memset(Ptr, 0xAB, Size);
+  return Ptr;
+}
+
+// Allocations of the same size class get the freed region back, those of
+// other classes do not.
+void TestSizeClassReuse() {
+  void *A = allocAndTouch(200 * KiB);
+  pocl_host_mem_free(A, PageSize, 200 * KiB);
+  TEST_ASSERT(isMapped(A));
+
+  // 256 KiB is in the same class as 200 KiB.
+  void *B = allocAndTouch(256 * KiB);
+  TEST_ASSERT(B == A);
+
+  // 300 KiB is in the next class.
+  void *C = allocAndTouch(300 * KiB);
+  TEST_ASSERT(C != A);
+
+  pocl_host_mem_free(B, PageSize, 256 * KiB);
+  pocl_host_mem_free(C, PageSize, 300 * KiB);
+}
+
+// The allocations of 2 MiB or more are aligned to the huge page size and
+// reused like the smaller ones.
+void TestHugeReuse() {
+  const size_t Size = 3 * MiB;
+  void *A = allocAndTouch(Size);
+  TEST_ASSERT((uintptr_t)A % (2 * MiB) == 0);
+  pocl_host_mem_free(A, PageSize, Size);
+  void *B = allocAndTouch(Size - 100 * KiB);
+  TEST_ASSERT(B == A);
+  pocl_host_mem_free(B, PageSize, Size - 100 * KiB);
+}
+
+// Freed allocations beyond POCL_HOST_MEM_POOL_MAX_MB are unmapped, the ones
+// within it are kept mapped and handed out again. Returns the reused
+// allocations, which are kept until the end so that the pool is empty for
+// the other tests.
+std::vector<void *> TestRetentionCap() {
+  const size_t Size = 2 * MiB;
+  // One more than fits in the cap.
+  const unsigned Count = MaxRetainedMB / 2 + 1;
+  std::vector<void *> Ptrs;
+  for (unsigned i = 0; i < Count; ++i)
+    Ptrs.push_back(allocAndTouch(Size));
+
+  for (void *Ptr : Ptrs)
+    pocl_host_mem_free(Ptr, PageSize, Size);
+
+  // The last one didn't fit in the cap.
+  for (unsigned i = 0; i + 1 < Count; ++i)
+    TEST_ASSERT(isMapped(Ptrs[i]));
+  TEST_ASSERT(!isMapped(Ptrs[Count - 1]));
+
+  // The retained ones are reused, most recently freed first.
+  std::vector<void *> Reused;
+  for (unsigned i = Count - 1; i > 0; --i) {
+    Reused.push_back(allocAndTouch(Size));
+    TEST_ASSERT(Reused.back() == Ptrs[i - 1]);
+  }
+  return Reused;
+}
+
+// Small and over-aligned allocations bypass the pool.
+void TestUnpooled() {
+  void *Small = pocl_host_mem_alloc(64, 64 * KiB);
+  TEST_ASSERT(Small != nullptr && (uintptr_t)Small % 64 == 0);
+  pocl_host_mem_free(Small, 64, 64 * KiB);
+
+  void *Aligned = pocl_host_mem_alloc(64 * KiB, 512 * KiB);
+  TEST_ASSERT(Aligned != nullptr && (uintptr_t)Aligned % (64 * KiB) == 0);
+  pocl_host_mem_free(Aligned, 64 * KiB, 512 * KiB);
+}
+
+int main() {
+  setenv("POCL_HOST_MEM_POOL", "1", 1);
+  setenv("POCL_HOST_MEM_POOL_MAX_MB", std::to_string(MaxRetainedMB).c_str(),
+         1);
+  // MAP_HUGETLB would depend on the huge pages reserved in the system.
+  setenv("POCL_HOST_MEM_POOL_HUGETLB", "0", 1);
+
+  // The pool is set up with the devices.
+  cl_platform_id Platform;
+  cl_uint NumDevices;
+  TEST_ASSERT(clGetPlatformIDs(1, &Platform, nullptr) == CL_SUCCESS);
+  TEST_ASSERT(clGetDeviceIDs(Platform, CL_DEVICE_TYPE_ALL, 0, nullptr,
+                             &NumDevices) == CL_SUCCESS);
+
+  std::vector<void *> Held = TestRetentionCap();
+  TestSizeClassReuse();
+  TestHugeReuse();
+  TestUnpooled();
+
+  for (void *Ptr : Held)
+    pocl_host_mem_free(Ptr, PageSize, 2 * MiB);
+
+  std::cout << "OK" << std::endl;
+  return 0;
+}
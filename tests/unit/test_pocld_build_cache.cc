@@ -0,0 +1,162 @@
+// Check the lookups, invalidation and eviction of the pocld program builds.
+//
+// Copyright (c) 2026 PoCL Developers
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "config.h"
+#include "build_cache.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define TEST_ASSERT(expr)                                                      \
+  if (!(expr)) {                                                               \
+    std::cout << __FILE__ << ":" << __LINE__ << ": "                           \
+              << "Assertion failure: '" << #expr << std::endl;                 \
+    std::exit(1);                                                              \
+  }
+
+static const char Source[] = "kernel void a(global int *p) { *p = 1; }\n"
+                             "kernel void b(global int *p) { *p = 2; }\n";
+static const std::string Options = "-cl-fast-relaxed-math -cl-kernel-arg-info";
+static const std::vector<std::string> Devices = {"cpu-0", "cpu-1"};
+
+static std::shared_ptr<BuildCacheEntry>
+makeEntry(size_t BinarySize, const std::vector<std::string> &KernelNames) {
+  auto E = std::make_shared<BuildCacheEntry>();
+  for (size_t i = 0; i < Devices.size(); ++i) {
+    E->Binaries.emplace_back(BinarySize, (unsigned char)i);
+    E->BuildLogs.emplace_back("");
+  }
+  for (const std::string &Name : KernelNames) {
+    clKernelMetadata M{};
+    std::strncpy(M.meta.name, Name.c_str(), MAX_PACKED_STRING_LEN - 1);
+    E->KernelMeta.push_back(M);
+  }
+  return E;
+}
+
+static ProgramBuildCache::Key sourceKey(const std::string &Opts,
+                                        const std::vector<std::string> &Devs) {
+  return ProgramBuildCache::makeKey('C', Source, sizeof(Source), Opts, Devs);
+}
+
+// A build with the same input, options and devices finds the entry.
+void TestHit(ProgramBuildCache &Cache) {
+  ProgramBuildCache::Key K = sourceKey(Options, Devices);
+  TEST_ASSERT(Cache.lookup(K) == nullptr);
+  Cache.insert(K, makeEntry(1024, {"a", "b"}));
+
+  uint64_t Hits = Cache.hits();
+  auto E = Cache.lookup(sourceKey(Options, Devices));
+  TEST_ASSERT(E != nullptr);
+  TEST_ASSERT(Cache.hits() == Hits + 1);
+  TEST_ASSERT(E->Binaries.size() == Devices.size());
+  TEST_ASSERT(E->matchesKernels({"a", "b"}));
+}
+
+// Changing the build options, the devices or the kind of the input gives
+// another key, which misses.
+void TestInvalidation(ProgramBuildCache &Cache) {
+  uint64_t Misses = Cache.misses();
+  TEST_ASSERT(Cache.lookup(sourceKey(Options + " -DX=1", Devices)) == nullptr);
+  TEST_ASSERT(Cache.lookup(sourceKey("", Devices)) == nullptr);
+  TEST_ASSERT(Cache.lookup(sourceKey(Options, {"cpu-0"})) == nullptr);
+  TEST_ASSERT(Cache.lookup(sourceKey(Options, {"cpu-1", "cpu-0"})) ==
+              nullptr);
+  TEST_ASSERT(Cache.lookup(sourceKey(Options, {"cpu-0", "gpu-0"})) ==
+              nullptr);
+  TEST_ASSERT(Cache.lookup(ProgramBuildCache::makeKey(
+                  'S', Source, sizeof(Source), Options, Devices)) == nullptr);
+  // the fields are hashed with their sizes, moving a character from the
+  // options to the device name changes the key
+  TEST_ASSERT(sourceKey("-cl-opt-disable", {"x"}) !=
+              sourceKey("-cl-opt-disabl", {"ex"}));
+  TEST_ASSERT(Cache.misses() == Misses + 6);
+
+  // the original still hits
+  TEST_ASSERT(Cache.lookup(sourceKey(Options, Devices)) != nullptr);
+}
+
+// The kernels recreated from the cached binaries must be the cached ones in
+// the same order, otherwise the entry is rejected and removed.
+void TestKernelMismatch(ProgramBuildCache &Cache) {
+  ProgramBuildCache::Key K = sourceKey(Options, Devices);
+  auto E = Cache.lookup(K);
+  TEST_ASSERT(E != nullptr);
+  TEST_ASSERT(!E->matchesKernels({"b", "a"}));
+  TEST_ASSERT(!E->matchesKernels({"a"}));
+  TEST_ASSERT(!E->matchesKernels({"a", "b", "c"}));
+  TEST_ASSERT(!E->matchesKernels({"a", "bb"}));
+
+  // names longer than the packed metadata are compared up to its length
+  std::string Long(MAX_PACKED_STRING_LEN + 8, 'k');
+  auto LongEntry = makeEntry(16, {Long});
+  TEST_ASSERT(LongEntry->matchesKernels({Long}));
+
+  Cache.remove(K);
+  TEST_ASSERT(Cache.lookup(K) == nullptr);
+  TEST_ASSERT(Cache.bytes() == 0);
+}
+
+// The least recently used entries are evicted to stay within
+// POCLD_BUILD_CACHE_MB, entries larger than it are not cached.
+void TestEviction(ProgramBuildCache &Cache) {
+  const size_t Size = 200 * 1024; // per device, 400 KiB per entry
+  ProgramBuildCache::Key K1 = sourceKey("-D1", Devices);
+  ProgramBuildCache::Key K2 = sourceKey("-D2", Devices);
+  ProgramBuildCache::Key K3 = sourceKey("-D3", Devices);
+  Cache.insert(K1, makeEntry(Size, {"a"}));
+  Cache.insert(K2, makeEntry(Size, {"a"}));
+  // make K1 the most recently used
+  TEST_ASSERT(Cache.lookup(K1) != nullptr);
+
+  uint64_t Evictions = Cache.evictions();
+  Cache.insert(K3, makeEntry(Size, {"a"}));
+  TEST_ASSERT(Cache.evictions() == Evictions + 1);
+  TEST_ASSERT(Cache.lookup(K2) == nullptr);
+  TEST_ASSERT(Cache.lookup(K1) != nullptr);
+  TEST_ASSERT(Cache.lookup(K3) != nullptr);
+  TEST_ASSERT(Cache.bytes() <= (1 << 20));
+
+  ProgramBuildCache::Key Huge = sourceKey("-DHUGE", Devices);
+  Cache.insert(Huge, makeEntry(1 << 20, {"a"}));
+  TEST_ASSERT(Cache.lookup(Huge) == nullptr);
+  TEST_ASSERT(Cache.lookup(K1) != nullptr);
+}
+
+int main() {
+  // read by the cache when it's first used
+  setenv("POCLD_BUILD_CACHE_MB", "1", 1);
+  ProgramBuildCache &Cache = ProgramBuildCache::instance();
+  TEST_ASSERT(Cache.enabled());
+
+  TestHit(Cache);
+  TestInvalidation(Cache);
+  TestKernelMismatch(Cache);
+  TestEviction(Cache);
+
+  std::cout << "OK" << std::endl;
+  return 0;
+}
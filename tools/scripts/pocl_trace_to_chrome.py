@@ -0,0 +1,182 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2026 PoCL developers
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to
+# deal in the Software without restriction, including without limitation the
+# rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+# sell copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+# IN THE SOFTWARE.
+#
+# Converts a trace written by POCL_TRACING=binary to the Chrome trace event
+# JSON format, which can be opened in https://ui.perfetto.dev or
+# chrome://tracing. Each device is shown as a process and each command
+# queue as a thread in it; event dependencies are drawn as flow arrows.
+# The work-group chunks recorded with POCL_CPU_WG_PROFILING=1 are shown
+# on one extra thread per CPU worker.
+#
+# Usage: pocl_trace_to_chrome.py [pocl_trace_events.bin] [output.json]
+#
+# The record layout must match pocl_trace_record in lib/CL/pocl_tracing.c.
+
+import json
+import struct
+import sys
+
+HEADER = struct.Struct("=8sII")
+RECORD = struct.Struct("=3Q4Q2QQ8QIhBB56s")
+MAGIC = b"POCLTRC\0"
+VERSION = 1
+FLAG_DEPS_CONT = 1
+FLAG_WG_CHUNK = 2
+# thread ids of the CPU worker tracks, after the command queues
+WORKER_TID_BASE = 1000000
+
+CL_COMMAND_NDRANGE_KERNEL = 0x11F0
+
+
+def read_events(path):
+    events = {}
+    order = []
+    chunks = []
+    with open(path, "rb") as f:
+        magic, version, record_size = HEADER.unpack(f.read(HEADER.size))
+        if magic != MAGIC:
+            sys.exit("%s is not a PoCL binary trace" % path)
+        if version != VERSION or record_size != RECORD.size:
+            sys.exit("Unsupported trace version %d (record size %d)"
+                     % (version, record_size))
+        while True:
+            data = f.read(RECORD.size)
+            if len(data) < RECORD.size:
+                break
+            r = RECORD.unpack(data)
+            ev_id, cq_id, dev_id = r[0:3]
+            num_deps, flags = r[20], r[21]
+            deps = list(r[10:10 + num_deps])
+            if flags & FLAG_WG_CHUNK:
+                chunks.append({"event": ev_id, "device": dev_id,
+                               "start": r[5], "end": r[6],
+                               "first_wg": r[7], "thread": r[8],
+                               "num_wgs": r[9]})
+                continue
+            if flags & FLAG_DEPS_CONT:
+                if ev_id in events:
+                    events[ev_id]["deps"] += deps
+                continue
+            events[ev_id] = {
+                "id": ev_id,
+                "queue": cq_id,
+                "device": dev_id,
+                "ts": r[3:7],
+                "objs": r[7:9],
+                "size": r[9],
+                "deps": deps,
+                "command_type": r[18],
+                "status": r[19],
+                "name": r[22].split(b"\0", 1)[0].decode(errors="replace"),
+            }
+            order.append(ev_id)
+    return [events[i] for i in order], chunks
+
+
+def convert(events, chunks):
+    valid = [e for e in events if e["ts"][2] and e["ts"][3]]
+    if not valid:
+        return []
+    base = min(e["ts"][0] or e["ts"][2] for e in valid)
+    if chunks:
+        base = min(base, min(c["start"] for c in chunks))
+
+    def us(ns):
+        return (ns - base) / 1000.0
+
+    out = []
+    seen_devices = set()
+    seen_queues = set()
+    by_id = {}
+    for e in valid:
+        by_id[e["id"]] = e
+        if e["device"] not in seen_devices:
+            seen_devices.add(e["device"])
+            out.append({"ph": "M", "name": "process_name", "pid": e["device"],
+                        "args": {"name": "Device %d" % e["device"]}})
+        if (e["device"], e["queue"]) not in seen_queues:
+            seen_queues.add((e["device"], e["queue"]))
+            out.append({"ph": "M", "name": "thread_name", "pid": e["device"],
+                        "tid": e["queue"],
+                        "args": {"name": "Queue %d" % e["queue"]}})
+
+        args = {"event": e["id"], "status": e["status"],
+                "queued_us": us(e["ts"][0]), "submitted_us": us(e["ts"][1])}
+        if e["command_type"] == CL_COMMAND_NDRANGE_KERNEL:
+            args["kernel"] = e["objs"][0]
+        else:
+            if e["objs"][0]:
+                args["src_mem"] = e["objs"][0]
+            if e["objs"][1]:
+                args["dst_mem"] = e["objs"][1]
+        if e["size"]:
+            args["size"] = e["size"]
+        out.append({"ph": "X", "name": e["name"], "cat": "command",
+                    "pid": e["device"], "tid": e["queue"],
+                    "ts": us(e["ts"][2]),
+                    "dur": max(e["ts"][3] - e["ts"][2], 0) / 1000.0,
+                    "args": args})
+
+    seen_workers = set()
+    for c in chunks:
+        tid = WORKER_TID_BASE + c["thread"]
+        if (c["device"], tid) not in seen_workers:
+            seen_workers.add((c["device"], tid))
+            out.append({"ph": "M", "name": "thread_name", "pid": c["device"],
+                        "tid": tid,
+                        "args": {"name": "CPU worker %d" % c["thread"]}})
+        e = by_id.get(c["event"])
+        out.append({"ph": "X", "name": e["name"] if e else "work-groups",
+                    "cat": "wg_chunk", "pid": c["device"], "tid": tid,
+                    "ts": us(c["start"]),
+                    "dur": max(c["end"] - c["start"], 0) / 1000.0,
+                    "args": {"event": c["event"], "first_wg": c["first_wg"],
+                             "num_wgs": c["num_wgs"]}})
+
+    flow_id = 0
+    for e in valid:
+        for dep in e["deps"]:
+            d = by_id.get(dep)
+            if d is None:
+                continue
+            flow_id += 1
+            out.append({"ph": "s", "id": flow_id, "name": "dependency",
+                        "cat": "dependency", "pid": d["device"],
+                        "tid": d["queue"], "ts": us(d["ts"][2])})
+            out.append({"ph": "f", "bp": "e", "id": flow_id,
+                        "name": "dependency", "cat": "dependency",
+                        "pid": e["device"], "tid": e["queue"],
+                        "ts": us(e["ts"][2])})
+    return out
+
+
+def main():
+    src = sys.argv[1] if len(sys.argv) > 1 else "pocl_trace_events.bin"
+    dst = sys.argv[2] if len(sys.argv) > 2 else "pocl_trace_events.json"
+    trace = convert(*read_events(src))
+    with open(dst, "w") as f:
+        json.dump({"traceEvents": trace, "displayTimeUnit": "ns"}, f)
+    print("Wrote %d trace events to %s" % (len(trace), dst))
+
+
+if __name__ == "__main__":
+    main()
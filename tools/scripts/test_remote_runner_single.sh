@@ -59,8 +59,21 @@ fi
 
 sleep 1
 
-export POCL_DEVICES="remote"
+# POCL_REMOTE_TEST_DEVICES client devices (1 by default) connect to the same
+# server device, which lets the multi-device tests migrate between them.
+NUM_DEVICES=${POCL_REMOTE_TEST_DEVICES:-1}
+POCL_DEVICES="remote"
 export POCL_REMOTE0_PARAMETERS="127.0.0.1:$PORT/0"
+for ((I = 1; I < NUM_DEVICES; ++I)); do
+  POCL_DEVICES="$POCL_DEVICES remote"
+  export POCL_REMOTE${I}_PARAMETERS="127.0.0.1:$PORT/0"
+done
+# POCL_REMOTE_TEST_LOCAL_DEVICES (e.g. "cpu") adds local devices after the
+# remote ones, which migrate to and from them through the host memory.
+if [ -n "$POCL_REMOTE_TEST_LOCAL_DEVICES" ]; then
+  POCL_DEVICES="$POCL_DEVICES $POCL_REMOTE_TEST_LOCAL_DEVICES"
+fi
+export POCL_DEVICES
 export POCL_DEBUG="err"
 unset POCL_ENABLE_UNINIT
 